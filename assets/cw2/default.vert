@@ -1,26 +1,142 @@
-#version 430
-
-// Inputs
-layout( location = 0 ) in vec3 iPosition;  // Vertex position
-layout( location = 1 ) in vec3 iColor;     // Vertex color
-layout( location = 2 ) in vec3 iNormal;    // Vertex normal
-layout( location = 3 ) in vec2 iTexCoord; // Texture coordinates
-
-// Uniforms
-layout( location = 0 ) uniform mat4 uModelViewProjection;
-layout( location = 1 ) uniform mat3 uNormalMatrix;
-
-// Outputs
-out vec3 v2fColor;    
-out vec3 v2fNormal;    
-out vec2 v2fTexCoord;
-
-void main() {
-    v2fTexCoord = iTexCoord;
-    v2fNormal = normalize(uNormalMatrix * iNormal);
-    
-    // Transform the input vertex position into clip space
-    gl_Position = uModelViewProjection * vec4(iPosition.xyz, 1.0);
-
-    v2fColor = iColor;
-}
+#version 430
+
+// See objects.frag for the FEATURE_* defines. With FEATURE_INSTANCING, each
+// instance supplies its own model-to-world matrix, and uModelViewProjection
+// holds only the world-to-clip transform. FEATURE_SHADOWS and
+// FEATURE_POINT_LIGHTS additionally need the world space position; without
+// instancing, the model-to-world matrix is passed in uModel.
+//
+// FEATURE_QUANTIZED takes the compact attributes of QuantizedVertices
+// (vertex_quant.hpp): positions and texture coordinates normalized to the
+// mesh's bounds, octahedral normals and sRGB colors. They are decoded first;
+// everything after that is the same as for float attributes.
+
+#if defined(FEATURE_SHADOWS) || defined(FEATURE_POINT_LIGHTS)
+#	define NEED_WORLD_POSITION 1
+#endif
+
+// Inputs
+layout( location = 0 ) in vec3 iPosition;  // Vertex position
+#if defined(FEATURE_VERTEX_COLOR)
+layout( location = 1 ) in vec3 iColor;     // Vertex color
+#endif
+#if defined(FEATURE_LIGHTING) && defined(FEATURE_QUANTIZED)
+layout( location = 2 ) in vec2 iNormal;    // Vertex normal, octahedral
+#elif defined(FEATURE_LIGHTING)
+layout( location = 2 ) in vec3 iNormal;    // Vertex normal
+#endif
+#if defined(FEATURE_TEXTURE)
+layout( location = 3 ) in vec2 iTexCoord; // Texture coordinates
+#endif
+#if defined(FEATURE_INSTANCING)
+layout( location = 4 ) in mat4 iInstanceModel; // Per instance; uses locations 4-7
+#endif
+
+// Uniforms
+layout( location = 0 ) uniform mat4 uModelViewProjection;
+#if defined(FEATURE_LIGHTING) && !defined(FEATURE_INSTANCING)
+layout( location = 1 ) uniform mat3 uNormalMatrix;
+#endif
+#if defined(NEED_WORLD_POSITION) && !defined(FEATURE_INSTANCING)
+layout( location = 6 ) uniform mat4 uModel;
+#endif
+#if defined(FEATURE_QUANTIZED)
+layout( location = 24 ) uniform vec3 uPositionOffset; // VertexDecode
+layout( location = 25 ) uniform vec3 uPositionScale;
+#	if defined(FEATURE_TEXTURE)
+layout( location = 26 ) uniform vec4 uTexCoordDecode; // offset.xy, scale.xy
+#	endif
+#endif
+
+// Outputs
+#if defined(FEATURE_VERTEX_COLOR)
+out vec3 v2fColor;    
+#endif
+#if defined(FEATURE_LIGHTING)
+out vec3 v2fNormal;    
+#endif
+#if defined(FEATURE_TEXTURE)
+out vec2 v2fTexCoord;
+#endif
+#if defined(NEED_WORLD_POSITION)
+out vec3 v2fWorldPosition;
+#endif
+
+// The depth prepass draws with the featureless variant, and the main pass
+// then tests against those depths with GL_LEQUAL. Both variants must
+// compute bit-identical positions for that.
+invariant gl_Position;
+
+#if defined(FEATURE_QUANTIZED)
+vec3 decode_octahedral( vec2 aEncoded )
+{
+    vec3 n = vec3( aEncoded, 1.0 - abs(aEncoded.x) - abs(aEncoded.y) );
+    if( n.z < 0.0 )
+        n.xy = (1.0 - abs(n.yx)) * mix( vec2(-1.0), vec2(1.0), greaterThanEqual( n.xy, vec2(0.0) ) );
+    return normalize( n );
+}
+
+vec3 srgb_to_linear( vec3 aColor )
+{
+    return mix( aColor / 12.92, pow( (aColor + 0.055) / 1.055, vec3(2.4) ), greaterThan( aColor, vec3(0.04045) ) );
+}
+#endif
+
+void main() {
+#	if defined(FEATURE_QUANTIZED)
+    vec3 position = uPositionOffset + uPositionScale * iPosition;
+#		if defined(FEATURE_LIGHTING)
+    vec3 normal = decode_octahedral( iNormal );
+#		endif
+#		if defined(FEATURE_VERTEX_COLOR)
+    vec3 color = srgb_to_linear( iColor );
+#		endif
+#		if defined(FEATURE_TEXTURE)
+    vec2 texCoord = uTexCoordDecode.xy + uTexCoordDecode.zw * iTexCoord;
+#		endif
+#	else
+    vec3 position = iPosition;
+#		if defined(FEATURE_LIGHTING)
+    vec3 normal = iNormal;
+#		endif
+#		if defined(FEATURE_VERTEX_COLOR)
+    vec3 color = iColor;
+#		endif
+#		if defined(FEATURE_TEXTURE)
+    vec2 texCoord = iTexCoord;
+#		endif
+#	endif
+
+#	if defined(FEATURE_TEXTURE)
+    v2fTexCoord = texCoord;
+#	endif
+
+#	if defined(FEATURE_INSTANCING)
+#		if defined(FEATURE_LIGHTING)
+    // Instances use rotations and uniform scales only, so the upper 3x3 part
+    // of the model matrix is fine for the normals.
+    v2fNormal = normalize(mat3(iInstanceModel) * normal);
+#		endif
+
+    gl_Position = uModelViewProjection * (iInstanceModel * vec4(position, 1.0));
+
+#		if defined(NEED_WORLD_POSITION)
+    v2fWorldPosition = (iInstanceModel * vec4(position, 1.0)).xyz;
+#		endif
+#	else
+#		if defined(FEATURE_LIGHTING)
+    v2fNormal = normalize(uNormalMatrix * normal);
+#		endif
+    
+    // Transform the input vertex position into clip space
+    gl_Position = uModelViewProjection * vec4(position, 1.0);
+
+#		if defined(NEED_WORLD_POSITION)
+    v2fWorldPosition = (uModel * vec4(position, 1.0)).xyz;
+#		endif
+#	endif
+
+#	if defined(FEATURE_VERTEX_COLOR)
+    v2fColor = color;
+#	endif
+}
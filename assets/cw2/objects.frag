@@ -0,0 +1,160 @@
+#version 430
+
+// Uber-shader for all opaque objects. Variants are selected at compile time
+// with the following defines (see EShaderFeature in render_model.hpp):
+//
+//  FEATURE_TEXTURE       - modulate by texture uTexture2D
+//  FEATURE_VERTEX_COLOR  - use the interpolated vertex color (otherwise:
+//                          uBaseColor)
+//  FEATURE_LIGHTING      - Lambertian diffuse + ambient (otherwise: unlit)
+//  FEATURE_SHADOWS       - cascaded shadow maps for the light (requires
+//                          FEATURE_LIGHTING; see shadow_maps.hpp)
+//  FEATURE_POINT_LIGHTS  - clustered point lights (requires FEATURE_LIGHTING;
+//                          see light_clusters.hpp)
+//
+// FEATURE_INSTANCING and FEATURE_QUANTIZED only affect the vertex shader.
+
+// Inputs
+#if defined(FEATURE_VERTEX_COLOR)
+in vec3 v2fColor;     // Interpolated vertex color
+#endif
+#if defined(FEATURE_LIGHTING)
+in vec3 v2fNormal;    // Interpolated normal vector
+#endif
+#if defined(FEATURE_TEXTURE)
+in vec2 v2fTexCoord;  // Interpolated texture coordinates
+
+layout( binding = 0 ) uniform sampler2D uTexture2D;
+#endif
+
+// Uniforms
+#if defined(FEATURE_LIGHTING)
+layout( location = 2 ) uniform vec3 uLightDir; // light direction
+layout( location = 3 ) uniform vec3 uLightDiffuse;
+layout( location = 4 ) uniform vec3 uSceneAmbient;
+#endif
+#if !defined(FEATURE_VERTEX_COLOR)
+layout( location = 5 ) uniform vec3 uBaseColor = vec3( 1.0 );
+#endif
+#if defined(FEATURE_SHADOWS) || defined(FEATURE_POINT_LIGHTS)
+in vec3 v2fWorldPosition;
+#endif
+#if defined(FEATURE_SHADOWS)
+const int kMaxCascades = 4; // kMaxShadowCascades
+
+layout( binding = 1 ) uniform sampler2DArrayShadow uShadowMap;
+
+layout( location = 8 ) uniform mat4 uShadowMatrices[kMaxCascades]; // world to light clip space
+layout( location = 12 ) uniform float uCascadeSplits[kMaxCascades]; // view depth at which a cascade ends
+layout( location = 16 ) uniform int uCascadeCount;
+layout( location = 17 ) uniform float uShadowNormalOffsets[kMaxCascades]; // world units
+#endif
+#if defined(FEATURE_POINT_LIGHTS)
+struct PointLight
+{
+	vec3 position;
+	float radius;
+	vec3 color;
+	float intensity;
+};
+
+layout( std430, binding = 2 ) readonly buffer PointLights { PointLight uPointLights[]; };
+layout( std430, binding = 3 ) readonly buffer LightClusters { uvec2 uLightClusters[]; }; // offset, count
+layout( std430, binding = 4 ) readonly buffer LightIndices { uint uLightIndices[]; };
+
+layout( location = 21 ) uniform uvec3 uClusterGrid;
+layout( location = 22 ) uniform vec2 uClusterSlices; // slice = log(depth) * x + y
+layout( location = 23 ) uniform vec2 uClusterTileSize; // pixels
+#endif
+
+// Outputs
+out vec4 oColor;
+
+#if defined(FEATURE_SHADOWS)
+// Fraction of the light that reaches the fragment.
+float shadow( vec3 aNormal )
+{
+	// For perspective projections, clip space w is the view depth.
+	float depth = 1.0 / gl_FragCoord.w;
+
+	int cascade = 0;
+	while( cascade < uCascadeCount && depth > uCascadeSplits[cascade] )
+		++cascade;
+
+	if( cascade == uCascadeCount )
+		return 1.0; // beyond the last cascade
+
+	vec3 position = v2fWorldPosition + aNormal * uShadowNormalOffsets[cascade];
+	vec4 light = uShadowMatrices[cascade] * vec4( position, 1.0 );
+	vec3 coord = light.xyz * 0.5 + 0.5;
+
+	// 3x3 PCF. Each lookup already filters 2x2 texels.
+	vec2 texel = 1.0 / vec2( textureSize( uShadowMap, 0 ).xy );
+
+	float lit = 0.0;
+	for( int y = -1; y <= 1; ++y )
+	{
+		for( int x = -1; x <= 1; ++x )
+			lit += texture( uShadowMap, vec4( coord.xy + vec2( x, y ) * texel, float(cascade), coord.z ) );
+	}
+
+	return lit / 9.0;
+}
+#endif
+
+#if defined(FEATURE_POINT_LIGHTS)
+// Diffuse light from the point lights of the fragment's cluster.
+vec3 point_lights( vec3 aNormal )
+{
+	float depth = 1.0 / gl_FragCoord.w;
+
+	uvec2 tile = min( uvec2( gl_FragCoord.xy / uClusterTileSize ), uClusterGrid.xy - 1u );
+	float slice = clamp( log( depth ) * uClusterSlices.x + uClusterSlices.y, 0.0, float(uClusterGrid.z - 1u) );
+	uvec2 cluster = uLightClusters[(uint(slice) * uClusterGrid.y + tile.y) * uClusterGrid.x + tile.x];
+
+	vec3 sum = vec3( 0.0 );
+	for( uint i = 0u; i < cluster.y; ++i )
+	{
+		PointLight light = uPointLights[uLightIndices[cluster.x + i]];
+
+		vec3 toLight = light.position - v2fWorldPosition;
+		float d2 = dot( toLight, toLight );
+
+		// Smooth falloff that reaches zero at the radius
+		float falloff = clamp( 1.0 - d2 / (light.radius * light.radius), 0.0, 1.0 );
+		float nDotL = max( 0.0, dot( aNormal, toLight * inversesqrt( max( d2, 1e-8 ) ) ) );
+
+		sum += light.color * (light.intensity * falloff * falloff * nDotL);
+	}
+
+	return sum;
+}
+#endif
+
+void main() 
+{
+#	if defined(FEATURE_VERTEX_COLOR)
+	vec3 color = v2fColor;
+#	else
+	vec3 color = uBaseColor;
+#	endif
+
+#	if defined(FEATURE_LIGHTING)
+	vec3 normal = normalize(v2fNormal);
+	float nDotL = max( 0.0, dot( normal, uLightDir ) );
+#		if defined(FEATURE_SHADOWS)
+	nDotL *= shadow( normal );
+#		endif
+	vec3 light = uSceneAmbient + nDotL * uLightDiffuse;
+#		if defined(FEATURE_POINT_LIGHTS)
+	light += point_lights( normal );
+#		endif
+	color *= light;
+#	endif
+
+#	if defined(FEATURE_TEXTURE)
+	color *= texture( uTexture2D, v2fTexCoord ).rgb;
+#	endif
+
+	oColor = vec4(color, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 430
+
+// Round, soft sprites. The color goes from hot (white/yellow) at the nozzle
+// to orange, and then to grey smoke that fades out. Drawn with additive
+// blending.
+
+// Inputs
+in float v2fAge;
+
+// Outputs
+out vec4 oColor;
+
+void main()
+{
+	vec2 d = gl_PointCoord * 2.0 - 1.0;
+	float r2 = dot( d, d );
+	if( r2 > 1.0 )
+		discard;
+
+	const vec3 hot = vec3( 1.0, 0.9, 0.6 );
+	const vec3 warm = vec3( 1.0, 0.4, 0.1 );
+	const vec3 smoke = vec3( 0.3 );
+
+	vec3 color = v2fAge < 0.3
+		? mix( hot, warm, v2fAge / 0.3 )
+		: mix( warm, smoke, (v2fAge - 0.3) / 0.7 );
+
+	float alpha = (1.0 - r2) * (1.0 - v2fAge) * 0.5;
+	oColor = vec4( color, alpha );
+}
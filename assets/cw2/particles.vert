@@ -0,0 +1,35 @@
+#version 430
+
+// Particles as point sprites. The vertex data is the particle position and
+// age, either straight from the simulation buffer (particles.comp) or
+// written by the CPU (write_particle_vertices()).
+
+// Input data
+layout( location = 0 ) in vec4 iPositionAge;
+
+// Uniforms
+layout( location = 0 ) uniform mat4 uViewProjection;
+layout( location = 1 ) uniform float uLifetime;
+layout( location = 2 ) uniform float uPointScale; // pixels per unit at distance 1
+layout( location = 3 ) uniform float uSize;
+
+// Outputs
+out float v2fAge; // relative to the lifetime: [0, 1)
+
+void main()
+{
+	v2fAge = iPositionAge.w / uLifetime;
+
+	if( v2fAge >= 1.0 )
+	{
+		// Dead particle: place it outside of the clip volume.
+		gl_Position = vec4( 2.0, 2.0, 2.0, 1.0 );
+		gl_PointSize = 1.0;
+		return;
+	}
+
+	gl_Position = uViewProjection * vec4( iPositionAge.xyz, 1.0 );
+
+	// The exhaust expands as it cools down.
+	gl_PointSize = uPointScale * uSize * (0.5 + 1.5 * v2fAge) / gl_Position.w;
+}
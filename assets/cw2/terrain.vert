@@ -0,0 +1,92 @@
+#version 430
+
+// CDLOD terrain (see terrain.hpp, terrain_renderer.hpp); used with
+// objects.frag. Each instance is a patch: a grid of uGrid quads over
+// [x, x+size] x [z, z+size]. The grid vertices are displaced by the height
+// texture, whose texels are the heightfield's samples.
+//
+// Over the last part of its level's range (uMorph), a vertex moves onto the
+// grid of the next coarser level: odd grid coordinates slide towards their
+// even neighbours. At the end of the range, the patch is thus identical to
+// its coarser neighbour's, so the levels meet without cracks.
+//
+// Only FEATURE_TEXTURE, FEATURE_LIGHTING, FEATURE_SHADOWS and
+// FEATURE_POINT_LIGHTS are supported.
+
+#if defined(FEATURE_SHADOWS) || defined(FEATURE_POINT_LIGHTS)
+#	define NEED_WORLD_POSITION 1
+#endif
+
+const int kMaxLevels = 16; // CdlodTree::kMaxLevels
+
+// Inputs
+layout( location = 0 ) in vec2 iGrid;  // grid coordinates, 0..uGrid
+layout( location = 1 ) in vec4 iPatch; // per instance: x, z, size, level
+
+// Uniforms
+layout( location = 0 ) uniform mat4 uViewProjection;
+layout( location = 27 ) uniform vec3 uCamera;
+layout( location = 28 ) uniform vec3 uHeightfield; // origin.xz, spacing
+layout( location = 29 ) uniform vec4 uExtent; // size.xz, 1 / samples.xz
+layout( location = 30 ) uniform vec3 uTexCoordU; // u = dot( uTexCoordU, vec3( x, z, 1 ) )
+layout( location = 31 ) uniform vec3 uTexCoordV;
+layout( location = 32 ) uniform float uGrid;
+layout( location = 33 ) uniform vec2 uMorph[kMaxLevels]; // start, end (view distance)
+
+layout( binding = 5 ) uniform sampler2D uHeights;
+
+// Outputs
+#if defined(FEATURE_LIGHTING)
+out vec3 v2fNormal;
+#endif
+#if defined(FEATURE_TEXTURE)
+out vec2 v2fTexCoord;
+#endif
+#if defined(NEED_WORLD_POSITION)
+out vec3 v2fWorldPosition;
+#endif
+
+// Positions outside of the heightfield are clamped to its edge.
+vec2 world_xz( vec2 aGrid )
+{
+    vec2 xz = iPatch.xy + aGrid * (iPatch.z / uGrid);
+    return clamp( xz, uHeightfield.xy, uHeightfield.xy + uExtent.xy );
+}
+
+float height( vec2 aXZ )
+{
+    vec2 uv = ((aXZ - uHeightfield.xy) / uHeightfield.z + 0.5) * uExtent.zw;
+    return textureLod( uHeights, uv, 0.0 ).r;
+}
+
+void main()
+{
+    // The morph factor depends on the unmorphed position's distance.
+    vec2 xz = world_xz( iGrid );
+    float dist = distance( vec3( xz.x, height( xz ), xz.y ), uCamera );
+
+    vec2 morph = uMorph[int(iPatch.w)];
+    float k = clamp( (dist - morph.x) / (morph.y - morph.x), 0.0, 1.0 );
+
+    vec2 grid = iGrid - fract( iGrid * 0.5 ) * 2.0 * k;
+    xz = world_xz( grid );
+    vec3 position = vec3( xz.x, height( xz ), xz.y );
+
+#	if defined(FEATURE_LIGHTING)
+    // Central differences, one sample apart
+    float d = uHeightfield.z;
+    float dx = height( xz + vec2( d, 0.0 ) ) - height( xz - vec2( d, 0.0 ) );
+    float dz = height( xz + vec2( 0.0, d ) ) - height( xz - vec2( 0.0, d ) );
+    v2fNormal = normalize( vec3( -dx, 2.0 * d, -dz ) );
+#	endif
+
+#	if defined(FEATURE_TEXTURE)
+    v2fTexCoord = vec2( dot( uTexCoordU, vec3( xz, 1.0 ) ), dot( uTexCoordV, vec3( xz, 1.0 ) ) );
+#	endif
+
+#	if defined(NEED_WORLD_POSITION)
+    v2fWorldPosition = position;
+#	endif
+
+    gl_Position = uViewProjection * vec4( position, 1.0 );
+}
@@ -0,0 +1,23 @@
+#version 430
+
+// The glyph atlas stores coverage in the red channel. Rectangles sample
+// fully covered (white) texels.
+//
+// Colors are given in sRGB, but the framebuffer expects linear values (it
+// converts them on write), so they are linearized first.
+
+// Inputs
+in vec2 v2fTexCoord;
+in vec4 v2fColor;
+
+// Uniforms
+layout( binding = 0 ) uniform sampler2D uAtlas;
+
+// Outputs
+out vec4 oColor;
+
+void main()
+{
+	vec3 linear = pow( v2fColor.rgb, vec3( 2.2 ) );
+	oColor = vec4( linear, v2fColor.a * texture( uAtlas, v2fTexCoord ).r );
+}
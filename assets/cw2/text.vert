@@ -0,0 +1,25 @@
+#version 430
+
+// Screen-space text and rectangles (TextRenderer). Positions are in pixels,
+// with the origin in the top left corner.
+
+// Input data
+layout( location = 0 ) in vec2 iPosition;
+layout( location = 1 ) in vec2 iTexCoord;
+layout( location = 2 ) in vec4 iColor;
+
+// Uniforms
+layout( location = 0 ) uniform vec2 uViewportSize;
+
+// Outputs
+out vec2 v2fTexCoord;
+out vec4 v2fColor;
+
+void main()
+{
+	vec2 ndc = iPosition / uViewportSize * 2.0 - 1.0;
+	gl_Position = vec4( ndc.x, -ndc.y, 0.0, 1.0 );
+
+	v2fTexCoord = iTexCoord;
+	v2fColor = iColor;
+}
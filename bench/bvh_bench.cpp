@@ -0,0 +1,727 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "../main/bvh.hpp"
+#include "../main/particles.hpp" // particle_hash()
+
+namespace
+{
+	struct Random_
+	{
+		std::uint32_t state;
+
+		float operator()( float aMin, float aMax ) noexcept
+		{
+			state = particle_hash( state );
+			return aMin + (aMax - aMin) * float(state >> 8) / float(1u << 24);
+		}
+	};
+
+	// Small triangles scattered in a box, of varying size
+	std::vector<Vec3f> make_soup_( std::size_t aCount, Random_& aRandom )
+	{
+		std::vector<Vec3f> ret;
+		for( std::size_t i = 0; i < aCount; ++i )
+		{
+			Vec3f const c{ aRandom( -10.f, 10.f ), aRandom( -10.f, 10.f ), aRandom( -10.f, 10.f ) };
+			float const size = aRandom( 0.1f, 1.5f );
+			for( int j = 0; j < 3; ++j )
+				ret.emplace_back( c + size * Vec3f{ aRandom( -1.f, 1.f ), aRandom( -1.f, 1.f ), aRandom( -1.f, 1.f ) } );
+		}
+		return ret;
+	}
+
+	Ray make_ray_( Random_& aRandom )
+	{
+		Vec3f const origin{ aRandom( -15.f, 15.f ), aRandom( -15.f, 15.f ), aRandom( -15.f, 15.f ) };
+		Vec3f const target{ aRandom( -8.f, 8.f ), aRandom( -8.f, 8.f ), aRandom( -8.f, 8.f ) };
+		return Ray{ origin, normalize( target - origin ) };
+	}
+
+	// Reference: every triangle, in double precision
+	RayHit brute_force_( std::vector<Vec3f> const& aSoup, Ray const& aRay )
+	{
+		RayHit ret;
+		for( std::size_t i = 0; i < aSoup.size() / 3; ++i )
+		{
+			auto const sub = [] (Vec3f aA, Vec3f aB) { return std::array<double,3>{ double(aA.x)-aB.x, double(aA.y)-aB.y, double(aA.z)-aB.z }; };
+			auto const crs = [] (std::array<double,3> aA, std::array<double,3> aB) { return std::array<double,3>{ aA[1]*aB[2]-aA[2]*aB[1], aA[2]*aB[0]-aA[0]*aB[2], aA[0]*aB[1]-aA[1]*aB[0] }; };
+			auto const dt = [] (std::array<double,3> aA, std::array<double,3> aB) { return aA[0]*aB[0] + aA[1]*aB[1] + aA[2]*aB[2]; };
+
+			auto const e1 = sub( aSoup[3*i+1], aSoup[3*i] ), e2 = sub( aSoup[3*i+2], aSoup[3*i] );
+			std::array<double,3> const d{ aRay.direction.x, aRay.direction.y, aRay.direction.z };
+			auto const s = sub( aRay.origin, aSoup[3*i] );
+
+			auto const p = crs( d, e2 );
+			double const det = dt( e1, p );
+			if( 0.0 == det )
+				continue;
+
+			double const u = dt( s, p ) / det;
+			auto const q = crs( s, e1 );
+			double const v = dt( d, q ) / det;
+			double const t = dt( e2, q ) / det;
+			if( u >= 0.0 && v >= 0.0 && u + v <= 1.0 && t >= aRay.tMin && t <= aRay.tMax && t < ret.t )
+				ret = RayHit{ float(t), std::uint32_t(i), float(u), float(v) };
+		}
+		return ret;
+	}
+
+	// Reference: closest point via the triangle's plane and its edges
+	float distance_sq_( Vec3f aP, Vec3f const* aTri )
+	{
+		Vec3f const n = normalize( cross( aTri[1] - aTri[0], aTri[2] - aTri[0] ) );
+		Vec3f const q = aP - n * dot( aP - aTri[0], n );
+
+		bool inside = true;
+		for( int i = 0; i < 3; ++i )
+			inside = inside && dot( cross( aTri[(i+1)%3] - aTri[i], q - aTri[i] ), n ) >= 0.f;
+		if( inside )
+			return dot( aP - q, aP - q );
+
+		float best = std::numeric_limits<float>::infinity();
+		for( int i = 0; i < 3; ++i )
+		{
+			Vec3f const a = aTri[i], e = aTri[(i+1)%3] - a;
+			float const s = std::clamp( dot( aP - a, e ) / dot( e, e ), 0.f, 1.f );
+			Vec3f const d = aP - (a + e * s);
+			best = std::min( best, dot( d, d ) );
+		}
+		return best;
+	}
+
+	// Reference: clip the triangle to the box, one plane at a time
+	bool overlaps_box_( Vec3f const* aTri, Vec3f aMin, Vec3f aMax )
+	{
+		std::vector<Vec3f> poly( aTri, aTri+3 );
+		for( std::size_t axis = 0; axis < 3 && !poly.empty(); ++axis )
+		{
+			for( float const sign : { 1.f, -1.f } )
+			{
+				float const bound = sign > 0.f ? aMin[axis] : aMax[axis];
+				std::vector<Vec3f> out;
+				for( std::size_t i = 0; i < poly.size(); ++i )
+				{
+					Vec3f const a = poly[i], b = poly[(i+1) % poly.size()];
+					float const da = sign * (a[axis] - bound), db = sign * (b[axis] - bound);
+					if( da >= 0.f )
+						out.emplace_back( a );
+					if( (da >= 0.f) != (db >= 0.f) )
+						out.emplace_back( a + (b - a) * (da / (da - db)) );
+				}
+				poly = std::move( out );
+			}
+		}
+		return !poly.empty();
+	}
+
+	Vec3f transform_( Mat44f const& aM, Vec3f aP )
+	{
+		Vec4f const p = aM * Vec4f{ aP.x, aP.y, aP.z, 1.f };
+		return { p.x, p.y, p.z };
+	}
+
+	// A few meshes, instanced with rotations, non-uniform scales and
+	// translations. The reference is the same scene as one world-space soup.
+	struct TestScene_
+	{
+		std::vector<std::vector<Vec3f>> meshes;
+		std::vector<std::uint32_t> instanceMesh;
+		std::vector<Mat44f> transforms;
+
+		SceneBvh bvh;
+		std::vector<Vec3f> world;
+		std::vector<std::uint32_t> worldInstance; // per triangle
+		std::vector<std::uint32_t> worldTriangle;
+
+		void bake()
+		{
+			world.clear();
+			worldInstance.clear();
+			worldTriangle.clear();
+			for( std::size_t i = 0; i < transforms.size(); ++i )
+			{
+				auto const& mesh = meshes[instanceMesh[i]];
+				for( std::size_t j = 0; j < mesh.size(); ++j )
+				{
+					world.emplace_back( transform_( transforms[i], mesh[j] ) );
+					if( 0 == j % 3 )
+					{
+						worldInstance.emplace_back( std::uint32_t(i) );
+						worldTriangle.emplace_back( std::uint32_t(j / 3) );
+					}
+				}
+			}
+		}
+	};
+
+	Mat44f make_transform_( Random_& aRandom, float aSpread )
+	{
+		return make_translation( { aRandom( -aSpread, aSpread ), aRandom( -aSpread, aSpread ), aRandom( -aSpread, aSpread ) } )
+			* make_rotation_y( aRandom( 0.f, 6.3f ) ) * make_rotation_x( aRandom( 0.f, 6.3f ) )
+			* make_scaling( aRandom( 0.2f, 1.5f ), aRandom( 0.2f, 1.5f ), aRandom( 0.2f, 1.5f ) );
+	}
+
+	TestScene_ make_test_scene_( Random_& aRandom, std::size_t aInstances, std::size_t aTriangles )
+	{
+		TestScene_ ret;
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			ret.meshes.emplace_back( make_soup_( aTriangles, aRandom ) );
+			ret.bvh.add_mesh( ret.meshes.back().data(), aTriangles );
+		}
+
+		for( std::size_t i = 0; i < aInstances; ++i )
+		{
+			ret.instanceMesh.emplace_back( std::uint32_t(i % 3) );
+			ret.transforms.emplace_back( make_transform_( aRandom, 40.f ) );
+			ret.bvh.add_instance( std::uint32_t(i % 3), ret.transforms.back(), 1u << (i % 2) );
+		}
+
+		ret.bvh.build();
+		ret.bake();
+		return ret;
+	}
+}
+
+TEST_CASE( "BVH closest hits", "[bvh]" )
+{
+	Random_ random{ 1 };
+	auto const soup = make_soup_( 3000, random );
+	TriangleBvh const bvh( soup.data(), soup.size() / 3 );
+
+	REQUIRE( bvh.triangle_count() == 3000 );
+
+	SECTION( "nodes bound their triangles" )
+	{
+		auto const& nodes = bvh.nodes();
+		REQUIRE( nodes.size() <= 2*3000 - 1 );
+
+		std::size_t leafTriangles = 0;
+		for( auto const& node : nodes )
+		{
+			if( 0 == node.count )
+			{
+				for( auto const& child : { nodes[node.first], nodes[node.first+1] } )
+				{
+					REQUIRE( child.min.x >= node.min.x );
+					REQUIRE( child.min.y >= node.min.y );
+					REQUIRE( child.min.z >= node.min.z );
+					REQUIRE( child.max.x <= node.max.x );
+					REQUIRE( child.max.y <= node.max.y );
+					REQUIRE( child.max.z <= node.max.z );
+				}
+			}
+			leafTriangles += node.count;
+		}
+		REQUIRE( leafTriangles == 3000 );
+	}
+
+	SECTION( "single rays" )
+	{
+		std::size_t hits = 0;
+		for( int i = 0; i < 2000; ++i )
+		{
+			Ray ray = make_ray_( random );
+			if( i % 2 )
+				ray.tMax = random( 5.f, 25.f );
+
+			RayHit const expected = brute_force_( soup, ray );
+
+			RayHit hit;
+			bool const found = bvh.intersect( ray, hit );
+			REQUIRE( found == (kNoTriangle != expected.triangle) );
+			REQUIRE( bvh.occluded( ray ) == found );
+
+			if( found )
+			{
+				REQUIRE( hit.triangle == expected.triangle );
+				REQUIRE( hit.t == Catch::Approx( expected.t ).epsilon( 1e-4 ) );
+				REQUIRE( hit.u == Catch::Approx( expected.u ).margin( 1e-4 ) );
+				REQUIRE( hit.v == Catch::Approx( expected.v ).margin( 1e-4 ) );
+				++hits;
+			}
+		}
+
+		// Make sure that the test exercises both cases.
+		REQUIRE( hits > 200 );
+		REQUIRE( hits < 1800 );
+	}
+
+	SECTION( "packets match single rays" )
+	{
+		for( int i = 0; i < 200; ++i )
+		{
+			// Rays from a common origin into a narrow cone, like camera rays
+			Ray const center = make_ray_( random );
+
+			RayPacket packet;
+			Ray rays[RayPacket::kSize];
+			for( std::size_t j = 0; j < RayPacket::kSize; ++j )
+			{
+				Vec3f const jitter{ random( -0.05f, 0.05f ), random( -0.05f, 0.05f ), random( -0.05f, 0.05f ) };
+				rays[j] = Ray{ center.origin, center.direction + jitter, 0.f, 40.f };
+				if( j == std::size_t(i) % RayPacket::kSize )
+					rays[j].tMax = -1.f; // inactive
+
+				packet.ox[j] = rays[j].origin.x; packet.oy[j] = rays[j].origin.y; packet.oz[j] = rays[j].origin.z;
+				packet.dx[j] = rays[j].direction.x; packet.dy[j] = rays[j].direction.y; packet.dz[j] = rays[j].direction.z;
+				packet.tMin[j] = rays[j].tMin;
+				packet.tMax[j] = rays[j].tMax;
+			}
+
+			bvh.intersect( packet );
+
+			for( std::size_t j = 0; j < RayPacket::kSize; ++j )
+			{
+				RayHit hit;
+				bvh.intersect( rays[j], hit );
+				REQUIRE( packet.triangle[j] == hit.triangle );
+				if( kNoTriangle != hit.triangle )
+				{
+					// Same intersection code, so the same distance
+					REQUIRE( packet.t[j] == hit.t );
+					REQUIRE( packet.u[j] == hit.u );
+					REQUIRE( packet.v[j] == hit.v );
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE( "BVH degenerate input", "[bvh]" )
+{
+	SECTION( "empty" )
+	{
+		TriangleBvh const bvh;
+		RayHit hit;
+		REQUIRE( !bvh.intersect( Ray{ { 0.f, 0.f, 0.f }, { 0.f, 0.f, -1.f } }, hit ) );
+		REQUIRE( !bvh.occluded( Ray{ { 0.f, 0.f, 0.f }, { 0.f, 0.f, -1.f } } ) );
+	}
+
+	SECTION( "coincident triangles" )
+	{
+		// All centroids coincide, so no split plane separates them.
+		std::vector<Vec3f> soup;
+		for( int i = 0; i < 100; ++i )
+			soup.insert( soup.end(), { { -1.f, -1.f, -2.f }, { 1.f, -1.f, -2.f }, { 0.f, 2.f, -2.f } } );
+
+		TriangleBvh const bvh( soup.data(), soup.size() / 3 );
+		REQUIRE( bvh.nodes().size() > 1 );
+
+		RayHit hit;
+		REQUIRE( bvh.intersect( Ray{ { 0.f, 0.f, 0.f }, { 0.f, 0.f, -1.f } }, hit ) );
+		REQUIRE( hit.t == Catch::Approx( 2.f ) );
+	}
+}
+
+TEST_CASE( "BVH overlaps", "[bvh]" )
+{
+	Random_ random{ 5 };
+	auto const soup = make_soup_( 3000, random );
+	TriangleBvh const bvh( soup.data(), soup.size() / 3 );
+
+	// Volumes within a small margin of a triangle may go either way.
+	constexpr float kMargin = 1e-3f;
+
+	SECTION( "spheres" )
+	{
+		std::size_t hits = 0;
+		for( int i = 0; i < 500; ++i )
+		{
+			Vec3f const center{ random( -12.f, 12.f ), random( -12.f, 12.f ), random( -12.f, 12.f ) };
+			float const radius = random( 0.01f, 1.5f );
+
+			float closest = std::numeric_limits<float>::infinity();
+			for( std::size_t j = 0; j < soup.size(); j += 3 )
+				closest = std::min( closest, std::sqrt( distance_sq_( center, &soup[j] ) ) );
+
+			if( std::abs( closest - radius ) < kMargin )
+				continue;
+
+			REQUIRE( bvh.overlaps_sphere( center, radius ) == (closest < radius) );
+			hits += closest < radius;
+		}
+
+		REQUIRE( hits > 50 );
+		REQUIRE( hits < 450 );
+	}
+
+	SECTION( "boxes" )
+	{
+		std::size_t hits = 0;
+		for( int i = 0; i < 500; ++i )
+		{
+			Vec3f const center{ random( -12.f, 12.f ), random( -12.f, 12.f ), random( -12.f, 12.f ) };
+			Vec3f const half{ random( 0.01f, 1.5f ), random( 0.01f, 1.5f ), random( 0.01f, 1.5f ) };
+			Vec3f const margin{ kMargin, kMargin, kMargin };
+
+			bool inner = false, outer = false;
+			for( std::size_t j = 0; j < soup.size(); j += 3 )
+			{
+				inner = inner || overlaps_box_( &soup[j], center - half + margin, center + half - margin );
+				outer = outer || overlaps_box_( &soup[j], center - half - margin, center + half + margin );
+			}
+
+			bool const overlaps = bvh.overlaps_box( center - half, center + half );
+			if( inner )
+			{
+				REQUIRE( overlaps );
+			}
+			if( !outer )
+			{
+				REQUIRE( !overlaps );
+			}
+			hits += overlaps;
+		}
+
+		REQUIRE( hits > 50 );
+		REQUIRE( hits < 450 );
+	}
+}
+
+TEST_CASE( "Scene BVH", "[bvh]" )
+{
+	Random_ random{ 11 };
+	auto scene = make_test_scene_( random, 40, 300 );
+
+	REQUIRE( scene.bvh.instance_count() == 40 );
+	REQUIRE( scene.bvh.mesh_count() == 3 );
+
+	auto const make_scene_ray = [&] {
+		Vec3f const origin{ random( -60.f, 60.f ), random( -60.f, 60.f ), random( -60.f, 60.f ) };
+		Vec3f const target{ random( -40.f, 40.f ), random( -40.f, 40.f ), random( -40.f, 40.f ) };
+		return Ray{ origin, target - origin, 0.f, random( 0.5f, 2.f ) };
+	};
+
+	auto const check_rays = [&] (std::size_t aCount) {
+		std::size_t hits = 0;
+		for( std::size_t i = 0; i < aCount; ++i )
+		{
+			Ray const ray = make_scene_ray();
+			RayHit const expected = brute_force_( scene.world, ray );
+
+			SceneHit hit;
+			bool const found = scene.bvh.intersect( ray, hit );
+			REQUIRE( found == (kNoTriangle != expected.triangle) );
+			REQUIRE( scene.bvh.occluded( ray ) == found );
+
+			if( found )
+			{
+				REQUIRE( hit.instance == scene.worldInstance[expected.triangle] );
+				REQUIRE( hit.triangle == scene.worldTriangle[expected.triangle] );
+				REQUIRE( hit.t == Catch::Approx( expected.t ).epsilon( 1e-4 ) );
+				++hits;
+			}
+		}
+		return hits;
+	};
+
+	SECTION( "single rays" )
+	{
+		std::size_t const hits = check_rays( 1000 );
+		REQUIRE( hits > 100 );
+		REQUIRE( hits < 900 );
+	}
+
+	SECTION( "masks" )
+	{
+		// Mask 1 selects the even instances.
+		std::vector<Vec3f> even;
+		std::vector<std::uint32_t> evenInstance;
+		for( std::size_t i = 0; i < scene.worldInstance.size(); ++i )
+		{
+			if( 0 == scene.worldInstance[i] % 2 )
+			{
+				even.insert( even.end(), { scene.world[3*i], scene.world[3*i+1], scene.world[3*i+2] } );
+				evenInstance.emplace_back( scene.worldInstance[i] );
+			}
+		}
+
+		for( int i = 0; i < 300; ++i )
+		{
+			Ray const ray = make_scene_ray();
+			RayHit const expected = brute_force_( even, ray );
+
+			SceneHit hit;
+			REQUIRE( scene.bvh.intersect( ray, hit, 1u ) == (kNoTriangle != expected.triangle) );
+			REQUIRE( scene.bvh.occluded( ray, 1u ) == (kNoTriangle != expected.triangle) );
+			if( kNoTriangle != expected.triangle )
+			{
+				REQUIRE( hit.instance == evenInstance[expected.triangle] );
+			}
+
+			REQUIRE( !scene.bvh.intersect( ray, hit, 4u ) );
+		}
+	}
+
+	SECTION( "packets match single rays" )
+	{
+		for( int i = 0; i < 200; ++i )
+		{
+			Ray const center = make_scene_ray();
+
+			RayPacket packet;
+			Ray rays[RayPacket::kSize];
+			for( std::size_t j = 0; j < RayPacket::kSize; ++j )
+			{
+				Vec3f const jitter{ random( -0.05f, 0.05f ), random( -0.05f, 0.05f ), random( -0.05f, 0.05f ) };
+				rays[j] = Ray{ center.origin, center.direction + jitter * length( center.direction ), 0.f, 2.f };
+				if( j == std::size_t(i) % RayPacket::kSize )
+					rays[j].tMax = -1.f; // inactive
+
+				packet.ox[j] = rays[j].origin.x; packet.oy[j] = rays[j].origin.y; packet.oz[j] = rays[j].origin.z;
+				packet.dx[j] = rays[j].direction.x; packet.dy[j] = rays[j].direction.y; packet.dz[j] = rays[j].direction.z;
+				packet.tMin[j] = rays[j].tMin;
+				packet.tMax[j] = rays[j].tMax;
+			}
+
+			std::uint32_t instances[RayPacket::kSize];
+			scene.bvh.intersect( packet, instances );
+
+			for( std::size_t j = 0; j < RayPacket::kSize; ++j )
+			{
+				SceneHit hit;
+				scene.bvh.intersect( rays[j], hit );
+				REQUIRE( instances[j] == hit.instance );
+				REQUIRE( packet.triangle[j] == hit.triangle );
+				if( kNoInstance != hit.instance )
+				{
+					REQUIRE( packet.t[j] == hit.t );
+				}
+			}
+		}
+	}
+
+	SECTION( "overlaps" )
+	{
+		constexpr float kMargin = 1e-3f;
+
+		std::vector<std::uint32_t> found;
+		for( int i = 0; i < 200; ++i )
+		{
+			Vec3f const center{ random( -45.f, 45.f ), random( -45.f, 45.f ), random( -45.f, 45.f ) };
+			float const radius = random( 0.5f, 6.f );
+			Vec3f const half{ radius, random( 0.5f, 6.f ), random( 0.5f, 6.f ) };
+			Vec3f const margin{ kMargin, kMargin, kMargin };
+
+			// Per instance: certainly inside, possibly inside
+			std::vector<int> sphereIn( 40, 0 ), sphereNear( 40, 0 ), boxIn( 40, 0 ), boxNear( 40, 0 );
+			for( std::size_t j = 0; j < scene.worldInstance.size(); ++j )
+			{
+				auto const instance = scene.worldInstance[j];
+				float const d = std::sqrt( distance_sq_( center, &scene.world[3*j] ) );
+				sphereIn[instance] |= d < radius - kMargin;
+				sphereNear[instance] |= d < radius + kMargin;
+				boxIn[instance] |= overlaps_box_( &scene.world[3*j], center - half + margin, center + half - margin );
+				boxNear[instance] |= overlaps_box_( &scene.world[3*j], center - half - margin, center + half + margin );
+			}
+
+			found.clear();
+			scene.bvh.overlap_sphere( center, radius, found );
+			for( std::uint32_t j = 0; j < 40; ++j )
+			{
+				bool const reported = found.end() != std::find( found.begin(), found.end(), j );
+				if( sphereIn[j] )
+				{
+					REQUIRE( reported );
+				}
+				if( !sphereNear[j] )
+				{
+					REQUIRE( !reported );
+				}
+			}
+
+			found.clear();
+			scene.bvh.overlap_box( center - half, center + half, found );
+			for( std::uint32_t j = 0; j < 40; ++j )
+			{
+				bool const reported = found.end() != std::find( found.begin(), found.end(), j );
+				if( boxIn[j] )
+				{
+					REQUIRE( reported );
+				}
+				if( !boxNear[j] )
+				{
+					REQUIRE( !reported );
+				}
+			}
+		}
+	}
+
+	SECTION( "refit" )
+	{
+		for( std::size_t i = 0; i < scene.transforms.size(); ++i )
+		{
+			scene.transforms[i] = make_transform_( random, 40.f );
+			scene.bvh.set_transform( std::uint32_t(i), scene.transforms[i] );
+		}
+
+		scene.bvh.refit();
+		scene.bake();
+
+		std::size_t const hits = check_rays( 500 );
+		REQUIRE( hits > 50 );
+	}
+}
+
+TEST_CASE( "BVH benchmark", "[bvh][!benchmark]" )
+{
+	Random_ random{ 7 };
+	auto const soup = make_soup_( 100'000, random );
+
+	BENCHMARK( "build, 100k triangles" )
+	{
+		return TriangleBvh( soup.data(), soup.size() / 3 ).nodes().size();
+	};
+
+	TriangleBvh const bvh( soup.data(), soup.size() / 3 );
+
+	// Coherent rays, like camera rays: a 256x256 grid from one origin
+	constexpr std::size_t kRays = 256;
+	auto const direction = [] (std::size_t aX, std::size_t aY) {
+		return Vec3f{ (float(aX) / kRays - 0.5f), (float(aY) / kRays - 0.5f), -1.f };
+	};
+	Vec3f const origin{ 0.f, 0.f, 15.f };
+
+	BENCHMARK( "65k coherent rays, single" )
+	{
+		std::size_t hits = 0;
+		for( std::size_t y = 0; y < kRays; ++y )
+		{
+			for( std::size_t x = 0; x < kRays; ++x )
+			{
+				RayHit hit;
+				hits += bvh.intersect( Ray{ origin, direction( x, y ) }, hit );
+			}
+		}
+		return hits;
+	};
+
+	BENCHMARK( "65k coherent rays, packets" )
+	{
+		std::size_t hits = 0;
+		for( std::size_t y = 0; y < kRays; ++y )
+		{
+			for( std::size_t x = 0; x < kRays; x += RayPacket::kSize )
+			{
+				RayPacket packet;
+				for( std::size_t i = 0; i < RayPacket::kSize; ++i )
+				{
+					Vec3f const d = direction( x+i, y );
+					packet.ox[i] = origin.x; packet.oy[i] = origin.y; packet.oz[i] = origin.z;
+					packet.dx[i] = d.x; packet.dy[i] = d.y; packet.dz[i] = d.z;
+					packet.tMin[i] = 0.f;
+					packet.tMax[i] = std::numeric_limits<float>::infinity();
+				}
+
+				bvh.intersect( packet );
+				for( auto const tri : packet.triangle )
+					hits += kNoTriangle != tri;
+			}
+		}
+		return hits;
+	};
+
+	BENCHMARK( "65k incoherent rays" )
+	{
+		Random_ rays{ 3 };
+		std::size_t hits = 0;
+		for( std::size_t i = 0; i < kRays*kRays; ++i )
+		{
+			RayHit hit;
+			hits += bvh.intersect( make_ray_( rays ), hit );
+		}
+		return hits;
+	};
+}
+
+TEST_CASE( "Scene BVH benchmark", "[bvh][!benchmark]" )
+{
+	// Two instances of a mesh of landingpad.obj's size (6204 triangles),
+	// among 30 small objects
+	Random_ random{ 13 };
+	auto const pad = make_soup_( 6204, random );
+	auto const part = make_soup_( 100, random );
+
+	SceneBvh bvh;
+	bvh.add_mesh( pad.data(), pad.size() / 3 );
+	bvh.add_mesh( part.data(), part.size() / 3 );
+
+	std::vector<Vec3f> world;
+	for( std::size_t i = 0; i < 32; ++i )
+	{
+		Mat44f const transform = make_transform_( random, 30.f );
+		bvh.add_instance( i < 2 ? 0 : 1, transform );
+		for( auto const& p : i < 2 ? pad : part )
+			world.emplace_back( transform_( transform, p ) );
+	}
+	bvh.build();
+
+	std::vector<Ray> rays;
+	for( int i = 0; i < 1000; ++i )
+	{
+		Vec3f const origin{ random( -50.f, 50.f ), random( -50.f, 50.f ), random( -50.f, 50.f ) };
+		Vec3f const target{ random( -30.f, 30.f ), random( -30.f, 30.f ), random( -30.f, 30.f ) };
+		rays.emplace_back( Ray{ origin, target - origin } );
+	}
+
+	BENCHMARK( "1000 picks, naive triangle loop" )
+	{
+		// Moeller-Trumbore in single precision, as the BVH
+		std::size_t hits = 0;
+		for( auto const& ray : rays )
+		{
+			float best = std::numeric_limits<float>::infinity();
+			for( std::size_t i = 0; i < world.size(); i += 3 )
+			{
+				Vec3f const e1 = world[i+1] - world[i], e2 = world[i+2] - world[i];
+				Vec3f const p = cross( ray.direction, e2 ), s = ray.origin - world[i], q = cross( s, e1 );
+				float const inv = 1.f / dot( e1, p );
+				float const u = dot( s, p ) * inv, v = dot( ray.direction, q ) * inv, t = dot( e2, q ) * inv;
+				if( u >= 0.f && v >= 0.f && u + v <= 1.f && t >= 0.f && t < best )
+					best = t;
+			}
+			hits += best < std::numeric_limits<float>::infinity();
+		}
+		return hits;
+	};
+
+	BENCHMARK( "1000 picks, scene BVH" )
+	{
+		std::size_t hits = 0;
+		for( auto const& ray : rays )
+		{
+			SceneHit hit;
+			hits += bvh.intersect( ray, hit );
+		}
+		return hits;
+	};
+
+	BENCHMARK( "1000 line-of-sight tests, scene BVH" )
+	{
+		std::size_t hits = 0;
+		for( auto const& ray : rays )
+			hits += bvh.occluded( ray );
+		return hits;
+	};
+
+	BENCHMARK( "1000 sphere overlaps, scene BVH" )
+	{
+		std::vector<std::uint32_t> found;
+		for( auto const& ray : rays )
+			bvh.overlap_sphere( ray.origin * 0.5f, 2.f, found );
+		return found.size();
+	};
+
+	BENCHMARK( "refit" )
+	{
+		bvh.refit();
+		return bvh.nodes().size();
+	};
+}
@@ -0,0 +1,103 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <numbers>
+
+#include <cmath>
+
+#include "../vmlib/vec4.hpp"
+
+#include "../main/cascades.hpp"
+
+namespace
+{
+	CascadeView make_view_( Vec3f aPosition, float aYaw )
+	{
+		CascadeView view;
+		view.camera2world = make_translation( aPosition ) * make_rotation_y( aYaw );
+		view.fovY = 60.f * std::numbers::pi_v<float> / 180.f;
+		view.aspect = 16.f / 9.f;
+		view.near = 0.1f;
+		view.far = 100.f;
+		return view;
+	}
+
+	Vec3f const kToLight_ = normalize( Vec3f{ 0.f, 1.f, -1.f } );
+}
+
+TEST_CASE( "Cascade splits", "[cascades]" )
+{
+	float splits[kMaxShadowCascades];
+
+	SECTION( "Increasing, ending at the far plane" )
+	{
+		compute_cascade_splits( 0.1f, 30.f, 4, 0.75f, splits );
+		for( std::size_t i = 1; i < 4; ++i )
+		{
+			REQUIRE( splits[i] > splits[i-1] );
+		}
+		REQUIRE( splits[3] == 30.f );
+	}
+
+	SECTION( "Uniform and logarithmic" )
+	{
+		compute_cascade_splits( 1.f, 16.f, 4, 0.f, splits );
+		REQUIRE( splits[0] == Catch::Approx( 4.75f ) );
+
+		compute_cascade_splits( 1.f, 16.f, 4, 1.f, splits );
+		REQUIRE( splits[0] == Catch::Approx( 2.f ) );
+		REQUIRE( splits[1] == Catch::Approx( 4.f ) );
+	}
+}
+
+TEST_CASE( "Cascade fitting", "[cascades]" )
+{
+	CascadeParams params;
+	params.resolution = 1024;
+
+	SECTION( "Covers the slice" )
+	{
+		auto const view = make_view_( { 1.f, 2.f, 3.f }, 0.7f );
+		auto const cascade = fit_cascade( view, 2.f, 10.f, kToLight_, params );
+
+		float const tanY = std::tan( 0.5f * view.fovY );
+		for( int i = 0; i < 8; ++i )
+		{
+			float const d = (i & 4) ? 10.f : 2.f;
+			float const x = (i & 1) ? d*tanY*view.aspect : -d*tanY*view.aspect;
+			float const y = (i & 2) ? d*tanY : -d*tanY;
+
+			Vec4f const clip = cascade.viewProjection * (view.camera2world * Vec4f{ x, y, -d, 1.f });
+			REQUIRE( std::abs( clip.x ) <= 1.f );
+			REQUIRE( std::abs( clip.y ) <= 1.f );
+			REQUIRE( std::abs( clip.z ) <= 1.f );
+		}
+	}
+
+	SECTION( "Stable under rotation" )
+	{
+		auto const a = fit_cascade( make_view_( { 0.f, 1.f, 0.f }, 0.f ), 0.1f, 5.f, kToLight_, params );
+		auto const b = fit_cascade( make_view_( { 0.f, 1.f, 0.f }, 1.3f ), 0.1f, 5.f, kToLight_, params );
+		REQUIRE( a.texelSize == b.texelSize );
+	}
+
+	SECTION( "Snapped to texels" )
+	{
+		// Moving the camera moves the cascade by whole texels, so a fixed
+		// world point stays at the same spot within its texel.
+		Vec4f const point{ 0.3f, 0.f, -2.f, 1.f };
+
+		auto const subtexel = [&] (float aOffset) {
+			auto const cascade = fit_cascade( make_view_( { aOffset, 1.f, 0.5f*aOffset }, 0.2f ), 0.1f, 5.f, kToLight_, params );
+			Vec4f const clip = cascade.viewProjection * point;
+
+			float const texels = (clip.x * 0.5f + 0.5f) * float(params.resolution);
+			return texels - std::floor( texels );
+		};
+
+		float const expected = subtexel( 0.f );
+		for( float offset : { 0.013f, 0.31f, 1.7f } )
+		{
+			REQUIRE( subtexel( offset ) == Catch::Approx( expected ).margin( 2e-3 ) );
+		}
+	}
+}
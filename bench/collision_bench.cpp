@@ -0,0 +1,245 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <cmath>
+
+#include "../support/thread_pool.hpp"
+
+#include "../main/collision.hpp"
+
+namespace
+{
+	// About the space vehicle's bounds
+	Vec3f const kHalf_{ 0.5f, 0.75f, 0.4f };
+
+	BodyShape make_shape_()
+	{
+		return BodyShape{ length( kHalf_ ), kHalf_ };
+	}
+
+	// Uniformly at random in a cube, at the given volume per body; about a
+	// tenth of the bodies are below the sea (y < 0).
+	std::vector<Vec3f> make_bodies_( std::size_t aCount, float aVolume, std::uint32_t aSeed )
+	{
+		float const side = std::cbrt( aVolume * float(aCount) );
+
+		std::mt19937 rng( aSeed );
+		std::uniform_real_distribution<float> dist( 0.f, side );
+
+		std::vector<Vec3f> ret( aCount );
+		for( auto& p : ret )
+		{
+			p.x = dist( rng );
+			p.y = dist( rng ) - 0.1f * side;
+			p.z = dist( rng );
+		}
+		return ret;
+	}
+
+	// All pairs of overlapping bodies, as (a, b), a < b
+	std::vector<std::pair<std::uint32_t,std::uint32_t>> brute_force_( std::vector<Vec3f> const& aBodies )
+	{
+		std::vector<std::pair<std::uint32_t,std::uint32_t>> ret;
+		for( std::size_t i = 0; i < aBodies.size(); ++i )
+		{
+			for( std::size_t j = i+1; j < aBodies.size(); ++j )
+			{
+				Vec3f const d = aBodies[j] - aBodies[i];
+				if( std::abs( d.x ) < 2.f*kHalf_.x && std::abs( d.y ) < 2.f*kHalf_.y && std::abs( d.z ) < 2.f*kHalf_.z )
+					ret.emplace_back( std::uint32_t(i), std::uint32_t(j) );
+			}
+		}
+		return ret;
+	}
+
+	Obb make_pad_( Vec3f aPosition, float aAngle )
+	{
+		return make_obb( make_translation( aPosition ) * make_rotation_y( aAngle ), { -2.f, -0.25f, -2.f }, { 2.f, 0.25f, 2.f } );
+	}
+}
+
+TEST_CASE( "Collision detection", "[collision]" )
+{
+	SECTION( "make_obb()" )
+	{
+		Obb const box = make_obb( make_translation( { 1.f, 2.f, 3.f } ) * make_scaling( 2.f, 1.f, 3.f ), { 0.f, -1.f, -1.f }, { 2.f, 1.f, 1.f } );
+		REQUIRE( box.center.x == Catch::Approx( 3.f ) );
+		REQUIRE( box.center.y == Catch::Approx( 2.f ) );
+		REQUIRE( box.center.z == Catch::Approx( 3.f ) );
+		REQUIRE( box.half.x == Catch::Approx( 2.f ) );
+		REQUIRE( box.half.y == Catch::Approx( 1.f ) );
+		REQUIRE( box.half.z == Catch::Approx( 3.f ) );
+		REQUIRE( box.axes[2].z == Catch::Approx( 1.f ) );
+	}
+
+	SECTION( "Body pairs match brute force" )
+	{
+		auto const bodies = make_bodies_( 3000, 4.f, 17 );
+		auto const expected = brute_force_( bodies );
+		REQUIRE( expected.size() > 100 );
+
+		ThreadPool pool( 2 );
+		CollisionWorld world( make_shape_() );
+		world.detect( bodies.data(), bodies.size(), pool );
+
+		auto const& stats = world.stats();
+		REQUIRE( stats.bodies == bodies.size() );
+		REQUIRE( stats.bodyContacts == expected.size() );
+		REQUIRE( stats.pairsTested < bodies.size() * bodies.size() / 20 );
+
+		for( std::size_t i = 0; i < expected.size(); ++i )
+		{
+			auto const& contact = world.contacts()[i];
+			REQUIRE( ContactKind::body == contact.kind );
+			REQUIRE( expected[i].first == contact.a );
+			REQUIRE( expected[i].second == contact.b );
+			REQUIRE( contact.depth > 0.f );
+			REQUIRE( 1.f == std::abs( contact.normal.x ) + std::abs( contact.normal.y ) + std::abs( contact.normal.z ) );
+
+			// Pushing a out along the normal separates the pair.
+			Vec3f const a = bodies[contact.a] + contact.depth * contact.normal;
+			Vec3f const d = bodies[contact.b] - a;
+			float const gap = std::abs( dot( d, contact.normal ) ) - 2.f * std::abs( dot( kHalf_, contact.normal ) );
+			REQUIRE( gap == Catch::Approx( 0.f ).margin( 1e-4f ) );
+		}
+
+		std::size_t below = 0;
+		for( auto const& p : bodies )
+			below += p.y < kHalf_.y;
+		REQUIRE( stats.groundContacts == below );
+	}
+
+	SECTION( "Independent of the thread count" )
+	{
+		auto const bodies = make_bodies_( 20'000, 4.f, 5 );
+
+		ThreadPool one( 1 ), four( 4 );
+		CollisionWorld a( make_shape_() ), b( make_shape_() );
+		for( auto* world : { &a, &b } )
+		{
+			world->add_obstacle( make_pad_( { 10.f, 5.f, 10.f }, 0.3f ) );
+			world->add_obstacle( make_pad_( { 20.f, 2.f, 15.f }, -1.1f ) );
+		}
+
+		a.detect( bodies.data(), bodies.size(), one );
+		b.detect( bodies.data(), bodies.size(), four );
+
+		REQUIRE( a.stats().obstacleContacts > 0 );
+		REQUIRE( a.contacts().size() == b.contacts().size() );
+		for( std::size_t i = 0; i < a.contacts().size(); ++i )
+		{
+			auto const& x = a.contacts()[i];
+			auto const& y = b.contacts()[i];
+			REQUIRE( x.kind == y.kind );
+			REQUIRE( x.a == y.a );
+			REQUIRE( x.b == y.b );
+			REQUIRE( x.depth == y.depth );
+		}
+
+		// Sorted by kind, a, b
+		REQUIRE( std::is_sorted( a.contacts().begin(), a.contacts().end(), [] (Contact const& aX, Contact const& aY) {
+			if( aX.kind != aY.kind ) return aX.kind < aY.kind;
+			if( aX.a != aY.a ) return aX.a < aY.a;
+			return aX.b < aY.b;
+		} ) );
+
+		// Reused without leftovers
+		a.detect( bodies.data(), 10, one );
+		REQUIRE( a.stats().bodies == 10 );
+		REQUIRE( a.contacts().size() == a.stats().bodyContacts + a.stats().obstacleContacts + a.stats().groundContacts );
+	}
+
+	SECTION( "Obstacles" )
+	{
+		ThreadPool pool( 1 );
+		CollisionWorld world( make_shape_() );
+		world.add_obstacle( make_pad_( { 0.f, 5.f, 0.f }, 0.f ) );
+		world.add_obstacle( make_pad_( { 20.f, 5.f, 0.f }, 0.25f * 3.14159265f ) );
+
+		Vec3f const bodies[] = {
+			{ 0.f, 5.f + 0.25f + 0.7f, 0.f },   // resting 0.05 deep on top of pad 0
+			{ -1.2f, 5.f + 0.25f + 0.8f, 0.f }, // just above pad 0
+			{ 2.45f, 5.f, 0.f },                // against pad 0's side, 0.05 deep
+			{ 2.45f, 5.f + 0.25f + 0.7f, 2.5f },// beyond pad 0's corner, boxes apart
+			{ 21.5f, 5.f, 1.5f },               // inside pad 1, which is rotated by 45 degrees
+			{ 22.2f, 5.f, -1.8f },              // outside it (unrotated, it would overlap)
+		};
+
+		world.detect( bodies, std::size(bodies), pool );
+		auto const& contacts = world.contacts();
+		REQUIRE( 3 == contacts.size() );
+
+		REQUIRE( 0 == contacts[0].a );
+		REQUIRE( 0 == contacts[0].b );
+		REQUIRE( contacts[0].depth == Catch::Approx( 0.05f ) );
+		REQUIRE( contacts[0].normal.y == Catch::Approx( 1.f ) );
+
+		REQUIRE( 2 == contacts[1].a );
+		REQUIRE( contacts[1].depth == Catch::Approx( 0.05f ) );
+		REQUIRE( contacts[1].normal.x == Catch::Approx( 1.f ) );
+
+		REQUIRE( 4 == contacts[2].a );
+		REQUIRE( 1 == contacts[2].b );
+	}
+
+	SECTION( "Ground" )
+	{
+		ThreadPool pool( 1 );
+		CollisionWorld world( make_shape_() );
+
+		Vec3f const bodies[] = { { 0.f, 0.5f, 0.f }, { 5.f, 0.75f, 0.f }, { 10.f, -3.f, 0.f } };
+		world.detect( bodies, std::size(bodies), pool );
+
+		auto const& contacts = world.contacts();
+		REQUIRE( 2 == contacts.size() );
+		REQUIRE( ContactKind::ground == contacts[0].kind );
+		REQUIRE( 0 == contacts[0].a );
+		REQUIRE( contacts[0].depth == Catch::Approx( 0.25f ) );
+		REQUIRE( 2 == contacts[1].a );
+		REQUIRE( contacts[1].depth == Catch::Approx( 3.75f ) );
+	}
+}
+
+TEST_CASE( "Collision scaling", "[collision][!benchmark]" )
+{
+	// Constant density: the number of contacts grows linearly.
+	auto const count = GENERATE( 1000u, 10'000u, 100'000u );
+	auto const bodies = make_bodies_( count, 8.f, 1 );
+
+	static ThreadPool pool;
+
+	CollisionWorld world( make_shape_() );
+	world.add_obstacle( make_pad_( { 10.f, 5.f, 10.f }, 0.3f ) );
+	world.add_obstacle( make_pad_( { 20.f, 2.f, 15.f }, -1.1f ) );
+
+	auto const suffix = std::to_string( count ) + " bodies";
+
+	BENCHMARK( "CollisionWorld::detect(), 1 thread, " + suffix )
+	{
+		static ThreadPool one( 1 );
+		world.detect( bodies.data(), bodies.size(), one );
+		return world.contacts().size();
+	};
+
+	BENCHMARK( "CollisionWorld::detect(), " + std::to_string( pool.thread_count() ) + " threads, " + suffix )
+	{
+		world.detect( bodies.data(), bodies.size(), pool );
+		return world.contacts().size();
+	};
+
+	if( count <= 10'000 )
+	{
+		BENCHMARK( "Brute force pairs, " + suffix )
+		{
+			return brute_force_( bodies ).size();
+		};
+	}
+
+	world.detect( bodies.data(), bodies.size(), pool );
+	auto const& stats = world.stats();
+	std::printf( "%zu bodies: %zu cells, %zu pairs tested (brute force: %zu), %zu/%zu/%zu contacts\n", stats.bodies, stats.cells, stats.pairsTested, stats.bodies * (stats.bodies-1) / 2, stats.bodyContacts, stats.obstacleContacts, stats.groundContacts );
+}
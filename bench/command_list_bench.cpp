@@ -0,0 +1,145 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <vector>
+
+#include <cstring>
+
+#include "../support/thread_pool.hpp"
+
+#include "../main/command_list.hpp"
+#include "../main/render_queue.hpp"
+
+#include "../main/particles.hpp" // particle_hash()
+
+namespace
+{
+	constexpr std::size_t kObjects_ = 20000;
+
+	bool same_( Mat44f const& aA, Mat44f const& aB ) noexcept
+	{
+		return 0 == std::memcmp( aA.v, aB.v, sizeof(aA.v) );
+	}
+
+	Mat44f object_world_( std::size_t aIndex ) noexcept
+	{
+		std::uint32_t const h = particle_hash( std::uint32_t(aIndex) );
+		Vec3f const position{ float(h & 0xff) - 128.f, float((h >> 8) & 0xf), -float((h >> 12) & 0xff) };
+		return make_translation( position ) * make_rotation_y( float(h >> 20) / 700.f ) * make_scaling( 2.f, 2.f, 2.f );
+	}
+
+	// Records objects [aBegin,aEnd), as the main loop does
+	void record_( CommandList& aList, Mat44f const& aProjCamera, std::size_t aBegin, std::size_t aEnd )
+	{
+		for( std::size_t i = aBegin; i < aEnd; ++i )
+		{
+			std::uint32_t const h = particle_hash( std::uint32_t(i) );
+			Mat44f const world = object_world_( i );
+
+			DrawPacket packet{ 1 + (h & 3), (h >> 2) % 5, std::uint32_t(i), 36, 0, 0, nullptr };
+			set_packet_transform( packet, aProjCamera, world );
+
+			float const depth = -(aProjCamera * world)(3,3);
+			auto const item = aList.record( packet );
+			aList.submit( RenderPass::opaque, (h >> 5) % 3, packet.texture, depth, item );
+			if( packet.texture )
+				aList.submit( RenderPass::depthPrepass, 0, 0, depth, item );
+		}
+	}
+
+	void record_parallel_( std::vector<CommandList>& aLists, Mat44f const& aProjCamera, ThreadPool& aPool )
+	{
+		aPool.parallel_for( aLists.size(), 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+			for( std::size_t p = aBegin; p < aEnd; ++p )
+			{
+				aLists[p].clear();
+				record_( aLists[p], aProjCamera, kObjects_ * p / aLists.size(), kObjects_ * (p+1) / aLists.size() );
+			}
+		} );
+	}
+
+	Mat44f const kProjCamera_ = make_perspective_projection( 1.f, 1.5f, 0.1f, 100.f ) * make_translation( { 0.f, -2.f, -5.f } );
+}
+
+TEST_CASE( "Command lists", "[command_list]" )
+{
+	SECTION( "set_packet_transform()" )
+	{
+		Mat44f const world = make_translation( { 3.f, 4.f, 5.f } ) * make_scaling( 2.f, 4.f, 0.5f );
+
+		DrawPacket packet{ 1, 0, 0, 3 };
+		set_packet_transform( packet, kProjCamera_, world );
+
+		REQUIRE( same_( packet.model2world, world ) );
+		REQUIRE( same_( packet.projCameraWorld, kProjCamera_ * world ) );
+
+		// Inverse transpose: inverse scales, no translation
+		REQUIRE( packet.normalMatrix(0,0) == Catch::Approx( 0.5f ) );
+		REQUIRE( packet.normalMatrix(1,1) == Catch::Approx( 0.25f ) );
+		REQUIRE( packet.normalMatrix(2,2) == Catch::Approx( 2.f ) );
+		REQUIRE( packet.normalMatrix(0,1) == 0.f );
+	}
+
+	SECTION( "parallel recording matches serial submission" )
+	{
+		CommandList serial;
+		record_( serial, kProjCamera_, 0, kObjects_ );
+
+		RenderQueue serialQueue;
+		std::vector<DrawPacket const*> serialPackets;
+		merge_command_lists( &serial, 1, serialQueue, serialPackets );
+		REQUIRE( serialPackets.size() == kObjects_ );
+
+		ThreadPool pool( 4 );
+		std::vector<CommandList> lists( 7 );
+		record_parallel_( lists, kProjCamera_, pool );
+
+		RenderQueue queue;
+		std::vector<DrawPacket const*> packets;
+		merge_command_lists( lists.data(), lists.size(), queue, packets );
+		REQUIRE( packets.size() == kObjects_ );
+
+		auto const& expected = serialQueue.entries();
+		auto const& entries = queue.entries();
+		REQUIRE( entries.size() == expected.size() );
+		REQUIRE( entries.size() > kObjects_ ); // some with a prepass entry
+
+		for( std::size_t i = 0; i < entries.size(); ++i )
+		{
+			REQUIRE( entries[i].key == expected[i].key );
+
+			auto const& packet = *packets[entries[i].item];
+			auto const& expectedPacket = *serialPackets[expected[i].item];
+			REQUIRE( packet.first == expectedPacket.first );
+			REQUIRE( same_( packet.projCameraWorld, expectedPacket.projCameraWorld ) );
+		}
+
+		// Merging again (e.g., next frame) starts over
+		merge_command_lists( lists.data(), 2, queue, packets );
+		REQUIRE( packets.size() == lists[0].packets().size() + lists[1].packets().size() );
+	}
+}
+
+TEST_CASE( "Command list benchmark", "[command_list][!benchmark]" )
+{
+	ThreadPool pool;
+
+	CommandList serial;
+	std::vector<CommandList> lists( pool.thread_count() );
+	RenderQueue queue;
+	std::vector<DrawPacket const*> packets;
+
+	BENCHMARK( "record 20k objects, serial" )
+	{
+		serial.clear();
+		record_( serial, kProjCamera_, 0, kObjects_ );
+		merge_command_lists( &serial, 1, queue, packets );
+		return queue.entries().size();
+	};
+
+	BENCHMARK( "record 20k objects, parallel" )
+	{
+		record_parallel_( lists, kProjCamera_, pool );
+		merge_command_lists( lists.data(), lists.size(), queue, packets );
+		return queue.entries().size();
+	};
+}
@@ -0,0 +1,92 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <string>
+#include <vector>
+
+#include <cmath>
+
+#include "../support/thread_pool.hpp"
+
+#include "../main/fleet.hpp"
+#include "../main/ship_simulation.hpp"
+
+namespace
+{
+	constexpr float kDt_ = ShipSimulation::kTimeStep;
+}
+
+TEST_CASE( "Fleet matches the single ship", "[fleet]" )
+{
+	ShipParams params;
+	params.initPosition = { 1.f, 2.f, 3.f };
+
+	ShipState ship = make_initial_ship_state( params );
+	ship.isAnimation = true;
+
+	Fleet fleet;
+	fleet.add( params.initPosition, params.initSpeed, params.initAngle, params.acceleration );
+
+	ThreadPool pool( 2 );
+	for( int i = 0; i < 10*120; ++i )
+	{
+		step_ship( ship, params, kDt_ );
+		step_fleet( fleet, params, kDt_, pool );
+	}
+
+	REQUIRE( fleet.posX[0] == Catch::Approx( ship.position.x ).epsilon( 1e-4 ) );
+	REQUIRE( fleet.posY[0] == Catch::Approx( ship.position.y ).epsilon( 1e-4 ) );
+	REQUIRE( fleet.posZ[0] == ship.position.z );
+	REQUIRE( fleet.angle[0] == Catch::Approx( ship.angle ).epsilon( 1e-4 ) );
+}
+
+TEST_CASE( "Fleet update", "[fleet][!benchmark]" )
+{
+	auto const count = GENERATE( 1u, 10u, 100u, 1000u, 10'000u, 100'000u, 1'000'000u );
+
+	ShipParams params;
+	Fleet fleet = make_fleet_grid( count, {}, 0.3f );
+
+	static ThreadPool pool;
+
+	auto const suffix = std::to_string( count ) + " ships";
+
+	BENCHMARK( "step_ship(), " + suffix )
+	{
+		// Baseline: the single-ship code path, applied to each ship.
+		ShipState ship;
+		ship.isAnimation = true;
+		for( std::size_t i = 0; i < fleet.size(); ++i )
+		{
+			ship.speed = fleet.speed[i];
+			ship.angle = fleet.angle[i];
+			ship.position = { fleet.posX[i], fleet.posY[i], fleet.posZ[i] };
+
+			step_ship( ship, params, kDt_ );
+
+			fleet.speed[i] = ship.speed;
+			fleet.angle[i] = ship.angle;
+			fleet.posX[i] = ship.position.x;
+			fleet.posY[i] = ship.position.y;
+		}
+		return fleet.posX[0];
+	};
+
+	BENCHMARK( "step_fleet(), 1 thread, " + suffix )
+	{
+		step_fleet( fleet, params, kDt_, 0, fleet.size() );
+		return fleet.posX[0];
+	};
+
+	BENCHMARK( "step_fleet(), thread pool, " + suffix )
+	{
+		step_fleet( fleet, params, kDt_, pool );
+		return fleet.posX[0];
+	};
+
+	std::vector<float> instances( 16 * fleet.size() );
+	BENCHMARK( "write_fleet_instances(), " + suffix )
+	{
+		write_fleet_instances( fleet, instances.data(), 0, fleet.size() );
+		return instances[0];
+	};
+}
@@ -0,0 +1,79 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <numbers>
+#include <vector>
+
+#include "../main/frustum.hpp"
+
+namespace
+{
+	Mat44f make_view_projection_()
+	{
+		// Camera at (0,0,5), looking down -z
+		Mat44f const projection = make_perspective_projection( 60.f * std::numbers::pi_v<float> / 180.f, 16.f/9.f, 0.1f, 100.f );
+		return projection * make_translation( { 0.f, 0.f, -5.f } );
+	}
+}
+
+TEST_CASE( "Frustum culling", "[frustum]" )
+{
+	Frustum const frustum( make_view_projection_() );
+
+	SECTION( "Inside" )
+	{
+		REQUIRE( frustum.intersects_sphere( { 0.f, 0.f, 0.f }, 0.5f ) );
+		REQUIRE( frustum.intersects_sphere( { 0.f, 0.f, -90.f }, 0.5f ) );
+	}
+
+	SECTION( "Behind the camera and past the far plane" )
+	{
+		REQUIRE( !frustum.intersects_sphere( { 0.f, 0.f, 6.f }, 0.5f ) );
+		REQUIRE( !frustum.intersects_sphere( { 0.f, 0.f, -100.f }, 0.5f ) );
+	}
+
+	SECTION( "Beside the view" )
+	{
+		// At distance 5, the half-height of the view is 5*tan(30deg) ~ 2.89
+		// and the half-width ~ 5.13.
+		REQUIRE( !frustum.intersects_sphere( { 0.f, 4.f, 0.f }, 0.5f ) );
+		REQUIRE( !frustum.intersects_sphere( { -6.f, 0.f, 0.f }, 0.5f ) );
+	}
+
+	SECTION( "Straddling a plane" )
+	{
+		REQUIRE( frustum.intersects_sphere( { 0.f, 3.f, 0.f }, 0.5f ) );
+		REQUIRE( frustum.intersects_sphere( { 0.f, 0.f, 5.5f }, 1.f ) );
+	}
+
+	SECTION( "Boxes" )
+	{
+		REQUIRE( frustum.intersects_box( { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f } ) );
+		REQUIRE( frustum.intersects_box( { -50.f, -1.f, -50.f }, { 50.f, 1.f, 50.f } ) ); // surrounds the camera
+		REQUIRE( frustum.intersects_box( { 0.f, 2.5f, -1.f }, { 1.f, 3.5f, 1.f } ) ); // straddling the top plane
+		REQUIRE( !frustum.intersects_box( { -1.f, 3.5f, -1.f }, { 1.f, 4.5f, 1.f } ) );
+		REQUIRE( !frustum.intersects_box( { -1.f, -1.f, 5.5f }, { 1.f, 1.f, 7.f } ) );
+	}
+}
+
+TEST_CASE( "Frustum culling benchmark", "[frustum][!benchmark]" )
+{
+	Frustum const frustum( make_view_projection_() );
+
+	// Spheres on a grid around the camera; about a fifth are visible.
+	std::vector<Vec4f> spheres;
+	for( int i = 0; i < 100'000; ++i )
+	{
+		float const x = float(i % 100) - 50.f;
+		float const z = float(i / 100 % 100) - 50.f;
+		float const y = float(i / 10'000) - 5.f;
+		spheres.emplace_back( Vec4f{ x, y, z, 0.5f } );
+	}
+
+	BENCHMARK( "100k spheres" )
+	{
+		std::size_t visible = 0;
+		for( auto const& s : spheres )
+			visible += frustum.intersects_sphere( { s.x, s.y, s.z }, s.w );
+		return visible;
+	};
+}
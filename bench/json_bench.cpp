@@ -0,0 +1,76 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <string>
+
+#include "../support/json.hpp"
+#include "../support/error.hpp"
+
+TEST_CASE( "JSON reader", "[json]" )
+{
+	SECTION( "Values" )
+	{
+		JsonDocument const doc( R"({ "a": [1, -2.5e1, true, null], "b": { "c": "x\ty\u00e9\ud83d\ude00" } })", "test" );
+		auto const& root = doc.root();
+
+		auto const& a = root["a"].as_array();
+		REQUIRE( 4 == a.size() );
+		REQUIRE( 1.0 == a[0].as_number() );
+		REQUIRE( -25.0 == a[1].as_number() );
+		REQUIRE( a[2].as_bool() );
+		REQUIRE( a[3].is_null() );
+
+		REQUIRE( "x\ty\xC3\xA9\xF0\x9F\x98\x80" == root["b"]["c"].as_string() );
+	}
+
+	SECTION( "Defaults" )
+	{
+		JsonDocument const doc( R"({ "f": 2 })", "test" );
+		REQUIRE( 2.f == doc.root().float_or( "f", 1.f ) );
+		REQUIRE( 1.f == doc.root().float_or( "g", 1.f ) );
+		REQUIRE( "d" == doc.root().string_or( "s", "d" ) );
+		REQUIRE( nullptr == doc.root().find( "g" ) );
+	}
+
+	SECTION( "Errors report the line" )
+	{
+		try
+		{
+			JsonDocument const doc( "{\n\"a\": 1,\n\"b\": [1 2]\n}", "test" );
+			FAIL( "no exception" );
+		}
+		catch( Error const& eErr )
+		{
+			REQUIRE( std::string(eErr.what()).starts_with( "test:3:" ) );
+		}
+
+		JsonDocument const doc( "{\n\"a\":\n  \"text\"\n}", "test" );
+		REQUIRE( 3 == doc.root()["a"].line() );
+		REQUIRE_THROWS_AS( doc.root()["a"].as_number(), Error );
+		REQUIRE_THROWS_AS( doc.root()["missing"], Error );
+	}
+
+	SECTION( "Malformed input" )
+	{
+		for( char const* text : { "", "{", "[1,]", "01x", "1.", "\"abc", "{\"a\" 1}", "[1] 2", "tru", "\"\\q\"" } )
+		{
+			REQUIRE_THROWS_AS( JsonDocument( text, "test" ), Error );
+		}
+	}
+}
+
+TEST_CASE( "JSON reader benchmark", "[json][!benchmark]" )
+{
+	// Roughly the shape of a scene file: an array of small objects.
+	std::string text = "[";
+	for( int i = 0; i < 10000; ++i )
+	{
+		if( i ) text += ",\n";
+		text += R"({ "name": "node)" + std::to_string(i) + R"(", "parent": "group", "translate": [1.5, -0.25, 3e2], "scale": 0.07 })";
+	}
+	text += "]";
+
+	BENCHMARK( "parse 10k objects" )
+	{
+		return JsonDocument( text, "bench" ).root().as_array().size();
+	};
+}
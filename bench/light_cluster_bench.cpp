@@ -0,0 +1,132 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+#include <numbers>
+#include <algorithm>
+
+#include "../support/thread_pool.hpp"
+
+#include "../main/light_clusters.hpp"
+
+namespace
+{
+	ClusterView make_view_()
+	{
+		ClusterView view;
+		view.world2camera = make_rotation_y( 0.3f ) * make_translation( { -1.f, -2.f, -3.f } );
+		view.fovY = 60.f * std::numbers::pi_v<float> / 180.f;
+		view.aspect = 16.f / 9.f;
+		view.near = 0.1f;
+		view.far = 100.f;
+		return view;
+	}
+
+	// Random lights in a box around the camera
+	std::vector<PointLight> make_lights_( std::size_t aCount, float aExtent, unsigned aSeed )
+	{
+		std::mt19937 rng( aSeed );
+		std::uniform_real_distribution<float> pos( -aExtent, aExtent );
+		std::uniform_real_distribution<float> radius( 0.2f, 2.f );
+
+		std::vector<PointLight> lights;
+		for( std::size_t i = 0; i < aCount; ++i )
+			lights.emplace_back( PointLight{ { pos( rng ), pos( rng ), pos( rng ) }, radius( rng ), { 1.f, 1.f, 1.f }, 1.f } );
+		return lights;
+	}
+}
+
+TEST_CASE( "Light clusters", "[lights]" )
+{
+	auto const view = make_view_();
+	auto const lights = make_lights_( 300, 15.f, 1 );
+
+	LightClusters clusters;
+	clusters.build( lights.data(), lights.size(), view );
+
+	auto const& grid = clusters.grid();
+	REQUIRE( clusters.clusters().size() == grid.size() );
+
+	SECTION( "Ranges are consistent" )
+	{
+		std::size_t total = 0;
+		for( auto const& range : clusters.clusters() )
+		{
+			REQUIRE( range.offset + range.count <= clusters.indices().size() );
+			total += range.count;
+		}
+		REQUIRE( total == clusters.indices().size() );
+	}
+
+	SECTION( "No light is missed" )
+	{
+		// Every light that reaches a visible point must be in the point's
+		// cluster.
+		std::mt19937 rng( 2 );
+		std::uniform_real_distribution<float> ndc( -0.999f, 0.999f );
+		std::uniform_real_distribution<float> depth( 0.1f, 40.f );
+
+		float const tanY = std::tan( 0.5f * view.fovY );
+		float const tanX = tanY * view.aspect;
+		Mat44f const camera2world = invert( view.world2camera );
+
+		for( int i = 0; i < 2000; ++i )
+		{
+			float const d = depth( rng );
+			Vec3f const pv{ ndc( rng ) * d * tanX, ndc( rng ) * d * tanY, -d };
+			Vec4f const pw = camera2world * Vec4f{ pv.x, pv.y, pv.z, 1.f };
+
+			auto const& range = clusters.clusters()[clusters.cluster_at( pv )];
+			auto const first = clusters.indices().begin() + range.offset;
+			auto const last = first + range.count;
+
+			for( std::uint32_t j = 0; j < lights.size(); ++j )
+			{
+				if( length( lights[j].position - Vec3f{ pw.x, pw.y, pw.z } ) < lights[j].radius )
+				{
+					REQUIRE( std::find( first, last, j ) != last );
+				}
+			}
+		}
+	}
+
+	SECTION( "Threaded build is identical" )
+	{
+		ThreadPool pool( 4 );
+
+		LightClusters threaded;
+		threaded.build( lights.data(), lights.size(), view, pool );
+
+		REQUIRE( threaded.indices() == clusters.indices() );
+		for( std::size_t i = 0; i < grid.size(); ++i )
+		{
+			REQUIRE( threaded.clusters()[i].offset == clusters.clusters()[i].offset );
+			REQUIRE( threaded.clusters()[i].count == clusters.clusters()[i].count );
+		}
+	}
+}
+
+TEST_CASE( "Light cluster benchmark", "[lights][!benchmark]" )
+{
+	auto const view = make_view_();
+
+	for( std::size_t count : { 100, 1000 } )
+	{
+		auto const lights = make_lights_( count, 20.f, 3 );
+		LightClusters clusters;
+
+		BENCHMARK( std::to_string( count ) + " lights" )
+		{
+			clusters.build( lights.data(), lights.size(), view );
+			return clusters.indices().size();
+		};
+
+		ThreadPool pool;
+		BENCHMARK( std::to_string( count ) + " lights, thread pool" )
+		{
+			clusters.build( lights.data(), lights.size(), view, pool );
+			return clusters.indices().size();
+		};
+	}
+}
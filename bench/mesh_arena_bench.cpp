@@ -0,0 +1,124 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <vector>
+#include <algorithm>
+
+#include <cstring>
+
+#include "../main/simple_mesh.hpp"
+#include "../main/space_vehicle.hpp"
+
+namespace
+{
+	bool equal_( SimpleMeshData const& aA, SimpleMeshData const& aB )
+	{
+		auto const eq = [] (auto const& aX, auto const& aY) {
+			return std::equal( aX.begin(), aX.end(), aY.begin(), aY.end(), [] (auto const& aU, auto const& aV) {
+				return 0 == std::memcmp( &aU, &aV, sizeof(aU) );
+			} );
+		};
+		return eq( aA.positions, aB.positions ) && eq( aA.colors, aB.colors ) && eq( aA.normals, aB.normals ) && eq( aA.texcoords, aB.texcoords );
+	}
+
+	// A few dozen parts, like the space vehicle
+	std::vector<SimpleMeshData> make_parts_( std::size_t aCount, std::pmr::memory_resource* aResource )
+	{
+		std::vector<SimpleMeshData> parts;
+		for( std::size_t i = 0; i < aCount; ++i )
+		{
+			Mat44f const xform = make_translation( { float(i), 0.f, 0.f } );
+			switch( i % 3 )
+			{
+				case 0: parts.emplace_back( make_cylinder( true, 64, { 0.5f, 0.5f, 0.5f }, xform, aResource ) ); break;
+				case 1: parts.emplace_back( make_cone( true, 32, { 0.8f, 0.2f, 0.1f }, xform, aResource ) ); break;
+				case 2: parts.emplace_back( make_cube( { 0.2f, 0.2f, 0.9f }, xform, aResource ) ); break;
+			}
+		}
+		return parts;
+	}
+}
+
+TEST_CASE( "Mesh arena", "[mesh_arena]" )
+{
+	MeshArena arena( 4096 );
+
+	SECTION( "same results as the heap" )
+	{
+		auto const heap = make_parts_( 9, std::pmr::get_default_resource() );
+		auto const pooled = make_parts_( 9, &arena );
+
+		for( std::size_t i = 0; i < heap.size(); ++i )
+		{
+			REQUIRE( pooled[i].resource() == &arena );
+			REQUIRE( equal_( heap[i], pooled[i] ) );
+		}
+
+		SimpleMeshData const merged = concatenate( pooled, &arena );
+		REQUIRE( merged.resource() == &arena );
+		REQUIRE( equal_( concatenate( heap ), merged ) );
+	}
+
+	SECTION( "statistics" )
+	{
+		{
+			// Reserved up front: one allocation per array
+			SimpleMeshData const cylinder = make_cylinder( true, 64, { 1.f, 1.f, 1.f }, kIdentity44f, &arena );
+			REQUIRE( 12*64 == cylinder.positions.size() );
+
+			auto const stats = arena.stats();
+			REQUIRE( 3 == stats.allocations );
+			REQUIRE( 3 * cylinder.positions.size() * sizeof(Vec3f) == stats.bytes );
+			REQUIRE( stats.reserved >= stats.bytes );
+			REQUIRE( stats.peakReserved == stats.reserved );
+		}
+
+		// Destroying the mesh frees nothing...
+		auto const before = arena.stats();
+		REQUIRE( before.reserved > 0 );
+
+		// ... until the arena is released.
+		arena.release();
+		auto const after = arena.stats();
+		REQUIRE( 0 == after.allocations );
+		REQUIRE( 0 == after.bytes );
+		REQUIRE( 0 == after.reserved );
+		REQUIRE( before.peakReserved == after.peakReserved );
+	}
+
+	SECTION( "copies and release()" )
+	{
+		SimpleMeshData mesh = make_cube( { 1.f, 1.f, 1.f }, kIdentity44f, &arena );
+
+		// Copies do not keep the arena alive.
+		SimpleMeshData const copy = mesh;
+		REQUIRE( copy.resource() == std::pmr::get_default_resource() );
+		REQUIRE( equal_( copy, mesh ) );
+
+		release( mesh );
+		REQUIRE( mesh.positions.empty() );
+		REQUIRE( 0 == mesh.positions.capacity() );
+		REQUIRE( mesh.resource() == &arena );
+	}
+}
+
+TEST_CASE( "Mesh arena benchmark", "[mesh_arena][!benchmark]" )
+{
+	// Builds and merges 300 parts, then throws everything away.
+	BENCHMARK( "300 parts, heap" )
+	{
+		auto const parts = make_parts_( 300, std::pmr::get_default_resource() );
+		return concatenate( parts ).positions.size();
+	};
+
+	MeshArena arena;
+	BENCHMARK( "300 parts, arena" )
+	{
+		std::size_t ret;
+		{
+			auto const parts = make_parts_( 300, &arena );
+			ret = concatenate( parts, &arena ).positions.size();
+		}
+		arena.release();
+		return ret;
+	};
+}
@@ -0,0 +1,179 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <filesystem>
+
+#include <cmath>
+#include <cstring>
+
+#include "../main/load_obj.hpp"
+#include "../main/mesh_codec.hpp"
+#include "../main/simple_mesh.hpp"
+#include "../main/vertex_quant.hpp"
+
+#include "../support/error.hpp"
+
+namespace
+{
+	// An N x N height field, as separate triangles (like the loaders'
+	// output): each grid point is shared by up to six triangles.
+	SimpleMeshData make_terrain_( std::size_t aN )
+	{
+		auto const height = [] (float aX, float aZ) { return 3.f * std::sin( 0.21f * aX ) * std::cos( 0.13f * aZ ); };
+
+		SimpleMeshData mesh;
+		auto const vertex = [&] (std::size_t aX, std::size_t aZ) {
+			float const x = float(aX), z = float(aZ);
+			float const y = height( x, z );
+			Vec3f const dx{ 2.f, height( x+1.f, z ) - height( x-1.f, z ), 0.f };
+			Vec3f const dz{ 0.f, height( x, z+1.f ) - height( x, z-1.f ), 2.f };
+
+			mesh.positions.emplace_back( Vec3f{ x, y, -z } );
+			mesh.normals.emplace_back( normalize( cross( dz, dx ) ) );
+			mesh.colors.emplace_back( y > 0.f ? Vec3f{ 0.8f, 0.8f, 0.7f } : Vec3f{ 0.2f, 0.5f, 0.1f } );
+			mesh.texcoords.emplace_back( Vec2f{ x / float(aN), z / float(aN) } );
+		};
+
+		for( std::size_t z = 0; z < aN; ++z )
+		{
+			for( std::size_t x = 0; x < aN; ++x )
+			{
+				vertex( x, z ); vertex( x+1, z ); vertex( x+1, z+1 );
+				vertex( x, z ); vertex( x+1, z+1 ); vertex( x, z+1 );
+			}
+		}
+		return mesh;
+	}
+
+	template< typename tArray >
+	bool same_( tArray const& aA, tArray const& aB )
+	{
+		return aA.size() == aB.size() && 0 == std::memcmp( aA.data(), aB.data(), aA.size() * sizeof(aA[0]) );
+	}
+
+	// The decoded mesh is exactly what the quantized vertices decode to.
+	void check_decoded_( SimpleMeshData const& aMesh, SimpleMeshData const& aDecoded )
+	{
+		QuantizedVertices quantized;
+		auto const decode = quantize_mesh( aMesh, quantized );
+
+		SimpleMeshData expected;
+		for( std::size_t i = 0; i < quantized.size(); ++i )
+		{
+			expected.positions.emplace_back( decode_position( quantized, i, decode ) );
+			expected.colors.emplace_back( decode_color( quantized.colors[i] ) );
+			expected.normals.emplace_back( decode_normal( quantized.normals[i] ) );
+			expected.texcoords.emplace_back( decode_texcoord( quantized.texcoords[i], decode ) );
+		}
+
+		REQUIRE( same_( expected.positions, aDecoded.positions ) );
+		REQUIRE( same_( expected.colors, aDecoded.colors ) );
+		REQUIRE( same_( expected.normals, aDecoded.normals ) );
+		REQUIRE( same_( expected.texcoords, aDecoded.texcoords ) );
+	}
+}
+
+TEST_CASE( "Mesh codec", "[mesh_codec]" )
+{
+	SECTION( "round trip" )
+	{
+		// 37 x 37 quads: the stream lengths are not multiples of 16
+		SimpleMeshData const mesh = make_terrain_( 37 );
+
+		for( bool const deflate : { false, true } )
+		{
+			MeshCodecStats stats;
+			auto const data = encode_mesh( mesh, deflate, &stats );
+
+			REQUIRE( stats.vertices == mesh.positions.size() );
+			REQUIRE( stats.uniqueVertices == 38*38 );
+			REQUIRE( stats.totalBytes == data.size() );
+
+			check_decoded_( mesh, decode_mesh( data.data(), data.size() ) );
+		}
+
+		// The index stream is mostly one byte per index
+		MeshCodecStats raw, deflated;
+		encode_mesh( mesh, false, &raw );
+		encode_mesh( mesh, true, &deflated );
+		REQUIRE( raw.indexBytes < 2 * raw.vertices );
+		REQUIRE( deflated.totalBytes < raw.totalBytes );
+		REQUIRE( deflated.totalBytes * 10 < mesh.positions.size() * kFloatVertexBytes );
+	}
+
+	SECTION( "small and empty meshes" )
+	{
+		SimpleMeshData triangle;
+		triangle.positions = { Vec3f{ 0.f, 0.f, 0.f }, Vec3f{ 1.f, 0.f, 0.f }, Vec3f{ 0.f, 1.f, 0.f } };
+		auto const data = encode_mesh( triangle );
+		check_decoded_( triangle, decode_mesh( data.data(), data.size() ) );
+
+		SimpleMeshData const empty;
+		for( bool const deflate : { false, true } )
+		{
+			auto const emptyData = encode_mesh( empty, deflate );
+			REQUIRE( decode_mesh( emptyData.data(), emptyData.size() ).positions.empty() );
+		}
+	}
+
+	SECTION( "corrupt data" )
+	{
+		SimpleMeshData const mesh = make_terrain_( 8 );
+		auto data = encode_mesh( mesh, true );
+
+		REQUIRE_THROWS_AS( decode_mesh( data.data(), data.size() / 2 ), Error );
+
+		auto badMagic = data;
+		badMagic[0] = 'X';
+		REQUIRE_THROWS_AS( decode_mesh( badMagic.data(), badMagic.size() ), Error );
+
+		// Damage the deflated vertex section
+		auto damaged = data;
+		for( std::size_t i = damaged.size() - 64; i < damaged.size(); ++i )
+			damaged[i] ^= 0x5a;
+		REQUIRE_THROWS_AS( decode_mesh( damaged.data(), damaged.size() ), Error );
+
+		// Indices out of range: the header claims fewer vertices
+		auto rawData = encode_mesh( mesh, false );
+		std::uint64_t unique;
+		std::memcpy( &unique, rawData.data() + 20, sizeof(unique) );
+		REQUIRE( unique == 81 );
+		unique = 80;
+		std::memcpy( rawData.data() + 20, &unique, sizeof(unique) );
+		REQUIRE_THROWS_AS( decode_mesh( rawData.data(), rawData.size() ), Error );
+	}
+
+	SECTION( "load_wavefront_obj()" )
+	{
+		SimpleMeshData const mesh = make_terrain_( 20 );
+		auto const path = (std::filesystem::temp_directory_path() / "mesh_codec_test.meshz").string();
+
+		save_compressed_mesh( mesh, path.c_str() );
+		check_decoded_( mesh, load_wavefront_obj( path.c_str() ) );
+
+		std::filesystem::remove( path );
+		REQUIRE_THROWS_AS( load_wavefront_obj( path.c_str() ), Error );
+	}
+}
+
+TEST_CASE( "Mesh codec benchmark", "[mesh_codec][!benchmark]" )
+{
+	SimpleMeshData const mesh = make_terrain_( 500 ); // 1.5M vertices, 66 MB as floats
+
+	auto const raw = encode_mesh( mesh, false );
+	auto const deflated = encode_mesh( mesh, true );
+
+	BENCHMARK( "encode_mesh(), deflated" )
+	{
+		return encode_mesh( mesh, true ).size();
+	};
+
+	BENCHMARK( "decode_mesh()" )
+	{
+		return decode_mesh( raw.data(), raw.size() ).positions.size();
+	};
+
+	BENCHMARK( "decode_mesh(), deflated" )
+	{
+		return decode_mesh( deflated.data(), deflated.size() ).positions.size();
+	};
+}
@@ -0,0 +1,258 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include <cstdio>
+#include <cstring>
+
+#include "../main/load_obj.hpp"
+#include "../main/obj_stream.hpp"
+#include "../main/simple_mesh.hpp"
+
+#include "../support/error.hpp"
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	std::filesystem::path temp_path_( char const* aName )
+	{
+		return std::filesystem::temp_directory_path() / aName;
+	}
+
+	void write_text_( std::filesystem::path const& aPath, std::string const& aText )
+	{
+		std::FILE* fout = std::fopen( aPath.string().c_str(), "wb" );
+		REQUIRE( fout );
+		std::fwrite( aText.data(), 1, aText.size(), fout );
+		std::fclose( fout );
+	}
+
+	// An N x N grid of quads (split into triangles in every third row), with
+	// two materials, negative indices and the usual clutter.
+	std::string make_obj_( std::size_t aN, char const* aMaterialLib )
+	{
+		std::string obj = "# test\nmtllib " + std::string(aMaterialLib) + "\no grid\n";
+
+		char line[256];
+		for( std::size_t y = 0; y <= aN; ++y )
+		{
+			for( std::size_t x = 0; x <= aN; ++x )
+			{
+				float const h = 0.1f * float((x * 7 + y * 3) % 11);
+				std::snprintf( line, sizeof(line), "v %g %g %g\nvt %g %g\nvn 0 1 0\n", double(x), double(h), -double(y), double(x) / double(aN), double(y) / double(aN) );
+				obj += line;
+			}
+		}
+
+		auto const index = [&] (std::size_t aX, std::size_t aY) { return aY * (aN+1) + aX + 1; };
+
+		for( std::size_t y = 0; y < aN; ++y )
+		{
+			obj += (y / 4) % 2 ? "usemtl red\ns 1\n" : "usemtl blue\ng part\n";
+			for( std::size_t x = 0; x < aN; ++x )
+			{
+				auto const a = index( x, y ), b = index( x+1, y ), c = index( x+1, y+1 ), d = index( x, y+1 );
+				if( 0 == y % 3 )
+					std::snprintf( line, sizeof(line), "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\nf %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, b, b, b, c, c, c, a, a, a, c, c, c, d, d, d );
+				else
+					std::snprintf( line, sizeof(line), "f %zu/%zu/%zu  %zu/%zu/%zu\t%zu/%zu/%zu %zu/%zu/%zu \r\n", a, a, a, b, b, b, c, c, c, d, d, d );
+				obj += line;
+			}
+		}
+
+		// A final quad that refers back with negative indices
+		obj += "v 0 5 0\nv 1 5 0\nv 1 6 0\nv 0 6 0\nf -4/1/1 -3/1/1 -2/1/1 -1/1/1\n";
+		return obj;
+	}
+
+	struct Files_
+	{
+		std::filesystem::path obj, mtl;
+
+		explicit Files_( std::size_t aN )
+			: obj( temp_path_( "obj_stream_test.obj" ) )
+			, mtl( temp_path_( "obj_stream_test.mtl" ) )
+		{
+			write_text_( mtl, "newmtl blue\nKa 0.1 0.2 0.9\nKd 1 1 1\n\nnewmtl red\nKa 0.8 0.1 0.1\n" );
+			write_text_( obj, make_obj_( aN, "obj_stream_test.mtl" ) );
+		}
+		~Files_()
+		{
+			std::error_code ec;
+			std::filesystem::remove( obj, ec );
+			std::filesystem::remove( mtl, ec );
+		}
+	};
+
+	SimpleMeshData stream_all_( char const* aPath, ThreadPool& aPool, std::size_t aChunkBytes, ObjStreamStats* aStats = nullptr )
+	{
+		SimpleMeshData ret;
+		auto const stats = stream_wavefront_obj( aPath, aPool, [&] (SimpleMeshData const& aChunk) {
+			REQUIRE( !aChunk.positions.empty() );
+			ret.positions.insert( ret.positions.end(), aChunk.positions.begin(), aChunk.positions.end() );
+			ret.colors.insert( ret.colors.end(), aChunk.colors.begin(), aChunk.colors.end() );
+			ret.normals.insert( ret.normals.end(), aChunk.normals.begin(), aChunk.normals.end() );
+			ret.texcoords.insert( ret.texcoords.end(), aChunk.texcoords.begin(), aChunk.texcoords.end() );
+		}, { 1.f, 1.f, 1.f }, aChunkBytes );
+
+		if( aStats )
+			*aStats = stats;
+		return ret;
+	}
+
+	template< typename tArray >
+	bool same_( tArray const& aA, tArray const& aB )
+	{
+		return aA.size() == aB.size() && 0 == std::memcmp( aA.data(), aB.data(), aA.size() * sizeof(aA[0]) );
+	}
+
+	bool same_( SimpleMeshData const& aA, SimpleMeshData const& aB )
+	{
+		return same_( aA.positions, aB.positions ) && same_( aA.colors, aB.colors ) && same_( aA.normals, aB.normals ) && same_( aA.texcoords, aB.texcoords );
+	}
+}
+
+TEST_CASE( "OBJ streaming", "[obj_stream]" )
+{
+	Files_ const files( 24 );
+	auto const path = files.obj.string();
+
+	ThreadPool pool( 3 );
+
+	SECTION( "matches load_wavefront_obj()" )
+	{
+		SimpleMeshData const reference = load_wavefront_obj( path.c_str() );
+
+		ObjStreamStats stats;
+		SimpleMeshData const streamed = stream_all_( path.c_str(), pool, 1 << 20, &stats );
+
+		REQUIRE( reference.positions.size() == (24*24 + 1) * 6 );
+		REQUIRE( same_( reference, streamed ) );
+
+		REQUIRE( 1 == stats.chunks );
+		REQUIRE( stats.vertices == streamed.positions.size() );
+		REQUIRE( stats.bytes == std::filesystem::file_size( files.obj ) );
+		REQUIRE( stats.min.x == 0.f );
+		REQUIRE( stats.max.x == 24.f );
+		REQUIRE( stats.min.z == -24.f );
+		REQUIRE( stats.max.y == 6.f );
+	}
+
+	SECTION( "independent of chunk size and thread count" )
+	{
+		SimpleMeshData const whole = stream_all_( path.c_str(), pool, 1 << 20 );
+
+		// Chunks smaller than some lines
+		ObjStreamStats stats;
+		SimpleMeshData const small = stream_all_( path.c_str(), pool, 37, &stats );
+		REQUIRE( stats.chunks > 100 );
+		REQUIRE( same_( whole, small ) );
+
+		ThreadPool single( 1 );
+		REQUIRE( same_( whole, stream_all_( path.c_str(), single, 1000 ) ) );
+	}
+
+	SECTION( "mesh cache" )
+	{
+		auto const cache = temp_path_( "obj_stream_test.meshb" );
+		auto const stats = import_wavefront_obj( path.c_str(), cache.string().c_str(), pool, { 1.f, 1.f, 1.f }, 4096 );
+
+		SimpleMeshData const streamed = stream_all_( path.c_str(), pool, 1 << 20 );
+
+		MeshCacheReader in( cache.string().c_str() );
+		REQUIRE( in.vertex_count() == streamed.positions.size() );
+		REQUIRE( in.bounds_min().z == stats.min.z );
+		REQUIRE( in.bounds_max().y == stats.max.y );
+
+		SimpleMeshData loaded;
+		std::size_t blocks = 0;
+		while( auto const count = in.next_block() )
+		{
+			auto const first = loaded.positions.size();
+			loaded.positions.resize( first + count );
+			loaded.colors.resize( first + count );
+			loaded.normals.resize( first + count );
+			loaded.texcoords.resize( first + count );
+			in.read_block( loaded.positions.data()+first, loaded.colors.data()+first, loaded.normals.data()+first, loaded.texcoords.data()+first );
+			++blocks;
+		}
+
+		REQUIRE( blocks > 1 );
+		REQUIRE( same_( streamed, loaded ) );
+
+		// The material libraries are recorded for staleness checks.
+		REQUIRE( 1 == stats.libraries.size() );
+		REQUIRE( files.mtl == std::filesystem::path( stats.libraries[0] ) );
+		REQUIRE( stats.libraries == in.libraries() );
+
+		// Truncated caches are rejected when opened.
+		auto const size = std::filesystem::file_size( cache );
+		for( auto const cut : { std::uintmax_t(1), std::uintmax_t(4), std::uintmax_t(10), size - 48 } )
+		{
+			std::filesystem::resize_file( cache, size - cut );
+			REQUIRE_THROWS_AS( MeshCacheReader( cache.string().c_str() ), Error );
+		}
+
+		std::error_code ec;
+		std::filesystem::remove( cache, ec );
+	}
+}
+
+TEST_CASE( "OBJ streaming errors", "[obj_stream]" )
+{
+	ThreadPool pool( 2 );
+	auto const path = temp_path_( "obj_stream_bad.obj" );
+
+	SECTION( "missing file" )
+	{
+		REQUIRE_THROWS_AS( stream_all_( "does-not-exist.obj", pool, 1024 ), Error );
+	}
+
+	SECTION( "index out of range" )
+	{
+		write_text_( path, "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 4\n" );
+		REQUIRE_THROWS_AS( stream_all_( path.string().c_str(), pool, 1024 ), Error );
+	}
+
+	SECTION( "malformed face" )
+	{
+		write_text_( path, "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 x\n" );
+		REQUIRE_THROWS_AS( stream_all_( path.string().c_str(), pool, 1024 ), Error );
+	}
+
+	SECTION( "no normals or texture coordinates" )
+	{
+		write_text_( path, "v 0 0 0\nv 2 0 0\nv 0 2 0\nf 1 2 3" ); // no final newline
+		auto const mesh = stream_all_( path.string().c_str(), pool, 1024 );
+		REQUIRE( 3 == mesh.positions.size() );
+		REQUIRE( mesh.normals[0].z == Catch::Approx( 1.f ) );
+		REQUIRE( mesh.texcoords[2].x == 0.f );
+		REQUIRE( mesh.colors[1].x == 1.f );
+	}
+
+	std::error_code ec;
+	std::filesystem::remove( path, ec );
+}
+
+TEST_CASE( "OBJ streaming benchmark", "[obj_stream][!benchmark]" )
+{
+	Files_ const files( 400 ); // 320k triangles, 12 MB
+	auto const path = files.obj.string();
+
+	BENCHMARK( "load_wavefront_obj()" )
+	{
+		return load_wavefront_obj( path.c_str() ).positions.size();
+	};
+
+	static ThreadPool pool;
+	BENCHMARK( "stream_wavefront_obj(), 1 MB chunks" )
+	{
+		std::size_t ret = 0;
+		stream_wavefront_obj( path.c_str(), pool, [&] (SimpleMeshData const& aChunk) {
+			ret += aChunk.positions.size();
+		}, { 1.f, 1.f, 1.f }, 1 << 20 );
+		return ret;
+	};
+}
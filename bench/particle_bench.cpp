@@ -0,0 +1,149 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <string>
+#include <vector>
+
+#include "../support/thread_pool.hpp"
+
+#include "../main/particles.hpp"
+
+namespace
+{
+	ParticleEmitter const kEmitters_[] = {
+		{ { 1.f, 2.f, 3.f }, { 0.f, -1.f, 0.f } },
+		{ { -1.f, 2.f, 3.f }, { 0.f, -1.f, 0.f } }
+	};
+}
+
+TEST_CASE( "Particle spawning", "[particles]" )
+{
+	ParticleParams params;
+	params.lifetime = 1.f;
+
+	SECTION( "Round robin at capacity/lifetime" )
+	{
+		ParticleSpawner spawner( 1000, params );
+
+		std::uint32_t total = 0, next = 0;
+		for( int i = 0; i < 100; ++i )
+		{
+			auto const spawn = spawner.step( 0.0125f, kEmitters_, 2 );
+			REQUIRE( next == spawn.first );
+			REQUIRE( 2 == spawn.emitterCount );
+
+			total += spawn.count;
+			next = (next + spawn.count) % 1000;
+		}
+
+		REQUIRE( total == Catch::Approx( 1250 ).margin( 1 ) );
+	}
+
+	SECTION( "Nothing without emitters" )
+	{
+		ParticleSpawner spawner( 1000, params );
+		REQUIRE( 0 == spawner.step( 0.5f, nullptr, 0 ).count );
+	}
+
+	SECTION( "Particles live for one lifetime" )
+	{
+		ParticleState state( 1000, params );
+		ParticleSpawner spawner( 1000, params );
+
+		auto const alive = [&] {
+			std::size_t ret = 0;
+			for( auto const age : state.age )
+				ret += age < params.lifetime;
+			return ret;
+		};
+
+		REQUIRE( 0 == alive() );
+
+		float const dt = 1.f / 64.f;
+		for( int i = 0; i < 128; ++i )
+		{
+			auto const spawn = spawner.step( dt, kEmitters_, 2 );
+			step_particles( state, params, spawn, dt, 0, state.size() );
+		}
+
+		REQUIRE( alive() > 950 );
+
+		// Once the emitters stop, all particles die within a lifetime.
+		for( int i = 0; i < 65; ++i )
+		{
+			auto const spawn = spawner.step( dt, nullptr, 0 );
+			step_particles( state, params, spawn, dt, 0, state.size() );
+		}
+
+		REQUIRE( 0 == alive() );
+	}
+
+	SECTION( "Particles leave along the emitter direction" )
+	{
+		ParticleState state( 100, params );
+		ParticleSpawner spawner( 100, params );
+
+		auto const spawn = spawner.step( 0.1f, kEmitters_, 2 );
+		REQUIRE( 10 == spawn.count );
+		step_particles( state, params, spawn, 0.1f, 0, state.size() );
+
+		for( std::size_t i = 0; i < spawn.count; ++i )
+		{
+			auto const& emitter = kEmitters_[i % 2];
+			REQUIRE( state.velY[i] < 0.f );
+			REQUIRE( state.posX[i] == Catch::Approx( emitter.position.x ).margin( 0.1 ) );
+			REQUIRE( state.posY[i] <= emitter.position.y );
+		}
+	}
+
+	SECTION( "Split ranges match a single range" )
+	{
+		ParticleState a( 1000, params ), b( 1000, params );
+		ParticleSpawner spawner( 1000, params );
+
+		for( int i = 0; i < 40; ++i )
+		{
+			auto const spawn = spawner.step( 0.07f, kEmitters_, 2 ); // wraps around
+			step_particles( a, params, spawn, 0.07f, 0, a.size() );
+			for( std::size_t j = 0; j < b.size(); j += 300 )
+				step_particles( b, params, spawn, 0.07f, j, std::min( j+300, b.size() ) );
+		}
+
+		REQUIRE( a.posX == b.posX );
+		REQUIRE( a.velZ == b.velZ );
+		REQUIRE( a.age == b.age );
+	}
+}
+
+TEST_CASE( "Particle update", "[particles][!benchmark]" )
+{
+	auto const count = GENERATE( 10'000u, 100'000u, 1'000'000u );
+
+	ParticleParams const params;
+	ParticleState state( count, params );
+	ParticleSpawner spawner( count, params );
+	std::vector<float> vertices( 4 * count );
+
+	static ThreadPool pool;
+
+	// Fill the pool first, so that all particles are alive.
+	for( int i = 0; i < 80; ++i )
+		step_particles( state, params, spawner.step( 1.f / 60.f, kEmitters_, 2 ), 1.f / 60.f, pool );
+
+	auto const spawn = spawner.step( 1.f / 60.f, kEmitters_, 2 );
+	auto const suffix = std::to_string( count ) + " particles";
+
+	BENCHMARK( "step_particles(), " + suffix )
+	{
+		step_particles( state, params, spawn, 1.f / 60.f, 0, state.size() );
+		return state.posX[0];
+	};
+
+	BENCHMARK( "step_particles() + vertices, " + std::to_string( pool.thread_count() ) + " threads, " + suffix )
+	{
+		pool.parallel_for( state.size(), 32*1024, [&] (std::size_t aBegin, std::size_t aEnd) {
+			step_particles( state, params, spawn, 1.f / 60.f, aBegin, aEnd );
+			write_particle_vertices( state, vertices.data(), aBegin, aEnd );
+		} );
+		return vertices[0];
+	};
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <string>
+#include <vector>
+
+#include "../support/thread_pool.hpp"
+
+#include "../main/flight_path.hpp"
+
+namespace
+{
+	FlightPath make_circuit_()
+	{
+		return FlightPath( EPathCurve::catmullRom, {
+			{ 0.f, 0.f, 0.f }, { 4.f, 1.f, 0.f }, { 5.f, 1.f, 5.f },
+			{ 1.f, 3.f, 6.f }, { -3.f, 0.f, 2.f }
+		}, 10.f, true );
+	}
+}
+
+TEST_CASE( "Flight paths", "[path]" )
+{
+	SECTION( "Catmull-Rom passes through its points" )
+	{
+		FlightPath const path( EPathCurve::catmullRom, { { 0.f, 0.f, 0.f }, { 1.f, 2.f, 0.f }, { 3.f, 2.f, 1.f } }, 1.f, false );
+
+		auto const start = path.sample( -1.f ).position;
+		auto const end = path.sample( 2.f ).position;
+		REQUIRE( start.x == Catch::Approx( 0.f ).margin( 1e-5 ) );
+		REQUIRE( end.x == Catch::Approx( 3.f ) );
+		REQUIRE( end.z == Catch::Approx( 1.f ) );
+	}
+
+	SECTION( "Constant speed" )
+	{
+		auto const path = make_circuit_();
+		float const expected = path.length() / 1000.f;
+
+		auto prev = path.sample( 0.f ).position;
+		for( int i = 1; i <= 1000; ++i )
+		{
+			auto const next = path.sample( path.duration() * float(i) / 1000.f ).position;
+			REQUIRE( length( next - prev ) == Catch::Approx( expected ).epsilon( 0.02 ) );
+			prev = next;
+		}
+	}
+
+	SECTION( "Loops wrap around" )
+	{
+		auto const path = make_circuit_();
+		auto const a = path.sample( 2.5f ).position;
+		auto const b = path.sample( 2.5f + 3.f * path.duration() ).position;
+		auto const c = path.sample( 2.5f - path.duration() ).position;
+		REQUIRE( length( a - b ) == Catch::Approx( 0.f ).margin( 1e-3 ) );
+		REQUIRE( length( a - c ) == Catch::Approx( 0.f ).margin( 1e-3 ) );
+	}
+
+	SECTION( "Bezier control point count is checked" )
+	{
+		REQUIRE_THROWS( FlightPath( EPathCurve::bezier, { {}, {}, {} }, 1.f, false ) );
+		REQUIRE_NOTHROW( FlightPath( EPathCurve::bezier, { {}, {}, {}, {} }, 1.f, false ) );
+	}
+}
+
+TEST_CASE( "Flight path evaluation", "[path][!benchmark]" )
+{
+	auto const count = GENERATE( 1000u, 100'000u, 1'000'000u );
+
+	auto const path = make_circuit_();
+
+	std::vector<float> times( count );
+	for( std::size_t i = 0; i < count; ++i )
+		times[i] = path.duration() * float(i) / float(count);
+
+	std::vector<PathSample> samples( count );
+
+	static ThreadPool pool;
+
+	auto const suffix = std::to_string( count ) + " samples";
+
+	BENCHMARK( "sample_batch(), 1 thread, " + suffix )
+	{
+		path.sample_batch( times.data(), samples.data(), count );
+		return samples[0].position.x;
+	};
+
+	BENCHMARK( "sample_batch(), thread pool, " + suffix )
+	{
+		pool.parallel_for( count, 16*1024, [&] (std::size_t aBegin, std::size_t aEnd) {
+			path.sample_batch( times.data()+aBegin, samples.data()+aBegin, aEnd-aBegin );
+		} );
+		return samples[0].position.x;
+	};
+}
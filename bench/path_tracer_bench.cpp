@@ -0,0 +1,232 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+#include "../main/path_tracer.hpp"
+#include "../main/soft_raster.hpp"
+#include "../main/simple_mesh.hpp"
+
+#include "../vmlib/vec4.hpp"
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	void add_quad_( SimpleMeshData& aMesh, Vec3f aA, Vec3f aB, Vec3f aC, Vec3f aD, Vec3f aColor )
+	{
+		Vec3f const normal = normalize( cross( aB - aA, aC - aA ) );
+		for( auto const& p : { aA, aB, aC, aA, aC, aD } )
+		{
+			aMesh.positions.emplace_back( p );
+			aMesh.colors.emplace_back( aColor );
+			aMesh.normals.emplace_back( normal );
+		}
+	}
+
+	// Axis aligned box, faces pointing outwards
+	void add_box_( SimpleMeshData& aMesh, Vec3f aMin, Vec3f aMax, Vec3f aColor )
+	{
+		Vec3f const a = aMin, b = aMax;
+		add_quad_( aMesh, { a.x, a.y, b.z }, { b.x, a.y, b.z }, { b.x, b.y, b.z }, { a.x, b.y, b.z }, aColor ); // +z
+		add_quad_( aMesh, { b.x, a.y, a.z }, { a.x, a.y, a.z }, { a.x, b.y, a.z }, { b.x, b.y, a.z }, aColor ); // -z
+		add_quad_( aMesh, { b.x, a.y, b.z }, { b.x, a.y, a.z }, { b.x, b.y, a.z }, { b.x, b.y, b.z }, aColor ); // +x
+		add_quad_( aMesh, { a.x, a.y, a.z }, { a.x, a.y, b.z }, { a.x, b.y, b.z }, { a.x, b.y, a.z }, aColor ); // -x
+		add_quad_( aMesh, { a.x, b.y, b.z }, { b.x, b.y, b.z }, { b.x, b.y, a.z }, { a.x, b.y, a.z }, aColor ); // +y
+		add_quad_( aMesh, { a.x, a.y, a.z }, { b.x, a.y, a.z }, { b.x, a.y, b.z }, { a.x, a.y, b.z }, aColor ); // -y
+	}
+
+	SimpleMeshData make_room_()
+	{
+		SimpleMeshData mesh;
+		add_quad_( mesh, { -20.f, 0.f, 20.f }, { 20.f, 0.f, 20.f }, { 20.f, 0.f, -20.f }, { -20.f, 0.f, -20.f }, { 0.8f, 0.8f, 0.8f } ); // floor
+		add_box_( mesh, { -1.f, 0.f, -6.f }, { 1.f, 2.f, -4.f }, { 0.9f, 0.3f, 0.2f } );
+		return mesh;
+	}
+
+	Mat44f make_projection_( float aAspect )
+	{
+		return make_perspective_projection( 60.f * std::numbers::pi_v<float> / 180.f, aAspect, 0.1f, 100.f );
+	}
+
+	float channel_( std::uint32_t aColor, unsigned aChannel )
+	{
+		return float((aColor >> 8*aChannel) & 0xff);
+	}
+}
+
+TEST_CASE( "Path tracer direct lighting", "[path_tracer]" )
+{
+	ThreadPool pool( 2 );
+
+	// A wall facing the camera, filling the view. All bounces leave into
+	// the sky, so each pixel is exactly albedo * (ambient + diffuse * cos),
+	// which is what the rasterizer computes.
+	SimpleMeshData wall;
+	add_quad_( wall, { -20.f, -20.f, -5.f }, { 20.f, -20.f, -5.f }, { 20.f, 20.f, -5.f }, { -20.f, 20.f, -5.f }, { 0.6f, 0.4f, 0.9f } );
+
+	std::size_t const w = 40, h = 30;
+	Mat44f const projCameraWorld = make_projection_( float(w) / float(h) );
+
+	SoftLighting lighting;
+	lighting.toLight = normalize( Vec3f{ 0.3f, 0.5f, 1.f } );
+	lighting.ambient = { 0.1f, 0.15f, 0.2f };
+
+	PathTracer tracer( pool, w, h );
+	tracer.add_mesh( wall, kIdentity44f, nullptr, 0, wall.positions.size() );
+	tracer.build();
+	tracer.set_camera( projCameraWorld );
+	tracer.lighting() = lighting;
+	tracer.render( 4 );
+
+	REQUIRE( 4 == tracer.samples() );
+	REQUIRE( tracer.rays() >= w * h * 4 * 3 ); // camera, shadow, bounce
+
+	SoftRasterizer raster( pool, w, h );
+	raster.lighting() = lighting;
+	raster.clear( { 0.f, 0.f, 0.f } );
+	raster.draw( wall, projCameraWorld, kIdentity44f, nullptr, 0, wall.positions.size() );
+	raster.finish();
+
+	auto const traced = tracer.image();
+	for( std::size_t i = 0; i < traced.size(); ++i )
+	{
+		for( unsigned c = 0; c < 3; ++c )
+		{
+			REQUIRE( std::abs( channel_( traced[i], c ) - channel_( raster.color()[i], c ) ) <= 1.f );
+		}
+	}
+}
+
+TEST_CASE( "Path tracer shadows and bounces", "[path_tracer]" )
+{
+	ThreadPool pool( 2 );
+	SimpleMeshData const room = make_room_();
+
+	// Looking down onto the floor, with the light straight above the box
+	std::size_t const w = 64, h = 64;
+	Mat44f const world2camera = make_rotation_x( 0.5f * std::numbers::pi_v<float> ) * make_translation( { 0.f, -12.f, 5.f } );
+
+	PathTracer tracer( pool, w, h );
+	tracer.add_mesh( room, kIdentity44f, nullptr, 0, room.positions.size() );
+	tracer.build();
+	tracer.set_camera( make_projection_( 1.f ) * world2camera );
+	tracer.lighting().toLight = { 0.f, 1.f, 0.f };
+
+	REQUIRE( tracer.triangle_count() == room.positions.size() / 3 );
+
+	auto const pixel = [&] (Vec3f aPoint) {
+		Vec4f const clip = make_projection_( 1.f ) * world2camera * Vec4f{ aPoint.x, aPoint.y, aPoint.z, 1.f };
+		auto const x = std::size_t((clip.x / clip.w * 0.5f + 0.5f) * float(w));
+		auto const y = std::size_t((clip.y / clip.w * 0.5f + 0.5f) * float(h));
+		return tracer.image()[y * w + x];
+	};
+
+	SECTION( "direct light only" )
+	{
+		tracer.params().maxBounces = 0;
+		tracer.render( 2 );
+
+		// The box's top and the floor around it are lit.
+		REQUIRE( channel_( pixel( { 0.f, 2.f, -5.f } ), 0 ) > 200.f );
+		REQUIRE( channel_( pixel( { 3.f, 0.f, -5.f } ), 1 ) > 200.f );
+	}
+
+	SECTION( "bounces brighten the floor next to the box" )
+	{
+		// Next to the box, the floor sees less sky, but receives light
+		// reflected off the box's sides (which are red).
+		tracer.params().maxBounces = 0;
+		tracer.render( 64 );
+		auto const direct = pixel( { 1.1f, 0.f, -5.f } );
+
+		tracer.params().maxBounces = 4;
+		tracer.reset();
+		tracer.render( 64 );
+		auto const global = pixel( { 1.1f, 0.f, -5.f } );
+
+		REQUIRE( channel_( global, 0 ) >= channel_( direct, 0 ) );
+		REQUIRE( channel_( global, 0 ) - channel_( global, 2 ) > channel_( direct, 0 ) - channel_( direct, 2 ) );
+	}
+}
+
+TEST_CASE( "Path tracer zero normals", "[path_tracer]" )
+{
+	ThreadPool pool( 2 );
+	Mat44f const projCameraWorld = make_projection_( 1.5f ) * make_rotation_x( 0.3f ) * make_translation( { 0.f, -3.f, 2.f } );
+
+	// Zero normals fall back to the face normal, which here is the normal
+	// that the room already has.
+	SimpleMeshData const room = make_room_();
+	SimpleMeshData flat = make_room_();
+	for( auto& n : flat.normals )
+		n = Vec3f{ 0.f, 0.f, 0.f };
+
+	auto const render = [&] (SimpleMeshData const& aMesh) {
+		PathTracer tracer( pool, 75, 50 );
+		tracer.add_mesh( aMesh, kIdentity44f, nullptr, 0, aMesh.positions.size() );
+		tracer.build();
+		tracer.set_camera( projCameraWorld );
+		tracer.render( 4 );
+		return tracer.image();
+	};
+
+	auto const expected = render( room );
+	auto const actual = render( flat );
+	for( std::size_t i = 0; i < expected.size(); ++i )
+	{
+		for( unsigned c = 0; c < 3; ++c )
+		{
+			REQUIRE( std::abs( channel_( actual[i], c ) - channel_( expected[i], c ) ) <= 1.f );
+		}
+	}
+}
+
+TEST_CASE( "Path tracer thread independence", "[path_tracer]" )
+{
+	SimpleMeshData const room = make_room_();
+	Mat44f const projCameraWorld = make_projection_( 1.5f ) * make_rotation_x( 0.3f ) * make_translation( { 0.f, -3.f, 2.f } );
+
+	auto const render = [&] (unsigned aThreads) {
+		ThreadPool pool( aThreads );
+		PathTracer tracer( pool, 75, 50 );
+		tracer.add_mesh( room, kIdentity44f, nullptr, 0, room.positions.size() );
+		tracer.build();
+		tracer.set_camera( projCameraWorld );
+		tracer.render( 2 );
+		tracer.render( 3 );
+		return std::make_pair( tracer.image(), tracer.rays() );
+	};
+
+	auto const single = render( 1 );
+	auto const multi = render( 4 );
+
+	REQUIRE( single.first == multi.first );
+	REQUIRE( single.second == multi.second );
+}
+
+TEST_CASE( "Path tracer benchmark", "[path_tracer][!benchmark]" )
+{
+	// The room, plus a field of boxes for depth complexity
+	SimpleMeshData scene = make_room_();
+	for( int z = 0; z < 20; ++z )
+	{
+		for( int x = -10; x < 10; ++x )
+		{
+			float const h = 0.2f + 0.1f * float((x * 7 + z * 13) & 7);
+			add_box_( scene, { float(x) + 0.2f, 0.f, -8.f - float(z) }, { float(x) + 0.7f, h, -7.5f - float(z) }, { 0.7f, 0.7f, 0.6f } );
+		}
+	}
+
+	static ThreadPool pool;
+	PathTracer tracer( pool, 320, 180 );
+	tracer.add_mesh( scene, kIdentity44f, nullptr, 0, scene.positions.size() );
+	tracer.build();
+	tracer.set_camera( make_projection_( 320.f / 180.f ) * make_rotation_x( 0.3f ) * make_translation( { 0.f, -3.f, 2.f } ) );
+
+	BENCHMARK( "320x180, 1 sample per pixel" )
+	{
+		tracer.render( 1 );
+		return tracer.rays();
+	};
+}
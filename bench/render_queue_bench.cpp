@@ -0,0 +1,133 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "../main/render_queue.hpp"
+
+#include "../main/particles.hpp" // particle_hash()
+
+namespace
+{
+	struct Draw_
+	{
+		RenderPass pass;
+		std::uint32_t program, material;
+		float depth;
+	};
+
+	std::vector<Draw_> make_draws_( std::size_t aCount )
+	{
+		std::vector<Draw_> draws;
+		for( std::size_t i = 0; i < aCount; ++i )
+		{
+			std::uint32_t const h = particle_hash( std::uint32_t(i) );
+			draws.emplace_back( Draw_{
+				(h & 1) ? RenderPass::opaque : RenderPass::depthPrepass,
+				(h >> 1) % 6,
+				(h >> 4) % 40,
+				float(h >> 12) / 4096.f - 100.f // some behind the camera
+			} );
+		}
+		return draws;
+	}
+}
+
+TEST_CASE( "Sort keys", "[render_queue]" )
+{
+	auto const key = make_sort_key( RenderPass::opaque, 0x2a, 0x1234, 5.f );
+	REQUIRE( RenderPass::opaque == sort_key_pass( key ) );
+	REQUIRE( 0x2a == sort_key_program( key ) );
+	REQUIRE( 0x1234 == sort_key_material( key ) );
+
+	SECTION( "Depth orders front to back" )
+	{
+		REQUIRE( make_sort_key( RenderPass::opaque, 1, 1, -2.f ) < make_sort_key( RenderPass::opaque, 1, 1, -1.f ) );
+		REQUIRE( make_sort_key( RenderPass::opaque, 1, 1, -1.f ) < make_sort_key( RenderPass::opaque, 1, 1, 0.f ) );
+		REQUIRE( make_sort_key( RenderPass::opaque, 1, 1, 0.f ) < make_sort_key( RenderPass::opaque, 1, 1, 0.5f ) );
+		REQUIRE( make_sort_key( RenderPass::opaque, 1, 1, 0.5f ) < make_sort_key( RenderPass::opaque, 1, 1, 80.f ) );
+	}
+
+	SECTION( "Pass, program and material before depth" )
+	{
+		REQUIRE( make_sort_key( RenderPass::depthPrepass, 5, 5, 99.f ) < make_sort_key( RenderPass::opaque, 0, 0, 0.f ) );
+		REQUIRE( make_sort_key( RenderPass::opaque, 1, 9, 99.f ) < make_sort_key( RenderPass::opaque, 2, 0, 0.f ) );
+		REQUIRE( make_sort_key( RenderPass::opaque, 1, 1, 99.f ) < make_sort_key( RenderPass::opaque, 1, 2, 0.f ) );
+	}
+}
+
+TEST_CASE( "Render queue sorting", "[render_queue]" )
+{
+	auto const draws = make_draws_( 5000 );
+
+	RenderQueue queue;
+	for( std::size_t i = 0; i < draws.size(); ++i )
+		queue.submit( draws[i].pass, draws[i].program, draws[i].material, draws[i].depth, std::uint32_t(i) );
+
+	queue.sort();
+
+	auto const& entries = queue.entries();
+	REQUIRE( entries.size() == draws.size() );
+
+	// Sorted, and a permutation of the submitted draws
+	std::vector<bool> seen( draws.size(), false );
+	for( std::size_t i = 0; i < entries.size(); ++i )
+	{
+		if( i )
+		{
+			REQUIRE( entries[i-1].key <= entries[i].key );
+		}
+
+		auto const item = entries[i].item;
+		REQUIRE( !seen[item] );
+		seen[item] = true;
+
+		auto const& draw = draws[item];
+		REQUIRE( entries[i].key == make_sort_key( draw.pass, draw.program, draw.material, draw.depth ) );
+	}
+
+	SECTION( "Stable, and reusable after clearing" )
+	{
+		queue.clear();
+		for( std::uint32_t i = 0; i < 100; ++i )
+			queue.submit( RenderPass::opaque, 3 - i % 4, 0, 1.f, i );
+
+		queue.sort();
+
+		auto const& resorted = queue.entries();
+		REQUIRE( resorted.size() == 100 );
+		for( std::size_t i = 1; i < resorted.size(); ++i )
+		{
+			if( resorted[i-1].key == resorted[i].key )
+			{
+				REQUIRE( resorted[i-1].item < resorted[i].item );
+			}
+		}
+	}
+}
+
+TEST_CASE( "Render queue benchmark", "[render_queue][!benchmark]" )
+{
+	auto const draws = make_draws_( 10'000 );
+
+	RenderQueue queue;
+	std::vector<std::uint64_t> keys;
+
+	BENCHMARK( "10k draws, radix sort" )
+	{
+		queue.clear();
+		for( std::size_t i = 0; i < draws.size(); ++i )
+			queue.submit( draws[i].pass, draws[i].program, draws[i].material, draws[i].depth, std::uint32_t(i) );
+		queue.sort();
+		return queue.entries().front().item;
+	};
+
+	BENCHMARK( "10k draws, std::sort (reference)" )
+	{
+		keys.clear();
+		for( auto const& draw : draws )
+			keys.emplace_back( make_sort_key( draw.pass, draw.program, draw.material, draw.depth ) );
+		std::sort( keys.begin(), keys.end() );
+		return keys.front();
+	};
+}
@@ -0,0 +1,270 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include <cstdio>
+#include <cstring>
+
+#include "../main/obj_stream.hpp"
+#include "../main/scene_file.hpp"
+
+#include "../support/error.hpp"
+
+namespace
+{
+	std::filesystem::path temp_path_( char const* aName )
+	{
+		return std::filesystem::temp_directory_path() / aName;
+	}
+
+	void write_bytes_( std::filesystem::path const& aPath, void const* aData, std::size_t aSize )
+	{
+		std::FILE* fout = std::fopen( aPath.string().c_str(), "wb" );
+		REQUIRE( fout );
+		std::fwrite( aData, 1, aSize, fout );
+		std::fclose( fout );
+	}
+
+	void write_text_( std::filesystem::path const& aPath, std::string const& aText )
+	{
+		write_bytes_( aPath, aText.data(), aText.size() );
+	}
+
+	std::vector<char> read_bytes_( std::filesystem::path const& aPath )
+	{
+		std::vector<char> ret( std::filesystem::file_size( aPath ) );
+
+		std::FILE* fin = std::fopen( aPath.string().c_str(), "rb" );
+		REQUIRE( fin );
+		REQUIRE( ret.size() == std::fread( ret.data(), 1, ret.size(), fin ) );
+		std::fclose( fin );
+		return ret;
+	}
+
+	// One of each kind of entry: loaded, streamed and procedural meshes, a
+	// node hierarchy and a path.
+	struct Files_
+	{
+		std::filesystem::path json, obj, mtl, binary, cacheDir;
+
+		Files_()
+			: json( temp_path_( "scene_file_test.json" ) )
+			, obj( temp_path_( "scene_file_test.obj" ) )
+			, mtl( temp_path_( "scene_file_test.mtl" ) )
+			, binary( temp_path_( "scene_file_test.scnb" ) )
+			, cacheDir( temp_path_( "scene_file_test_cache" ) )
+		{
+			write_text_( mtl, "newmtl pad\nKa 0.2 0.4 0.6\nKd 1 1 1\n" );
+			write_text_( obj, "mtllib scene_file_test.mtl\nusemtl pad\n"
+				"v 0 0 0\nv 1 0 0\nv 1 0 1\nv 0 0 1\nvn 0 1 0\nvt 0 0\nvt 1 1\n"
+				"f 1/1/1 2/2/1 3/2/1 4/1/1\n"
+			);
+
+			std::string const objPath = obj.generic_string();
+			write_text_( json, R"({
+				"materials": [
+					{ "name": "pad", "texture": "pad.png" },
+					{ "name": "hull", "color": [0.25, 0.5, 0.75] }
+				],
+				"meshes": [
+					{ "name": "pad", "obj": ")" + objPath + R"(", "material": "pad" },
+					{ "name": "big", "obj": ")" + objPath + R"(", "stream": true },
+					{ "name": "body", "primitive": "cylinder", "subdivs": 8, "material": "hull" },
+					{ "name": "leg", "primitive": "cube", "material": "hull" }
+				],
+				"nodes": [
+					{ "name": "pad", "mesh": "pad", "translate": [5, 0, -5] },
+					{ "name": "ship", "translate": [1, 2, 3], "rotate": [0, 90, 0] },
+					{ "name": "body", "parent": "ship", "mesh": "body", "scale": [1, 0.5, 0.5] },
+					{ "name": "leg", "parent": "ship", "mesh": "leg", "scale": 0.1 },
+					{ "name": "big", "mesh": "big" }
+				],
+				"paths": [
+					{ "name": "loop", "duration": 10, "loop": true, "points": [ [0,0,0], [1,0,0], [1,1,0], [0,1,0] ] },
+					{ "name": "arc", "curve": "bezier", "duration": 2, "points": [ [0,0,0], [0,1,0], [1,1,0], [1,0,0] ] }
+				]
+			})" );
+		}
+		~Files_()
+		{
+			std::error_code ec;
+			std::filesystem::remove( json, ec );
+			std::filesystem::remove( obj, ec );
+			std::filesystem::remove( mtl, ec );
+			std::filesystem::remove( binary, ec );
+			std::filesystem::remove_all( cacheDir, ec );
+		}
+	};
+
+	template< typename tArray >
+	bool same_( tArray const& aA, tArray const& aB )
+	{
+		return aA.size() == aB.size() && 0 == std::memcmp( aA.data(), aB.data(), aA.size() * sizeof(aA[0]) );
+	}
+
+	bool same_( SimpleMeshData const& aA, SimpleMeshData const& aB )
+	{
+		return same_( aA.positions, aB.positions ) && same_( aA.colors, aB.colors ) && same_( aA.normals, aB.normals ) && same_( aA.texcoords, aB.texcoords );
+	}
+}
+
+TEST_CASE( "Scene binaries", "[scene_file]" )
+{
+	Files_ files;
+
+	std::vector<std::string> sources;
+	SceneDesc const compiled = compile_scene( files.json.string().c_str(), &sources, files.cacheDir.string() );
+	REQUIRE( 4 == sources.size() ); // JSON, both OBJ meshes, and the streamed mesh's material library
+
+	save_scene_binary( compiled, files.binary.string().c_str(), sources );
+
+	SECTION( "Round trip" )
+	{
+		SceneDesc const loaded = load_scene_binary( files.binary.string().c_str(), true );
+
+		REQUIRE( compiled.materials.size() == loaded.materials.size() );
+		for( std::size_t i = 0; i < compiled.materials.size(); ++i )
+		{
+			auto const& a = compiled.materials[i];
+			auto const& b = loaded.materials[i];
+			REQUIRE( a.name == b.name );
+			REQUIRE( 0 == std::memcmp( &a.color, &b.color, sizeof(Vec3f) ) );
+			REQUIRE( a.texture == b.texture );
+		}
+		REQUIRE( "pad.png" == loaded.materials[0].texture );
+
+		REQUIRE( compiled.meshes.size() == loaded.meshes.size() );
+		for( std::size_t i = 0; i < compiled.meshes.size(); ++i )
+		{
+			auto const& a = compiled.meshes[i];
+			auto const& b = loaded.meshes[i];
+			REQUIRE( a.name == b.name );
+			REQUIRE( a.material == b.material );
+			REQUIRE( a.streamed == b.streamed );
+			REQUIRE( same_( a.data, b.data ) );
+		}
+		REQUIRE( 6 == loaded.meshes[0].data.positions.size() ); // one quad
+		REQUIRE( !loaded.meshes[1].streamed.empty() );
+		REQUIRE( loaded.meshes[1].data.positions.empty() );
+
+		REQUIRE( compiled.nodes.size() == loaded.nodes.size() );
+		for( std::size_t i = 0; i < compiled.nodes.size(); ++i )
+		{
+			auto const& a = compiled.nodes[i];
+			auto const& b = loaded.nodes[i];
+			REQUIRE( a.name == b.name );
+			REQUIRE( a.parent == b.parent );
+			REQUIRE( a.mesh == b.mesh );
+			REQUIRE( 0 == std::memcmp( &a.transform, &b.transform, sizeof(Mat44f) ) );
+		}
+		REQUIRE( 1 == loaded.nodes[2].parent );
+
+		REQUIRE( compiled.paths.size() == loaded.paths.size() );
+		for( std::size_t i = 0; i < compiled.paths.size(); ++i )
+		{
+			auto const& a = compiled.paths[i];
+			auto const& b = loaded.paths[i];
+			REQUIRE( a.name == b.name );
+			REQUIRE( a.curve == b.curve );
+			REQUIRE( a.duration == b.duration );
+			REQUIRE( a.loop == b.loop );
+			REQUIRE( same_( a.points, b.points ) );
+		}
+		REQUIRE( EPathCurve::bezier == loaded.paths[1].curve );
+	}
+
+	SECTION( "Changed sources" )
+	{
+		std::filesystem::last_write_time( files.obj, std::filesystem::last_write_time( files.obj ) + std::chrono::seconds( 10 ) );
+		REQUIRE_THROWS_AS( load_scene_binary( files.binary.string().c_str(), true ), Error );
+		REQUIRE_NOTHROW( load_scene_binary( files.binary.string().c_str(), false ) );
+	}
+
+	SECTION( "Changed material libraries" )
+	{
+		// The streamed mesh's cache is reimported when its colors change.
+		auto const first_color = [&] {
+			MeshCacheReader in( compiled.meshes[1].streamed.c_str() );
+			std::vector<Vec3f> positions( in.next_block() ), colors( positions.size() ), normals( positions.size() );
+			std::vector<Vec2f> texcoords( positions.size() );
+			in.read_block( positions.data(), colors.data(), normals.data(), texcoords.data() );
+			return colors.at( 0 );
+		};
+		REQUIRE( first_color().z == Catch::Approx( 0.6f ) );
+
+		write_text_( files.mtl, "newmtl pad\nKa 0.9 0.8 0.7\n" );
+		std::filesystem::last_write_time( files.mtl, std::filesystem::last_write_time( files.mtl ) + std::chrono::seconds( 10 ) );
+		REQUIRE_THROWS_AS( load_scene_binary( files.binary.string().c_str(), true ), Error );
+
+		SceneDesc const recompiled = compile_scene( files.json.string().c_str(), nullptr, files.cacheDir.string() );
+		REQUIRE( recompiled.meshes[1].streamed == compiled.meshes[1].streamed );
+		REQUIRE( first_color().z == Catch::Approx( 0.7f ) );
+	}
+
+	SECTION( "Truncated and corrupt binaries" )
+	{
+		auto const original = read_bytes_( files.binary );
+		auto const corrupt = temp_path_( "scene_file_test_corrupt.scnb" );
+
+		// Anything but Error (e.g., std::bad_alloc) fails the test.
+		auto const load = [&] (std::vector<char> const& aBytes) {
+			write_bytes_( corrupt, aBytes.data(), aBytes.size() );
+			try
+			{
+				load_scene_binary( corrupt.string().c_str(), false );
+				return true;
+			}
+			catch( Error const& )
+			{
+				return false;
+			}
+		};
+
+		REQUIRE( load( original ) );
+
+		// Every truncation is detected.
+		for( std::size_t size = 0; size < original.size(); size += 1 + size / 64 )
+		{
+			std::vector<char> const bytes( original.begin(), original.begin() + std::ptrdiff_t(size) );
+			INFO( "Size " << size );
+			REQUIRE( !load( bytes ) );
+		}
+
+		// Huge lengths and counts anywhere are either rejected or harmless
+		// (e.g., within vertex data).
+		std::size_t rejected = 0;
+		for( std::size_t offset = 0; offset+4 <= original.size(); ++offset )
+		{
+			auto bytes = original;
+			std::memset( bytes.data() + offset, 0xff, 4 );
+			INFO( "Offset " << offset );
+			rejected += !load( bytes );
+		}
+		REQUIRE( rejected > 0 );
+
+		std::error_code ec;
+		std::filesystem::remove( corrupt, ec );
+	}
+}
+
+TEST_CASE( "Scene binary benchmark", "[scene_file][!benchmark]" )
+{
+	Files_ files;
+
+	std::vector<std::string> sources;
+	SceneDesc const compiled = compile_scene( files.json.string().c_str(), &sources, files.cacheDir.string() );
+	save_scene_binary( compiled, files.binary.string().c_str(), sources );
+
+	BENCHMARK( "compile_scene()" )
+	{
+		return compile_scene( files.json.string().c_str(), nullptr, files.cacheDir.string() ).meshes.size();
+	};
+
+	BENCHMARK( "load_scene_binary()" )
+	{
+		return load_scene_binary( files.binary.string().c_str(), true ).meshes.size();
+	};
+}
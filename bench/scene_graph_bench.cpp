@@ -0,0 +1,81 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <string>
+#include <vector>
+
+#include "../main/scene_graph.hpp"
+
+namespace
+{
+	// Articulated vehicles: a root with aParts children, each with two
+	// sub-parts.
+	SceneGraph make_vehicles_( std::size_t aCount, std::size_t aParts, std::vector<SceneNode>& aRoots )
+	{
+		SceneGraph graph;
+		for( std::size_t i = 0; i < aCount; ++i )
+		{
+			auto const root = graph.add_node( kNoSceneNode, make_translation( { float(i), 0.f, 0.f } ) );
+			aRoots.emplace_back( root );
+
+			for( std::size_t j = 0; j < aParts; ++j )
+			{
+				auto const part = graph.add_node( root, make_rotation_y( float(j) ) );
+				graph.add_node( part, make_scaling( 1.f, 2.f, 1.f ) );
+				graph.add_node( part, make_translation( { 0.f, 1.f, 0.f } ) );
+			}
+		}
+		return graph;
+	}
+}
+
+TEST_CASE( "Scene graph", "[scene]" )
+{
+	SceneGraph graph;
+	auto const root = graph.add_node( kNoSceneNode, make_translation( { 1.f, 0.f, 0.f } ) );
+	auto const child = graph.add_node( root, make_rotation_z( 0.5f ) );
+	auto const leaf = graph.add_node( child, make_translation( { 0.f, 2.f, 0.f } ) );
+	auto const other = graph.add_node( kNoSceneNode, make_scaling( 2.f, 2.f, 2.f ) );
+
+	REQUIRE( 4 == graph.update() );
+	REQUIRE( 0 == graph.update() );
+
+	auto const expected = make_translation( { 1.f, 0.f, 0.f } ) * make_rotation_z( 0.5f ) * make_translation( { 0.f, 2.f, 0.f } );
+	for( std::size_t i = 0; i < 16; ++i )
+	{
+		REQUIRE( graph.world( leaf ).v[i] == Catch::Approx( expected.v[i] ).margin( 1e-6 ) );
+	}
+
+	SECTION( "Dirty subtrees only" )
+	{
+		graph.set_local( child, kIdentity44f );
+		REQUIRE( 2 == graph.update() );
+		REQUIRE( graph.world( leaf )(0,3) == Catch::Approx( 1.f ) );
+		REQUIRE( graph.world( leaf )(1,3) == Catch::Approx( 2.f ) );
+		REQUIRE( graph.world( other )(0,0) == Catch::Approx( 2.f ) );
+	}
+}
+
+TEST_CASE( "Scene graph update", "[scene][!benchmark]" )
+{
+	auto const count = GENERATE( 100u, 10'000u );
+
+	std::vector<SceneNode> roots;
+	SceneGraph graph = make_vehicles_( count, 8, roots );
+	graph.update();
+
+	auto const suffix = std::to_string( graph.size() ) + " nodes";
+
+	BENCHMARK( "update(), all roots moved, " + suffix )
+	{
+		for( auto const root : roots )
+			graph.set_local( root, make_translation( { 1.f, 2.f, 3.f } ) );
+		return graph.update();
+	};
+
+	BENCHMARK( "update(), 1% of roots moved, " + suffix )
+	{
+		for( std::size_t i = 0; i < roots.size(); i += 100 )
+			graph.set_local( roots[i], make_translation( { 1.f, 2.f, 3.f } ) );
+		return graph.update();
+	};
+}
@@ -0,0 +1,234 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <random>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <cstring>
+#include <cstdint>
+
+#include "../support/triple_buffer.hpp"
+
+#include "../main/ship_simulation.hpp"
+
+namespace
+{
+	constexpr auto kStep_ = std::chrono::duration_cast<Clock::duration>( Secondsf( ShipSimulation::kTimeStep ) );
+
+	ShipParams make_params_()
+	{
+		ShipParams params;
+		params.initPosition = { 1.f, 2.f, 3.f };
+		params.acceleration = 0.5f;
+		return params;
+	}
+
+	// Runs aSim for aSteps steps from aStart, with the given frame lengths
+	// (repeated as necessary), and returns the state rendered half-way into
+	// the following step.
+	ShipState run_( ShipSimulation& aSim, Clock::time_point aStart, unsigned aSteps, std::vector<Clock::duration> const& aFrames )
+	{
+		auto const end = aStart + aSteps * kStep_;
+
+		auto now = aStart;
+		for( std::size_t i = 0; now < end; ++i )
+		{
+			now = std::min( now + aFrames[i % aFrames.size()], end );
+			aSim.update( now );
+		}
+
+		return aSim.update( end + kStep_ / 2 );
+	}
+
+	bool same_( ShipState const& aA, ShipState const& aB )
+	{
+		return aA.isAnimation == aB.isAnimation
+			&& 0 == std::memcmp( &aA.speed, &aB.speed, sizeof(float) )
+			&& 0 == std::memcmp( &aA.angle, &aB.angle, sizeof(float) )
+			&& 0 == std::memcmp( &aA.position, &aB.position, sizeof(Vec3f) )
+			&& 0 == std::memcmp( &aA.direction, &aB.direction, sizeof(Vec3f) )
+		;
+	}
+
+	// Every element holds the same value, so a torn read shows up as a
+	// mismatch.
+	struct Payload_
+	{
+		std::uint64_t values[32];
+	};
+}
+
+TEST_CASE( "Ship simulation", "[ship_simulation]" )
+{
+	SECTION( "Independent of the frame times" )
+	{
+		constexpr unsigned kSteps = 1000;
+
+		std::mt19937 rng( 3 );
+		std::uniform_int_distribution<Clock::rep> jitter( 0, (ShipSimulation::kMaxStepsPerUpdate * kStep_).count() );
+
+		std::vector<Clock::duration> const frames[] = {
+			{ kStep_ },                       // exactly one step per frame
+			{ 2 * kStep_ },                   // 60 Hz
+			{ kStep_ / 7 },                   // high frame rate; most frames don't step
+			{ 3 * kStep_ + kStep_ / 3, Clock::duration( 0 ), kStep_ / 2 },
+			[&] {
+				std::vector<Clock::duration> ret( 257 );
+				for( auto& d : ret )
+					d = Clock::duration( jitter( rng ) );
+				return ret;
+			}()
+		};
+
+		auto const start = Clock::now() + std::chrono::seconds( 1 );
+
+		ShipState reference{};
+		for( auto const& split : frames )
+		{
+			ShipSimulation sim( make_params_() );
+
+			// Catching up from construction drops the excess time, which
+			// leaves the simulation exactly one step behind start.
+			sim.update( start );
+			REQUIRE( ShipSimulation::kMaxStepsPerUpdate == sim.ticks() );
+
+			sim.toggle_animation();
+			ShipState const state = run_( sim, start - kStep_, kSteps, split );
+			REQUIRE( ShipSimulation::kMaxStepsPerUpdate + kSteps == sim.ticks() );
+
+			if( &split == frames )
+			{
+				reference = state;
+				REQUIRE( reference.isAnimation );
+				REQUIRE( reference.position.y > make_params_().initPosition.y );
+			}
+			else
+			{
+				REQUIRE( same_( reference, state ) );
+			}
+		}
+	}
+
+	SECTION( "Matches step_ship()" )
+	{
+		ShipParams const params = make_params_();
+
+		ShipSimulation sim( params );
+		auto const start = Clock::now() + std::chrono::seconds( 1 );
+		sim.update( start );
+
+		sim.toggle_animation();
+		ShipState const state = run_( sim, start - kStep_, 100, { 2 * kStep_ } );
+
+		// Half-way between steps 99 and 100 (up to rounding of the step)
+		float const alpha = std::chrono::duration_cast<Secondsf>( kStep_ / 2 ).count() / ShipSimulation::kTimeStep;
+
+		ShipState prev = make_initial_ship_state( params ), next;
+		prev.isAnimation = true;
+		for( int i = 0; i < 99; ++i )
+			step_ship( prev, params, ShipSimulation::kTimeStep );
+		next = prev;
+		step_ship( next, params, ShipSimulation::kTimeStep );
+
+		REQUIRE( same_( interpolate( prev, next, alpha ), state ) );
+	}
+}
+
+TEST_CASE( "Triple buffer", "[ship_simulation]" )
+{
+	SECTION( "Latest value" )
+	{
+		TripleBuffer<int> buffer;
+		REQUIRE( !buffer.update() );
+		REQUIRE( 0 == buffer.read() );
+
+		for( int i = 1; i <= 3; ++i )
+		{
+			buffer.write_buffer() = i;
+			buffer.publish();
+		}
+
+		REQUIRE( buffer.update() );
+		REQUIRE( 3 == buffer.read() );
+		REQUIRE( !buffer.update() );
+		REQUIRE( 3 == buffer.read() );
+
+		buffer.write_buffer() = 4;
+		buffer.publish();
+		REQUIRE( buffer.update() );
+		REQUIRE( 4 == buffer.read() );
+	}
+
+	SECTION( "Concurrent producer and consumer" )
+	{
+		constexpr std::uint64_t kCount = 200'000;
+
+		TripleBuffer<Payload_> buffer;
+
+		std::thread producer( [&buffer] {
+			for( std::uint64_t i = 1; i <= kCount; ++i )
+			{
+				auto& payload = buffer.write_buffer();
+				for( auto& v : payload.values )
+					v = i;
+				buffer.publish();
+			}
+		} );
+
+		// Each value read must be whole, and newer than the previous one
+		// whenever update() reports a new value.
+		std::uint64_t last = 0, torn = 0, stale = 0, seen = 0;
+		while( last < kCount )
+		{
+			bool const fresh = buffer.update();
+
+			auto const& payload = buffer.read();
+			std::uint64_t const first = payload.values[0];
+			for( auto const v : payload.values )
+				torn += v != first;
+
+			if( fresh )
+			{
+				stale += first <= last;
+				++seen;
+			}
+			else
+			{
+				stale += first != last;
+			}
+
+			last = first;
+		}
+
+		producer.join();
+
+		REQUIRE( 0 == torn );
+		REQUIRE( 0 == stale );
+		REQUIRE( seen > 0 );
+		REQUIRE( kCount == last );
+		REQUIRE( !buffer.update() );
+	}
+}
+
+TEST_CASE( "Ship simulation benchmark", "[ship_simulation][!benchmark]" )
+{
+	ShipSimulation sim( make_params_() );
+	sim.toggle_animation();
+
+	auto now = Clock::now();
+	BENCHMARK( "ShipSimulation::update(), 60 Hz" )
+	{
+		now += 2 * kStep_;
+		return sim.update( now ).position.x;
+	};
+
+	TripleBuffer<Payload_> buffer;
+	BENCHMARK( "TripleBuffer publish and update" )
+	{
+		buffer.write_buffer().values[0] += 1;
+		buffer.publish();
+		buffer.update();
+		return buffer.read().values[0];
+	};
+}
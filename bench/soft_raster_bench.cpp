@@ -0,0 +1,285 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <cmath>
+#include <algorithm>
+#include <numbers>
+#include <vector>
+
+#include "../main/soft_raster.hpp"
+#include "../main/simple_mesh.hpp"
+#include "../main/particles.hpp" // particle_hash()
+
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	void add_quad_( SimpleMeshData& aMesh, Vec3f aA, Vec3f aB, Vec3f aC, Vec3f aD, Vec3f aColor )
+	{
+		for( auto const& p : { aA, aB, aC, aA, aC, aD } )
+		{
+			aMesh.positions.emplace_back( p );
+			aMesh.colors.emplace_back( aColor );
+		}
+	}
+
+	// Jittered grid over the viewport, in clip space (w = 1). Interior
+	// vertices are shared, and so are the edges.
+	SimpleMeshData make_grid_( std::size_t aN )
+	{
+		auto const vertex = [&] (std::size_t aX, std::size_t aY) {
+			float x = -1.f + 2.f * float(aX) / float(aN);
+			float y = -1.f + 2.f * float(aY) / float(aN);
+			if( aX > 0 && aX < aN && aY > 0 && aY < aN )
+			{
+				std::uint32_t const h = particle_hash( std::uint32_t(aY * (aN+1) + aX) );
+				x += (float(h & 0xffff) / 65535.f - 0.5f) / float(aN);
+				y += (float(h >> 16) / 65535.f - 0.5f) / float(aN);
+			}
+			return Vec3f{ x, y, 0.f };
+		};
+
+		SimpleMeshData mesh;
+		for( std::size_t y = 0; y < aN; ++y )
+		{
+			for( std::size_t x = 0; x < aN; ++x )
+				add_quad_( mesh, vertex( x, y ), vertex( x+1, y ), vertex( x+1, y+1 ), vertex( x, y+1 ), { 1.f, 1.f, 1.f } );
+		}
+		return mesh;
+	}
+
+	std::vector<std::uint8_t> make_checker_( std::size_t aSize )
+	{
+		std::vector<std::uint8_t> texels;
+		for( std::size_t y = 0; y < aSize; ++y )
+		{
+			for( std::size_t x = 0; x < aSize; ++x )
+			{
+				std::uint8_t const c = ((x / 8) ^ (y / 8)) & 1 ? 255 : 40;
+				texels.insert( texels.end(), { c, std::uint8_t(255-c), 128, 255 } );
+			}
+		}
+		return texels;
+	}
+
+	// Ground plane of aN x aN quads, with normals and texture coordinates
+	SimpleMeshData make_terrain_( std::size_t aN, float aSize )
+	{
+		SimpleMeshData mesh;
+		for( std::size_t z = 0; z < aN; ++z )
+		{
+			for( std::size_t x = 0; x < aN; ++x )
+			{
+				float const x0 = aSize * (float(x) / float(aN) - 0.5f), x1 = aSize * (float(x+1) / float(aN) - 0.5f);
+				float const z0 = aSize * (float(z) / float(aN) - 0.5f), z1 = aSize * (float(z+1) / float(aN) - 0.5f);
+				float const h = 0.2f * std::sin( x0 ) * std::cos( z0 );
+
+				// Counter-clockwise seen from above
+				add_quad_( mesh, { x0, h, z1 }, { x1, h, z1 }, { x1, h, z0 }, { x0, h, z0 }, { 1.f, 1.f, 1.f } );
+				for( int i = 0; i < 6; ++i )
+					mesh.normals.emplace_back( Vec3f{ 0.f, 1.f, 0.f } );
+
+				float const u0 = float(x) / float(aN), u1 = float(x+1) / float(aN);
+				float const v0 = float(z) / float(aN), v1 = float(z+1) / float(aN);
+				for( auto const& uv : { Vec2f{ u0, v1 }, Vec2f{ u1, v1 }, Vec2f{ u1, v0 }, Vec2f{ u0, v1 }, Vec2f{ u1, v0 }, Vec2f{ u0, v0 } } )
+					mesh.texcoords.emplace_back( uv );
+			}
+		}
+		return mesh;
+	}
+
+	Mat44f make_projection_( float aAspect )
+	{
+		return make_perspective_projection( 60.f * std::numbers::pi_v<float> / 180.f, aAspect, 0.1f, 100.f );
+	}
+
+	std::uint32_t center_( SoftRasterizer const& aRaster )
+	{
+		return aRaster.color()[aRaster.height()/2 * aRaster.width() + aRaster.width()/2];
+	}
+
+	float decode_( std::uint32_t aColor, unsigned aChannel )
+	{
+		float const c = float((aColor >> 8*aChannel) & 0xff) / 255.f;
+		return c <= 0.04045f ? c / 12.92f : std::pow( (c + 0.055f) / 1.055f, 2.4f );
+	}
+}
+
+TEST_CASE( "Software rasterizer coverage", "[soft_raster]" )
+{
+	ThreadPool pool( 2 );
+
+	// Odd sizes, so that the tiles at the edges are partial
+	std::size_t const w = 97, h = 71;
+	SimpleMeshData const grid = make_grid_( 6 );
+
+	SECTION( "No gaps" )
+	{
+		SoftRasterizer raster( pool, w, h );
+		raster.clear( { 0.f, 0.f, 0.f } );
+		render_model( raster, grid, kIdentity44f, kIdentity44f, kIdentity44f, nullptr, grid.positions.size() );
+		raster.finish();
+
+		for( auto const c : raster.color() )
+		{
+			REQUIRE( 0xffffffffu == c );
+		}
+	}
+
+	SECTION( "No pixel drawn twice" )
+	{
+		// Each triangle on its own; the coverage must add up exactly.
+		SoftRasterizer raster( pool, w, h );
+
+		std::size_t covered = 0;
+		for( std::size_t first = 0; first < grid.positions.size(); first += 3 )
+		{
+			raster.clear( { 0.f, 0.f, 0.f } );
+			render_model( raster, grid, kIdentity44f, kIdentity44f, kIdentity44f, nullptr, 3, first );
+			raster.finish();
+
+			for( auto const c : raster.color() )
+				covered += (0xffffffffu == c);
+		}
+
+		REQUIRE( w * h == covered );
+	}
+
+	SECTION( "Back faces are culled" )
+	{
+		SimpleMeshData flipped;
+		for( std::size_t i = 0; i < grid.positions.size(); i += 3 )
+		{
+			for( std::size_t k : { 0, 2, 1 } )
+			{
+				flipped.positions.emplace_back( grid.positions[i+k] );
+				flipped.colors.emplace_back( grid.colors[i+k] );
+			}
+		}
+
+		SoftRasterizer raster( pool, w, h );
+		raster.clear( { 0.f, 0.f, 0.f } );
+		render_model( raster, flipped, kIdentity44f, kIdentity44f, kIdentity44f, nullptr, flipped.positions.size() );
+		raster.finish();
+
+		REQUIRE( 0 == raster.triangle_count() );
+		REQUIRE( std::all_of( raster.color().begin(), raster.color().end(), [] (std::uint32_t aC) { return 0xff000000u == aC; } ) );
+	}
+}
+
+TEST_CASE( "Software rasterizer depth and interpolation", "[soft_raster]" )
+{
+	ThreadPool pool( 2 );
+	std::size_t const size = 128;
+	Mat44f const projection = make_projection_( 1.f );
+
+	SECTION( "Depth test is independent of the draw order" )
+	{
+		SimpleMeshData near, far;
+		add_quad_( near, { -1.f, -1.f, -3.f }, { 1.f, -1.f, -3.f }, { 1.f, 1.f, -3.f }, { -1.f, 1.f, -3.f }, { 1.f, 0.f, 0.f } );
+		add_quad_( far, { -2.f, -2.f, -5.f }, { 2.f, -2.f, -5.f }, { 2.f, 2.f, -5.f }, { -2.f, 2.f, -5.f }, { 0.f, 0.f, 1.f } );
+
+		for( bool nearFirst : { true, false } )
+		{
+			SoftRasterizer raster( pool, size, size );
+			raster.clear( { 0.f, 0.f, 0.f } );
+			render_model( raster, nearFirst ? near : far, projection, kIdentity44f, kIdentity44f, nullptr, 6 );
+			render_model( raster, nearFirst ? far : near, projection, kIdentity44f, kIdentity44f, nullptr, 6 );
+			raster.finish();
+
+			REQUIRE( center_( raster ) == 0xff0000ffu );
+		}
+	}
+
+	SECTION( "Perspective-correct attributes, clipped at the near plane" )
+	{
+		// Floor, from behind the camera to z = -9. The vertex colors encode
+		// the world position: red along x, green along z.
+		SimpleMeshData floor;
+		floor.positions = { { -1.f, -1.f, 1.f }, { 1.f, -1.f, 1.f }, { 1.f, -1.f, -9.f }, { -1.f, -1.f, 1.f }, { 1.f, -1.f, -9.f }, { -1.f, -1.f, -9.f } };
+		floor.colors = { { 0.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, { 1.f, 1.f, 0.f }, { 0.f, 0.f, 0.f }, { 1.f, 1.f, 0.f }, { 0.f, 1.f, 0.f } };
+
+		SoftRasterizer raster( pool, size, size );
+		raster.clear( { 0.f, 0.f, 1.f } );
+		render_model( raster, floor, projection, kIdentity44f, kIdentity44f, nullptr, 6 );
+		raster.finish();
+
+		float const tanHalf = std::tan( 30.f * std::numbers::pi_v<float> / 180.f );
+		for( std::size_t py = 0; py < size/2 - 4; py += 5 )
+		{
+			for( std::size_t px = 0; px < size; px += 7 )
+			{
+				// Intersect the pixel's ray with the floor
+				float const dx = (2.f * (float(px) + 0.5f) / float(size) - 1.f) * tanHalf;
+				float const dy = (2.f * (float(py) + 0.5f) / float(size) - 1.f) * tanHalf;
+				float const t = -1.f / dy;
+				float const x = dx * t, z = -t;
+
+				if( std::abs( x ) > 0.95f || z < -8.9f )
+					continue;
+
+				auto const c = raster.color()[py*size + px];
+				REQUIRE_THAT( decode_( c, 0 ), Catch::Matchers::WithinAbs( (x + 1.f) / 2.f, 0.01 ) );
+				REQUIRE_THAT( decode_( c, 1 ), Catch::Matchers::WithinAbs( (1.f - z) / 10.f, 0.01 ) );
+			}
+		}
+	}
+}
+
+TEST_CASE( "Software rasterizer thread independence", "[soft_raster]" )
+{
+	auto const texels = make_checker_( 64 );
+	SoftTexture const texture( 64, 64, texels.data() );
+	SimpleMeshData const terrain = make_terrain_( 32, 20.f );
+
+	Mat44f const projection = make_projection_( 160.f / 90.f );
+	Mat44f const world2camera = make_rotation_x( 0.3f ) * make_translation( { 0.f, -2.f, 0.f } );
+
+	auto const render = [&] (unsigned aThreads) {
+		ThreadPool pool( aThreads );
+		SoftRasterizer raster( pool, 160, 90 );
+		raster.clear( { 0.1f, 0.2f, 0.3f } );
+		render_model( raster, terrain, projection, world2camera, kIdentity44f, &texture, terrain.positions.size() );
+		render_model( raster, terrain, projection, world2camera, make_translation( { 0.f, 0.5f, -3.f } ) * make_rotation_y( 0.7f ), nullptr, terrain.positions.size() );
+		raster.finish();
+		return std::make_pair( raster.color(), raster.depth() );
+	};
+
+	auto const single = render( 1 );
+	auto const multi = render( 4 );
+
+	REQUIRE( single.first == multi.first );
+	REQUIRE( single.second == multi.second );
+}
+
+TEST_CASE( "Software rasterizer benchmark", "[soft_raster][!benchmark]" )
+{
+	// Compare with the OpenGL renderer on llvmpipe, e.g., main's frame time
+	// with LIBGL_ALWAYS_SOFTWARE=1.
+	static ThreadPool pool;
+	SoftRasterizer raster( pool, 1280, 720 );
+
+	auto const texels = make_checker_( 1024 );
+	SoftTexture const texture( 1024, 1024, texels.data() );
+	SimpleMeshData const terrain = make_terrain_( 256, 60.f ); // 131k triangles
+
+	Mat44f const projection = make_projection_( 1280.f / 720.f );
+	Mat44f const world2camera = make_rotation_x( 0.25f ) * make_translation( { 0.f, -3.f, 0.f } );
+
+	BENCHMARK( "1280x720, textured terrain" )
+	{
+		raster.clear( { 0.f, 0.f, 0.f } );
+		render_model( raster, terrain, projection, world2camera, kIdentity44f, &texture, terrain.positions.size() );
+		raster.finish();
+		return raster.triangle_count();
+	};
+
+	SimpleMeshData const grid = make_grid_( 64 );
+	BENCHMARK( "1280x720, 8k triangles, 4x overdraw" )
+	{
+		raster.clear( { 0.f, 0.f, 0.f } );
+		for( int i = 0; i < 4; ++i )
+			render_model( raster, grid, kIdentity44f, kIdentity44f, make_translation( { 0.f, 0.f, -0.1f * float(i) } ), nullptr, grid.positions.size() );
+		raster.finish();
+		return raster.triangle_count();
+	};
+}
@@ -0,0 +1,261 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <filesystem>
+#include <numbers>
+#include <vector>
+
+#include <cmath>
+
+#include <stb_image_write.h>
+
+#include "../main/frustum.hpp"
+#include "../main/terrain.hpp"
+
+#include "../support/error.hpp"
+
+namespace
+{
+	// Procedural heights, smooth at every scale
+	Heightfield make_field_( std::size_t aSamples, float aSpacing )
+	{
+		Heightfield field;
+		field.samplesX = field.samplesZ = aSamples;
+		field.origin = Vec2f{ -0.5f * float(aSamples - 1) * aSpacing, -0.5f * float(aSamples - 1) * aSpacing };
+		field.spacing = aSpacing;
+		for( std::size_t j = 0; j < aSamples; ++j )
+		{
+			for( std::size_t i = 0; i < aSamples; ++i )
+			{
+				float const x = float(i) * aSpacing, z = float(j) * aSpacing;
+				field.heights.emplace_back( 20.f * std::sin( 0.011f * x ) * std::cos( 0.007f * z ) + 2.f * std::sin( 0.13f * x + 0.1f * z ) );
+			}
+		}
+		return field;
+	}
+
+	// Looking down at the terrain from above, with a wide view
+	Mat44f make_top_view_( Vec3f aEye, float aFar )
+	{
+		Mat44f const projection = make_perspective_projection( 170.f * std::numbers::pi_v<float> / 180.f, 1.f, 1.f, aFar );
+		return projection * make_rotation_x( 0.5f * std::numbers::pi_v<float> ) * make_translation( -aEye );
+	}
+
+	Mat44f make_ground_view_( Vec3f aEye, float aFar )
+	{
+		Mat44f const projection = make_perspective_projection( 60.f * std::numbers::pi_v<float> / 180.f, 16.f/9.f, 0.1f, aFar );
+		return projection * make_rotation_x( 0.2f ) * make_translation( -aEye );
+	}
+}
+
+TEST_CASE( "Heightfields", "[terrain]" )
+{
+	SECTION( "make_heightfield()" )
+	{
+		// A sloped plane, 10 x 6 units, as two triangles per cell
+		SimpleMeshData mesh;
+		auto const vertex = [&] (float aX, float aZ) {
+			mesh.positions.emplace_back( Vec3f{ aX, 0.5f * aX + 0.25f * aZ, aZ } );
+			mesh.texcoords.emplace_back( Vec2f{ aX / 10.f, 1.f - (aZ + 6.f) / 6.f } );
+		};
+		for( int z = -6; z < 0; ++z )
+		{
+			for( int x = 0; x < 10; ++x )
+			{
+				float const fx = float(x), fz = float(z);
+				vertex( fx, fz ); vertex( fx, fz+1.f ); vertex( fx+1.f, fz );
+				vertex( fx+1.f, fz ); vertex( fx, fz+1.f ); vertex( fx+1.f, fz+1.f );
+			}
+		}
+
+		Heightfield const field = make_heightfield( mesh, 41 );
+		REQUIRE( field.samplesX == 41 );
+		REQUIRE( field.samplesZ == 25 );
+		REQUIRE( field.spacing == Catch::Approx( 0.25f ) );
+		REQUIRE( field.origin.y == -6.f );
+
+		for( std::size_t j = 0; j < field.samplesZ; ++j )
+		{
+			for( std::size_t i = 0; i < field.samplesX; ++i )
+			{
+				float const x = field.origin.x + float(i) * field.spacing;
+				float const z = field.origin.y + float(j) * field.spacing;
+				REQUIRE( field.sample( i, j ) == Catch::Approx( 0.5f * x + 0.25f * z ).margin( 1e-5f ) );
+			}
+		}
+
+		// Bilinear in between, clamped outside
+		REQUIRE( field.height_at( 3.1f, -2.3f ) == Catch::Approx( 0.5f * 3.1f - 0.25f * 2.3f ) );
+		REQUIRE( field.height_at( 20.f, -3.f ) == Catch::Approx( 5.f - 0.75f ) );
+
+		// The texture coordinates are recovered exactly
+		REQUIRE( field.texcoordU.x == Catch::Approx( 0.1f ) );
+		REQUIRE( field.texcoordU.y == Catch::Approx( 0.f ).margin( 1e-6f ) );
+		REQUIRE( field.texcoordV.y == Catch::Approx( -1.f / 6.f ) );
+		REQUIRE( field.texcoordV.z == Catch::Approx( 0.f ).margin( 1e-5f ) );
+
+		REQUIRE_THROWS_AS( make_heightfield( SimpleMeshData{}, 16 ), Error );
+	}
+
+	SECTION( "load_heightfield()" )
+	{
+		auto const path = (std::filesystem::temp_directory_path() / "terrain_test.png").string();
+		unsigned char const pixels[] = { 0, 51, 255, 102, 204, 0 };
+		REQUIRE( stbi_write_png( path.c_str(), 3, 2, 1, pixels, 3 ) );
+
+		Heightfield const field = load_heightfield( path.c_str(), Vec3f{ 1.f, -2.f, 3.f }, 4.f, 10.f );
+		std::filesystem::remove( path );
+
+		REQUIRE( field.samplesX == 3 );
+		REQUIRE( field.samplesZ == 2 );
+		REQUIRE( field.spacing == 2.f );
+		REQUIRE( field.sample( 0, 0 ) == -2.f );
+		REQUIRE( field.sample( 1, 0 ) == Catch::Approx( 0.f ).margin( 1e-6f ) ); // -2 + 10 * 51/255
+		REQUIRE( field.sample( 2, 0 ) == Catch::Approx( 8.f ) );
+		REQUIRE( field.sample( 0, 1 ) == Catch::Approx( 2.f ) );
+		REQUIRE( field.height_at( 1.f, 5.f ) == Catch::Approx( 2.f ) ); // second row is at z = origin + spacing
+
+		REQUIRE_THROWS_AS( load_heightfield( path.c_str(), Vec3f{}, 1.f, 1.f ), Error );
+	}
+}
+
+TEST_CASE( "CDLOD", "[terrain]" )
+{
+	Heightfield const field = make_field_( 1025, 0.5f );
+	CdlodTree const tree( field );
+
+	// Leaves of 32 cells, up to a single node over all 1024
+	REQUIRE( tree.level_count() == 6 );
+	REQUIRE( tree.node_size( 0 ) == 16.f );
+	REQUIRE( tree.node_size( 5 ) == 512.f );
+
+	SECTION( "node heights" )
+	{
+		float lo = field.heights.front(), hi = lo;
+		for( float const h : field.heights )
+		{
+			lo = std::min( lo, h );
+			hi = std::max( hi, h );
+		}
+		REQUIRE( tree.node_heights( 5, 0, 0 ).x == lo );
+		REQUIRE( tree.node_heights( 5, 0, 0 ).y == hi );
+
+		// Leaf (3, 7) covers samples 96..128 x 224..256
+		Vec2f const leaf = tree.node_heights( 0, 3, 7 );
+		for( std::size_t j = 224; j <= 256; ++j )
+		{
+			for( std::size_t i = 96; i <= 128; ++i )
+			{
+				REQUIRE( field.sample( i, j ) >= leaf.x );
+				REQUIRE( field.sample( i, j ) <= leaf.y );
+			}
+		}
+	}
+
+	SECTION( "morph ranges" )
+	{
+		for( std::size_t i = 0; i < tree.level_count(); ++i )
+		{
+			Vec2f const range = tree.morph_range( i );
+			REQUIRE( range.x < range.y );
+			REQUIRE( range.y == tree.lod_range( i ) );
+			if( i )
+			{
+				REQUIRE( range.x > tree.lod_range( i-1 ) );
+			}
+		}
+	}
+
+	SECTION( "selection covers the terrain once" )
+	{
+		// Cover the leaf cells; each must be drawn exactly once.
+		std::size_t const cells = 1024 / 32 * 2; // half patches are half a leaf
+		float const cell = 0.5f * tree.node_size( 0 );
+		Vec3f const eye{ 30.f, 60.f, -20.f };
+
+		CdlodTree::Selection selection;
+		tree.select( eye, Frustum( make_top_view_( eye + Vec3f{ 0.f, 1000.f, 0.f }, 5000.f ) ), selection );
+		REQUIRE( !selection.full.empty() );
+		REQUIRE( !selection.half.empty() );
+
+		std::vector<int> covered( cells * cells, 0 );
+		std::vector<float> levels( cells * cells, -1.f );
+		for( auto const* patches : { &selection.full, &selection.half } )
+		{
+			for( auto const& patch : *patches )
+			{
+				auto const x0 = std::size_t((patch.x - field.origin.x) / cell);
+				auto const z0 = std::size_t((patch.z - field.origin.y) / cell);
+				auto const n = std::size_t(patch.size / cell);
+				for( std::size_t z = z0; z < z0 + n; ++z )
+				{
+					for( std::size_t x = x0; x < x0 + n; ++x )
+					{
+						++covered[z * cells + x];
+						levels[z * cells + x] = patch.level;
+					}
+				}
+			}
+		}
+
+		for( int const c : covered )
+		{
+			REQUIRE( 1 == c );
+		}
+
+		// The finest level is drawn under the camera, and neighbouring cells
+		// differ by at most one level, so that morphing closes the seams.
+		auto const under = std::size_t((eye.x - field.origin.x) / cell) + cells * std::size_t((eye.z - field.origin.y) / cell);
+		REQUIRE( 0.f == levels[under] );
+		for( std::size_t z = 0; z < cells; ++z )
+		{
+			for( std::size_t x = 0; x+1 < cells; ++x )
+			{
+				REQUIRE( std::abs( levels[z * cells + x] - levels[z * cells + x+1] ) <= 1.f );
+				REQUIRE( std::abs( levels[x * cells + z] - levels[(x+1) * cells + z] ) <= 1.f );
+			}
+		}
+	}
+
+	SECTION( "frustum culling" )
+	{
+		Vec3f const eye{ 0.f, 30.f, 0.f };
+
+		CdlodTree::Selection all, view;
+		tree.select( eye, Frustum( make_top_view_( eye + Vec3f{ 0.f, 1000.f, 0.f }, 5000.f ) ), all );
+		tree.select( eye, Frustum( make_ground_view_( eye, 1000.f ) ), view );
+
+		REQUIRE( view.full.size() + view.half.size() > 0 );
+		REQUIRE( view.full.size() + view.half.size() < (all.full.size() + all.half.size()) / 2 );
+
+		// Only patches in front of the camera (-z)
+		for( auto const& patch : view.full )
+		{
+			REQUIRE( patch.z < eye.z + 1.f );
+		}
+	}
+
+	REQUIRE_THROWS_AS( CdlodTree( field, CdlodParams{ 30 } ), Error );
+}
+
+TEST_CASE( "CDLOD benchmark", "[terrain][!benchmark]" )
+{
+	// 100x the area of langerso's 1025^2 samples, at its (unit) spacing
+	Heightfield const field = make_field_( 10241, 1.f );
+
+	CdlodTree tree( field );
+	CdlodTree::Selection selection;
+
+	Vec3f const eye{ 100.f, 40.f, 300.f };
+	Frustum const frustum( make_ground_view_( eye, 20000.f ) );
+
+	BENCHMARK( "CdlodTree::select(), 10241^2 samples" )
+	{
+		tree.select( eye, frustum, selection );
+		return selection.full.size() + selection.half.size();
+	};
+
+	tree.select( eye, frustum, selection );
+	std::size_t const patches = selection.full.size() + selection.half.size();
+	std::size_t const triangles = 2 * 32*32 * selection.full.size() + 2 * 16*16 * selection.half.size();
+	std::printf( "%zu patches (%zu full), %zu triangles; the full-resolution field has %zu\n", patches, selection.full.size(), triangles, 2 * 10240 * std::size_t(10240) );
+}
@@ -0,0 +1,150 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include <random>
+
+#include <cmath>
+
+#include "../main/simple_mesh.hpp"
+#include "../main/vertex_quant.hpp"
+
+namespace
+{
+	SimpleMeshData make_random_mesh_( std::size_t aCount, Vec3f aMin, Vec3f aMax, std::uint32_t aSeed )
+	{
+		std::mt19937 rng( aSeed );
+		std::uniform_real_distribution<float> unit( 0.f, 1.f );
+		std::normal_distribution<float> gauss;
+
+		SimpleMeshData mesh;
+		for( std::size_t i = 0; i < aCount; ++i )
+		{
+			mesh.positions.emplace_back( Vec3f{
+				aMin.x + (aMax.x - aMin.x) * unit( rng ),
+				aMin.y + (aMax.y - aMin.y) * unit( rng ),
+				aMin.z + (aMax.z - aMin.z) * unit( rng )
+			} );
+			mesh.normals.emplace_back( normalize( Vec3f{ gauss( rng ), gauss( rng ), gauss( rng ) } ) );
+			mesh.colors.emplace_back( Vec3f{ unit( rng ), unit( rng ), unit( rng ) } );
+			mesh.texcoords.emplace_back( Vec2f{ -1.f + 3.f * unit( rng ), 4.f * unit( rng ) } );
+		}
+		return mesh;
+	}
+}
+
+TEST_CASE( "Vertex quantization", "[vertex_quant]" )
+{
+	SECTION( "errors within the format's precision" )
+	{
+		Vec3f const lo{ -120.f, 0.5f, -3.f }, hi{ 80.f, 2.5f, 900.f };
+		SimpleMeshData const mesh = make_random_mesh_( 20000, lo, hi, 7 );
+
+		QuantizedVertices vertices;
+		auto const decode = quantize_mesh( mesh, vertices );
+		REQUIRE( vertices.size() == mesh.positions.size() );
+
+		auto const error = quantization_error( mesh, vertices, 0, decode );
+
+		// Half a step along each axis, plus float rounding
+		Vec3f const halfStep = (hi - lo) * (0.5f / 65535.f);
+		REQUIRE( error.position <= 1.01f * length( halfStep ) );
+		REQUIRE( error.position > 0.f );
+
+		REQUIRE( error.normal < 0.01f ); // degrees
+		REQUIRE( error.color < 0.005f ); // half a step at full brightness, in linear terms
+		REQUIRE( error.texcoord <= 1.01f * 0.5f * 4.f / 65535.f );
+	}
+
+	SECTION( "axis-aligned normals are exact" )
+	{
+		SimpleMeshData mesh;
+		Vec3f const axes[] = {
+			{ 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f },
+			{ 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f },
+			{ 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f }
+		};
+		for( auto const& n : axes )
+		{
+			mesh.positions.emplace_back( n );
+			mesh.normals.emplace_back( n );
+		}
+
+		QuantizedVertices vertices;
+		quantize_mesh( mesh, vertices );
+		for( std::size_t i = 0; i < 6; ++i )
+		{
+			Vec3f const n = decode_normal( vertices.normals[i] );
+			REQUIRE( n.x == axes[i].x );
+			REQUIRE( n.y == axes[i].y );
+			REQUIRE( n.z == axes[i].z );
+		}
+	}
+
+	SECTION( "flat and degenerate meshes" )
+	{
+		// All vertices at y = 2: zero extent along y
+		SimpleMeshData mesh;
+		mesh.positions = { Vec3f{ 0.f, 2.f, 0.f }, Vec3f{ 1.f, 2.f, 0.f }, Vec3f{ 0.f, 2.f, 1.f } };
+
+		QuantizedVertices vertices;
+		auto const decode = quantize_mesh( mesh, vertices );
+		REQUIRE( decode.positionScale.y == 0.f );
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			Vec3f const p = decode_position( vertices, i, decode );
+			REQUIRE( p.x == mesh.positions[i].x );
+			REQUIRE( p.y == 2.f );
+			REQUIRE( p.z == mesh.positions[i].z );
+		}
+
+		// Missing attributes: as in the scene's packed meshes
+		REQUIRE( decode_normal( vertices.normals[0] ).y == Catch::Approx( 1.f ) );
+		REQUIRE( decode_color( vertices.colors[1] ).x == 1.f );
+		REQUIRE( decode_texcoord( vertices.texcoords[2], decode ).x == 0.f );
+
+		// A single vertex
+		SimpleMeshData point;
+		point.positions = { Vec3f{ -4.f, 5.f, 6.f } };
+		auto const pointDecode = quantize_mesh( point, vertices );
+		REQUIRE( 4 == vertices.size() );
+		REQUIRE( decode_position( vertices, 3, pointDecode ).x == -4.f );
+
+		// Zero-length normals and out of range colors
+		point.normals = { Vec3f{ 0.f, 0.f, 0.f } };
+		point.colors = { Vec3f{ 2.f, -1.f, 0.5f } };
+		quantize_mesh( point, vertices );
+		REQUIRE( decode_color( vertices.colors[4] ).x == 1.f );
+		REQUIRE( decode_color( vertices.colors[4] ).y == 0.f );
+		REQUIRE( std::isfinite( decode_normal( vertices.normals[4] ).z ) );
+	}
+
+	SECTION( "meshes share buffers" )
+	{
+		SimpleMeshData const a = make_random_mesh_( 100, { 0.f, 0.f, 0.f }, { 1.f, 1.f, 1.f }, 1 );
+		SimpleMeshData const b = make_random_mesh_( 50, { 1000.f, 0.f, 0.f }, { 1001.f, 1.f, 1.f }, 2 );
+
+		QuantizedVertices vertices;
+		auto const decodeA = quantize_mesh( a, vertices );
+		auto const decodeB = quantize_mesh( b, vertices );
+		REQUIRE( vertices.size() == 150 );
+		REQUIRE( 4*150 == vertices.positions.size() );
+
+		// Each relative to its own bounds
+		REQUIRE( quantization_error( a, vertices, 0, decodeA ).position < 1e-4f );
+		REQUIRE( quantization_error( b, vertices, 100, decodeB ).position < 1e-3f );
+	}
+
+	REQUIRE( kFloatVertexBytes == 44 );
+	REQUIRE( kQuantizedVertexBytes == 20 );
+}
+
+TEST_CASE( "Vertex quantization benchmark", "[vertex_quant][!benchmark]" )
+{
+	SimpleMeshData const mesh = make_random_mesh_( 300000, { -50.f, 0.f, -50.f }, { 50.f, 10.f, 50.f }, 3 );
+
+	BENCHMARK( "quantize_mesh(), 300k vertices" )
+	{
+		QuantizedVertices vertices;
+		quantize_mesh( mesh, vertices );
+		return vertices.size();
+	};
+}
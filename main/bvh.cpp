@@ -0,0 +1,992 @@
+#include "bvh.hpp"
+
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+namespace
+{
+	// Cost of visiting a node, relative to one triangle test
+	constexpr float kTraversalCost_ = 1.f;
+
+	// Traversal stacks hold at most one entry per level. Deeper nodes are
+	// made leaves regardless of their size; balanced trees of even huge
+	// meshes are far shallower than this.
+	constexpr std::size_t kMaxDepth_ = 64;
+
+	constexpr float kInf_ = std::numeric_limits<float>::infinity();
+
+	// Bins per axis for the SAH
+	constexpr std::size_t kBins_ = TriangleBvh::kBins;
+
+	struct Bounds_
+	{
+		Vec3f min{ kInf_, kInf_, kInf_ };
+		Vec3f max{ -kInf_, -kInf_, -kInf_ };
+
+		void grow( Vec3f aPoint ) noexcept
+		{
+			min = { std::min( min.x, aPoint.x ), std::min( min.y, aPoint.y ), std::min( min.z, aPoint.z ) };
+			max = { std::max( max.x, aPoint.x ), std::max( max.y, aPoint.y ), std::max( max.z, aPoint.z ) };
+		}
+		void grow( Bounds_ const& aOther ) noexcept
+		{
+			grow( aOther.min );
+			grow( aOther.max );
+		}
+		void grow( BvhBox const& aBox ) noexcept
+		{
+			grow( aBox.min );
+			grow( aBox.max );
+		}
+
+		// Half of the surface area, which is all SAH needs. Zero if empty.
+		float area() const noexcept
+		{
+			if( min.x > max.x )
+				return 0.f;
+
+			Vec3f const e = max - min;
+			return e.x * e.y + e.y * e.z + e.z * e.x;
+		}
+	};
+
+	struct Bin_
+	{
+		Bounds_ bounds;
+		std::size_t count = 0;
+	};
+
+	struct Pending_
+	{
+		std::uint32_t node;
+		std::size_t depth;
+	};
+
+	// Entry distance of the ray into the box, or infinity if it misses the
+	// box within [aTMin,aTMax].
+	inline float hit_box_( Vec3f aMin, Vec3f aMax, Vec3f aOrigin, Vec3f aInvDir, float aTMin, float aTMax ) noexcept
+	{
+		float const x0 = (aMin.x - aOrigin.x) * aInvDir.x, x1 = (aMax.x - aOrigin.x) * aInvDir.x;
+		float const y0 = (aMin.y - aOrigin.y) * aInvDir.y, y1 = (aMax.y - aOrigin.y) * aInvDir.y;
+		float const z0 = (aMin.z - aOrigin.z) * aInvDir.z, z1 = (aMax.z - aOrigin.z) * aInvDir.z;
+
+		float const t0 = std::max( std::max( std::min( x0, x1 ), std::min( y0, y1 ) ), std::max( std::min( z0, z1 ), aTMin ) );
+		float const t1 = std::min( std::min( std::max( x0, x1 ), std::max( y0, y1 ) ), std::min( std::max( z0, z1 ), aTMax ) );
+		return t0 <= t1 ? t0 : kInf_;
+	}
+
+	// Moeller-Trumbore. Single rays and the lanes of a packet both go
+	// through this (the lane loops vectorize it), so that the two find the
+	// same hits at the same distances. Without early exits; misses,
+	// including parallel rays (det is zero, the results NaN or infinite),
+	// fail the final comparisons.
+	inline bool hit_triangle_( Vec3f aV0, Vec3f aE1, Vec3f aE2, Vec3f aOrigin, Vec3f aDir, float aTMin, float aTMax, float& aT, float& aU, float& aV ) noexcept
+	{
+		Vec3f const p = cross( aDir, aE2 );
+		float const inv = 1.f / dot( aE1, p );
+
+		Vec3f const s = aOrigin - aV0;
+		Vec3f const q = cross( s, aE1 );
+
+		aU = dot( s, p ) * inv;
+		aV = dot( aDir, q ) * inv;
+		aT = dot( aE2, q ) * inv;
+		return aU >= 0.f && aV >= 0.f && aU + aV <= 1.f && aT >= aTMin && aT <= aTMax;
+	}
+
+	Vec3f inverse_( Vec3f aDir ) noexcept
+	{
+		return { 1.f / aDir.x, 1.f / aDir.y, 1.f / aDir.z };
+	}
+
+	inline bool boxes_overlap_( Vec3f aMinA, Vec3f aMaxA, Vec3f aMinB, Vec3f aMaxB ) noexcept
+	{
+		return aMinA.x <= aMaxB.x && aMinB.x <= aMaxA.x
+			&& aMinA.y <= aMaxB.y && aMinB.y <= aMaxA.y
+			&& aMinA.z <= aMaxB.z && aMinB.z <= aMaxA.z;
+	}
+
+	// Closest point of the triangle to aP (Ericson, Real-Time Collision
+	// Detection, 5.1.5): by the Voronoi region of aP.
+	Vec3f closest_on_triangle_( Vec3f aV0, Vec3f aE1, Vec3f aE2, Vec3f aP ) noexcept
+	{
+		Vec3f const ap = aP - aV0;
+		float const d1 = dot( aE1, ap ), d2 = dot( aE2, ap );
+		if( d1 <= 0.f && d2 <= 0.f )
+			return aV0;
+
+		Vec3f const bp = ap - aE1;
+		float const d3 = dot( aE1, bp ), d4 = dot( aE2, bp );
+		if( d3 >= 0.f && d4 <= d3 )
+			return aV0 + aE1;
+
+		float const vc = d1*d4 - d3*d2;
+		if( vc <= 0.f && d1 >= 0.f && d3 <= 0.f )
+			return aV0 + aE1 * (d1 / (d1 - d3));
+
+		Vec3f const cp = ap - aE2;
+		float const d5 = dot( aE1, cp ), d6 = dot( aE2, cp );
+		if( d6 >= 0.f && d5 <= d6 )
+			return aV0 + aE2;
+
+		float const vb = d5*d2 - d1*d6;
+		if( vb <= 0.f && d2 >= 0.f && d6 <= 0.f )
+			return aV0 + aE2 * (d2 / (d2 - d6));
+
+		float const va = d3*d6 - d5*d4;
+		if( va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f )
+			return aV0 + aE1 + (aE2 - aE1) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		float const denom = 1.f / (va + vb + vc);
+		return aV0 + aE1 * (vb * denom) + aE2 * (vc * denom);
+	}
+
+	bool triangle_overlaps_sphere_( Vec3f aV0, Vec3f aE1, Vec3f aE2, Vec3f aCenter, float aRadius ) noexcept
+	{
+		Vec3f const d = closest_on_triangle_( aV0, aE1, aE2, aCenter ) - aCenter;
+		return dot( d, d ) <= aRadius * aRadius;
+	}
+
+	// Separating axis test (Akenine-Moeller): the box's axes, the
+	// triangle's normal and the nine cross products of their edges.
+	bool triangle_overlaps_box_( Vec3f aV0, Vec3f aE1, Vec3f aE2, Vec3f aMin, Vec3f aMax ) noexcept
+	{
+		Vec3f const center = (aMin + aMax) * 0.5f, half = (aMax - aMin) * 0.5f;
+		Vec3f const v[3] = { aV0 - center, aV0 + aE1 - center, aV0 + aE2 - center };
+		Vec3f const edges[3] = { aE1, aE2 - aE1, -aE2 };
+
+		auto const separated = [&] (Vec3f aAxis) {
+			float const p0 = dot( v[0], aAxis ), p1 = dot( v[1], aAxis ), p2 = dot( v[2], aAxis );
+			float const r = half.x * std::abs( aAxis.x ) + half.y * std::abs( aAxis.y ) + half.z * std::abs( aAxis.z );
+			return std::min( { p0, p1, p2 } ) > r || std::max( { p0, p1, p2 } ) < -r;
+		};
+
+		for( std::size_t axis = 0; axis < 3; ++axis )
+		{
+			if( std::min( { v[0][axis], v[1][axis], v[2][axis] } ) > half[axis] || std::max( { v[0][axis], v[1][axis], v[2][axis] } ) < -half[axis] )
+				return false;
+		}
+
+		if( separated( cross( aE1, aE2 ) ) )
+			return false;
+
+		for( auto const& edge : edges )
+		{
+			if( separated( Vec3f{ 0.f, -edge.z, edge.y } ) || separated( Vec3f{ edge.z, 0.f, -edge.x } ) || separated( Vec3f{ -edge.y, edge.x, 0.f } ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	// Affine transforms only; the last row is ignored.
+	inline Vec3f transform_point_( Mat44f const& aM, Vec3f aP ) noexcept
+	{
+		return {
+			aM(0,0) * aP.x + aM(0,1) * aP.y + aM(0,2) * aP.z + aM(0,3),
+			aM(1,0) * aP.x + aM(1,1) * aP.y + aM(1,2) * aP.z + aM(1,3),
+			aM(2,0) * aP.x + aM(2,1) * aP.y + aM(2,2) * aP.z + aM(2,3)
+		};
+	}
+	inline Vec3f transform_vector_( Mat44f const& aM, Vec3f aV ) noexcept
+	{
+		return {
+			aM(0,0) * aV.x + aM(0,1) * aV.y + aM(0,2) * aV.z,
+			aM(1,0) * aV.x + aM(1,1) * aV.y + aM(1,2) * aV.z,
+			aM(2,0) * aV.x + aM(2,1) * aV.y + aM(2,2) * aV.z
+		};
+	}
+
+	// Bounds of the transformed box (Arvo)
+	BvhBox transform_box_( Mat44f const& aM, Vec3f aMin, Vec3f aMax ) noexcept
+	{
+		Vec3f const center = transform_point_( aM, (aMin + aMax) * 0.5f );
+		Vec3f const half = (aMax - aMin) * 0.5f;
+		Vec3f const extent{
+			std::abs( aM(0,0) ) * half.x + std::abs( aM(0,1) ) * half.y + std::abs( aM(0,2) ) * half.z,
+			std::abs( aM(1,0) ) * half.x + std::abs( aM(1,1) ) * half.y + std::abs( aM(1,2) ) * half.z,
+			std::abs( aM(2,0) ) * half.x + std::abs( aM(2,1) ) * half.y + std::abs( aM(2,2) ) * half.z
+		};
+		return { center - extent, center + extent };
+	}
+}
+
+void build_bvh( BvhBox const* aBoxes, Vec3f const* aCentroids, std::size_t aCount, std::size_t aMaxLeafSize, std::vector<BvhNode>& aNodes, std::vector<std::uint32_t>& aOrder )
+{
+	aNodes.clear();
+	aOrder.resize( aCount );
+	if( 0 == aCount )
+		return;
+
+	assert( aBoxes && aCentroids );
+	assert( aCount < ~std::uint32_t(0) );
+
+	std::iota( aOrder.begin(), aOrder.end(), std::uint32_t(0) );
+
+	// A binary tree with N leaves has 2N-1 nodes, so this never reallocates.
+	aNodes.reserve( 2*aCount - 1 );
+	aNodes.emplace_back( BvhNode{ {}, 0, {}, std::uint32_t(aCount) } );
+
+	std::vector<Pending_> pending{ { 0, 1 } };
+	while( !pending.empty() )
+	{
+		auto const [index, depth] = pending.back();
+		pending.pop_back();
+
+		auto& node = aNodes[index];
+		auto const first = node.first, count = node.count;
+
+		Bounds_ bounds, centroidBounds;
+		for( std::size_t i = first; i < first+count; ++i )
+		{
+			bounds.grow( aBoxes[aOrder[i]] );
+			centroidBounds.grow( aCentroids[aOrder[i]] );
+		}
+
+		node.min = bounds.min;
+		node.max = bounds.max;
+
+		if( 1 == count || depth >= kMaxDepth_ )
+			continue;
+
+		// Find the cheapest split. Bins are only evaluated where both sides
+		// receive primitives.
+		float bestCost = kInf_;
+		std::size_t bestAxis = 0, bestSplit = 0;
+
+		for( std::size_t axis = 0; axis < 3; ++axis )
+		{
+			float const lo = centroidBounds.min[axis], extent = centroidBounds.max[axis] - lo;
+			if( !(extent > 0.f) )
+				continue;
+
+			float const scale = float(kBins_) / extent;
+			Bin_ bins[kBins_];
+			for( std::size_t i = first; i < first+count; ++i )
+			{
+				auto const prim = aOrder[i];
+				auto const bin = std::min( kBins_-1, std::size_t((aCentroids[prim][axis] - lo) * scale) );
+				bins[bin].bounds.grow( aBoxes[prim] );
+				++bins[bin].count;
+			}
+
+			// Sweep from the right, then from the left.
+			float rightArea[kBins_];
+			std::size_t rightCount[kBins_];
+
+			Bounds_ right;
+			std::size_t rightN = 0;
+			for( std::size_t i = kBins_-1; i > 0; --i )
+			{
+				right.grow( bins[i].bounds );
+				rightN += bins[i].count;
+				rightArea[i] = right.area();
+				rightCount[i] = rightN;
+			}
+
+			Bounds_ left;
+			std::size_t leftN = 0;
+			for( std::size_t i = 1; i < kBins_; ++i )
+			{
+				left.grow( bins[i-1].bounds );
+				leftN += bins[i-1].count;
+				if( 0 == leftN || 0 == rightCount[i] )
+					continue;
+
+				float const cost = float(leftN) * left.area() + float(rightCount[i]) * rightArea[i];
+				if( cost < bestCost )
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i;
+				}
+			}
+		}
+
+		std::size_t mid;
+		if( bestCost < kInf_ )
+		{
+			float const area = bounds.area();
+			if( count <= aMaxLeafSize && kTraversalCost_ * area + bestCost >= float(count) * area )
+				continue;
+
+			float const lo = centroidBounds.min[bestAxis];
+			float const scale = float(kBins_) / (centroidBounds.max[bestAxis] - lo);
+			auto const it = std::partition( aOrder.begin()+first, aOrder.begin()+first+count, [&] (std::uint32_t aPrim) {
+				return std::min( kBins_-1, std::size_t((aCentroids[aPrim][bestAxis] - lo) * scale) ) < bestSplit;
+			} );
+			mid = std::size_t(it - aOrder.begin());
+		}
+		else
+		{
+			// All centroids coincide; only large leaves are split, evenly.
+			if( count <= aMaxLeafSize )
+				continue;
+
+			mid = first + count/2;
+		}
+
+		assert( mid > first && mid < first+count );
+
+		auto const left = std::uint32_t(aNodes.size());
+		node.first = left;
+		node.count = 0;
+
+		aNodes.emplace_back( BvhNode{ {}, first, {}, std::uint32_t(mid - first) } );
+		aNodes.emplace_back( BvhNode{ {}, std::uint32_t(mid), {}, std::uint32_t(first + count - mid) } );
+
+		pending.emplace_back( Pending_{ left+1, depth+1 } );
+		pending.emplace_back( Pending_{ left, depth+1 } );
+	}
+}
+
+TriangleBvh::TriangleBvh( Vec3f const* aPositions, std::size_t aTriangleCount )
+{
+	if( 0 == aTriangleCount )
+		return;
+
+	assert( aPositions );
+	assert( aTriangleCount < kNoTriangle );
+
+	std::vector<BvhBox> boxes( aTriangleCount );
+	std::vector<Vec3f> centroids( aTriangleCount );
+	for( std::size_t i = 0; i < aTriangleCount; ++i )
+	{
+		Bounds_ box;
+		for( std::size_t j = 0; j < 3; ++j )
+			box.grow( aPositions[3*i+j] );
+
+		boxes[i] = BvhBox{ box.min, box.max };
+		centroids[i] = (aPositions[3*i] + aPositions[3*i+1] + aPositions[3*i+2]) / 3.f;
+	}
+
+	build_bvh( boxes.data(), centroids.data(), aTriangleCount, kMaxLeafSize, mNodes, mIndices );
+
+	mTriangles.reserve( aTriangleCount );
+	for( auto const tri : mIndices )
+	{
+		Vec3f const v0 = aPositions[3*tri];
+		mTriangles.emplace_back( Triangle_{ v0, aPositions[3*tri+1] - v0, aPositions[3*tri+2] - v0 } );
+	}
+}
+
+bool TriangleBvh::intersect( Ray const& aRay, RayHit& aHit ) const noexcept
+{
+	if( mNodes.empty() )
+		return false;
+
+	Vec3f const inv = inverse_( aRay.direction );
+	float tMax = std::min( aRay.tMax, aHit.t );
+	bool found = false;
+
+	struct Entry_
+	{
+		std::uint32_t node;
+		float t;
+	} stack[kMaxDepth_];
+	std::size_t top = 0;
+
+	auto const& root = mNodes[0];
+	float const rootT = hit_box_( root.min, root.max, aRay.origin, inv, aRay.tMin, tMax );
+	if( kInf_ == rootT )
+		return false;
+
+	stack[top++] = { 0, rootT };
+	while( top )
+	{
+		auto const entry = stack[--top];
+		if( entry.t > tMax )
+			continue;
+
+		// Descend, nearer child first, until reaching a leaf.
+		std::uint32_t index = entry.node;
+		while( 0 == mNodes[index].count )
+		{
+			auto const& left = mNodes[mNodes[index].first];
+			auto const& right = mNodes[mNodes[index].first+1];
+			float tl = hit_box_( left.min, left.max, aRay.origin, inv, aRay.tMin, tMax );
+			float tr = hit_box_( right.min, right.max, aRay.origin, inv, aRay.tMin, tMax );
+
+			std::uint32_t near = mNodes[index].first, far = near+1;
+			if( tr < tl )
+			{
+				std::swap( tl, tr );
+				std::swap( near, far );
+			}
+
+			if( kInf_ == tl )
+				break;
+			if( kInf_ != tr )
+				stack[top++] = { far, tr };
+
+			index = near;
+		}
+
+		auto const& node = mNodes[index];
+		for( std::size_t i = node.first; i < node.first+node.count; ++i )
+		{
+			auto const& tri = mTriangles[i];
+			float t, u, v;
+			if( hit_triangle_( tri.v0, tri.e1, tri.e2, aRay.origin, aRay.direction, aRay.tMin, tMax, t, u, v ) )
+			{
+				tMax = t;
+				aHit = RayHit{ t, mIndices[i], u, v };
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+bool TriangleBvh::occluded( Ray const& aRay ) const noexcept
+{
+	if( mNodes.empty() )
+		return false;
+
+	Vec3f const inv = inverse_( aRay.direction );
+
+	std::uint32_t stack[kMaxDepth_];
+	std::size_t top = 0;
+
+	stack[top++] = 0;
+	while( top )
+	{
+		auto const& node = mNodes[stack[--top]];
+		if( kInf_ == hit_box_( node.min, node.max, aRay.origin, inv, aRay.tMin, aRay.tMax ) )
+			continue;
+
+		if( 0 == node.count )
+		{
+			stack[top++] = node.first+1;
+			stack[top++] = node.first;
+			continue;
+		}
+
+		for( std::size_t i = node.first; i < node.first+node.count; ++i )
+		{
+			auto const& tri = mTriangles[i];
+			float t, u, v;
+			if( hit_triangle_( tri.v0, tri.e1, tri.e2, aRay.origin, aRay.direction, aRay.tMin, aRay.tMax, t, u, v ) )
+				return true;
+		}
+	}
+
+	return false;
+}
+
+void TriangleBvh::intersect( RayPacket& aPacket ) const noexcept
+{
+	constexpr std::size_t N = RayPacket::kSize;
+
+	float invX[N], invY[N], invZ[N];
+	Vec3f meanDir{ 0.f, 0.f, 0.f };
+	for( std::size_t i = 0; i < N; ++i )
+	{
+		invX[i] = 1.f / aPacket.dx[i];
+		invY[i] = 1.f / aPacket.dy[i];
+		invZ[i] = 1.f / aPacket.dz[i];
+
+		aPacket.t[i] = kInf_;
+		aPacket.u[i] = aPacket.v[i] = 0.f;
+		aPacket.triangle[i] = kNoTriangle;
+
+		meanDir += Vec3f{ aPacket.dx[i], aPacket.dy[i], aPacket.dz[i] };
+	}
+
+	if( mNodes.empty() )
+		return;
+
+	// Closest hit so far, per lane
+	float tMax[N];
+	std::copy_n( aPacket.tMax, N, tMax );
+
+	std::uint32_t stack[kMaxDepth_];
+	std::size_t top = 0;
+
+	stack[top++] = 0;
+	while( top )
+	{
+		auto const& node = mNodes[stack[--top]];
+
+		// The packet enters the node if any of its rays does. (All lanes
+		// are tested; the loop is vectorized.)
+		int any = 0;
+		for( std::size_t i = 0; i < N; ++i )
+		{
+			float const x0 = (node.min.x - aPacket.ox[i]) * invX[i], x1 = (node.max.x - aPacket.ox[i]) * invX[i];
+			float const y0 = (node.min.y - aPacket.oy[i]) * invY[i], y1 = (node.max.y - aPacket.oy[i]) * invY[i];
+			float const z0 = (node.min.z - aPacket.oz[i]) * invZ[i], z1 = (node.max.z - aPacket.oz[i]) * invZ[i];
+
+			float const t0 = std::max( std::max( std::min( x0, x1 ), std::min( y0, y1 ) ), std::max( std::min( z0, z1 ), aPacket.tMin[i] ) );
+			float const t1 = std::min( std::min( std::max( x0, x1 ), std::max( y0, y1 ) ), std::min( std::max( z0, z1 ), tMax[i] ) );
+			any |= t0 <= t1;
+		}
+
+		if( !any )
+			continue;
+
+		if( 0 == node.count )
+		{
+			// Visit the child that is nearer along the packet's mean
+			// direction first.
+			auto const& left = mNodes[node.first];
+			auto const& right = mNodes[node.first+1];
+			Vec3f const delta = (right.min + right.max) - (left.min + left.max);
+
+			bool const leftFirst = dot( delta, meanDir ) > 0.f;
+			stack[top++] = leftFirst ? node.first+1 : node.first;
+			stack[top++] = leftFirst ? node.first : node.first+1;
+			continue;
+		}
+
+		for( std::size_t k = node.first; k < node.first+node.count; ++k )
+		{
+			auto const& tri = mTriangles[k];
+			std::uint32_t const index = mIndices[k];
+
+			// All lanes at once (see hit_triangle_())
+			for( std::size_t i = 0; i < N; ++i )
+			{
+				Vec3f const origin{ aPacket.ox[i], aPacket.oy[i], aPacket.oz[i] };
+				Vec3f const dir{ aPacket.dx[i], aPacket.dy[i], aPacket.dz[i] };
+
+				float t, u, v;
+				bool const hit = hit_triangle_( tri.v0, tri.e1, tri.e2, origin, dir, aPacket.tMin[i], tMax[i], t, u, v );
+				tMax[i] = hit ? t : tMax[i];
+				aPacket.t[i] = hit ? t : aPacket.t[i];
+				aPacket.u[i] = hit ? u : aPacket.u[i];
+				aPacket.v[i] = hit ? v : aPacket.v[i];
+				aPacket.triangle[i] = hit ? index : aPacket.triangle[i];
+			}
+		}
+	}
+}
+
+template< typename tTest >
+bool TriangleBvh::any_triangle_( Vec3f aMin, Vec3f aMax, tTest&& aTest ) const noexcept
+{
+	if( mNodes.empty() )
+		return false;
+
+	std::uint32_t stack[kMaxDepth_];
+	std::size_t top = 0;
+
+	stack[top++] = 0;
+	while( top )
+	{
+		auto const& node = mNodes[stack[--top]];
+		if( !boxes_overlap_( node.min, node.max, aMin, aMax ) )
+			continue;
+
+		if( 0 == node.count )
+		{
+			stack[top++] = node.first+1;
+			stack[top++] = node.first;
+			continue;
+		}
+
+		for( std::size_t i = node.first; i < node.first+node.count; ++i )
+		{
+			auto const& tri = mTriangles[i];
+			if( aTest( tri.v0, tri.e1, tri.e2 ) )
+				return true;
+		}
+	}
+
+	return false;
+}
+
+bool TriangleBvh::overlaps_sphere( Vec3f aCenter, float aRadius ) const noexcept
+{
+	Vec3f const r{ aRadius, aRadius, aRadius };
+	return any_triangle_( aCenter - r, aCenter + r, [&] (Vec3f aV0, Vec3f aE1, Vec3f aE2) {
+		return triangle_overlaps_sphere_( aV0, aE1, aE2, aCenter, aRadius );
+	} );
+}
+
+bool TriangleBvh::overlaps_box( Vec3f aMin, Vec3f aMax ) const noexcept
+{
+	return any_triangle_( aMin, aMax, [&] (Vec3f aV0, Vec3f aE1, Vec3f aE2) {
+		return triangle_overlaps_box_( aV0, aE1, aE2, aMin, aMax );
+	} );
+}
+
+std::vector<TriangleBvh::Node> const& TriangleBvh::nodes() const noexcept
+{
+	return mNodes;
+}
+
+std::size_t TriangleBvh::triangle_count() const noexcept
+{
+	return mTriangles.size();
+}
+
+
+
+std::uint32_t SceneBvh::add_mesh( Vec3f const* aPositions, std::size_t aTriangleCount )
+{
+	mMeshes.emplace_back( aPositions, aTriangleCount );
+	return std::uint32_t(mMeshes.size() - 1);
+}
+
+std::uint32_t SceneBvh::add_instance( std::uint32_t aMesh, Mat44f const& aModel2world, std::uint32_t aMask )
+{
+	assert( aMesh < mMeshes.size() );
+
+	mInstances.emplace_back( Instance_{ aMesh, aMask, {}, {}, {} } );
+	set_transform( std::uint32_t(mInstances.size() - 1), aModel2world );
+	return std::uint32_t(mInstances.size() - 1);
+}
+
+void SceneBvh::set_transform( std::uint32_t aInstance, Mat44f const& aModel2world )
+{
+	assert( aInstance < mInstances.size() );
+
+	auto& instance = mInstances[aInstance];
+	instance.model2world = aModel2world;
+	instance.world2model = invert( aModel2world );
+
+	auto const& nodes = mMeshes[instance.mesh].nodes();
+	if( nodes.empty() )
+		instance.bounds = BvhBox{ { kInf_, kInf_, kInf_ }, { -kInf_, -kInf_, -kInf_ } };
+	else
+		instance.bounds = transform_box_( aModel2world, nodes[0].min, nodes[0].max );
+}
+
+void SceneBvh::build()
+{
+	// Instances of empty meshes are left out.
+	std::vector<std::uint32_t> ids;
+	std::vector<BvhBox> boxes;
+	std::vector<Vec3f> centroids;
+	for( std::size_t i = 0; i < mInstances.size(); ++i )
+	{
+		auto const& bounds = mInstances[i].bounds;
+		if( bounds.min.x > bounds.max.x )
+			continue;
+
+		ids.emplace_back( std::uint32_t(i) );
+		boxes.emplace_back( bounds );
+		centroids.emplace_back( (bounds.min + bounds.max) * 0.5f );
+	}
+
+	build_bvh( boxes.data(), centroids.data(), boxes.size(), kMaxLeafSize, mNodes, mOrder );
+	for( auto& index : mOrder )
+		index = ids[index];
+}
+
+void SceneBvh::refit()
+{
+	// Children are stored after their parents.
+	for( std::size_t i = mNodes.size(); i-- > 0; )
+	{
+		auto& node = mNodes[i];
+
+		Bounds_ bounds;
+		if( 0 == node.count )
+		{
+			bounds.grow( BvhBox{ mNodes[node.first].min, mNodes[node.first].max } );
+			bounds.grow( BvhBox{ mNodes[node.first+1].min, mNodes[node.first+1].max } );
+		}
+		else
+		{
+			for( std::size_t j = node.first; j < node.first+node.count; ++j )
+				bounds.grow( mInstances[mOrder[j]].bounds );
+		}
+
+		node.min = bounds.min;
+		node.max = bounds.max;
+	}
+}
+
+bool SceneBvh::intersect( Ray const& aRay, SceneHit& aHit, std::uint32_t aMask ) const noexcept
+{
+	if( mNodes.empty() )
+		return false;
+
+	Vec3f const inv = inverse_( aRay.direction );
+	float tMax = std::min( aRay.tMax, aHit.t );
+	bool found = false;
+
+	struct Entry_
+	{
+		std::uint32_t node;
+		float t;
+	} stack[kMaxDepth_];
+	std::size_t top = 0;
+
+	float const rootT = hit_box_( mNodes[0].min, mNodes[0].max, aRay.origin, inv, aRay.tMin, tMax );
+	if( kInf_ == rootT )
+		return false;
+
+	stack[top++] = { 0, rootT };
+	while( top )
+	{
+		auto const entry = stack[--top];
+		if( entry.t > tMax )
+			continue;
+
+		auto const& node = mNodes[entry.node];
+		if( 0 == node.count )
+		{
+			// Nearer child on top
+			auto const& left = mNodes[node.first];
+			auto const& right = mNodes[node.first+1];
+			float const tl = hit_box_( left.min, left.max, aRay.origin, inv, aRay.tMin, tMax );
+			float const tr = hit_box_( right.min, right.max, aRay.origin, inv, aRay.tMin, tMax );
+
+			Entry_ near{ node.first, tl }, far{ node.first+1, tr };
+			if( tr < tl )
+				std::swap( near, far );
+
+			if( kInf_ != far.t )
+				stack[top++] = far;
+			if( kInf_ != near.t )
+				stack[top++] = near;
+			continue;
+		}
+
+		for( std::size_t i = node.first; i < node.first+node.count; ++i )
+		{
+			auto const& instance = mInstances[mOrder[i]];
+			if( !(instance.mask & aMask) )
+				continue;
+
+			Ray const local{ transform_point_( instance.world2model, aRay.origin ), transform_vector_( instance.world2model, aRay.direction ), aRay.tMin, tMax };
+
+			RayHit hit;
+			if( mMeshes[instance.mesh].intersect( local, hit ) )
+			{
+				tMax = hit.t;
+				aHit = SceneHit{ hit.t, mOrder[i], hit.triangle, hit.u, hit.v };
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+bool SceneBvh::occluded( Ray const& aRay, std::uint32_t aMask ) const noexcept
+{
+	if( mNodes.empty() )
+		return false;
+
+	Vec3f const inv = inverse_( aRay.direction );
+
+	std::uint32_t stack[kMaxDepth_];
+	std::size_t top = 0;
+
+	stack[top++] = 0;
+	while( top )
+	{
+		auto const& node = mNodes[stack[--top]];
+		if( kInf_ == hit_box_( node.min, node.max, aRay.origin, inv, aRay.tMin, aRay.tMax ) )
+			continue;
+
+		if( 0 == node.count )
+		{
+			stack[top++] = node.first+1;
+			stack[top++] = node.first;
+			continue;
+		}
+
+		for( std::size_t i = node.first; i < node.first+node.count; ++i )
+		{
+			auto const& instance = mInstances[mOrder[i]];
+			if( !(instance.mask & aMask) )
+				continue;
+
+			Ray const local{ transform_point_( instance.world2model, aRay.origin ), transform_vector_( instance.world2model, aRay.direction ), aRay.tMin, aRay.tMax };
+			if( mMeshes[instance.mesh].occluded( local ) )
+				return true;
+		}
+	}
+
+	return false;
+}
+
+void SceneBvh::intersect( RayPacket& aPacket, std::uint32_t* aInstances, std::uint32_t aMask ) const noexcept
+{
+	constexpr std::size_t N = RayPacket::kSize;
+
+	assert( aInstances );
+
+	float invX[N], invY[N], invZ[N];
+	for( std::size_t i = 0; i < N; ++i )
+	{
+		invX[i] = 1.f / aPacket.dx[i];
+		invY[i] = 1.f / aPacket.dy[i];
+		invZ[i] = 1.f / aPacket.dz[i];
+
+		aPacket.t[i] = kInf_;
+		aPacket.u[i] = aPacket.v[i] = 0.f;
+		aPacket.triangle[i] = kNoTriangle;
+		aInstances[i] = kNoInstance;
+	}
+
+	if( mNodes.empty() )
+		return;
+
+	// Closest hit so far, per lane
+	float tMax[N];
+	std::copy_n( aPacket.tMax, N, tMax );
+
+	std::uint32_t stack[kMaxDepth_];
+	std::size_t top = 0;
+
+	stack[top++] = 0;
+	while( top )
+	{
+		auto const& node = mNodes[stack[--top]];
+
+		// As in TriangleBvh: the packet enters if any of its rays does.
+		int any = 0;
+		for( std::size_t i = 0; i < N; ++i )
+		{
+			float const x0 = (node.min.x - aPacket.ox[i]) * invX[i], x1 = (node.max.x - aPacket.ox[i]) * invX[i];
+			float const y0 = (node.min.y - aPacket.oy[i]) * invY[i], y1 = (node.max.y - aPacket.oy[i]) * invY[i];
+			float const z0 = (node.min.z - aPacket.oz[i]) * invZ[i], z1 = (node.max.z - aPacket.oz[i]) * invZ[i];
+
+			float const t0 = std::max( std::max( std::min( x0, x1 ), std::min( y0, y1 ) ), std::max( std::min( z0, z1 ), aPacket.tMin[i] ) );
+			float const t1 = std::min( std::min( std::max( x0, x1 ), std::max( y0, y1 ) ), std::min( std::max( z0, z1 ), tMax[i] ) );
+			any |= t0 <= t1;
+		}
+
+		if( !any )
+			continue;
+
+		if( 0 == node.count )
+		{
+			stack[top++] = node.first+1;
+			stack[top++] = node.first;
+			continue;
+		}
+
+		for( std::size_t k = node.first; k < node.first+node.count; ++k )
+		{
+			auto const& instance = mInstances[mOrder[k]];
+			if( !(instance.mask & aMask) )
+				continue;
+
+			// The packet in the instance's model space, limited to the
+			// closest hits so far
+			Mat44f const& m = instance.world2model;
+			RayPacket local;
+			for( std::size_t i = 0; i < N; ++i )
+			{
+				local.ox[i] = m(0,0) * aPacket.ox[i] + m(0,1) * aPacket.oy[i] + m(0,2) * aPacket.oz[i] + m(0,3);
+				local.oy[i] = m(1,0) * aPacket.ox[i] + m(1,1) * aPacket.oy[i] + m(1,2) * aPacket.oz[i] + m(1,3);
+				local.oz[i] = m(2,0) * aPacket.ox[i] + m(2,1) * aPacket.oy[i] + m(2,2) * aPacket.oz[i] + m(2,3);
+				local.dx[i] = m(0,0) * aPacket.dx[i] + m(0,1) * aPacket.dy[i] + m(0,2) * aPacket.dz[i];
+				local.dy[i] = m(1,0) * aPacket.dx[i] + m(1,1) * aPacket.dy[i] + m(1,2) * aPacket.dz[i];
+				local.dz[i] = m(2,0) * aPacket.dx[i] + m(2,1) * aPacket.dy[i] + m(2,2) * aPacket.dz[i];
+				local.tMin[i] = aPacket.tMin[i];
+				local.tMax[i] = tMax[i];
+			}
+
+			mMeshes[instance.mesh].intersect( local );
+
+			for( std::size_t i = 0; i < N; ++i )
+			{
+				if( kNoTriangle == local.triangle[i] )
+					continue;
+
+				tMax[i] = aPacket.t[i] = local.t[i];
+				aPacket.u[i] = local.u[i];
+				aPacket.v[i] = local.v[i];
+				aPacket.triangle[i] = local.triangle[i];
+				aInstances[i] = mOrder[k];
+			}
+		}
+	}
+}
+
+template< typename tTest >
+void SceneBvh::overlap_( Vec3f aMin, Vec3f aMax, std::vector<std::uint32_t>& aInstances, std::uint32_t aMask, tTest&& aTest ) const
+{
+	if( mNodes.empty() )
+		return;
+
+	std::uint32_t stack[kMaxDepth_];
+	std::size_t top = 0;
+
+	stack[top++] = 0;
+	while( top )
+	{
+		auto const& node = mNodes[stack[--top]];
+		if( !boxes_overlap_( node.min, node.max, aMin, aMax ) )
+			continue;
+
+		if( 0 == node.count )
+		{
+			stack[top++] = node.first+1;
+			stack[top++] = node.first;
+			continue;
+		}
+
+		for( std::size_t i = node.first; i < node.first+node.count; ++i )
+		{
+			auto const& instance = mInstances[mOrder[i]];
+			if( !(instance.mask & aMask) || !boxes_overlap_( instance.bounds.min, instance.bounds.max, aMin, aMax ) )
+				continue;
+
+			// Leaves are culled in model space, with the bounds of the query
+			// volume's bounds; the triangles are tested in world space.
+			Mat44f const& m = instance.model2world;
+			BvhBox const local = transform_box_( instance.world2model, aMin, aMax );
+			bool const overlaps = mMeshes[instance.mesh].any_triangle_( local.min, local.max, [&] (Vec3f aV0, Vec3f aE1, Vec3f aE2) {
+				return aTest( transform_point_( m, aV0 ), transform_vector_( m, aE1 ), transform_vector_( m, aE2 ) );
+			} );
+
+			if( overlaps )
+				aInstances.emplace_back( mOrder[i] );
+		}
+	}
+}
+
+void SceneBvh::overlap_sphere( Vec3f aCenter, float aRadius, std::vector<std::uint32_t>& aInstances, std::uint32_t aMask ) const
+{
+	Vec3f const r{ aRadius, aRadius, aRadius };
+	overlap_( aCenter - r, aCenter + r, aInstances, aMask, [&] (Vec3f aV0, Vec3f aE1, Vec3f aE2) {
+		return triangle_overlaps_sphere_( aV0, aE1, aE2, aCenter, aRadius );
+	} );
+}
+
+void SceneBvh::overlap_box( Vec3f aMin, Vec3f aMax, std::vector<std::uint32_t>& aInstances, std::uint32_t aMask ) const
+{
+	overlap_( aMin, aMax, aInstances, aMask, [&] (Vec3f aV0, Vec3f aE1, Vec3f aE2) {
+		return triangle_overlaps_box_( aV0, aE1, aE2, aMin, aMax );
+	} );
+}
+
+std::size_t SceneBvh::mesh_count() const noexcept
+{
+	return mMeshes.size();
+}
+std::size_t SceneBvh::instance_count() const noexcept
+{
+	return mInstances.size();
+}
+
+TriangleBvh const& SceneBvh::mesh( std::uint32_t aMesh ) const noexcept
+{
+	assert( aMesh < mMeshes.size() );
+	return mMeshes[aMesh];
+}
+BvhBox const& SceneBvh::bounds( std::uint32_t aInstance ) const noexcept
+{
+	assert( aInstance < mInstances.size() );
+	return mInstances[aInstance].bounds;
+}
+
+std::vector<BvhNode> const& SceneBvh::nodes() const noexcept
+{
+	return mNodes;
+}
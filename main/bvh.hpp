@@ -0,0 +1,223 @@
+#ifndef BVH_HPP_2C7E5B91_0F4D_4A68_B3D2_8E1F6A9C7054
+#define BVH_HPP_2C7E5B91_0F4D_4A68_B3D2_8E1F6A9C7054
+
+#include <limits>
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+constexpr std::uint32_t kNoTriangle = ~std::uint32_t(0);
+constexpr std::uint32_t kNoInstance = ~std::uint32_t(0);
+
+struct Ray
+{
+	Vec3f origin;
+	Vec3f direction; // need not be normalized; t is in units of it
+	float tMin = 0.f;
+	float tMax = std::numeric_limits<float>::infinity();
+};
+
+struct RayHit
+{
+	float t = std::numeric_limits<float>::infinity();
+	std::uint32_t triangle = kNoTriangle; // index as passed to the BVH
+	float u = 0.f, v = 0.f; // barycentric weights of the second and third vertex
+};
+
+/* RayPacket: kSize rays that are traced together
+ *
+ * The rays are stored as structure of arrays. They should be coherent (e.g.,
+ * camera rays through neighbouring pixels), since the packet visits every
+ * node that any of its rays visits. Lanes with tMax < tMin are inactive.
+ * The results are written to the hit arrays; triangle is kNoTriangle for
+ * rays without a hit.
+ */
+struct RayPacket
+{
+	static constexpr std::size_t kSize = 8;
+
+	float ox[kSize], oy[kSize], oz[kSize];
+	float dx[kSize], dy[kSize], dz[kSize];
+	float tMin[kSize], tMax[kSize];
+
+	float t[kSize], u[kSize], v[kSize];
+	std::uint32_t triangle[kSize];
+};
+
+struct BvhBox
+{
+	Vec3f min, max;
+};
+
+struct BvhNode
+{
+	Vec3f min;
+	std::uint32_t first; // first primitive (leaf) or left child (inner)
+	Vec3f max;
+	std::uint32_t count; // number of primitives; zero for inner nodes
+};
+
+/* build_bvh(): builds the nodes of a BVH over boxes
+ *
+ * Top-down, with the surface area heuristic, as described for TriangleBvh.
+ * The split planes are chosen by the primitives' centroids. aOrder receives
+ * the primitives' indices in leaf order: the primitives of a leaf are
+ * aOrder[first] ... aOrder[first+count-1].
+ */
+void build_bvh( BvhBox const* aBoxes, Vec3f const* aCentroids, std::size_t aCount, std::size_t aMaxLeafSize, std::vector<BvhNode>& aNodes, std::vector<std::uint32_t>& aOrder );
+
+/* TriangleBvh: bounding volume hierarchy over a triangle soup
+ *
+ * The positions are read as consecutive triples, like the non-indexed
+ * vertices of SimpleMeshData. The tree is built top-down with the surface
+ * area heuristic (SAH), evaluated at kBins bins along each axis of the
+ * triangles' centroid bounds. Nodes with at most kMaxLeafSize triangles
+ * become leaves when splitting does not pay off.
+ *
+ * Nodes are stored depth first in one array, and the two children of an
+ * inner node are adjacent. Each leaf's triangles are stored contiguously,
+ * as (vertex, edge, edge), which is the form the intersection test uses.
+ */
+class TriangleBvh final
+{
+	public:
+		static constexpr std::size_t kBins = 16;
+		static constexpr std::size_t kMaxLeafSize = 8;
+
+		using Node = BvhNode;
+
+	public:
+		TriangleBvh() = default;
+		TriangleBvh( Vec3f const* aPositions, std::size_t aTriangleCount );
+
+	public:
+		// Closest hit in [tMin, aHit.t) and [tMin, tMax]. Returns true and
+		// updates aHit if a closer hit was found.
+		bool intersect( Ray const&, RayHit& aHit ) const noexcept;
+
+		// Any hit in [tMin, tMax] (e.g., shadow rays). Stops at the first
+		// hit found, which is cheaper than finding the closest one.
+		bool occluded( Ray const& ) const noexcept;
+
+		// Closest hits for all rays of the packet
+		void intersect( RayPacket& ) const noexcept;
+
+		// Whether any triangle overlaps the sphere or the box (boundaries
+		// included)
+		bool overlaps_sphere( Vec3f aCenter, float aRadius ) const noexcept;
+		bool overlaps_box( Vec3f aMin, Vec3f aMax ) const noexcept;
+
+	public:
+		std::vector<Node> const& nodes() const noexcept;
+		std::size_t triangle_count() const noexcept;
+
+	private:
+		friend class SceneBvh;
+
+		struct Triangle_
+		{
+			Vec3f v0, e1, e2;
+		};
+
+		// Calls aTest( v0, e1, e2 ) for the triangles in leaves whose bounds
+		// overlap [aMin,aMax], until it returns true.
+		template< typename tTest >
+		bool any_triangle_( Vec3f aMin, Vec3f aMax, tTest&& aTest ) const noexcept;
+
+	private:
+		std::vector<Node> mNodes;
+		std::vector<Triangle_> mTriangles; // in leaf order
+		std::vector<std::uint32_t> mIndices; // original index of each
+};
+
+struct SceneHit
+{
+	float t = std::numeric_limits<float>::infinity();
+	std::uint32_t instance = kNoInstance;
+	std::uint32_t triangle = kNoTriangle; // in the instance's mesh
+	float u = 0.f, v = 0.f;
+};
+
+/* SceneBvh: spatial queries over a scene's geometry
+ *
+ * A two-level hierarchy: each mesh has its own TriangleBvh, in model space,
+ * and a top-level BVH is built over the instances of the meshes, with
+ * their world-space bounds. Meshes can thus be shared by several instances,
+ * and moving an instance only requires refitting the top level. Queries
+ * transform the ray (or the query volume's bounds) into each instance's
+ * model space, so t is the same in both; the exact overlap tests use the
+ * triangles in world space, so any affine transform works.
+ *
+ * Each instance has a mask; queries only consider instances whose mask
+ * shares a bit with the query's (e.g., to ignore the object that a
+ * line-of-sight test looks at).
+ *
+ * build() must be called after adding instances; refit() suffices after
+ * set_transform(). The tree's quality degrades as instances move far from
+ * where they were at build(), but the results stay correct.
+ */
+class SceneBvh final
+{
+	public:
+		static constexpr std::size_t kMaxLeafSize = 2;
+
+	public:
+		// Builds the mesh's BVH; returns the mesh's index.
+		std::uint32_t add_mesh( Vec3f const* aPositions, std::size_t aTriangleCount );
+
+		// Returns the instance's index.
+		std::uint32_t add_instance( std::uint32_t aMesh, Mat44f const& aModel2world, std::uint32_t aMask = ~std::uint32_t(0) );
+		void set_transform( std::uint32_t aInstance, Mat44f const& aModel2world );
+
+		void build();
+		void refit();
+
+	public:
+		bool intersect( Ray const&, SceneHit& aHit, std::uint32_t aMask = ~std::uint32_t(0) ) const noexcept;
+		bool occluded( Ray const&, std::uint32_t aMask = ~std::uint32_t(0) ) const noexcept;
+
+		// Closest hits for all rays of the packet; aInstances receives the
+		// instance (or kNoInstance) of each ray's hit. The packet's triangle
+		// indices refer to those instances' meshes.
+		void intersect( RayPacket&, std::uint32_t* aInstances, std::uint32_t aMask = ~std::uint32_t(0) ) const noexcept;
+
+		// Appends the instances whose triangles overlap the sphere or the
+		// (world-space) box
+		void overlap_sphere( Vec3f aCenter, float aRadius, std::vector<std::uint32_t>& aInstances, std::uint32_t aMask = ~std::uint32_t(0) ) const;
+		void overlap_box( Vec3f aMin, Vec3f aMax, std::vector<std::uint32_t>& aInstances, std::uint32_t aMask = ~std::uint32_t(0) ) const;
+
+	public:
+		std::size_t mesh_count() const noexcept;
+		std::size_t instance_count() const noexcept;
+
+		TriangleBvh const& mesh( std::uint32_t ) const noexcept;
+		BvhBox const& bounds( std::uint32_t aInstance ) const noexcept; // world space
+
+		std::vector<BvhNode> const& nodes() const noexcept;
+
+	private:
+		struct Instance_
+		{
+			std::uint32_t mesh;
+			std::uint32_t mask;
+			Mat44f model2world;
+			Mat44f world2model;
+			BvhBox bounds;
+		};
+
+		template< typename tTest >
+		void overlap_( Vec3f aMin, Vec3f aMax, std::vector<std::uint32_t>&, std::uint32_t aMask, tTest&& ) const;
+
+	private:
+		std::vector<TriangleBvh> mMeshes;
+		std::vector<Instance_> mInstances;
+
+		std::vector<BvhNode> mNodes;
+		std::vector<std::uint32_t> mOrder; // instances, in leaf order
+};
+
+#endif // BVH_HPP_2C7E5B91_0F4D_4A68_B3D2_8E1F6A9C7054
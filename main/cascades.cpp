@@ -0,0 +1,129 @@
+#include "cascades.hpp"
+
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include "../vmlib/vec4.hpp"
+
+namespace
+{
+	// Rotation into the light's frame: z points towards the light, so the
+	// light looks along -z.
+	Mat44f make_light_rotation_( Vec3f aToLight ) noexcept
+	{
+		Vec3f const z = normalize( aToLight );
+
+		// Any up vector that is not parallel to the light works; the
+		// cascade's orientation is fixed, which keeps the texel grid stable.
+		Vec3f const up = std::abs( z.y ) < 0.99f ? Vec3f{ 0.f, 1.f, 0.f } : Vec3f{ 1.f, 0.f, 0.f };
+		Vec3f const x = normalize( cross( up, z ) );
+		Vec3f const y = cross( z, x );
+
+		return { {
+			x.x, x.y, x.z, 0.f,
+			y.x, y.y, y.z, 0.f,
+			z.x, z.y, z.z, 0.f,
+			0.f, 0.f, 0.f, 1.f
+		} };
+	}
+
+	// OpenGL-style orthographic projection of the box [aL,aR]x[aB,aT]x[-aF,-aN].
+	Mat44f make_orthographic_( float aL, float aR, float aB, float aT, float aN, float aF ) noexcept
+	{
+		return { {
+			2.f/(aR-aL), 0.f, 0.f, -(aR+aL)/(aR-aL),
+			0.f, 2.f/(aT-aB), 0.f, -(aT+aB)/(aT-aB),
+			0.f, 0.f, -2.f/(aF-aN), -(aF+aN)/(aF-aN),
+			0.f, 0.f, 0.f, 1.f
+		} };
+	}
+}
+
+void compute_cascade_splits( float aNear, float aFar, std::size_t aCount, float aLambda, float* aSplits ) noexcept
+{
+	assert( aNear > 0.f && aFar > aNear );
+
+	for( std::size_t i = 1; i <= aCount; ++i )
+	{
+		float const f = float(i) / float(aCount);
+		float const logSplit = aNear * std::pow( aFar / aNear, f );
+		float const uniformSplit = aNear + (aFar - aNear) * f;
+		aSplits[i-1] = aLambda * logSplit + (1.f - aLambda) * uniformSplit;
+	}
+
+	aSplits[aCount-1] = aFar; // exactly
+}
+
+Cascade fit_cascade( CascadeView const& aView, float aSliceNear, float aSliceFar, Vec3f aToLight, CascadeParams const& aParams ) noexcept
+{
+	// Corners of the slice, in world space
+	float const tanY = std::tan( 0.5f * aView.fovY );
+	float const tanX = tanY * aView.aspect;
+
+	Vec3f corners[8];
+	for( int i = 0; i < 8; ++i )
+	{
+		float const d = (i & 4) ? aSliceFar : aSliceNear;
+		float const x = (i & 1) ? d*tanX : -d*tanX;
+		float const y = (i & 2) ? d*tanY : -d*tanY;
+
+		Vec4f const p = aView.camera2world * Vec4f{ x, y, -d, 1.f };
+		corners[i] = Vec3f{ p.x, p.y, p.z };
+	}
+
+	// Bounding sphere. The center lies on the view axis; the farthest corner
+	// is one of the far corners (or a near one, for very wide slices).
+	Vec3f center{ 0.f, 0.f, 0.f };
+	for( auto const& c : corners )
+		center += c;
+	center /= 8.f;
+
+	float radius = 0.f;
+	for( auto const& c : corners )
+		radius = std::max( radius, length( c - center ) );
+
+	// Round up, such that floating point noise does not change the size of
+	// the cascade from frame to frame.
+	radius = std::ceil( radius * 16.f ) / 16.f;
+
+	float const texelSize = 2.f * radius / float(aParams.resolution);
+
+	// Snap the center to the texel grid in light space.
+	Mat44f const rotation = make_light_rotation_( aToLight );
+	Vec4f const lc = rotation * Vec4f{ center.x, center.y, center.z, 1.f };
+	float const cx = std::round( lc.x / texelSize ) * texelSize;
+	float const cy = std::round( lc.y / texelSize ) * texelSize;
+
+	// The light looks along -z. Casters up to casterMargin in front of the
+	// sphere are included.
+	float const zNear = -(lc.z + radius + aParams.casterMargin);
+	float const zFar = -(lc.z - radius);
+
+	Cascade ret;
+	ret.viewProjection = make_orthographic_( cx - radius, cx + radius, cy - radius, cy + radius, zNear, zFar ) * rotation;
+	ret.splitFar = aSliceFar;
+	ret.texelSize = texelSize;
+	return ret;
+}
+
+std::size_t fit_cascades( CascadeView const& aView, Vec3f aToLight, CascadeParams const& aParams, Cascade* aCascades ) noexcept
+{
+	std::size_t const count = std::min( aParams.count, kMaxShadowCascades );
+	if( 0 == count )
+		return 0;
+
+	float splits[kMaxShadowCascades];
+	float const far = std::min( aView.far, aParams.maxDistance );
+	compute_cascade_splits( aView.near, far, count, aParams.splitLambda, splits );
+
+	float sliceNear = aView.near;
+	for( std::size_t i = 0; i < count; ++i )
+	{
+		aCascades[i] = fit_cascade( aView, sliceNear, splits[i], aToLight, aParams );
+		sliceNear = splits[i];
+	}
+
+	return count;
+}
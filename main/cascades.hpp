@@ -0,0 +1,54 @@
+#ifndef CASCADES_HPP_71C5A3E9_0B2D_4F86_9E47_D83A6C15B2F0
+#define CASCADES_HPP_71C5A3E9_0B2D_4F86_9E47_D83A6C15B2F0
+
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+constexpr std::size_t kMaxShadowCascades = 4;
+
+struct CascadeParams
+{
+	std::size_t count = 3; // 0 disables shadows
+	std::size_t resolution = 2048; // texels, per side and cascade
+
+	float maxDistance = 30.f; // the last cascade ends here (or at the far plane)
+	float splitLambda = 0.75f; // 0: uniform splits, 1: logarithmic splits
+	float casterMargin = 20.f; // casters this far beyond a cascade still cast into it
+};
+
+// Perspective camera, as set up by make_perspective_projection().
+struct CascadeView
+{
+	Mat44f camera2world;
+	float fovY; // radians
+	float aspect;
+	float near, far;
+};
+
+struct Cascade
+{
+	Mat44f viewProjection; // world to light clip space
+	float splitFar; // view distance at which the cascade ends
+	float texelSize; // world units per shadow map texel
+};
+
+// Far end of each of aCount cascades between aNear and aFar. The "practical
+// split scheme": a blend of uniform and logarithmic splits.
+void compute_cascade_splits( float aNear, float aFar, std::size_t aCount, float aLambda, float* aSplits ) noexcept;
+
+/* Fits a cascade to the slice [aSliceNear, aSliceFar] of the view frustum
+ *
+ * The cascade is an orthographic projection along the light direction
+ * (aToLight points towards the light). It covers the bounding sphere of the
+ * slice, such that its size does not change as the camera rotates, and its
+ * origin is snapped to whole texels, such that shadow edges do not shimmer
+ * as the camera moves.
+ */
+Cascade fit_cascade( CascadeView const&, float aSliceNear, float aSliceFar, Vec3f aToLight, CascadeParams const& ) noexcept;
+
+// Fits params.count cascades to the view. Returns the number of cascades.
+std::size_t fit_cascades( CascadeView const&, Vec3f aToLight, CascadeParams const&, Cascade* aCascades ) noexcept;
+
+#endif // CASCADES_HPP_71C5A3E9_0B2D_4F86_9E47_D83A6C15B2F0
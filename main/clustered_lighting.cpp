@@ -0,0 +1,67 @@
+#include "clustered_lighting.hpp"
+
+#include <algorithm>
+
+#include <cstring>
+
+namespace
+{
+	// Zero-sized ranges cannot be bound; allocate at least this much.
+	constexpr std::size_t kMinBlockSize_ = 16;
+
+	StreamBuffer::Allocation upload_( StreamBuffer& aStream, void const* aData, std::size_t aSize )
+	{
+		auto const alloc = aStream.allocate( std::max( aSize, kMinBlockSize_ ), StreamBuffer::storage_alignment() );
+		if( aSize )
+			std::memcpy( alloc.data, aData, aSize );
+		aStream.commit( alloc );
+		return alloc;
+	}
+}
+
+ClusteredLighting::ClusteredLighting( ClusterGrid const& aGrid )
+	: mClusters( aGrid )
+{}
+
+void ClusteredLighting::update( PointLight const* aLights, std::size_t aCount, ClusterView const& aView, float aViewportWidth, float aViewportHeight, ThreadPool& aPool, StreamBuffer& aStream )
+{
+	mClusters.build( aLights, aCount, aView, aPool );
+	mLightCount = aCount;
+
+	auto const& ranges = mClusters.clusters();
+	auto const& indices = mClusters.indices();
+
+	mStream = &aStream;
+	mLights = upload_( aStream, aLights, aCount * sizeof(PointLight) );
+	mRanges = upload_( aStream, ranges.data(), ranges.size() * sizeof(LightClusters::Range) );
+	mIndices = upload_( aStream, indices.data(), indices.size() * sizeof(std::uint32_t) );
+
+	auto const& grid = mClusters.grid();
+	mTileSize[0] = aViewportWidth / float(grid.x);
+	mTileSize[1] = aViewportHeight / float(grid.y);
+}
+
+void ClusteredLighting::set_uniforms() const
+{
+	if( !mStream )
+		return;
+
+	mStream->bind_range( GL_SHADER_STORAGE_BUFFER, 2, mLights );
+	mStream->bind_range( GL_SHADER_STORAGE_BUFFER, 3, mRanges );
+	mStream->bind_range( GL_SHADER_STORAGE_BUFFER, 4, mIndices );
+
+	auto const& grid = mClusters.grid();
+	glUniform3ui( 21, grid.x, grid.y, grid.z );
+	glUniform2f( 22, mClusters.slice_scale(), mClusters.slice_bias() );
+	glUniform2fv( 23, 1, mTileSize );
+}
+
+LightClusters const& ClusteredLighting::clusters() const noexcept
+{
+	return mClusters;
+}
+
+std::size_t ClusteredLighting::light_count() const noexcept
+{
+	return mLightCount;
+}
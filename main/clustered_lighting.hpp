@@ -0,0 +1,47 @@
+#ifndef CLUSTERED_LIGHTING_HPP_9D61B0F4_5E2A_4C87_B3D9_07A4F8E21C65
+#define CLUSTERED_LIGHTING_HPP_9D61B0F4_5E2A_4C87_B3D9_07A4F8E21C65
+
+#include <glad/glad.h>
+
+#include <cstdlib>
+
+#include "../support/stream_buffer.hpp"
+
+#include "light_clusters.hpp"
+
+class ThreadPool;
+
+/* ClusteredLighting: point lights for the object shaders
+ *
+ * Each frame, update() bins the lights into clusters (LightClusters) on the
+ * thread pool, and writes the lights, the per-cluster ranges and the light
+ * indices into the stream buffer. set_uniforms() binds them as storage
+ * blocks 2-4 of the current program (FEATURE_POINT_LIGHTS; see
+ * objects.frag), such that each fragment only loops over the lights of its
+ * own cluster.
+ */
+class ClusteredLighting final
+{
+	public:
+		explicit ClusteredLighting( ClusterGrid const& = {} );
+
+	public:
+		void update( PointLight const*, std::size_t aCount, ClusterView const&, float aViewportWidth, float aViewportHeight, ThreadPool&, StreamBuffer& );
+
+		void set_uniforms() const;
+
+	public:
+		LightClusters const& clusters() const noexcept;
+		std::size_t light_count() const noexcept;
+
+	private:
+		LightClusters mClusters;
+		std::size_t mLightCount = 0;
+
+		StreamBuffer const* mStream = nullptr;
+		StreamBuffer::Allocation mLights{}, mRanges{}, mIndices{};
+
+		float mTileSize[2] = {}; // pixels
+};
+
+#endif // CLUSTERED_LIGHTING_HPP_9D61B0F4_5E2A_4C87_B3D9_07A4F8E21C65
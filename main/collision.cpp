@@ -0,0 +1,347 @@
+#include "collision.hpp"
+
+#include <atomic>
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	// Bodies per chunk, for building the hash and for finding contacts
+	constexpr std::size_t kBodyGrain_ = 4096;
+
+	// Buckets per chunk, for the prefix sum and for sorting the buckets
+	constexpr std::size_t kBucketGrain_ = 16*1024;
+
+	// Cross products of nearly parallel axes are skipped by the separating
+	// axis test; the face axes cover those cases.
+	constexpr float kParallelEpsilon_ = 1e-6f;
+
+	struct Cell_
+	{
+		std::int32_t x, y, z;
+	};
+
+	inline Cell_ cell_( Vec3f aPosition, float aInvCellSize ) noexcept
+	{
+		return {
+			std::int32_t(std::floor( aPosition.x * aInvCellSize )),
+			std::int32_t(std::floor( aPosition.y * aInvCellSize )),
+			std::int32_t(std::floor( aPosition.z * aInvCellSize ))
+		};
+	}
+
+	// Teschner et al., "Optimized Spatial Hashing for Collision Detection
+	// of Deformable Objects"
+	inline std::uint32_t hash_( std::int32_t aX, std::int32_t aY, std::int32_t aZ ) noexcept
+	{
+		return (std::uint32_t(aX) * 73856093u) ^ (std::uint32_t(aY) * 19349663u) ^ (std::uint32_t(aZ) * 83492791u);
+	}
+
+	// Separating axis test between two oriented boxes. On overlap, returns
+	// the axis of least penetration, pointing from aB towards aA.
+	bool obb_overlap_( Obb const& aA, Obb const& aB, Vec3f& aNormal, float& aDepth ) noexcept
+	{
+		Vec3f const t = aA.center - aB.center;
+
+		float best = std::numeric_limits<float>::infinity();
+		auto const test = [&] (Vec3f aAxis) {
+			float const len2 = dot( aAxis, aAxis );
+			if( len2 < kParallelEpsilon_ )
+				return true;
+
+			Vec3f const axis = aAxis / std::sqrt( len2 );
+			float const ra = aA.half.x * std::abs( dot( aA.axes[0], axis ) ) + aA.half.y * std::abs( dot( aA.axes[1], axis ) ) + aA.half.z * std::abs( dot( aA.axes[2], axis ) );
+			float const rb = aB.half.x * std::abs( dot( aB.axes[0], axis ) ) + aB.half.y * std::abs( dot( aB.axes[1], axis ) ) + aB.half.z * std::abs( dot( aB.axes[2], axis ) );
+			float const distance = dot( t, axis );
+			float const overlap = ra + rb - std::abs( distance );
+			if( overlap <= 0.f )
+				return false;
+
+			if( overlap < best )
+			{
+				best = overlap;
+				aNormal = distance < 0.f ? -axis : axis;
+			}
+			return true;
+		};
+
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			if( !test( aA.axes[i] ) || !test( aB.axes[i] ) )
+				return false;
+		}
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			for( std::size_t j = 0; j < 3; ++j )
+			{
+				if( !test( cross( aA.axes[i], aB.axes[j] ) ) )
+					return false;
+			}
+		}
+
+		aDepth = best;
+		return true;
+	}
+
+	// Distance from the point to the box (zero inside)
+	float obb_distance_sq_( Obb const& aBox, Vec3f aPoint ) noexcept
+	{
+		Vec3f const d = aPoint - aBox.center;
+
+		float ret = 0.f;
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			float const outside = std::abs( dot( d, aBox.axes[i] ) ) - aBox.half[i];
+			if( outside > 0.f )
+				ret += outside * outside;
+		}
+		return ret;
+	}
+}
+
+Obb make_obb( Mat44f const& aModel2world, Vec3f aMin, Vec3f aMax ) noexcept
+{
+	Vec3f const center = (aMin + aMax) * 0.5f, half = (aMax - aMin) * 0.5f;
+	Vec4f const c = aModel2world * Vec4f{ center.x, center.y, center.z, 1.f };
+
+	Obb ret;
+	ret.center = Vec3f{ c.x, c.y, c.z };
+	for( std::size_t i = 0; i < 3; ++i )
+	{
+		Vec3f const axis{ aModel2world(0,i), aModel2world(1,i), aModel2world(2,i) };
+		float const scale = length( axis );
+
+		ret.axes[i] = scale > 0.f ? axis / scale : Vec3f{ float(0 == i), float(1 == i), float(2 == i) };
+		ret.half[i] = half[i] * scale;
+	}
+	return ret;
+}
+
+CollisionWorld::CollisionWorld( BodyShape const& aShape )
+	: mShape( aShape )
+	, mCellSize( 2.f * aShape.radius )
+	, mInvCellSize( 1.f / (2.f * aShape.radius) )
+{
+	assert( aShape.radius > 0.f );
+}
+
+std::uint32_t CollisionWorld::add_obstacle( Obb const& aBox )
+{
+	mObstacles.emplace_back( Obstacle_{ aBox, length( aBox.half ) } );
+	return std::uint32_t(mObstacles.size() - 1);
+}
+
+void CollisionWorld::detect( Vec3f const* aPositions, std::size_t aCount, ThreadPool& aPool )
+{
+	assert( aPositions || 0 == aCount );
+	assert( aCount < ~std::uint32_t(0) );
+
+	mContacts.clear();
+	mStats = CollisionStats{};
+	mStats.bodies = aCount;
+	if( 0 == aCount )
+		return;
+
+	// About two buckets per body keeps collisions between cells rare.
+	std::size_t buckets = 64;
+	while( buckets < 2*aCount )
+		buckets *= 2;
+
+	mBucketMask = std::uint32_t(buckets - 1);
+	mKeys.resize( aCount );
+	mSorted.resize( aCount );
+	mStart.assign( buckets+1, 0 );
+	mCursor.resize( buckets );
+
+	std::size_t const bodyChunks = (aCount + kBodyGrain_ - 1) / kBodyGrain_;
+	std::size_t const bucketChunks = (buckets + kBucketGrain_ - 1) / kBucketGrain_;
+
+	// Count the bodies per bucket.
+	aPool.parallel_for( bodyChunks, 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t i = aBegin * kBodyGrain_; i < std::min( aEnd * kBodyGrain_, aCount ); ++i )
+		{
+			Cell_ const cell = cell_( aPositions[i], mInvCellSize );
+			std::uint32_t const key = hash_( cell.x, cell.y, cell.z ) & mBucketMask;
+			mKeys[i] = key;
+			std::atomic_ref<std::uint32_t>( mStart[key] ).fetch_add( 1, std::memory_order_relaxed );
+		}
+	} );
+
+	// Exclusive prefix sum: per chunk of buckets, then over the chunks'
+	// totals, then the chunks' offsets are added.
+	std::vector<std::uint32_t> chunkTotals( bucketChunks, 0 );
+	std::vector<std::size_t> chunkCells( bucketChunks, 0 );
+	aPool.parallel_for( bucketChunks, 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t c = aBegin; c < aEnd; ++c )
+		{
+			std::uint32_t sum = 0;
+			for( std::size_t k = c * kBucketGrain_; k < std::min( (c+1) * kBucketGrain_, buckets ); ++k )
+			{
+				chunkCells[c] += 0 != mStart[k];
+				sum += std::exchange( mStart[k], sum );
+			}
+			chunkTotals[c] = sum;
+		}
+	} );
+
+	std::uint32_t offset = 0;
+	for( std::size_t c = 0; c < bucketChunks; ++c )
+	{
+		offset += std::exchange( chunkTotals[c], offset );
+		mStats.cells += chunkCells[c];
+	}
+	mStart[buckets] = offset;
+
+	aPool.parallel_for( bucketChunks, 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t c = aBegin; c < aEnd; ++c )
+		{
+			for( std::size_t k = c * kBucketGrain_; k < std::min( (c+1) * kBucketGrain_, buckets ); ++k )
+				mCursor[k] = mStart[k] += chunkTotals[c];
+		}
+	} );
+
+	// Scatter the bodies into their buckets. The order within a bucket
+	// depends on the scheduling, so the buckets are sorted afterwards.
+	aPool.parallel_for( bodyChunks, 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t i = aBegin * kBodyGrain_; i < std::min( aEnd * kBodyGrain_, aCount ); ++i )
+		{
+			auto const slot = std::atomic_ref<std::uint32_t>( mCursor[mKeys[i]] ).fetch_add( 1, std::memory_order_relaxed );
+			mSorted[slot] = std::uint32_t(i);
+		}
+	} );
+
+	aPool.parallel_for( bucketChunks, 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t k = aBegin * kBucketGrain_; k < std::min( aEnd * kBucketGrain_, buckets ); ++k )
+		{
+			if( mStart[k+1] - mStart[k] > 1 )
+				std::sort( mSorted.begin() + mStart[k], mSorted.begin() + mStart[k+1] );
+		}
+	} );
+
+	// Contacts, per chunk of bodies
+	mChunks.resize( std::max( mChunks.size(), bodyChunks ) );
+	aPool.parallel_for( bodyChunks, 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t c = aBegin; c < aEnd; ++c )
+			find_contacts_( aPositions, c * kBodyGrain_, std::min( (c+1) * kBodyGrain_, aCount ), mChunks[c] );
+	} );
+
+	for( std::size_t c = 0; c < bodyChunks; ++c )
+	{
+		mStats.pairsTested += mChunks[c].pairsTested;
+		mStats.bodyContacts += mChunks[c].bodies.size();
+		mStats.obstacleContacts += mChunks[c].obstacles.size();
+		mStats.groundContacts += mChunks[c].ground.size();
+	}
+
+	mContacts.reserve( mStats.bodyContacts + mStats.obstacleContacts + mStats.groundContacts );
+	for( auto const list : { &Chunk_::bodies, &Chunk_::obstacles, &Chunk_::ground } )
+	{
+		for( std::size_t c = 0; c < bodyChunks; ++c )
+			mContacts.insert( mContacts.end(), (mChunks[c].*list).begin(), (mChunks[c].*list).end() );
+	}
+}
+
+BodyShape const& CollisionWorld::shape() const noexcept
+{
+	return mShape;
+}
+float CollisionWorld::cell_size() const noexcept
+{
+	return mCellSize;
+}
+
+std::vector<Contact> const& CollisionWorld::contacts() const noexcept
+{
+	return mContacts;
+}
+CollisionStats const& CollisionWorld::stats() const noexcept
+{
+	return mStats;
+}
+
+void CollisionWorld::find_contacts_( Vec3f const* aPositions, std::size_t aBegin, std::size_t aEnd, Chunk_& aChunk ) const
+{
+	aChunk.bodies.clear();
+	aChunk.obstacles.clear();
+	aChunk.ground.clear();
+	aChunk.pairsTested = 0;
+
+	float const reach = 2.f * mShape.radius;
+	Vec3f const span = 2.f * mShape.half;
+
+	for( std::size_t i = aBegin; i < aEnd; ++i )
+	{
+		Vec3f const p = aPositions[i];
+		Cell_ const cell = cell_( p, mInvCellSize );
+
+		// Neighbouring cells may share a bucket; each bucket is only
+		// visited once, so that no pair is found twice.
+		std::uint32_t keys[27];
+		std::size_t keyCount = 0;
+		for( std::int32_t dz = -1; dz <= 1; ++dz )
+		{
+			for( std::int32_t dy = -1; dy <= 1; ++dy )
+			{
+				for( std::int32_t dx = -1; dx <= 1; ++dx )
+				{
+					std::uint32_t const key = hash_( cell.x+dx, cell.y+dy, cell.z+dz ) & mBucketMask;
+					if( std::find( keys, keys+keyCount, key ) == keys+keyCount )
+						keys[keyCount++] = key;
+				}
+			}
+		}
+
+		std::size_t const first = aChunk.bodies.size();
+		for( std::size_t k = 0; k < keyCount; ++k )
+		{
+			for( std::uint32_t s = mStart[keys[k]]; s < mStart[keys[k]+1]; ++s )
+			{
+				std::uint32_t const j = mSorted[s];
+				if( j <= i )
+					continue;
+
+				++aChunk.pairsTested;
+				Vec3f const d = aPositions[j] - p;
+				if( dot( d, d ) >= reach * reach )
+					continue;
+
+				Vec3f const overlap{ span.x - std::abs( d.x ), span.y - std::abs( d.y ), span.z - std::abs( d.z ) };
+				if( overlap.x <= 0.f || overlap.y <= 0.f || overlap.z <= 0.f )
+					continue;
+
+				std::size_t const axis = overlap.x <= overlap.y && overlap.x <= overlap.z ? 0 : (overlap.y <= overlap.z ? 1 : 2);
+				Vec3f normal{ 0.f, 0.f, 0.f };
+				normal[axis] = d[axis] > 0.f ? -1.f : 1.f;
+				aChunk.bodies.emplace_back( Contact{ ContactKind::body, std::uint32_t(i), j, normal, overlap[axis] } );
+			}
+		}
+
+		std::sort( aChunk.bodies.begin() + std::ptrdiff_t(first), aChunk.bodies.end(), [] (Contact const& aX, Contact const& aY) {
+			return aX.b < aY.b;
+		} );
+
+		Obb const box{ p, { { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f } }, mShape.half };
+		for( std::size_t o = 0; o < mObstacles.size(); ++o )
+		{
+			auto const& obstacle = mObstacles[o];
+			Vec3f const d = p - obstacle.box.center;
+			float const r = mShape.radius + obstacle.radius;
+			if( dot( d, d ) >= r * r || obb_distance_sq_( obstacle.box, p ) >= mShape.radius * mShape.radius )
+				continue;
+
+			Vec3f normal;
+			float depth;
+			if( obb_overlap_( box, obstacle.box, normal, depth ) )
+				aChunk.obstacles.emplace_back( Contact{ ContactKind::obstacle, std::uint32_t(i), std::uint32_t(o), normal, depth } );
+		}
+
+		if( float const bottom = p.y - mShape.half.y; bottom < 0.f )
+			aChunk.ground.emplace_back( Contact{ ContactKind::ground, std::uint32_t(i), 0, { 0.f, 1.f, 0.f }, -bottom } );
+	}
+}
@@ -0,0 +1,134 @@
+#ifndef COLLISION_HPP_4B8E2D61_A93C_4F07_8D15_C62F0A7E93B4
+#define COLLISION_HPP_4B8E2D61_A93C_4F07_8D15_C62F0A7E93B4
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+class ThreadPool;
+
+// Oriented box
+struct Obb
+{
+	Vec3f center;
+	Vec3f axes[3]; // orthonormal
+	Vec3f half; // extents along the axes
+};
+
+// The box [aMin,aMax] under aModel2world, which must not shear (e.g.,
+// rotations, scales along the box's axes, translations).
+Obb make_obb( Mat44f const& aModel2world, Vec3f aMin, Vec3f aMax ) noexcept;
+
+// The shape of all bodies: a bounding sphere, and an axis-aligned box for
+// the exact test. Both are centered on the body's position. (The vehicles
+// are identical and do not rotate.)
+struct BodyShape
+{
+	float radius;
+	Vec3f half;
+};
+
+enum class ContactKind : std::uint8_t
+{
+	body, // b is another body, b > a
+	obstacle, // b is an obstacle
+	ground // with the sea plane, y = 0
+};
+
+// Overlap of body a with b, which is pushed out of it by moving depth units
+// along normal.
+struct Contact
+{
+	ContactKind kind;
+	std::uint32_t a, b;
+	Vec3f normal; // unit, towards a
+	float depth;
+};
+
+struct CollisionStats
+{
+	std::size_t bodies;
+	std::size_t cells; // occupied cells
+	std::size_t pairsTested; // sphere tests between bodies
+	std::size_t bodyContacts, obstacleContacts, groundContacts;
+};
+
+/* CollisionWorld: contacts between moving bodies, static obstacles and the
+ * ground
+ *
+ * detect() finds all contacts for the bodies' current positions; nothing
+ * is kept from one call to the next, so the bodies may move arbitrarily in
+ * between. The broadphase is a spatial hash over a uniform grid, whose cells
+ * are at least a body's bounding sphere across. Overlapping bodies are thus
+ * in the same or in adjacent cells, and each body only visits the 27 cells
+ * around its own.
+ *
+ * The hash is rebuilt on every call, on the thread pool: the bodies' cells
+ * are counted (with atomic increments) and prefix summed, the bodies are
+ * scattered into their cells, and each cell's bodies are sorted by index.
+ * Each chunk of bodies then looks up its neighbours and writes its own
+ * contacts; the chunks' contacts are concatenated in order. The result thus
+ * depends neither on the thread count nor on the scheduling.
+ *
+ * The narrowphase checks the bounding spheres first, and then the boxes:
+ * box against box for bodies, box against oriented box (separating axes)
+ * for obstacles. Obstacles are few and large (the landing pads); each body
+ * tests all of them, rejecting most by their bounding spheres.
+ */
+class CollisionWorld final
+{
+	public:
+		explicit CollisionWorld( BodyShape const& );
+
+	public:
+		std::uint32_t add_obstacle( Obb const& );
+
+		void detect( Vec3f const* aPositions, std::size_t aCount, ThreadPool& );
+
+	public:
+		BodyShape const& shape() const noexcept;
+		float cell_size() const noexcept;
+
+		// Sorted by kind, then a, then b
+		std::vector<Contact> const& contacts() const noexcept;
+		CollisionStats const& stats() const noexcept;
+
+	private:
+		struct Obstacle_
+		{
+			Obb box;
+			float radius; // bounding sphere, around box.center
+		};
+
+		struct Chunk_
+		{
+			std::vector<Contact> bodies, obstacles, ground;
+			std::size_t pairsTested;
+		};
+
+		void find_contacts_( Vec3f const* aPositions, std::size_t aBegin, std::size_t aEnd, Chunk_& ) const;
+
+	private:
+		BodyShape mShape;
+		float mCellSize, mInvCellSize;
+
+		std::vector<Obstacle_> mObstacles;
+
+		// Spatial hash; buckets are cells, or several cells whose hashes
+		// collide.
+		std::vector<std::uint32_t> mKeys; // per body
+		std::vector<std::uint32_t> mStart; // per bucket, and one past the end
+		std::vector<std::uint32_t> mCursor;
+		std::vector<std::uint32_t> mSorted; // bodies, grouped by bucket
+		std::uint32_t mBucketMask = 0;
+
+		std::vector<Chunk_> mChunks;
+		std::vector<Contact> mContacts;
+		CollisionStats mStats{};
+};
+
+#endif // COLLISION_HPP_4B8E2D61_A93C_4F07_8D15_C62F0A7E93B4
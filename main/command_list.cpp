@@ -0,0 +1,58 @@
+#include "command_list.hpp"
+
+#include <limits>
+
+#include <cassert>
+
+void set_packet_transform( DrawPacket& aPacket, Mat44f const& aProjCamera, Mat44f const& aModel2world ) noexcept
+{
+	aPacket.projCameraWorld = aProjCamera * aModel2world;
+	aPacket.model2world = aModel2world;
+	aPacket.normalMatrix = mat44_to_mat33( transpose( invert( aModel2world ) ) );
+}
+
+void CommandList::clear() noexcept
+{
+	mPackets.clear();
+	mQueue.clear();
+}
+
+std::uint32_t CommandList::record( DrawPacket const& aPacket )
+{
+	assert( mPackets.size() < std::numeric_limits<std::uint32_t>::max() );
+
+	auto const index = std::uint32_t(mPackets.size());
+	mPackets.emplace_back( aPacket );
+	return index;
+}
+
+void CommandList::submit( RenderPass aPass, std::uint32_t aProgram, std::uint32_t aMaterial, float aDepth, std::uint32_t aPacket )
+{
+	assert( aPacket < mPackets.size() );
+	mQueue.submit( aPass, aProgram, aMaterial, aDepth, aPacket );
+}
+
+std::vector<DrawPacket> const& CommandList::packets() const noexcept
+{
+	return mPackets;
+}
+RenderQueue const& CommandList::queue() const noexcept
+{
+	return mQueue;
+}
+
+void merge_command_lists( CommandList const* aLists, std::size_t aCount, RenderQueue& aQueue, std::vector<DrawPacket const*>& aPackets )
+{
+	aQueue.clear();
+	aPackets.clear();
+
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		auto const& list = aLists[i];
+		aQueue.append( list.queue(), std::uint32_t(aPackets.size()) );
+		for( auto const& packet : list.packets() )
+			aPackets.emplace_back( &packet );
+	}
+
+	aQueue.sort();
+}
@@ -0,0 +1,75 @@
+#ifndef COMMAND_LIST_HPP_5E2A9C17_B4D3_4F60_8A1E_37C9D02F6B85
+#define COMMAND_LIST_HPP_5E2A9C17_B4D3_4F60_8A1E_37C9D02F6B85
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/mat44.hpp"
+#include "../vmlib/mat33.hpp"
+
+#include "render_queue.hpp"
+
+struct VertexDecode;
+
+/* DrawPacket: a recorded draw
+ *
+ * Everything that the GL thread needs to issue the draw, with the per-object
+ * math (the matrix products and the normal matrix) already done. Single
+ * draws use projCameraWorld, normalMatrix and model2world; instanced draws
+ * (non-zero instanceCount) only projCameraWorld, which is then the plain
+ * view-projection matrix. The shader variant is not stored: it is the
+ * program part of the packet's sort key(s), which may differ per pass.
+ */
+struct DrawPacket
+{
+	std::uint32_t vao;
+	std::uint32_t texture; // 0 if untextured
+	std::uint32_t first, vertices;
+	std::uint32_t instanceCount = 0, baseInstance = 0;
+	VertexDecode const* decode = nullptr; // if the VAO is quantized
+
+	Mat44f projCameraWorld{};
+	Mat44f model2world{};
+	Mat33f normalMatrix{};
+};
+
+// Fills in the packet's matrices for a single draw
+void set_packet_transform( DrawPacket&, Mat44f const& aProjCamera, Mat44f const& aModel2world ) noexcept;
+
+/* CommandList: draws recorded by one thread
+ *
+ * A list holds packets, and a RenderQueue whose items index them. Each
+ * packet may be submitted to several passes. Lists are filled independently
+ * (e.g., one per scene partition, on the ThreadPool's workers); they share
+ * no state, so no locking is needed.
+ *
+ * merge_command_lists() then gathers the lists' entries into a single queue
+ * and sorts it; the queue's items index the returned packet pointers. Since
+ * the sort is stable and the lists are merged in order, the result is the
+ * same as if all draws had been submitted serially, list by list. The lists
+ * must not change until the merged queue has been drawn.
+ */
+class CommandList final
+{
+	public:
+		void clear() noexcept;
+
+		// Returns the packet's index, for submit()
+		std::uint32_t record( DrawPacket const& );
+
+		void submit( RenderPass, std::uint32_t aProgram, std::uint32_t aMaterial, float aDepth, std::uint32_t aPacket );
+
+	public:
+		std::vector<DrawPacket> const& packets() const noexcept;
+		RenderQueue const& queue() const noexcept;
+
+	private:
+		std::vector<DrawPacket> mPackets;
+		RenderQueue mQueue;
+};
+
+void merge_command_lists( CommandList const* aLists, std::size_t aCount, RenderQueue& aQueue, std::vector<DrawPacket const*>& aPackets );
+
+#endif // COMMAND_LIST_HPP_5E2A9C17_B4D3_4F60_8A1E_37C9D02F6B85
@@ -0,0 +1,136 @@
+#include "fleet.hpp"
+
+#include <numbers>
+#include <algorithm>
+
+#include <cmath>
+
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	// sin(x) for any x. Reduces x to [-pi/2, pi/2] and evaluates an odd
+	// polynomial (Taylor series to x^11). Branch free, so that loops calling
+	// it can be vectorized.
+	inline
+	float sin_approx_( float aX ) noexcept
+	{
+		constexpr float kPi = std::numbers::pi_v<float>;
+		constexpr float kTwoPi = 2.f * kPi;
+
+		// Round to the nearest integer by adding and subtracting 1.5*2^23.
+		// Unlike std::floor() or std::round(), this vectorizes without
+		// -ffast-math. (Valid for |aX| < 2^22*2pi, which is plenty.)
+		constexpr float kRound = 0x1.8p23f;
+		float const k = (aX * (1.f / kTwoPi) + kRound) - kRound;
+
+		float x = aX - kTwoPi * k; // [-pi, pi]
+		x = x > 0.5f*kPi ? kPi - x : x;
+		x = x < -0.5f*kPi ? -kPi - x : x;
+
+		float const x2 = x * x;
+		return x * (1.f + x2 * (-1.f/6.f + x2 * (1.f/120.f + x2 * (-1.f/5040.f + x2 * (1.f/362880.f + x2 * (-1.f/39916800.f))))));
+	}
+
+	// The __restrict parameters tell the compiler that the arrays don't alias,
+	// which is what allows the loop to be vectorized. (With GCC, __restrict
+	// local pointers were not sufficient for this.)
+	void step_fleet_kernel_( std::size_t aCount, float* __restrict aPosX, float* __restrict aPosY, float* __restrict aSpeed, float* __restrict aAngle, float const* __restrict aAccel, ShipParams const& aParams, float aDt ) noexcept
+	{
+		float const maxSpeed = aParams.maxSpeed;
+		float const maxAngle = std::numbers::pi_v<float> - 0.1f;
+		float const radius = aParams.radius;
+		float const climb = aDt * aParams.climbRate;
+
+		for( std::size_t i = 0; i < aCount; ++i )
+		{
+			float const s = std::min( aSpeed[i] + aAccel[i] * aDt, maxSpeed );
+			float const a = std::min( aAngle[i] + aDt * s / radius, maxAngle );
+
+			aSpeed[i] = s;
+			aAngle[i] = a;
+
+			aPosX[i] += aDt * radius * sin_approx_( a );
+			aPosY[i] += climb;
+		}
+	}
+}
+
+std::size_t Fleet::size() const noexcept
+{
+	return posX.size();
+}
+
+void Fleet::reserve( std::size_t aCount )
+{
+	for( auto* arr : { &posX, &posY, &posZ, &speed, &angle, &acceleration } )
+		arr->reserve( aCount );
+}
+
+void Fleet::add( Vec3f aPosition, float aSpeed, float aAngle, float aAcceleration )
+{
+	posX.emplace_back( aPosition.x );
+	posY.emplace_back( aPosition.y );
+	posZ.emplace_back( aPosition.z );
+	speed.emplace_back( aSpeed );
+	angle.emplace_back( aAngle );
+	acceleration.emplace_back( aAcceleration );
+}
+
+Fleet make_fleet_grid( std::size_t aCount, Vec3f aCenter, float aSpacing )
+{
+	Fleet fleet;
+	fleet.reserve( aCount );
+
+	auto const side = std::size_t(std::ceil( std::sqrt( double(aCount) ) ));
+	float const offset = 0.5f * aSpacing * float(side > 0 ? side-1 : 0);
+
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		float const x = aCenter.x + aSpacing * float(i % side) - offset;
+		float const z = aCenter.z + aSpacing * float(i / side) - offset;
+
+		// Vary the acceleration a bit, so that the ships don't move in
+		// lockstep. (Cheap deterministic hash of the index.)
+		float const jitter = float((i * 2654435761u) % 1024u) / 1024.f;
+
+		fleet.add( { x, aCenter.y, z }, 0.f, 0.f, 0.01f + 0.04f * jitter );
+	}
+
+	return fleet;
+}
+
+void step_fleet( Fleet& aFleet, ShipParams const& aParams, float aDt, std::size_t aBegin, std::size_t aEnd ) noexcept
+{
+	step_fleet_kernel_(
+		aEnd - aBegin,
+		aFleet.posX.data() + aBegin,
+		aFleet.posY.data() + aBegin,
+		aFleet.speed.data() + aBegin,
+		aFleet.angle.data() + aBegin,
+		aFleet.acceleration.data() + aBegin,
+		aParams,
+		aDt
+	);
+}
+
+void step_fleet( Fleet& aFleet, ShipParams const& aParams, float aDt, ThreadPool& aPool )
+{
+	aPool.parallel_for( aFleet.size(), kFleetGrain, [&] (std::size_t aBegin, std::size_t aEnd) {
+		step_fleet( aFleet, aParams, aDt, aBegin, aEnd );
+	} );
+}
+
+void write_fleet_instances( Fleet const& aFleet, float* aOut, std::size_t aBegin, std::size_t aEnd ) noexcept
+{
+	for( std::size_t i = aBegin; i < aEnd; ++i )
+	{
+		float* m = aOut + 16*i;
+
+		// Column-major translation matrix
+		m[0] = 1.f; m[1] = 0.f; m[2] = 0.f; m[3] = 0.f;
+		m[4] = 0.f; m[5] = 1.f; m[6] = 0.f; m[7] = 0.f;
+		m[8] = 0.f; m[9] = 0.f; m[10] = 1.f; m[11] = 0.f;
+		m[12] = aFleet.posX[i]; m[13] = aFleet.posY[i]; m[14] = aFleet.posZ[i]; m[15] = 1.f;
+	}
+}
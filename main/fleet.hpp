@@ -0,0 +1,57 @@
+#ifndef FLEET_HPP_9C1D47E2_B35A_4F86_A2E0_7D64F18C3B95
+#define FLEET_HPP_9C1D47E2_B35A_4F86_A2E0_7D64F18C3B95
+
+#include <vector>
+
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+
+#include "ship_simulation.hpp"
+
+class ThreadPool;
+
+// Ships per thread pool chunk, for step_fleet() and the per-ship loops in
+// main. Smaller chunks don't amortize the cost of waking the workers.
+constexpr std::size_t kFleetGrain = 16*1024;
+
+/* Fleet: many spaceships in structure-of-arrays form
+ *
+ * Each ship follows the same motion model as the single ship (step_ship()),
+ * with individual start positions, speeds, angles and accelerations. The
+ * shared parameters (radius, maximum speed, climb rate) come from ShipParams.
+ *
+ * Each attribute lives in its own contiguous array, such that the update
+ * kernel streams through memory and can be vectorized by the compiler.
+ */
+struct Fleet
+{
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> speed;
+	std::vector<float> angle;
+	std::vector<float> acceleration;
+
+	std::size_t size() const noexcept;
+
+	void reserve( std::size_t );
+	void add( Vec3f aPosition, float aSpeed, float aAngle, float aAcceleration );
+};
+
+// Lays out aCount ships in a square grid centered on aCenter, with slightly
+// varying accelerations.
+Fleet make_fleet_grid( std::size_t aCount, Vec3f aCenter, float aSpacing );
+
+// Advance ships [aBegin, aEnd) by aDt. Equivalent to calling step_ship() on
+// each (animated) ship, except that sin() is replaced by a polynomial
+// approximation (max. error about 1e-6), which allows vectorization.
+void step_fleet( Fleet&, ShipParams const&, float aDt, std::size_t aBegin, std::size_t aEnd ) noexcept;
+
+// Advance all ships, using the thread pool for large fleets.
+void step_fleet( Fleet&, ShipParams const&, float aDt, ThreadPool& );
+
+// Writes one column-major 4x4 model matrix (16 floats) per ship, suitable for
+// the instanced object shaders (FEATURE_INSTANCING). aOut must have room for
+// 16*size() floats.
+void write_fleet_instances( Fleet const&, float* aOut, std::size_t aBegin, std::size_t aEnd ) noexcept;
+
+#endif // FLEET_HPP_9C1D47E2_B35A_4F86_A2E0_7D64F18C3B95
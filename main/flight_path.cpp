@@ -0,0 +1,263 @@
+#include "flight_path.hpp"
+
+#include <utility>
+#include <algorithm>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "../support/error.hpp"
+
+namespace
+{
+	// Sub-steps per segment when measuring the arc length. The table is
+	// interpolated linearly between these.
+	constexpr std::size_t kLengthSubsteps_ = 64;
+
+	Vec3f bezier_( Vec3f const (&aP)[4], float aT ) noexcept
+	{
+		float const s = 1.f - aT;
+		return (s*s*s) * aP[0] + (3.f*s*s*aT) * aP[1] + (3.f*s*aT*aT) * aP[2] + (aT*aT*aT) * aP[3];
+	}
+	Vec3f bezier_tangent_( Vec3f const (&aP)[4], float aT ) noexcept
+	{
+		float const s = 1.f - aT;
+		return (3.f*s*s) * (aP[1]-aP[0]) + (6.f*s*aT) * (aP[2]-aP[1]) + (3.f*aT*aT) * (aP[3]-aP[2]);
+	}
+}
+
+FlightPath::FlightPath( EPathCurve aCurve, std::vector<Vec3f> aPoints, float aDuration, bool aLoop, std::size_t aTableSize )
+	: mCurve( aCurve )
+	, mPoints( std::move(aPoints) )
+	, mSegments( 0 )
+	, mLoop( aLoop )
+	, mDuration( aDuration )
+	, mLength( 0.f )
+{
+	auto const n = mPoints.size();
+
+	if( EPathCurve::catmullRom == mCurve )
+	{
+		if( n < (mLoop ? 3u : 2u) )
+			throw Error( "FlightPath: Catmull-Rom path needs at least %d points, got %zu", mLoop ? 3 : 2, n );
+
+		mSegments = mLoop ? n : n-1;
+	}
+	else
+	{
+		if( mLoop ? (n < 3 || 0 != n % 3) : (n < 4 || 0 != (n-1) % 3) )
+			throw Error( "FlightPath: Bezier path needs %s points, got %zu", mLoop ? "3k" : "3k+1", n );
+
+		mSegments = mLoop ? n/3 : (n-1)/3;
+	}
+
+	if( !(mDuration > 0.f) )
+		throw Error( "FlightPath: duration must be positive, got %f", double(mDuration) );
+
+	build_table_( std::max<std::size_t>( 2, aTableSize ) );
+}
+
+PathSample FlightPath::sample( float aTime ) const noexcept
+{
+	// Distance along the path, as a fraction of its length
+	float x = aTime / mDuration;
+	if( mLoop )
+		x -= std::floor( x );
+	else
+		x = std::clamp( x, 0.f, 1.f );
+
+	// Look up the curve parameter
+	float const f = x * float(mParamAtDistance.size()-1);
+	auto const i = std::min( std::size_t(f), mParamAtDistance.size()-2 );
+	float const frac = f - float(i);
+	float const u = mParamAtDistance[i] + (mParamAtDistance[i+1] - mParamAtDistance[i]) * frac;
+
+	auto const seg = std::min( std::size_t(u), mSegments-1 );
+	float const t = u - float(seg);
+
+	Vec3f p[4];
+	segment_points_( seg, p );
+
+	PathSample ret;
+	ret.position = bezier_( p, t );
+
+	Vec3f const tangent = bezier_tangent_( p, t );
+	float const len = ::length( tangent );
+	ret.forward = len > 1e-6f ? tangent / len : Vec3f{ 0.f, 1.f, 0.f };
+
+	return ret;
+}
+
+void FlightPath::sample_batch( float const* aTimes, PathSample* aOut, std::size_t aCount ) const noexcept
+{
+	for( std::size_t i = 0; i < aCount; ++i )
+		aOut[i] = sample( aTimes[i] );
+}
+
+float FlightPath::length() const noexcept
+{
+	return mLength;
+}
+float FlightPath::duration() const noexcept
+{
+	return mDuration;
+}
+
+bool FlightPath::loops() const noexcept
+{
+	return mLoop;
+}
+std::size_t FlightPath::segment_count() const noexcept
+{
+	return mSegments;
+}
+
+void FlightPath::segment_points_( std::size_t aSegment, Vec3f (&aOut)[4] ) const noexcept
+{
+	auto const n = mPoints.size();
+
+	if( EPathCurve::bezier == mCurve )
+	{
+		for( std::size_t i = 0; i < 4; ++i )
+			aOut[i] = mPoints[(3*aSegment + i) % n];
+		return;
+	}
+
+	// Catmull-Rom segment between points k and k+1, converted to the
+	// equivalent Bezier control points. Open paths repeat their end points.
+	auto const at = [&] (std::ptrdiff_t aIdx) {
+		if( mLoop )
+			return mPoints[std::size_t((aIdx + std::ptrdiff_t(n)) % std::ptrdiff_t(n))];
+		return mPoints[std::size_t(std::clamp<std::ptrdiff_t>( aIdx, 0, std::ptrdiff_t(n)-1 ))];
+	};
+
+	auto const k = std::ptrdiff_t(aSegment);
+	Vec3f const p0 = at( k-1 ), p1 = at( k ), p2 = at( k+1 ), p3 = at( k+2 );
+
+	aOut[0] = p1;
+	aOut[1] = p1 + (p2 - p0) / 6.f;
+	aOut[2] = p2 - (p3 - p1) / 6.f;
+	aOut[3] = p2;
+}
+
+void FlightPath::build_table_( std::size_t aTableSize )
+{
+	// Measure the cumulative length at evenly spaced parameter values.
+	std::vector<float> lengths;
+	lengths.reserve( mSegments * kLengthSubsteps_ + 1 );
+	lengths.emplace_back( 0.f );
+
+	for( std::size_t seg = 0; seg < mSegments; ++seg )
+	{
+		Vec3f p[4];
+		segment_points_( seg, p );
+
+		Vec3f prev = p[0];
+		for( std::size_t i = 1; i <= kLengthSubsteps_; ++i )
+		{
+			Vec3f const next = bezier_( p, float(i) / kLengthSubsteps_ );
+			lengths.emplace_back( lengths.back() + ::length( next - prev ) );
+			prev = next;
+		}
+	}
+
+	mLength = lengths.back();
+
+	// Invert: find the parameter at evenly spaced distances.
+	mParamAtDistance.resize( aTableSize );
+
+	std::size_t j = 0;
+	for( std::size_t i = 0; i < aTableSize; ++i )
+	{
+		float const target = mLength * float(i) / float(aTableSize-1);
+		while( j+2 < lengths.size() && lengths[j+1] < target )
+			++j;
+
+		float const span = lengths[j+1] - lengths[j];
+		float const frac = span > 0.f ? std::clamp( (target - lengths[j]) / span, 0.f, 1.f ) : 0.f;
+		mParamAtDistance[i] = (float(j) + frac) / kLengthSubsteps_;
+	}
+
+	// Degenerate path (all points equal): fall back to the plain parameter.
+	if( !(mLength > 0.f) )
+	{
+		for( std::size_t i = 0; i < aTableSize; ++i )
+			mParamAtDistance[i] = float(mSegments) * float(i) / float(aTableSize-1);
+	}
+}
+
+FlightPath load_flight_path( char const* aPath )
+{
+	std::FILE* fin = std::fopen( aPath, "r" );
+	if( !fin )
+		throw Error( "load_flight_path(): unable to open '%s'", aPath );
+
+	EPathCurve curve = EPathCurve::catmullRom;
+	float duration = 0.f;
+	bool loop = false;
+	std::vector<Vec3f> points;
+
+	char line[512];
+	for( int lineNo = 1; std::fgets( line, sizeof(line), fin ); ++lineNo )
+	{
+		if( char* comment = std::strchr( line, '#' ) )
+			*comment = '\0';
+
+		char keyword[32], value[32];
+		int const fields = std::sscanf( line, "%31s %31s", keyword, value );
+		if( fields <= 0 )
+			continue; // empty line
+
+		Vec3f p;
+		if( 0 == std::strcmp( "point", keyword ) && 3 == std::sscanf( line, "%*s %f %f %f", &p.x, &p.y, &p.z ) )
+			points.emplace_back( p );
+		else if( 0 == std::strcmp( "duration", keyword ) && 1 == std::sscanf( line, "%*s %f", &duration ) )
+			;
+		else if( 0 == std::strcmp( "loop", keyword ) && 1 == fields )
+			loop = true;
+		else if( 0 == std::strcmp( "curve", keyword ) && 2 == fields && 0 == std::strcmp( "catmull-rom", value ) )
+			curve = EPathCurve::catmullRom;
+		else if( 0 == std::strcmp( "curve", keyword ) && 2 == fields && 0 == std::strcmp( "bezier", value ) )
+			curve = EPathCurve::bezier;
+		else
+		{
+			std::fclose( fin );
+			throw Error( "load_flight_path(): '%s' line %d: unable to parse '%s'", aPath, lineNo, keyword );
+		}
+	}
+
+	std::fclose( fin );
+
+	try
+	{
+		return FlightPath( curve, std::move(points), duration, loop );
+	}
+	catch( Error const& eErr )
+	{
+		throw Error( "load_flight_path(): '%s': %s", aPath, eErr.what() );
+	}
+}
+
+void write_path_instances( PathSample const* aSamples, float* aOut, std::size_t aBegin, std::size_t aEnd ) noexcept
+{
+	for( std::size_t i = aBegin; i < aEnd; ++i )
+	{
+		Vec3f const up = aSamples[i].forward;
+
+		// Any side vector will do; prefer one that keeps the ship level.
+		Vec3f side = cross( up, Vec3f{ 0.f, 1.f, 0.f } );
+		float const len = length( side );
+		side = len > 1e-4f ? side / len : Vec3f{ 1.f, 0.f, 0.f };
+
+		Vec3f const back = cross( side, up );
+		Vec3f const pos = aSamples[i].position;
+
+		// Column-major: side, up, back, translation
+		float* m = aOut + 16*i;
+		m[0] = side.x; m[1] = side.y; m[2] = side.z; m[3] = 0.f;
+		m[4] = up.x; m[5] = up.y; m[6] = up.z; m[7] = 0.f;
+		m[8] = back.x; m[9] = back.y; m[10] = back.z; m[11] = 0.f;
+		m[12] = pos.x; m[13] = pos.y; m[14] = pos.z; m[15] = 1.f;
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef FLIGHT_PATH_HPP_5B0E8F3A_27C4_4D19_9A6E_C1F4038D72B6
+#define FLIGHT_PATH_HPP_5B0E8F3A_27C4_4D19_9A6E_C1F4038D72B6
+
+#include <vector>
+
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+
+enum class EPathCurve
+{
+	catmullRom, // passes through all points
+	bezier      // piecewise cubic; points are p0 c0 c1 p1 c2 c3 p2 ...
+};
+
+struct PathSample
+{
+	Vec3f position;
+	Vec3f forward; // unit tangent, direction of travel
+};
+
+/* FlightPath: scripted route, traversed at constant speed
+ *
+ * The curve is reparameterized by arc length when the path is constructed.
+ * A table maps evenly spaced distances along the path to the curve
+ * parameter, so that sample() costs one table lookup plus one evaluation of
+ * a cubic segment, independently of the number of points.
+ *
+ * A path is immutable after construction. sample() and sample_batch() only
+ * read from it, and can be called from any number of threads concurrently.
+ *
+ * Times are in seconds; the full path takes duration() seconds. Looped paths
+ * wrap around, other paths hold their end points outside of [0, duration()].
+ */
+class FlightPath final
+{
+	public:
+		FlightPath( EPathCurve, std::vector<Vec3f> aPoints, float aDuration, bool aLoop, std::size_t aTableSize = 1024 );
+
+	public:
+		PathSample sample( float aTime ) const noexcept;
+		void sample_batch( float const* aTimes, PathSample* aOut, std::size_t aCount ) const noexcept;
+
+		float length() const noexcept;
+		float duration() const noexcept;
+
+		bool loops() const noexcept;
+		std::size_t segment_count() const noexcept;
+
+	private:
+		void segment_points_( std::size_t, Vec3f (&aOut)[4] ) const noexcept;
+		void build_table_( std::size_t );
+
+	private:
+		EPathCurve mCurve;
+		std::vector<Vec3f> mPoints;
+		std::size_t mSegments;
+		bool mLoop;
+
+		float mDuration;
+		float mLength;
+
+		// Curve parameter (segment index + local parameter) at distances
+		// k*mLength/(size-1) along the path.
+		std::vector<float> mParamAtDistance;
+};
+
+// Loads a path from a text file. One statement per line; '#' starts a
+// comment:
+//
+//	curve catmull-rom      (or: bezier)
+//	duration 12.5          (seconds)
+//	loop                   (optional)
+//	point 1.0 2.0 -3.0     (repeated)
+//
+FlightPath load_flight_path( char const* aPath );
+
+// Model-to-world matrix of a ship following a path. The ship's up axis (+Y)
+// is aligned with the direction of travel. Writes 16 floats (column-major)
+// per sample for samples [aBegin, aEnd); see write_fleet_instances().
+void write_path_instances( PathSample const*, float* aOut, std::size_t aBegin, std::size_t aEnd ) noexcept;
+
+#endif // FLIGHT_PATH_HPP_5B0E8F3A_27C4_4D19_9A6E_C1F4038D72B6
@@ -0,0 +1,70 @@
+#include "frustum.hpp"
+
+#include <algorithm>
+
+#include <cmath>
+
+Frustum::Frustum( Mat44f const& aViewProjection ) noexcept
+{
+	// Gribb & Hartmann: with clip = M * p, the point is inside if
+	// -w <= x,y,z <= w, i.e., if (row3 +- row_i) . p >= 0.
+	auto const row = [&] (int aI) {
+		return Vec4f{ aViewProjection(aI,0), aViewProjection(aI,1), aViewProjection(aI,2), aViewProjection(aI,3) };
+	};
+
+	Vec4f const r0 = row( 0 ), r1 = row( 1 ), r2 = row( 2 ), r3 = row( 3 );
+
+	planes[0] = r3 + r0;
+	planes[1] = r3 - r0;
+	planes[2] = r3 + r1;
+	planes[3] = r3 - r1;
+	planes[4] = r3 + r2;
+	planes[5] = r3 - r2;
+
+	for( auto& plane : planes )
+	{
+		float const len = std::sqrt( plane.x*plane.x + plane.y*plane.y + plane.z*plane.z );
+		if( len > 0.f )
+			plane = plane / len;
+	}
+}
+
+bool Frustum::intersects_sphere( Vec3f aCenter, float aRadius ) const noexcept
+{
+	for( auto const& plane : planes )
+	{
+		float const dist = plane.x*aCenter.x + plane.y*aCenter.y + plane.z*aCenter.z + plane.w;
+		if( dist < -aRadius )
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::intersects_sphere( Mat44f const& aModel2world, Vec3f aCenter, float aRadius ) const noexcept
+{
+	auto const& m = aModel2world;
+	Vec4f const center = m * Vec4f{ aCenter.x, aCenter.y, aCenter.z, 1.f };
+	float const scale = std::sqrt( std::max( {
+		m(0,0)*m(0,0) + m(1,0)*m(1,0) + m(2,0)*m(2,0),
+		m(0,1)*m(0,1) + m(1,1)*m(1,1) + m(2,1)*m(2,1),
+		m(0,2)*m(0,2) + m(1,2)*m(1,2) + m(2,2)*m(2,2)
+	} ) );
+
+	return intersects_sphere( Vec3f{ center.x, center.y, center.z }, scale * aRadius );
+}
+
+bool Frustum::intersects_box( Vec3f aMin, Vec3f aMax ) const noexcept
+{
+	// The box is outside if its corner furthest along a plane's normal is.
+	for( auto const& plane : planes )
+	{
+		float const x = plane.x >= 0.f ? aMax.x : aMin.x;
+		float const y = plane.y >= 0.f ? aMax.y : aMin.y;
+		float const z = plane.z >= 0.f ? aMax.z : aMin.z;
+		if( plane.x*x + plane.y*y + plane.z*z + plane.w < 0.f )
+			return false;
+	}
+
+	return true;
+}
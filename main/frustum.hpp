@@ -0,0 +1,32 @@
+#ifndef FRUSTUM_HPP_8B4D2F61_C97A_4E13_B5F0_3A6E19D7C042
+#define FRUSTUM_HPP_8B4D2F61_C97A_4E13_B5F0_3A6E19D7C042
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat44.hpp"
+
+/* Frustum: the six clip planes of a view-projection matrix
+ *
+ * Each plane is (n, d) with n pointing into the frustum; a point p is on the
+ * inside of the plane if dot(n, p) + d >= 0. The planes are normalized, so
+ * that sphere tests can compare distances directly.
+ */
+struct Frustum
+{
+	Vec4f planes[6]; // left, right, bottom, top, near, far
+
+	explicit Frustum( Mat44f const& aViewProjection ) noexcept;
+
+	// Conservative: spheres that intersect the frustum, or that are close
+	// to one of its corners, count as visible.
+	bool intersects_sphere( Vec3f aCenter, float aRadius ) const noexcept;
+
+	// As above, for a sphere in model space. The radius is scaled by the
+	// largest scale factor of aModel2world.
+	bool intersects_sphere( Mat44f const& aModel2world, Vec3f aCenter, float aRadius ) const noexcept;
+
+	// Axis-aligned box in world space. Conservative, like the sphere test.
+	bool intersects_box( Vec3f aMin, Vec3f aMax ) const noexcept;
+};
+
+#endif // FRUSTUM_HPP_8B4D2F61_C97A_4E13_B5F0_3A6E19D7C042
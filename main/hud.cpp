@@ -0,0 +1,127 @@
+#include "hud.hpp"
+
+#include <iterator>
+#include <algorithm>
+
+#include <cstdio>
+
+#if defined(__linux__)
+#	include <unistd.h>
+#endif // ~ __linux__
+
+#include "text_renderer.hpp"
+
+namespace
+{
+	constexpr float kMemoryInterval_ = 0.25f; // seconds between samples
+	constexpr float kSmoothing_ = 0.05f; // of the frame time average
+
+	constexpr float kGraphHeight_ = 60.f; // pixels
+	constexpr float kGraphScale_ = 1.f / 0.05f; // graph height per second (50ms = full)
+	constexpr float kBudget_ = 1.f / 60.f; // seconds; marked in the graph
+
+	constexpr std::uint32_t kPanelColor_ = pack_rgba( 0, 0, 0, 160 );
+	constexpr std::uint32_t kTextColor_ = pack_rgba( 230, 230, 230 );
+	constexpr std::uint32_t kGoodColor_ = pack_rgba( 90, 200, 90 );
+	constexpr std::uint32_t kSlowColor_ = pack_rgba( 230, 80, 60 );
+	constexpr std::uint32_t kBudgetColor_ = pack_rgba( 255, 255, 255, 120 );
+
+	// Resident set size in bytes, or 0 if unknown.
+	std::size_t process_memory_()
+	{
+#		if defined(__linux__)
+		std::size_t size = 0, resident = 0;
+		if( auto* statm = std::fopen( "/proc/self/statm", "r" ) )
+		{
+			if( 2 != std::fscanf( statm, "%zu %zu", &size, &resident ) )
+				resident = 0;
+			std::fclose( statm );
+		}
+		return resident * std::size_t(sysconf( _SC_PAGESIZE ));
+#		else // !__linux__
+		return 0;
+#		endif // ~ __linux__
+	}
+}
+
+void PerformanceHud::add_frame( FrameStats const& aStats )
+{
+	mFrameTimes[mNext] = aStats.frameTime;
+	mNext = (mNext+1) % kHistory;
+	mCount = std::min( mCount+1, kHistory );
+
+	mAverage = 0.f == mAverage ? aStats.frameTime : mAverage + kSmoothing_ * (aStats.frameTime - mAverage);
+	mLast = aStats;
+
+	mMemoryAge += aStats.frameTime;
+	if( 0 == mMemory || mMemoryAge >= kMemoryInterval_ )
+	{
+		mMemory = process_memory_();
+		mMemoryAge = 0.f;
+	}
+}
+
+void PerformanceHud::draw( TextRenderer& aText, float aX, float aY ) const
+{
+	float const lineHeight = aText.line_height();
+	float const pad = 0.5f * lineHeight;
+
+	char lines[8][96];
+	std::snprintf( lines[0], sizeof(lines[0]), "%6.2f ms (%5.1f fps)  cpu %5.2f ms", 1e3f*mAverage, mAverage > 0.f ? 1.f/mAverage : 0.f, 1e3f*mLast.cpuTime );
+	std::snprintf( lines[1], sizeof(lines[1]), "draw calls %zu (prepass %zu)  binds %zu  triangles %zu", mLast.drawCalls, mLast.prepassDraws, mLast.stateChanges, mLast.triangles );
+	std::snprintf( lines[2], sizeof(lines[2]), "objects %zu  culled %zu  terrain patches %zu", mLast.objects, mLast.culled, mLast.terrainPatches );
+	std::snprintf( lines[3], sizeof(lines[3]), "particles %zu  picked %.24s  queries %.2f ms", mLast.particles, mLast.picked ? mLast.picked : "-", 1e3f*mLast.queryCpuTime );
+	std::snprintf( lines[4], sizeof(lines[4]), "stream %.2f / %.2f MiB  contacts %zu/%zu/%zu  %.2f ms", double(mLast.streamUsed) / (1024.*1024.), double(mLast.streamSize) / (1024.*1024.), mLast.bodyContacts, mLast.padContacts, mLast.seaContacts, 1e3f*mLast.collisionCpuTime );
+	if( mMemory )
+		std::snprintf( lines[5], sizeof(lines[5]), "memory %.1f MiB", double(mMemory) / (1024.*1024.) );
+	else
+		std::snprintf( lines[5], sizeof(lines[5]), "memory n/a" );
+
+	std::snprintf( lines[6], sizeof(lines[6]), "lights %zu  max/cluster %zu  cpu %.2f ms", mLast.pointLights, mLast.maxLightsPerCluster, 1e3f*mLast.lightCpuTime );
+
+	if( mLast.shadowCascades )
+	{
+		// Total GPU time, followed by the individual cascades
+		float total = 0.f;
+		for( std::size_t i = 0; i < mLast.shadowCascades; ++i )
+			total += mLast.shadowGpuTimes[i];
+
+		int len = std::snprintf( lines[7], sizeof(lines[7]), "shadows %zux%zu cpu %.2f gpu %.2f ms (", mLast.shadowCascades, mLast.shadowResolution, 1e3f*mLast.shadowCpuTime, 1e3f*total );
+		for( std::size_t i = 0; i < mLast.shadowCascades && len > 0 && std::size_t(len) < sizeof(lines[7]); ++i )
+			len += std::snprintf( lines[7]+len, sizeof(lines[7])-std::size_t(len), i ? " %.2f" : "%.2f", 1e3f*mLast.shadowGpuTimes[i] );
+		if( len > 0 && std::size_t(len) < sizeof(lines[7]) )
+			std::snprintf( lines[7]+len, sizeof(lines[7])-std::size_t(len), ")" );
+	}
+	else
+		std::snprintf( lines[7], sizeof(lines[7]), "shadows off" );
+
+	float width = float(kHistory);
+	for( auto const* line : lines )
+		width = std::max( width, aText.text_width( line ) );
+	width += 2.f*pad;
+
+	float const textHeight = float(std::size(lines)) * lineHeight;
+	aText.rect( aX, aY, aX + width, aY + textHeight + kGraphHeight_ + 3.f*pad, kPanelColor_ );
+
+	float y = aY + pad;
+	for( auto const* line : lines )
+	{
+		aText.text( aX + pad, y, line, kTextColor_ );
+		y += lineHeight;
+	}
+
+	// Frame time graph, oldest frame on the left. Frames that are clearly
+	// over budget (not just vsync jitter) are drawn in red.
+	float const base = y + pad + kGraphHeight_;
+	std::size_t const first = (mNext + kHistory - mCount) % kHistory;
+	for( std::size_t i = 0; i < mCount; ++i )
+	{
+		float const time = mFrameTimes[(first + i) % kHistory];
+		float const height = std::min( time * kGraphScale_, 1.f ) * kGraphHeight_;
+		float const x = aX + pad + float(kHistory - mCount + i);
+		aText.rect( x, base - height, x + 1.f, base, time > 1.1f*kBudget_ ? kSlowColor_ : kGoodColor_ );
+	}
+
+	float const budget = base - kBudget_ * kGraphScale_ * kGraphHeight_;
+	aText.rect( aX + pad, budget, aX + pad + float(kHistory), budget + 1.f, kBudgetColor_ );
+}
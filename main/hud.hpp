@@ -0,0 +1,72 @@
+#ifndef HUD_HPP_5F0C83A2_6D19_4B7E_A84C_E21B97F03D56
+#define HUD_HPP_5F0C83A2_6D19_4B7E_A84C_E21B97F03D56
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "cascades.hpp"
+
+class TextRenderer;
+
+struct FrameStats
+{
+	float frameTime; // seconds, between frame starts
+	float cpuTime; // seconds, spent submitting the frame
+
+	std::size_t drawCalls;
+	std::size_t prepassDraws; // ... of which only wrote depth
+	std::size_t stateChanges; // program, VAO and texture binds
+	std::size_t triangles;
+	std::size_t objects; // scene objects considered for drawing
+	std::size_t culled; // ... of which were outside of the view
+	std::size_t terrainPatches; // CDLOD patches drawn (zero without --terrain)
+	std::size_t particles;
+
+	char const* picked; // name of the object picked last, or nullptr
+	float queryCpuTime; // seconds, spent on picking and line-of-sight tests
+
+	std::size_t bodyContacts, padContacts, seaContacts; // ship and fleet collisions
+	float collisionCpuTime; // seconds, spent detecting them
+
+	std::size_t streamUsed, streamSize; // bytes of per-frame data
+
+	std::size_t pointLights;
+	std::size_t maxLightsPerCluster;
+	float lightCpuTime; // seconds, spent binning and uploading the lights
+
+	std::size_t shadowCascades; // 0 without shadows
+	std::size_t shadowResolution;
+	float shadowCpuTime; // seconds, spent submitting the shadow pass
+	float shadowGpuTimes[kMaxShadowCascades]; // seconds, per cascade
+};
+
+/* PerformanceHud: frame statistics overlay
+ *
+ * Keeps a history of the last kHistory frame times, and draws it as a bar
+ * graph below the most recent frame's statistics. The process' resident
+ * memory is sampled a few times per second (Linux only).
+ */
+class PerformanceHud final
+{
+	public:
+		static constexpr std::size_t kHistory = 240;
+
+	public:
+		void add_frame( FrameStats const& );
+
+		// Draws the HUD with its top left corner at (aX, aY). Only adds to
+		// the renderer's batch; the caller flushes.
+		void draw( TextRenderer&, float aX, float aY ) const;
+
+	private:
+		float mFrameTimes[kHistory] = {};
+		std::size_t mNext = 0, mCount = 0;
+
+		FrameStats mLast{};
+		float mAverage = 0.f; // smoothed frame time
+
+		std::size_t mMemory = 0; // bytes, 0 if unknown
+		float mMemoryAge = 0.f; // seconds since the last sample
+};
+
+#endif // HUD_HPP_5F0C83A2_6D19_4B7E_A84C_E21B97F03D56
@@ -0,0 +1,231 @@
+#include "light_clusters.hpp"
+
+#include <limits>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	constexpr std::size_t kSliceGrain_ = 2; // depth slices per thread pool chunk
+
+	// Tile range covered by [aMin, aMax] in NDC, or false if none.
+	bool tile_range_( float aMin, float aMax, std::uint32_t aTiles, std::uint32_t& aFirst, std::uint32_t& aLast ) noexcept
+	{
+		if( aMax < -1.f || aMin > 1.f )
+			return false;
+
+		float const tiles = float(aTiles);
+		aFirst = std::uint32_t(std::clamp( (aMin * 0.5f + 0.5f) * tiles, 0.f, tiles - 1.f ));
+		aLast = std::uint32_t(std::clamp( (aMax * 0.5f + 0.5f) * tiles, 0.f, tiles - 1.f ));
+		return true;
+	}
+
+	// Range of c/d/aTan for c in [aCenter-aRadius, aCenter+aRadius] and d in
+	// [aNear, aFar] (with 0 < aNear <= aFar). This bounds the NDC extent of
+	// a sphere within a depth range.
+	void ndc_extent_( float aCenter, float aRadius, float aNear, float aFar, float aTan, float& aMin, float& aMax ) noexcept
+	{
+		float const lo = aCenter - aRadius, hi = aCenter + aRadius;
+		aMin = lo / ((lo < 0.f ? aNear : aFar) * aTan);
+		aMax = hi / ((hi > 0.f ? aNear : aFar) * aTan);
+	}
+}
+
+std::uint32_t ClusterGrid::size() const noexcept
+{
+	return x * y * z;
+}
+
+LightClusters::LightClusters( ClusterGrid const& aGrid )
+	: mGrid( aGrid )
+	, mClusters( aGrid.size(), Range{ 0, 0 } )
+	, mSliceIndices( aGrid.z )
+	, mSliceCandidates( aGrid.z )
+{
+	assert( aGrid.x > 0 && aGrid.y > 0 && aGrid.z > 0 );
+}
+
+void LightClusters::build( PointLight const* aLights, std::size_t aCount, ClusterView const& aView )
+{
+	prepare_( aLights, aCount, aView );
+	for( std::uint32_t z = 0; z < mGrid.z; ++z )
+		bin_slice_( z );
+	gather_();
+}
+
+void LightClusters::build( PointLight const* aLights, std::size_t aCount, ClusterView const& aView, ThreadPool& aPool )
+{
+	prepare_( aLights, aCount, aView );
+	aPool.parallel_for( mGrid.z, kSliceGrain_, [this] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t z = aBegin; z < aEnd; ++z )
+			bin_slice_( std::uint32_t(z) );
+	} );
+	gather_();
+}
+
+ClusterGrid const& LightClusters::grid() const noexcept
+{
+	return mGrid;
+}
+
+std::vector<LightClusters::Range> const& LightClusters::clusters() const noexcept
+{
+	return mClusters;
+}
+std::vector<std::uint32_t> const& LightClusters::indices() const noexcept
+{
+	return mIndices;
+}
+
+std::uint32_t LightClusters::max_lights_per_cluster() const noexcept
+{
+	return mMaxPerCluster;
+}
+
+float LightClusters::slice_scale() const noexcept
+{
+	return float(mGrid.z) / std::log( mView.far / mView.near );
+}
+float LightClusters::slice_bias() const noexcept
+{
+	return -std::log( mView.near ) * slice_scale();
+}
+
+std::uint32_t LightClusters::cluster_at( Vec3f aPoint ) const noexcept
+{
+	float const depth = std::max( -aPoint.z, mView.near );
+
+	auto const tile = [] (float aNdc, std::uint32_t aTiles) {
+		float const tiles = float(aTiles);
+		return std::uint32_t(std::clamp( (aNdc * 0.5f + 0.5f) * tiles, 0.f, tiles - 1.f ));
+	};
+
+	std::uint32_t const x = tile( aPoint.x / (depth * mTanX), mGrid.x );
+	std::uint32_t const y = tile( aPoint.y / (depth * mTanY), mGrid.y );
+
+	float const slice = std::log( depth ) * slice_scale() + slice_bias();
+	std::uint32_t const z = std::uint32_t(std::clamp( slice, 0.f, float(mGrid.z - 1) ));
+
+	return (z * mGrid.y + y) * mGrid.x + x;
+}
+
+void LightClusters::prepare_( PointLight const* aLights, std::size_t aCount, ClusterView const& aView )
+{
+	assert( aView.near > 0.f && aView.far > aView.near );
+
+	mView = aView;
+	mTanY = std::tan( 0.5f * aView.fovY );
+	mTanX = mTanY * aView.aspect;
+
+	mViewLights.resize( aCount );
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		auto const& p = aLights[i].position;
+		Vec4f const v = aView.world2camera * Vec4f{ p.x, p.y, p.z, 1.f };
+		mViewLights[i] = Vec4f{ v.x, v.y, v.z, aLights[i].radius };
+	}
+}
+
+void LightClusters::bin_slice_( std::uint32_t aZ )
+{
+	float const ratio = mView.far / mView.near;
+	float const sliceNear = mView.near * std::pow( ratio, float(aZ) / float(mGrid.z) );
+	float const sliceFar = aZ+1 == mGrid.z
+		? std::numeric_limits<float>::max() // the last slice extends to infinity
+		: mView.near * std::pow( ratio, float(aZ+1) / float(mGrid.z) );
+
+	// Find the lights that overlap the slice, and the tiles they cover
+	// within it.
+	auto& candidates = mSliceCandidates[aZ];
+	candidates.clear();
+
+	for( std::size_t i = 0; i < mViewLights.size(); ++i )
+	{
+		auto const& light = mViewLights[i];
+		float const depth = -light.z;
+		float const radius = light.w;
+
+		float const d0 = std::max( depth - radius, sliceNear );
+		float const d1 = std::min( depth + radius, sliceFar );
+		if( d0 > d1 )
+			continue;
+
+		float xMin, xMax, yMin, yMax;
+		ndc_extent_( light.x, radius, d0, d1, mTanX, xMin, xMax );
+		ndc_extent_( light.y, radius, d0, d1, mTanY, yMin, yMax );
+
+		Candidate_ c;
+		c.light = std::uint32_t(i);
+		if( tile_range_( xMin, xMax, mGrid.x, c.x0, c.x1 ) && tile_range_( yMin, yMax, mGrid.y, c.y0, c.y1 ) )
+			candidates.emplace_back( c );
+	}
+
+	// Emit the lists of the slice's clusters, in order. This is a counting
+	// sort: count the lights per cluster, turn the counts into offsets, and
+	// then scatter. The cost is proportional to the number of entries,
+	// rather than to clusters times lights.
+	std::uint32_t const base = aZ * mGrid.y * mGrid.x;
+	Range* const ranges = mClusters.data() + base;
+	std::fill_n( ranges, mGrid.y * mGrid.x, Range{ 0, 0 } );
+
+	for( auto const& c : candidates )
+	{
+		for( std::uint32_t y = c.y0; y <= c.y1; ++y )
+		{
+			for( std::uint32_t x = c.x0; x <= c.x1; ++x )
+				++ranges[y * mGrid.x + x].count;
+		}
+	}
+
+	std::uint32_t total = 0;
+	for( std::uint32_t i = 0; i < mGrid.y * mGrid.x; ++i )
+	{
+		ranges[i].offset = total;
+		total += ranges[i].count;
+		ranges[i].count = 0; // counts again while scattering
+	}
+
+	auto& indices = mSliceIndices[aZ];
+	indices.resize( total );
+
+	for( auto const& c : candidates )
+	{
+		for( std::uint32_t y = c.y0; y <= c.y1; ++y )
+		{
+			for( std::uint32_t x = c.x0; x <= c.x1; ++x )
+			{
+				auto& range = ranges[y * mGrid.x + x];
+				indices[range.offset + range.count++] = c.light;
+			}
+		}
+	}
+}
+
+void LightClusters::gather_()
+{
+	std::size_t total = 0;
+	for( auto const& slice : mSliceIndices )
+		total += slice.size();
+
+	mIndices.clear();
+	mIndices.reserve( total );
+	mMaxPerCluster = 0;
+
+	std::uint32_t const perSlice = mGrid.x * mGrid.y;
+	for( std::uint32_t z = 0; z < mGrid.z; ++z )
+	{
+		auto const base = std::uint32_t(mIndices.size());
+		for( std::uint32_t i = 0; i < perSlice; ++i )
+		{
+			auto& range = mClusters[z * perSlice + i];
+			range.offset += base;
+			mMaxPerCluster = std::max( mMaxPerCluster, range.count );
+		}
+
+		mIndices.insert( mIndices.end(), mSliceIndices[z].begin(), mSliceIndices[z].end() );
+	}
+}
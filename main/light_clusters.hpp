@@ -0,0 +1,118 @@
+#ifndef LIGHT_CLUSTERS_HPP_4A8E1C27_F3B6_4D90_87A5_2C61E9D0B4F3
+#define LIGHT_CLUSTERS_HPP_4A8E1C27_F3B6_4D90_87A5_2C61E9D0B4F3
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat44.hpp"
+
+class ThreadPool;
+
+// Layout matches the PointLight struct in objects.frag (std430).
+struct PointLight
+{
+	Vec3f position; // world space
+	float radius; // the light has no effect beyond this distance
+	Vec3f color;
+	float intensity;
+};
+
+static_assert( sizeof(PointLight) == 32 );
+
+struct ClusterGrid
+{
+	std::uint32_t x = 16, y = 9; // screen tiles
+	std::uint32_t z = 24; // depth slices
+
+	std::uint32_t size() const noexcept;
+};
+
+struct ClusterView
+{
+	Mat44f world2camera;
+	float fovY; // radians
+	float aspect;
+	float near, far; // of the clustered depth range
+};
+
+/* LightClusters: point lights binned into view-space clusters
+ *
+ * The view frustum is divided into a grid of clusters: screen-space tiles in
+ * x and y, and slices in depth. The slices are spaced exponentially, i.e.,
+ * slice k covers depths near*(far/near)^(k/z) to near*(far/near)^((k+1)/z),
+ * such that clusters are roughly cubical. Fragments beyond far use the last
+ * slice.
+ *
+ * build() assigns each light to all clusters that its sphere may touch (the
+ * test is conservative), and stores the result as one (offset, count) pair
+ * per cluster into a shared list of light indices. Clusters are ordered x
+ * first, then y, then z. This is the layout that the object shaders use
+ * (FEATURE_POINT_LIGHTS).
+ *
+ * Slices are independent, so the threaded build() bins them in parallel.
+ */
+class LightClusters final
+{
+	public:
+		struct Range
+		{
+			std::uint32_t offset;
+			std::uint32_t count;
+		};
+
+	public:
+		explicit LightClusters( ClusterGrid const& = {} );
+
+	public:
+		void build( PointLight const*, std::size_t aCount, ClusterView const& );
+		void build( PointLight const*, std::size_t aCount, ClusterView const&, ThreadPool& );
+
+	public:
+		ClusterGrid const& grid() const noexcept;
+
+		std::vector<Range> const& clusters() const noexcept;
+		std::vector<std::uint32_t> const& indices() const noexcept;
+
+		std::uint32_t max_lights_per_cluster() const noexcept;
+
+		// Slice index = floor(log(depth) * scale + bias); see objects.frag.
+		float slice_scale() const noexcept;
+		float slice_bias() const noexcept;
+
+		// Index of the cluster that contains the view-space point aPoint.
+		// Points outside of the frustum are clamped to the border clusters.
+		std::uint32_t cluster_at( Vec3f aPoint ) const noexcept;
+
+	private:
+		struct Candidate_
+		{
+			std::uint32_t light;
+			std::uint32_t x0, x1, y0, y1;
+		};
+
+		void prepare_( PointLight const*, std::size_t, ClusterView const& );
+		void bin_slice_( std::uint32_t );
+		void gather_();
+
+	private:
+		ClusterGrid mGrid;
+		ClusterView mView{};
+		float mTanX = 0.f, mTanY = 0.f;
+
+		std::vector<Vec4f> mViewLights; // view-space position and radius
+
+		std::vector<Range> mClusters;
+		std::vector<std::uint32_t> mIndices;
+		std::uint32_t mMaxPerCluster = 0;
+
+		// Per slice scratch. Offsets in mClusters are relative to the slice
+		// until gather_().
+		std::vector<std::vector<std::uint32_t>> mSliceIndices;
+		std::vector<std::vector<Candidate_>> mSliceCandidates;
+};
+
+#endif // LIGHT_CLUSTERS_HPP_4A8E1C27_F3B6_4D90_87A5_2C61E9D0B4F3
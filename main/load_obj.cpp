@@ -1,11 +1,18 @@
 #include "load_obj.hpp"
 
+#include <string_view>
+
 #include <rapidobj/rapidobj.hpp>
 
 #include "../support/error.hpp"
 
-SimpleMeshData load_wavefront_obj( char const* aPath )
+#include "mesh_codec.hpp"
+
+SimpleMeshData load_wavefront_obj( char const* aPath, std::pmr::memory_resource* aResource )
 {
+	if( std::string_view( aPath ).ends_with( kCompressedMeshExtension ) )
+		return load_compressed_mesh( aPath, aResource );
+
 	
 	// ask for loading the requested file 
 	auto result = rapidobj::ParseFile( aPath );
@@ -17,7 +24,17 @@ SimpleMeshData load_wavefront_obj( char const* aPath )
 	// triangulate all faces since openGL renders only triangles
 	rapidobj::Triangulate( result );
 
-	SimpleMeshData ret;
+	SimpleMeshData ret( aResource );
+
+	// Reserve up front: each array is then allocated exactly once.
+	std::size_t vertices = 0;
+	for( auto const& shape : result.shapes )
+		vertices += shape.mesh.indices.size();
+
+	ret.positions.reserve( vertices );
+	ret.colors.reserve( vertices );
+	ret.normals.reserve( vertices );
+	ret.texcoords.reserve( vertices );
 
 	for( auto const& shape : result.shapes ) // For every shape i Result object
 	{
@@ -3,6 +3,8 @@
 
 #include "simple_mesh.hpp"
 
-SimpleMeshData load_wavefront_obj( char const* aPath );
+// Also loads compressed meshes (files ending in kCompressedMeshExtension; see
+// mesh_codec.hpp), such that those can be used wherever OBJ files are.
+SimpleMeshData load_wavefront_obj( char const* aPath, std::pmr::memory_resource* = std::pmr::get_default_resource() );
 
 #endif // LOAD_OBJ_HPP_2CF735BE_6624_413E_B6DC_B5BBA337F96F
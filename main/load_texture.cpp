@@ -1,5 +1,7 @@
 #include "load_texture.hpp"
 
+#include <memory>
+
 #include <cassert>
 
 #include <stb_image.h>
@@ -34,4 +36,18 @@ GLuint load_texture_2d( char const* aPath )
     glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, 6.f );
 
     return tex;
-}
\ No newline at end of file
+}
+
+SoftTexture load_soft_texture( char const* aPath )
+{
+    assert( aPath );
+
+    stbi_set_flip_vertically_on_load( true );
+
+    int w, h, channels;
+    std::unique_ptr<stbi_uc, void (*)(void*)> ptr( stbi_load( aPath, &w, &h, &channels, 4 ), &stbi_image_free );
+    if( !ptr )
+        throw Error( "Unable to load image '%s'\n", aPath );
+
+    return SoftTexture( std::size_t(w), std::size_t(h), ptr.get() );
+}
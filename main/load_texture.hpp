@@ -3,6 +3,12 @@
 
 #include <glad/glad.h>
 
+#include "soft_raster.hpp"
+
 GLuint load_texture_2d( char const* aPath );
 
+// The same image, for the CPU renderers (same orientation as the OpenGL
+// texture)
+SoftTexture load_soft_texture( char const* aPath );
+
 #endif // TEXTURE_HPP_D0746DED_C9C6_40CD_B6E0_C6FEF665DD31
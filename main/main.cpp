@@ -1,16 +1,28 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <vector>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <algorithm>
 #include <numbers>
 #include <typeinfo>
 #include <stdexcept>
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
+#include <filesystem>
 
 #include "../support/error.hpp"
 #include "../support/program.hpp"
+#include "../support/shader_cache.hpp"
+#include "../support/parallel_compile.hpp"
+#include "../support/shader_reload.hpp"
+#include "../support/thread_pool.hpp"
+#include "../support/stream_buffer.hpp"
 #include "../support/checkpoint.hpp"
 #include "../support/debug_output.hpp"
 
@@ -27,6 +39,29 @@
 #include "render_model.hpp"
 #include "space_vehicle.hpp"
 #include "eCamera_mode.hpp"
+#include "ship_simulation.hpp"
+#include "fleet.hpp"
+#include "flight_path.hpp"
+#include "scene_graph.hpp"
+#include "scene_file.hpp"
+#include "obj_stream.hpp"
+#include "vertex_quant.hpp"
+#include "particles.hpp"
+#include "particle_renderer.hpp"
+#include "text_renderer.hpp"
+#include "shadow_maps.hpp"
+#include "clustered_lighting.hpp"
+#include "frustum.hpp"
+#include "render_queue.hpp"
+#include "command_list.hpp"
+#include "path_tracer.hpp"
+#include "soft_raster.hpp"
+#include "bvh.hpp"
+#include "collision.hpp"
+#include "mesh_codec.hpp"
+#include "terrain.hpp"
+#include "terrain_renderer.hpp"
+#include "hud.hpp"
 
 #include <iostream>
 
@@ -34,25 +69,59 @@
 namespace
 {
 	constexpr char const* kWindowTitle = "COMP3811 - CW2";
+	constexpr char const* kShaderCacheDir_ = "_shadercache_";
+	constexpr char const* kSceneCacheDir_ = "_scenecache_";
+	constexpr char const* kDefaultScene_ = "assets/cw2/scene.json";
+	constexpr char const* kHudFont_ = "assets/cw2/DroidSansMonoDotted.ttf";
 
 	constexpr float kMovementPerSecond_ = 5.0f; // units per second
 	constexpr float kMouseSensitivity_ = 0.01f; // radians per pixel
-	constexpr Vec3f kLandpadPosition1_ = {5.f, 0.f, -5.f}; // Placed on the sea - y-axis is 0
-	constexpr Vec3f kLandpadPosition2_ = {-2.1f, 0.f, 1.1f};
-	constexpr Vec3f kLandpadColor_ = {1.f, 1.f, 1.f};
-	constexpr Vec3f kBurgandy_ = {0.333f, 0.01f, 0.03f};
-	constexpr Vec3f kGrayBurgandy_ = {0.232f, 0.03f, 0.045f};
-	constexpr Vec3f kLightBlue_ = {0.745f, 0.851f, 0.867f}; // #bed9dd
-	constexpr Vec3f kGray_ = {0.718f, 0.718f, 0.718f}; // #b7b7b7
+	constexpr float kLegsRetraction_ = 0.12f; // units; legs retract into the hull
+
+	constexpr float kFleetSpacing_ = 0.3f;
+
+	constexpr std::size_t kDrawGrain_ = 256; // drawables per command list (minimum)
+
+	constexpr std::size_t kDefaultParticles_ = 200'000;
+	constexpr char const* kExhaustNodes_[] = { "booster1", "booster2" }; // the exhaust leaves at the node's origin
+
+	constexpr char const* kBeaconNodes_[] = { "landingpad1", "landingpad2" }; // beacons ring these
+	constexpr char const* kObstacleNodes_[] = { "landingpad1", "landingpad2" }; // ships collide with these
+	constexpr char const* kTerrainNode_ = "langerso"; // drawn with CDLOD with --terrain
+	constexpr std::size_t kBeaconsPerPad_ = 24;
+	constexpr std::size_t kMaxEngineGlows_ = 1024; // fleet ships with a light
+
+	constexpr std::size_t kStreamFrameSize_ = 4*1024*1024; // bytes of per-frame data (minimum)
+	constexpr std::size_t kLightStreamSize_ = 1024*1024; // bytes reserved for the light clusters
+
+	constexpr float kFovY_ = 60.f * std::numbers::pi_v<float> / 180.f;
+	constexpr float kNear_ = 0.1f, kFar_ = 100.f;
+
+	// Scene query masks (see SceneBvh)
+	constexpr std::uint32_t kQueryStatic_ = 1;
+	constexpr std::uint32_t kQueryShip_ = 2;
+
+	// The ground camera rises in steps until it sees the ship's center.
+	constexpr float kGroundCameraLiftStep_ = 0.25f; // units
+	constexpr float kGroundCameraMaxLift_ = 3.f;
+	constexpr Vec3f kShipCenter_{ 0.f, 0.5f, 0.f }; // relative to the ship node
+
+	constexpr std::size_t kPathTraceWidth_ = 1920, kPathTraceHeight_ = 1080;
+	constexpr std::size_t kDefaultPathTraceSamples_ = 256; // per pixel
+
+	constexpr std::size_t kSoftRenderWidth_ = 1920, kSoftRenderHeight_ = 1080;
+
+	constexpr float kHudFontSize_ = 16.f; // pixels
+	constexpr float kHudMargin_ = 8.f; // pixels
 
 	struct State_
 	{
-		ShaderProgram* progTexture;
-		ShaderProgram* progColor;
+		ShaderPermutations* objectShaders;
 		CameraMode camMode = FreeCamera;
 
 		Vec3f trackCameraDistanceOffset = {0.f, -1.f, -5.f};
 		Vec3f groundCameraPosition = {-2.f, -0.1f, 1.f};
+		float groundCameraLift = 0.f; // set by the line-of-sight test
 		
 		struct CamCtrl_
 		{
@@ -71,18 +140,25 @@ namespace
 			float lastX, lastY;
 		} camControl;
 
-		struct SpaceshipCtrl_
-		{
-			bool isAnimation = false, isAnimationPaused = true;
+		ShipSimulation* ship;
+		ShipState shipRender; // Interpolated ship state for the current frame
+		bool fleetReset; // Set by the reset key; handled by the main loop
+		bool pickRequested; // Set by a left click; handled by the main loop
+		double pickX, pickY; // cursor position of the click (window coordinates)
+		bool showHud = true;
+	};
 
-			float shipInitSpeed = 0.f, initAngle = 0.f, radius = 5.f, acceleration = 0.01f;
-			float shipSpeed = shipInitSpeed;
-			float angle = initAngle;
-			
-			Vec3f shipInitPosition = kLandpadPosition1_;
-			Vec3f shipPosition = shipInitPosition;
-			Vec3f shipDirection = {0.0f, 1.0f, 0.0f}; // up to Y axis direction
-		} spaceship;
+	struct Drawable_
+	{
+		SceneNode node;
+		GLuint vao;
+		std::size_t first, vertices;
+		GLuint texture;
+
+		Vec3f center; // bounding sphere, in model space
+		float radius;
+
+		VertexDecode const* decode; // if quantized
 	};
 
 	void glfw_callback_error_( int, char const* );
@@ -91,9 +167,18 @@ namespace
 	void glfw_callback_mouse_button_( GLFWwindow*, int, int, int );
 	void update_camera_position_by_cam_movement( State_::CamCtrl_&, float );
 	void update_free_camera_direction_vectors( State_::CamCtrl_&);
-	void update_ship_position( State_::SpaceshipCtrl_ &, float );
 	void update_camera ( State_&, float );
 
+	Vec3f translation_( Mat44f const& );
+	Ray make_pick_ray_( Mat44f const&, float, float );
+	float view_depth_( Mat44f const&, Mat44f const&, Vec3f, float );
+	bool is_software_renderer_();
+
+	std::vector<SoftTexture const*> load_soft_textures_( SceneDesc const&, std::vector<std::optional<SoftTexture>>& aStorage );
+	void path_trace_( char const* aSceneFile, char const* aOutput, std::size_t aSamples );
+	void software_render_( char const* aSceneFile, char const* aOutput );
+	void compress_mesh_( char const* aInput, char const* aOutput );
+
 
 
 	struct GLFWCleanupHelper
@@ -108,8 +193,120 @@ namespace
 
 }
 
-int main() try
+int main( int aArgc, char* aArgv[] ) try
 {
+	// Command line options
+	bool simulationThread = false; // --sim-thread: run the simulation on its own thread
+	std::size_t fleetSize = 0; // --fleet N: fly N additional ships (instanced)
+	char const* fleetPathName = nullptr; // --path NAME: the fleet follows a scripted route (scene path or file)
+	char const* sceneFile = kDefaultScene_; // --scene FILE: JSON or compiled scene
+	std::size_t particleCount = kDefaultParticles_; // --particles N: size of the exhaust particle pool
+	bool cpuParticles = false; // --cpu-particles: simulate the particles on the CPU
+	CascadeParams shadowParams; // --shadow-cascades N (0: off), --shadow-size N: shadow map cost
+	bool pointLights = true; // --no-point-lights: disable the beacons and engine glows
+	bool depthPrepass = true; // --no-depth-prepass: shade textured objects without laying down their depth first
+	char const* pathTraceFile = nullptr; // --path-trace FILE: render the scene offline to a PNG and exit (no window)
+	std::size_t pathTraceSamples = kDefaultPathTraceSamples_; // --samples N: samples per pixel for --path-trace
+	char const* softRenderFile = nullptr; // --software-render FILE: rasterize the scene on the CPU to a PNG and exit (no window)
+	bool quantize = false; // --quantize: store the meshes' vertices in compact formats (see vertex_quant.hpp)
+	char const* compressInput = nullptr; // --compress-mesh IN OUT: convert a mesh into the compressed format and exit (no window)
+	char const* compressOutput = nullptr;
+	std::size_t terrainResolution = 0; // --terrain N: resample the terrain into a heightfield with N samples along its longer side, and draw it with CDLOD
+	char const* heightmapFile = nullptr; // --heightmap FILE: with --terrain, take the heights from a grayscale image (over the terrain's bounds) instead
+	for( int i = 1; i < aArgc; ++i )
+	{
+		if( 0 == std::strcmp( "--sim-thread", aArgv[i] ) )
+			simulationThread = true;
+		else if( 0 == std::strcmp( "--fleet", aArgv[i] ) && i+1 < aArgc )
+		{
+			char* end = nullptr;
+			fleetSize = std::strtoull( aArgv[++i], &end, 10 );
+			if( !end || *end )
+				throw Error( "--fleet: expected a number, got '%s'", aArgv[i] );
+		}
+		else if( 0 == std::strcmp( "--path", aArgv[i] ) && i+1 < aArgc )
+			fleetPathName = aArgv[++i];
+		else if( 0 == std::strcmp( "--scene", aArgv[i] ) && i+1 < aArgc )
+			sceneFile = aArgv[++i];
+		else if( 0 == std::strcmp( "--particles", aArgv[i] ) && i+1 < aArgc )
+		{
+			char* end = nullptr;
+			particleCount = std::strtoull( aArgv[++i], &end, 10 );
+			if( !end || *end )
+				throw Error( "--particles: expected a number, got '%s'", aArgv[i] );
+		}
+		else if( 0 == std::strcmp( "--cpu-particles", aArgv[i] ) )
+			cpuParticles = true;
+		else if( 0 == std::strcmp( "--no-point-lights", aArgv[i] ) )
+			pointLights = false;
+		else if( 0 == std::strcmp( "--no-depth-prepass", aArgv[i] ) )
+			depthPrepass = false;
+		else if( 0 == std::strcmp( "--quantize", aArgv[i] ) )
+			quantize = true;
+		else if( 0 == std::strcmp( "--compress-mesh", aArgv[i] ) && i+2 < aArgc )
+		{
+			compressInput = aArgv[++i];
+			compressOutput = aArgv[++i];
+		}
+		else if( 0 == std::strcmp( "--terrain", aArgv[i] ) && i+1 < aArgc )
+		{
+			char* end = nullptr;
+			terrainResolution = std::strtoull( aArgv[++i], &end, 10 );
+			if( !end || *end || terrainResolution < 2 )
+				throw Error( "--terrain: expected a number of at least 2, got '%s'", aArgv[i] );
+		}
+		else if( 0 == std::strcmp( "--heightmap", aArgv[i] ) && i+1 < aArgc )
+			heightmapFile = aArgv[++i];
+		else if( 0 == std::strcmp( "--path-trace", aArgv[i] ) && i+1 < aArgc )
+			pathTraceFile = aArgv[++i];
+		else if( 0 == std::strcmp( "--software-render", aArgv[i] ) && i+1 < aArgc )
+			softRenderFile = aArgv[++i];
+		else if( 0 == std::strcmp( "--samples", aArgv[i] ) && i+1 < aArgc )
+		{
+			char* end = nullptr;
+			pathTraceSamples = std::strtoull( aArgv[++i], &end, 10 );
+			if( !end || *end || 0 == pathTraceSamples )
+				throw Error( "--samples: expected a positive number, got '%s'", aArgv[i] );
+		}
+		else if( 0 == std::strcmp( "--shadow-cascades", aArgv[i] ) && i+1 < aArgc )
+		{
+			char* end = nullptr;
+			shadowParams.count = std::strtoull( aArgv[++i], &end, 10 );
+			if( !end || *end || shadowParams.count > kMaxShadowCascades )
+				throw Error( "--shadow-cascades: expected a number up to %zu, got '%s'", kMaxShadowCascades, aArgv[i] );
+		}
+		else if( 0 == std::strcmp( "--shadow-size", aArgv[i] ) && i+1 < aArgc )
+		{
+			char* end = nullptr;
+			shadowParams.resolution = std::strtoull( aArgv[++i], &end, 10 );
+			if( !end || *end || 0 == shadowParams.resolution )
+				throw Error( "--shadow-size: expected a positive number, got '%s'", aArgv[i] );
+		}
+		else
+			throw Error( "Unknown command line option '%s'", aArgv[i] );
+	}
+
+	if( heightmapFile && !terrainResolution )
+		throw Error( "--heightmap requires --terrain" );
+
+	// Offline rendering needs neither a window nor OpenGL, so it also runs
+	// on machines without a GPU.
+	if( pathTraceFile )
+	{
+		path_trace_( sceneFile, pathTraceFile, pathTraceSamples );
+		return 0;
+	}
+	if( softRenderFile )
+	{
+		software_render_( sceneFile, softRenderFile );
+		return 0;
+	}
+	if( compressInput )
+	{
+		compress_mesh_( compressInput, compressOutput );
+		return 0;
+	}
+
 	// Initialize GLFW
 	if( GLFW_TRUE != glfwInit() )
 	{
@@ -182,6 +379,27 @@ int main() try
 	setup_gl_debug_output();
 #	endif // ~ !NDEBUG
 
+	// Shader compilation
+	// Prefer the driver's own parallel compilation. Without it, compile on a
+	// worker thread using a hidden window whose context shares objects with
+	// the main one. Note: the worker must be destroyed before its window.
+	GLFWWindowDeleter compileWindowDeleter{ nullptr };
+	std::unique_ptr<ShaderCompileThread> compileThread;
+
+	if( !setup_parallel_shader_compile( (GLADloadproc)&glfwGetProcAddress ) )
+	{
+		glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+		if( GLFWwindow* compileWindow = glfwCreateWindow( 1, 1, kWindowTitle, nullptr, window ) )
+		{
+			compileWindowDeleter.window = compileWindow;
+			compileThread = std::make_unique<ShaderCompileThread>(
+				[compileWindow] { glfwMakeContextCurrent( compileWindow ); },
+				[] { glfwMakeContextCurrent( nullptr ); }
+			);
+		}
+		glfwWindowHint( GLFW_VISIBLE, GLFW_TRUE );
+	}
+
 	// Global GL state
 	OGL_CHECKPOINT_ALWAYS();
 
@@ -193,7 +411,6 @@ int main() try
 	glfwGetFramebufferSize( window, &iwidth, &iheight );
 	glViewport( 0, 0, iwidth, iheight );
 
-	// Animation state
 	auto last = Clock::now();
 	
 	// Other initialization & loading
@@ -208,85 +425,439 @@ int main() try
 	OGL_CHECKPOINT_ALWAYS();
 
 	// Load shader program
-	ShaderProgram progTexture( {{ GL_VERTEX_SHADER, "assets/cw2/default.vert" }, { GL_FRAGMENT_SHADER, "assets/cw2/textured_objects.frag" }} );
-	ShaderProgram progColor( {{ GL_VERTEX_SHADER, "assets/cw2/default.vert" }, { GL_FRAGMENT_SHADER, "assets/cw2/colored_objects.frag" }} );
+	// The object shaders are uber-shaders; variants are compiled per feature
+	// set. The cache shares identical stages between variants, and keeps
+	// linked program binaries on disk for subsequent runs. The variants are
+	// only started here; they compile while the assets below are loaded.
+	// Edited sources are recompiled via the hot reload.
+	ShaderCache shaderCache( kShaderCacheDir_ );
+	ShaderHotReload shaderReload;
+
+	ShaderPermutations objectShaders( 
+		{{ GL_VERTEX_SHADER, "assets/cw2/default.vert" }, { GL_FRAGMENT_SHADER, "assets/cw2/objects.frag" }},
+		kObjectShaderFeatures,
+		&shaderCache, compileThread.get(), &shaderReload
+	);
+
+	// Variants used by the scene; others are created on demand. The shadow
+	// pass and the depth prepass use the featureless variants (apart from
+	// the quantized vertex format).
+	std::uint32_t const vertexFormat = quantize ? kShaderQuantized : 0;
+	std::uint32_t const litFeatures = kShaderVertexColor | kShaderLighting | vertexFormat
+		| (shadowParams.count ? kShaderShadows : 0)
+		| (pointLights ? kShaderPointLights : 0);
+
+	objectShaders.prepare( kShaderTexture | litFeatures );
+	objectShaders.prepare( litFeatures );
+	if( fleetSize )
+		objectShaders.prepare( litFeatures | kShaderInstancing );
+
+	if( shadowParams.count || depthPrepass )
+		objectShaders.prepare( vertexFormat );
+	if( shadowParams.count && fleetSize )
+		objectShaders.prepare( vertexFormat | kShaderInstancing );
 	
-	state.progTexture = &progTexture;
-	state.progColor = &progColor;
-
-	// Load Meshes and Textures
-	SimpleMeshData langersoMesh = load_wavefront_obj("assets/cw2/langerso.obj"); // Load Mesh
-	GLuint langersoVAO = create_vao(langersoMesh); // Returns a VAO pointer from the Attributes object
-	std::size_t langersoVertices = langersoMesh.positions.size() ; // Calculate the number of vertices to draw later
-	GLuint textureID = load_texture_2d("assets/cw2/L3211E-4k.jpg");  // Load Texture
-
-	SimpleMeshData landingpadMesh = load_wavefront_obj("assets/cw2/landingpad.obj"); // Load Mesh
-	GLuint landingpadVAO = create_vao(landingpadMesh); // Returns a VAO pointer from the Attributes object
-	std::size_t landingpadVertices = landingpadMesh.positions.size() ; // Calculate the number of vertices to draw later
-
-	float cylinderBodyRadius = 0.07f; 
-	float cylinderBoosterRadius = 0.03f;
-	float cubeHeight = 0.08f;
-	float cubeRadius = 0.01f;
-
-	// Rocket base
-	SimpleMeshData cylinderMesh1 = make_cylinder(
-		true, 64, kGrayBurgandy_, 
-		make_translation( { 0.f, 0.05f, 0.f }) * 
-		make_scaling( cylinderBodyRadius, 1.f, cylinderBodyRadius ) * 
-		make_rotation_z(std::numbers::pi_v<float> / 2.0f));	
-	SimpleMeshData coneMesh1 = make_cone(
-		true, 64, kGrayBurgandy_ , 
-		make_translation( { 0.f, 1.05f, 0.f }) * 
-		make_scaling( cylinderBodyRadius, 0.2f, cylinderBodyRadius ) * 
-		make_rotation_z(std::numbers::pi_v<float> / 2.0f));
-
-	// Boosters
-	SimpleMeshData cylinderMesh2 = make_cylinder(
-		true, 64, kBurgandy_, 
-		make_translation( { cylinderBodyRadius * 1.05f, 0.03f, 0.f }) * 
-		make_scaling( cylinderBoosterRadius, 0.5f, cylinderBoosterRadius ) * 
-		make_rotation_z(std::numbers::pi_v<float> / 2.0f));	
-	SimpleMeshData coneMesh2 = make_cone(
-		true, 64, kBurgandy_ , 
-		make_translation( { cylinderBodyRadius * 1.05f, 0.53f, 0.f }) * 
-		make_scaling( cylinderBoosterRadius, 0.07f, cylinderBoosterRadius ) * 
-		make_rotation_z(std::numbers::pi_v<float> / 2.0f));
-	SimpleMeshData cylinderMesh3 = make_cylinder(
-		true, 64, kBurgandy_, 
-		make_translation( { -cylinderBodyRadius * 1.05f, 0.03f, 0.f }) * 
-		make_scaling( cylinderBoosterRadius, 0.5f, cylinderBoosterRadius ) * 
-		make_rotation_z(std::numbers::pi_v<float> / 2.0f));	
-	SimpleMeshData coneMesh3 = make_cone(
-		true, 64, kBurgandy_ , 
-		make_translation( { -cylinderBodyRadius * 1.05f, 0.53f, 0.f }) * 
-		make_scaling( cylinderBoosterRadius, 0.07f, cylinderBoosterRadius ) * 
-		make_rotation_z(std::numbers::pi_v<float> / 2.0f));
-
-	// Legs 
-	SimpleMeshData cubeMesh1 = make_cube(
-		kLightBlue_ , 
-		make_translation( { 0.f, cubeHeight, cylinderBodyRadius }) * 
-		make_scaling( cubeRadius, cubeHeight, cubeRadius ));
-	SimpleMeshData cubeMesh2 = make_cube(
-		kLightBlue_ , 
-		make_translation( { cylinderBodyRadius * sqrtf(3.f) / 2.0f, cubeHeight, -cylinderBodyRadius / 2.0f }) *
-		make_scaling( cubeRadius, cubeHeight, cubeRadius )); 
-	SimpleMeshData cubeMesh3 = make_cube(
-		kLightBlue_ , 
-		make_translation( { -cylinderBodyRadius * sqrtf(3.f) / 2.0f, cubeHeight , -cylinderBodyRadius / 2.0f }) * 
-		make_scaling( cubeRadius, cubeHeight, cubeRadius ));
-
-	GLuint vehicleVAO = create_vao( concatenate( {cylinderMesh1,cylinderMesh2,cylinderMesh3, coneMesh1, coneMesh2, coneMesh3, cubeMesh1, cubeMesh2, cubeMesh3} ));
-	std::size_t vehicleVertices = cylinderMesh1.positions.size() + cylinderMesh2.positions.size() + cylinderMesh2.positions.size() + 
-		coneMesh1.positions.size() + coneMesh2.positions.size() +coneMesh3.positions.size() + cubeMesh1.positions.size() * 3;
+	state.objectShaders = &objectShaders;
+
+	// Exhaust particles are simulated by a compute shader, except on software
+	// renderers, where the (vectorized, multi-threaded) CPU version is much
+	// faster. The compute variant is only compiled when used.
+	bool const gpuParticles = !cpuParticles && !is_software_renderer_();
+
+	ShaderPermutations particleShaders(
+		{{ GL_VERTEX_SHADER, "assets/cw2/particles.vert" }, { GL_FRAGMENT_SHADER, "assets/cw2/particles.frag" }},
+		{}, &shaderCache, compileThread.get(), &shaderReload
+	);
+	ShaderPermutations particleCompute(
+		{{ GL_COMPUTE_SHADER, "assets/cw2/particles.comp" }},
+		{}, &shaderCache, compileThread.get(), &shaderReload
+	);
+
+	particleShaders.prepare( 0 );
+	if( gpuParticles )
+		particleCompute.prepare( 0 );
+
+	ShaderPermutations textShaders(
+		{{ GL_VERTEX_SHADER, "assets/cw2/text.vert" }, { GL_FRAGMENT_SHADER, "assets/cw2/text.frag" }},
+		{}, &shaderCache, compileThread.get(), &shaderReload
+	);
+	textShaders.prepare( 0 );
+
+	// The CDLOD terrain's shaders share objects.frag with the objects.
+	ShaderPermutations terrainShaders(
+		{{ GL_VERTEX_SHADER, "assets/cw2/terrain.vert" }, { GL_FRAGMENT_SHADER, "assets/cw2/objects.frag" }},
+		kObjectShaderFeatures,
+		&shaderCache, compileThread.get(), &shaderReload
+	);
+	if( terrainResolution )
+		terrainShaders.prepare( kShaderTexture | (litFeatures & ~std::uint32_t(kShaderVertexColor | kShaderQuantized)) );
+
+	// Load the scene
+	// JSON scenes are compiled on first use (this loads the OBJ files and
+	// builds the procedural meshes); later runs load the cached binary.
+	// All meshes share a single VAO.
+	// The vertex data is only needed until it has been uploaded, so it is
+	// allocated from an arena that is released in one go afterwards.
+	MeshArena loadArena;
+	SceneDesc sceneDesc = load_scene( sceneFile, kSceneCacheDir_, &loadArena );
+	SceneGpu sceneGpu = create_scene_gpu( sceneDesc, quantize );
+
+	auto const require_node_ = [&] ( char const* aName ) {
+		auto const node = sceneDesc.find_node( aName );
+		if( kNoSceneIndex == node )
+			throw Error( "Scene '%s': missing node '%s'", sceneFile, aName );
+		return node;
+	};
+
+	Vec3f const landingpad1Position = translation_( sceneDesc.nodes[require_node_( "landingpad1" )].transform );
+	Vec3f const landingpad2Position = translation_( sceneDesc.nodes[require_node_( "landingpad2" )].transform );
+
+	// Terrain
+	// With --terrain, the terrain node's mesh is resampled into a heightfield
+	// (in world space), and drawn with CDLOD instead of as a drawable.
+	std::uint32_t const terrainNode = terrainResolution ? require_node_( kTerrainNode_ ) : kNoSceneIndex;
+	std::optional<TerrainRenderer> terrain;
+	if( kNoSceneIndex != terrainNode )
+	{
+		auto const& node = sceneDesc.nodes[terrainNode];
+		if( kNoSceneIndex == node.mesh || sceneDesc.meshes[node.mesh].data.positions.empty() )
+			throw Error( "Scene '%s': terrain node '%s' has no (non-streamed) mesh", sceneFile, kTerrainNode_ );
+
+		Mat44f world = node.transform;
+		for( auto parent = node.parent; kNoSceneIndex != parent; parent = sceneDesc.nodes[parent].parent )
+			world = sceneDesc.nodes[parent].transform * world;
+
+		auto const& mesh = sceneDesc.meshes[node.mesh];
+		SimpleMeshData worldMesh;
+		worldMesh.texcoords = mesh.data.texcoords;
+		for( auto const& p : mesh.data.positions )
+		{
+			Vec4f const w = world * Vec4f{ p.x, p.y, p.z, 1.f };
+			worldMesh.positions.emplace_back( Vec3f{ w.x, w.y, w.z } );
+		}
+
+		auto const terrainStart = Clock::now();
+		Heightfield field = make_heightfield( worldMesh, terrainResolution );
+		if( heightmapFile )
+		{
+			float lo = field.heights.front(), hi = lo;
+			for( float const h : field.heights )
+			{
+				lo = std::min( lo, h );
+				hi = std::max( hi, h );
+			}
+
+			Heightfield image = load_heightfield( heightmapFile, Vec3f{ field.origin.x, lo, field.origin.y }, field.size_x(), hi - lo );
+			image.texcoordU = field.texcoordU;
+			image.texcoordV = field.texcoordV;
+			field = std::move( image );
+		}
+
+		GLuint const texture = kNoSceneIndex != mesh.material ? sceneGpu.textures[mesh.material] : 0;
+		terrain.emplace( field, CdlodParams{}, texture );
+
+		float const terrainTime = std::chrono::duration_cast<Secondsf>(Clock::now()-terrainStart).count();
+		std::printf( "Terrain: %zux%zu samples, spacing %.4f, %zu levels (%.1f ms)\n", field.samplesX, field.samplesZ, double(field.spacing), terrain->tree().level_count(), 1e3 * double(terrainTime) );
+	}
+
+	// Scene graph
+	// Mirrors the scene's nodes, such that both use the same indices. The
+	// spaceship's parts are children of the ship node; the boosters and legs
+	// are grouped under their own nodes, such that they can be animated as a
+	// unit.
+	SceneGraph scene;
+	std::vector<Drawable_> drawables;
+
+	for( auto const& node : sceneDesc.nodes )
+	{
+		SceneNode const id = scene.add_node( node.parent, node.transform );
+		if( kNoSceneIndex == node.mesh || id == terrainNode )
+			continue;
+
+		auto const& mesh = sceneDesc.meshes[node.mesh];
+		auto const& range = sceneGpu.meshes[node.mesh];
+		GLuint const texture = kNoSceneIndex != mesh.material ? sceneGpu.textures[mesh.material] : 0;
+		VertexDecode const* decode = range.quantized ? &range.decode : nullptr;
+		drawables.emplace_back( Drawable_{ id, range.vao, range.first, range.count, texture, range.center, range.radius, decode } );
+	}
+
+	SceneNode const shipNode = require_node_( "ship" );
+	SceneNode const boostersNode = require_node_( "boosters" );
+	SceneNode const legsNode = require_node_( "legs" );
+
+	// Scene queries
+	// Ray casts and overlap tests against the scene's triangles, for picking
+	// and the ground camera's line of sight. Each mesh's BVH is built before
+	// its vertex data is released; streamed meshes are not resident on the
+	// CPU and thus left out, as is the (instanced) fleet. The ship's parts
+	// move, so their instances are updated with the scene graph.
+	SceneBvh sceneQuery;
+	std::vector<SceneNode> queryNodes; // per instance
+	std::vector<std::uint32_t> shipInstances;
+	{
+		auto const queryStart = Clock::now();
+
+		std::vector<std::uint32_t> meshes;
+		std::size_t triangles = 0;
+		for( auto const& mesh : sceneDesc.meshes )
+		{
+			meshes.emplace_back( sceneQuery.add_mesh( mesh.data.positions.data(), mesh.data.positions.size() / 3 ) );
+			triangles += mesh.data.positions.size() / 3;
+		}
+
+		scene.update();
+		for( std::size_t i = 0; i < sceneDesc.nodes.size(); ++i )
+		{
+			if( kNoSceneIndex == sceneDesc.nodes[i].mesh )
+				continue;
+
+			bool ship = false;
+			for( auto node = std::uint32_t(i); kNoSceneIndex != node && !ship; node = sceneDesc.nodes[node].parent )
+				ship = shipNode == node;
+
+			auto const instance = sceneQuery.add_instance( meshes[sceneDesc.nodes[i].mesh], scene.world( SceneNode(i) ), ship ? kQueryShip_ : kQueryStatic_ );
+			queryNodes.emplace_back( SceneNode(i) );
+			if( ship )
+				shipInstances.emplace_back( instance );
+		}
+		sceneQuery.build();
+
+		float const queryTime = std::chrono::duration_cast<Secondsf>(Clock::now()-queryStart).count();
+		std::printf( "Scene queries: %zu meshes (%zu triangles), %zu instances (%.1f ms)\n", sceneQuery.mesh_count(), triangles, sceneQuery.instance_count(), 1e3 * double(queryTime) );
+	}
+
+	SceneNode pickedNode = kNoSceneNode;
+
+	std::vector<SceneNode> exhaustNodes;
+	for( char const* name : kExhaustNodes_ )
+	{
+		if( auto const node = sceneDesc.find_node( name ); kNoSceneIndex != node && exhaustNodes.size() < kMaxParticleEmitters )
+			exhaustNodes.emplace_back( node );
+	}
+
+	// Beacons are spread around the rim of each landing pad.
+	struct Beacon_
+	{
+		Vec3f position;
+		float phase; // fraction of the chase cycle
+	};
+
+	std::vector<Beacon_> beacons;
+	for( char const* name : kBeaconNodes_ )
+	{
+		auto const node = sceneDesc.find_node( name );
+		if( kNoSceneIndex == node || kNoSceneIndex == sceneDesc.nodes[node].mesh )
+			continue;
+
+		auto const& bounds = sceneGpu.meshes[sceneDesc.nodes[node].mesh];
+		Vec3f const center = translation_( sceneDesc.nodes[node].transform ) + bounds.center;
+		for( std::size_t i = 0; i < kBeaconsPerPad_; ++i )
+		{
+			float const phase = float(i) / float(kBeaconsPerPad_);
+			float const angle = 2.f * std::numbers::pi_v<float> * phase;
+			float const r = 0.9f * bounds.radius;
+			beacons.emplace_back( Beacon_{ center + Vec3f{ r * std::cos( angle ), 0.05f, r * std::sin( angle ) }, phase } );
+		}
+	}
+
+	// Animation state
+	// The ship is simulated with a fixed time step, independently of the
+	// frame rate. The camera is updated per frame.
+	ShipParams shipParams;
+	shipParams.initPosition = landingpad1Position;
+
+	ShipSimulation shipSimulation( shipParams, simulationThread );
+	state.ship = &shipSimulation;
+	state.shipRender = make_initial_ship_state( shipParams );
+
+	// The fleet takes off from the second landing pad. It is stepped on the
+	// main thread (with help from the pool) using the same time step as the
+	// ship, and flies whenever the ship does.
+	Fleet const fleetStart = make_fleet_grid( fleetSize, landingpad2Position, kFleetSpacing_ );
+	Fleet fleet = fleetStart;
+	float fleetTime = 0.f; // Unsimulated time
+	ThreadPool threadPool;
+
+	// With a scripted route, the ships are spread evenly along the path
+	// instead, and their positions are evaluated from the time directly.
+	// The route is one of the scene's paths, or else a path file.
+	std::optional<FlightPath> fleetPath;
+	if( fleetPathName )
+	{
+		if( auto const path = sceneDesc.find_path( fleetPathName ); kNoSceneIndex != path )
+			fleetPath.emplace( make_flight_path( sceneDesc.paths[path] ) );
+		else
+			fleetPath.emplace( load_flight_path( fleetPathName ) );
+	}
+
+	float pathTime = 0.f;
+	std::vector<float> pathTimes( fleetPath ? fleet.size() : 0 );
+	std::vector<PathSample> pathSamples( pathTimes.size() );
+
+	// Fleet: the ships are drawn instanced, so the parts are baked into a
+	// single mesh (in their rest pose).
+	SimpleMeshData vehicleMesh = bake_scene_subtree( sceneDesc, shipNode, &loadArena );
+	std::size_t const vehicleVertices = vehicleMesh.positions.size();
+
+	// Collisions
+	// The ship (body 0) and the fleet are checked against each other, the
+	// landing pads and the sea every frame. All motion is scripted, so the
+	// contacts are only reported. Each body is the vehicle's bounding box;
+	// ships on a route turn freely about their origin, and thus get a cube
+	// that holds the vehicle in any orientation.
+	Vec3f bodyOffset{ 0.f, 0.f, 0.f }; // box center, from the ship's origin
+	BodyShape bodyShape{ 1.f, { 1.f, 1.f, 1.f } };
+	if( !vehicleMesh.positions.empty() )
+	{
+		Vec3f lo = vehicleMesh.positions.front(), hi = lo;
+		float reach = 0.f;
+		for( auto const& p : vehicleMesh.positions )
+		{
+			lo = Vec3f{ std::min( lo.x, p.x ), std::min( lo.y, p.y ), std::min( lo.z, p.z ) };
+			hi = Vec3f{ std::max( hi.x, p.x ), std::max( hi.y, p.y ), std::max( hi.z, p.z ) };
+			reach = std::max( reach, length( p ) );
+		}
+
+		if( fleetPath )
+			bodyShape.half = Vec3f{ reach, reach, reach };
+		else
+		{
+			bodyOffset = 0.5f * (lo + hi);
+			bodyShape.half = 0.5f * (hi - lo);
+		}
+		bodyShape.radius = length( bodyShape.half );
+	}
+
+	CollisionWorld collisions( bodyShape );
+	for( char const* name : kObstacleNodes_ )
+	{
+		auto const node = sceneDesc.find_node( name );
+		if( kNoSceneIndex == node || kNoSceneIndex == sceneDesc.nodes[node].mesh )
+			continue;
+
+		// Streamed meshes aren't in memory, but their caches record the
+		// bounds.
+		auto const& mesh = sceneDesc.meshes[sceneDesc.nodes[node].mesh];
+		if( !mesh.streamed.empty() )
+		{
+			MeshCacheReader const cache( mesh.streamed.c_str() );
+			if( cache.vertex_count() )
+				collisions.add_obstacle( make_obb( scene.world( SceneNode(node) ), cache.bounds_min(), cache.bounds_max() ) );
+			continue;
+		}
+
+		auto const& positions = mesh.data.positions;
+		if( positions.empty() )
+			continue;
+
+		Vec3f lo = positions.front(), hi = lo;
+		for( auto const& p : positions )
+		{
+			lo = Vec3f{ std::min( lo.x, p.x ), std::min( lo.y, p.y ), std::min( lo.z, p.z ) };
+			hi = Vec3f{ std::max( hi.x, p.x ), std::max( hi.y, p.y ), std::max( hi.z, p.z ) };
+		}
+		collisions.add_obstacle( make_obb( scene.world( SceneNode(node) ), lo, hi ) );
+	}
+
+	std::vector<Vec3f> bodies( 1 + fleet.size() );
+
+	GLuint vehicleVAO = 0;
+	std::optional<VertexDecode> vehicleDecode;
+	if( quantize )
+	{
+		QuantizedVertices vertices;
+		vehicleDecode = quantize_mesh( vehicleMesh, vertices );
+		vehicleVAO = create_vao( vertices );
+	}
+	else
+		vehicleVAO = create_vao( vehicleMesh );
+
+	VertexDecode const* const vehicleDecodePtr = vehicleDecode ? &*vehicleDecode : nullptr;
+
+	// All vertex data is on the GPU now.
+	release( vehicleMesh );
+	for( auto& mesh : sceneDesc.meshes )
+		release( mesh.data );
+
+	auto const arenaStats = loadArena.stats();
+	std::printf( "Load arena: %zu allocations, %.1f MB requested, %.1f MB peak\n", arenaStats.allocations, double(arenaStats.bytes) / (1024.*1024.), double(arenaStats.peakReserved) / (1024.*1024.) );
+	loadArena.release();
+
+	// Exhaust particles
+	ParticleParams const particleParams;
+	ParticleSpawner particleSpawner( particleCount, particleParams );
+	ParticleState particles( gpuParticles ? 0 : particleCount, particleParams );
+	ParticleRenderer particleRenderer( particleCount, particleParams, gpuParticles );
+
+	std::printf( "Particles: %zu, simulated on the %s\n", particleCount, gpuParticles ? "GPU" : "CPU" );
+
+	// Performance HUD
+	// All text is batched and drawn with a single draw call at the end of
+	// the frame. Its vertices go into the ring buffer as well.
+	TextRenderer text( kHudFont_, kHudFontSize_ );
+	PerformanceHud hud;
+
+	// Command lists and render queue
+	// Rebuilt every frame from the visible objects. The drawables are split
+	// into partitions, which are culled and recorded on the thread pool, each
+	// into its own list. The lists are then merged into a single queue.
+	std::vector<CommandList> commandLists( threadPool.thread_count() );
+	std::vector<std::size_t> listCulled( commandLists.size() );
+	RenderQueue renderQueue;
+	std::vector<DrawPacket const*> drawPackets;
+
+	// Point lights
+	// Binned into clusters every frame (on the thread pool), such that each
+	// fragment only considers the lights nearby.
+	ClusteredLighting clusteredLighting;
+	std::vector<PointLight> lights;
+	float beaconTime = 0.f;
+
+	// Shadows
+	std::optional<ShadowMaps> shadowMaps;
+	if( shadowParams.count )
+	{
+		shadowMaps.emplace( shadowParams );
+		std::printf( "Shadows: %zu cascades, %zu x %zu\n", shadowParams.count, shadowParams.resolution, shadowParams.resolution );
+	}
+
+	// Per-frame data
+	// Data that changes every frame is written directly into a (usually
+	// persistently mapped) ring buffer. The fleet's model matrices and the
+	// CPU-simulated particles go there.
+	std::size_t const streamBytes = kInstanceStride * (fleet.size() + 1) + 4 * sizeof(float) * particles.size() + kLightStreamSize_;
+	StreamBuffer streamBuffer( std::max( kStreamFrameSize_, streamBytes ) );
+	set_instance_buffer( vehicleVAO, streamBuffer.buffer() );
+
+	// Pick up the shader programs. Usually, they have finished compiling by
+	// now. Afterwards, the shared stages are no longer needed.
+	objectShaders.finish();
+	particleShaders.finish();
+	particleCompute.finish();
+	textShaders.finish();
+	terrainShaders.finish();
+
+	shaderCache.release_stages();
+
+	{
+		auto const stats = shaderCache.stats();
+		std::printf( "Shader cache: %zu programs cached, %zu compiled (%zu rejected), %zu stages compiled, %zu shared\n", stats.programHits, stats.programMisses + stats.programRejected, stats.programRejected, stats.stagesCompiled, stats.stagesShared );
+	}
 	
 
+	// Animated parts; the scene graph is only updated when these change
+	float legsLift = -1.f, boostersAngle = -1.f;
+
 	// Main loop
 	while( !glfwWindowShouldClose( window ) )
 	{
 		// Let GLFW process events
 		glfwPollEvents();
+
+		// Swap in any shader programs that were edited and have finished
+		// recompiling. Doing so here ensures that a frame uses a consistent
+		// set of programs.
+		shaderReload.update();
 		
 		// Check if window was resized.
 		float fbwidth, fbheight;
@@ -318,11 +889,58 @@ int main() try
 		float dt = std::chrono::duration_cast<Secondsf>(now-last).count();
 		last = now;
 
-		// Update camera state
-		update_camera(state, dt);
+		auto& renderStats = render_stats();
+		renderStats = {};
 
 		// Update spaceship state
-		update_ship_position(state.spaceship, dt);
+		state.shipRender = shipSimulation.update( now );
+
+		// Update fleet
+		if( std::exchange( state.fleetReset, false ) )
+		{
+			fleet = fleetStart;
+			fleetTime = 0.f;
+			pathTime = 0.f;
+		}
+
+		StreamBuffer::Allocation fleetInstances{};
+		if( fleet.size() )
+			fleetInstances = streamBuffer.allocate( kInstanceStride * fleet.size(), kInstanceStride );
+
+		auto* const fleetMatrices = static_cast<float*>(fleetInstances.data);
+
+		if( fleetPath && fleet.size() )
+		{
+			if( state.shipRender.isAnimation )
+				pathTime += dt;
+
+			float const spacing = fleetPath->duration() / float(fleet.size());
+			threadPool.parallel_for( fleet.size(), kFleetGrain, [&] (std::size_t aBegin, std::size_t aEnd) {
+				for( std::size_t i = aBegin; i < aEnd; ++i )
+					pathTimes[i] = pathTime - spacing * float(i);
+
+				fleetPath->sample_batch( pathTimes.data()+aBegin, pathSamples.data()+aBegin, aEnd-aBegin );
+				write_path_instances( pathSamples.data(), fleetMatrices, aBegin, aEnd );
+			} );
+			streamBuffer.commit( fleetInstances );
+		}
+		else if( fleet.size() )
+		{
+			if( state.shipRender.isAnimation )
+			{
+				fleetTime = std::min( fleetTime + dt, ShipSimulation::kMaxStepsPerUpdate * ShipSimulation::kTimeStep );
+				for( ; fleetTime >= ShipSimulation::kTimeStep; fleetTime -= ShipSimulation::kTimeStep )
+					step_fleet( fleet, shipParams, ShipSimulation::kTimeStep, threadPool );
+			}
+
+			threadPool.parallel_for( fleet.size(), kFleetGrain, [&] (std::size_t aBegin, std::size_t aEnd) {
+				write_fleet_instances( fleet, fleetMatrices, aBegin, aEnd );
+			} );
+			streamBuffer.commit( fleetInstances );
+		}
+
+		// Update camera state
+		update_camera(state, dt);
 
 		// Define the camera rotation matrices
 		Mat44f Rx = make_rotation_x(state.camControl.theta); // Theta controls vertical rotation -  yaw
@@ -331,20 +949,294 @@ int main() try
 		// transformation for langerso
 		Mat44f T = make_translation({state.camControl.cameraPosition.x, state.camControl.cameraPosition.y, -state.camControl.cameraPosition.z}); // Define the camera position in world space
 		Mat44f world2camera = Rx * Ry * T; // Create world to camera matrix by first translating and then rotating
-		Mat44f projection = make_perspective_projection(  60.f * std::numbers::pi_v<float> / 180.f, fbwidth/float(fbheight), 0.1f, 100.0f );
+		Mat44f projection = make_perspective_projection( kFovY_, fbwidth/float(fbheight), kNear_, kFar_ );
+
+		// Update transforms
+		// Only the nodes that changed (and their children) are recomputed.
+		scene.set_local( shipNode, make_translation( state.shipRender.position ) );
+
+		float const lift = std::clamp( state.shipRender.position.y - shipParams.initPosition.y, 0.f, 1.f );
+		if( lift != legsLift )
+		{
+			// Retract the legs into the hull during the first unit of ascent.
+			legsLift = lift;
+			scene.set_local( legsNode, make_translation( { 0.f, kLegsRetraction_ * lift, 0.f } ) );
+		}
+		if( state.shipRender.angle != boostersAngle )
+		{
+			// Boosters rotate about the hull as the ship turns.
+			boostersAngle = state.shipRender.angle;
+			scene.set_local( boostersNode, make_rotation_y( 2.f * boostersAngle ) );
+		}
+
+		if( scene.update() )
+		{
+			for( auto const instance : shipInstances )
+				sceneQuery.set_transform( instance, scene.world( queryNodes[instance] ) );
+			sceneQuery.refit();
+		}
+
+		// Detect collisions
+		auto const collisionStart = Clock::now();
+
+		bodies[0] = translation_( scene.world( shipNode ) ) + bodyOffset;
+		threadPool.parallel_for( fleet.size(), kFleetGrain, [&] (std::size_t aBegin, std::size_t aEnd) {
+			for( std::size_t i = aBegin; i < aEnd; ++i )
+				bodies[1+i] = (fleetPath ? pathSamples[i].position : Vec3f{ fleet.posX[i], fleet.posY[i], fleet.posZ[i] }) + bodyOffset;
+		} );
+		collisions.detect( bodies.data(), bodies.size(), threadPool );
+
+		float const collisionTime = std::chrono::duration_cast<Secondsf>(Clock::now()-collisionStart).count();
+
+		// Update exhaust
+		// The boosters fire while the ship flies. The exhaust leaves along
+		// the boosters' axes (the cylinders are built along +x).
+		ParticleEmitter emitters[kMaxParticleEmitters];
+		std::size_t emitterCount = 0;
+		if( state.shipRender.isAnimation )
+		{
+			for( auto const node : exhaustNodes )
+			{
+				auto const& world = scene.world( node );
+				Vec4f const axis = world * Vec4f{ 1.f, 0.f, 0.f, 0.f };
+				emitters[emitterCount++] = ParticleEmitter{ translation_( world ), -normalize( Vec3f{ axis.x, axis.y, axis.z } ) };
+			}
+		}
+
+		auto const spawn = particleSpawner.step( dt, emitters, emitterCount );
+		if( particleRenderer.gpu_simulation() )
+			particleRenderer.simulate( particleCompute.get( 0 ).programId(), spawn, dt );
+		else if( particles.size() )
+		{
+			auto const vertices = streamBuffer.allocate( 4 * sizeof(float) * particles.size() );
+			threadPool.parallel_for( particles.size(), kParticleGrain, [&] (std::size_t aBegin, std::size_t aEnd) {
+				step_particles( particles, particleParams, spawn, dt, aBegin, aEnd );
+				write_particle_vertices( particles, static_cast<float*>(vertices.data), aBegin, aEnd );
+			} );
+			streamBuffer.commit( vertices );
+			particleRenderer.set_vertices( streamBuffer.buffer(), vertices.offset );
+		}
+
+		// Update point lights
+		// The beacons chase around the pads. Flying ships (up to a limit)
+		// get an engine glow, the main ship one per booster.
+		auto const lightStart = Clock::now();
+		if( pointLights )
+		{
+			beaconTime += dt;
+			lights.clear();
+
+			for( auto const& beacon : beacons )
+			{
+				float const chase = 0.5f + 0.5f * std::cos( 2.f * std::numbers::pi_v<float> * (beacon.phase - 0.5f * beaconTime) );
+				lights.emplace_back( PointLight{ beacon.position, 0.6f, { 1.f, 0.15f, 0.05f }, 0.2f + 0.8f * chase*chase*chase*chase } );
+			}
+
+			if( state.shipRender.isAnimation )
+			{
+				float const flicker = 0.9f + 0.1f * std::sin( 37.f * beaconTime );
+				for( std::size_t i = 0; i < emitterCount; ++i )
+				{
+					Vec3f const position = emitters[i].position + emitters[i].direction * 0.05f;
+					lights.emplace_back( PointLight{ position, 1.2f, { 1.f, 0.55f, 0.2f }, 1.5f * flicker } );
+				}
+
+				std::size_t const glows = std::min( fleet.size(), kMaxEngineGlows_ );
+				for( std::size_t i = 0; i < glows; ++i )
+				{
+					Vec3f const position = fleetPath ? pathSamples[i].position : Vec3f{ fleet.posX[i], fleet.posY[i], fleet.posZ[i] };
+					lights.emplace_back( PointLight{ position - Vec3f{ 0.f, 0.05f, 0.f }, 0.6f, { 1.f, 0.55f, 0.2f }, 0.8f * flicker } );
+				}
+			}
+
+			ClusterView const view{ world2camera, kFovY_, fbwidth/fbheight, kNear_, kFar_ };
+			clusteredLighting.update( lights.data(), lights.size(), view, fbwidth, fbheight, threadPool, streamBuffer );
+			render_lighting().pointLights = &clusteredLighting;
+		}
+		float const lightBinTime = std::chrono::duration_cast<Secondsf>(Clock::now()-lightStart).count();
+
+		// Render shadow maps
+		// The cascades are refitted to the view every frame. Each cascade
+		// culls the casters against its own volume.
+		auto const shadowStart = Clock::now();
+		if( shadowMaps )
+		{
+			CascadeView const view{ invert( world2camera ), kFovY_, fbwidth/fbheight, kNear_, kFar_ };
+			shadowMaps->update( view, render_lighting().toLight );
+
+			for( std::size_t i = 0; i < shadowMaps->cascade_count(); ++i )
+			{
+				auto const& cascade = shadowMaps->cascade( i );
+				Frustum const volume( cascade.viewProjection );
+
+				shadowMaps->begin_cascade( i );
+				for( auto const& drawable : drawables )
+				{
+					auto const& world = scene.world( drawable.node );
+					if( volume.intersects_sphere( world, drawable.center, drawable.radius ) )
+						render_depth( objectShaders, drawable.vao, cascade.viewProjection, world, drawable.vertices, drawable.first, drawable.decode );
+				}
+
+				render_instanced_depth( objectShaders, vehicleVAO, cascade.viewProjection, vehicleVertices, fleet.size(), fleetInstances.offset / kInstanceStride, vehicleDecodePtr );
+				shadowMaps->end_cascade( i );
+			}
+
+			shadowMaps->end_pass( GLsizei(fbwidth), GLsizei(fbheight) );
+			render_lighting().shadows = &*shadowMaps;
+		}
+		float const shadowTime = std::chrono::duration_cast<Secondsf>(Clock::now()-shadowStart).count();
+
+		// Scene queries
+		// A left click (while the camera is inactive, so the cursor is
+		// visible) picks the object under the cursor. The ground camera
+		// checks its line of sight to the ship against the static scene, and
+		// rises to the lowest height from which the ship is visible; it stays
+		// put when the ship is hidden from all of them.
+		auto const queryStart = Clock::now();
+		if( std::exchange( state.pickRequested, false ) )
+		{
+			int wwidth, wheight;
+			glfwGetWindowSize( window, &wwidth, &wheight );
+
+			float const x = float(2.0 * state.pickX / double(wwidth) - 1.0);
+			float const y = float(1.0 - 2.0 * state.pickY / double(wheight));
+			Ray const ray = make_pick_ray_( invert( projection * world2camera ), x, y );
+
+			SceneHit hit;
+			pickedNode = sceneQuery.intersect( ray, hit ) ? queryNodes[hit.instance] : kNoSceneNode;
+			if( kNoSceneNode != pickedNode )
+				std::printf( "Picked '%s' (triangle %u), %.2f units away\n", sceneDesc.nodes[pickedNode].name.c_str(), hit.triangle, double(hit.t * length( ray.direction )) );
+		}
+
+		if( GroundCamera == state.camMode )
+		{
+			Vec3f const base = translation_( invert( world2camera ) ) - Vec3f{ 0.f, state.groundCameraLift, 0.f };
+			Vec3f const target = translation_( scene.world( shipNode ) ) + kShipCenter_;
+			for( float lift = 0.f; lift <= kGroundCameraMaxLift_; lift += kGroundCameraLiftStep_ )
+			{
+				Vec3f const eye = base + Vec3f{ 0.f, lift, 0.f };
+				if( !sceneQuery.occluded( Ray{ eye, target - eye, 0.f, 1.f }, kQueryStatic_ ) )
+				{
+					state.groundCameraLift = lift;
+					break;
+				}
+			}
+		}
+		float const queryTime = std::chrono::duration_cast<Secondsf>(Clock::now()-queryStart).count();
 
 		// Draw scene
-		// Render langerso model
-		render_model(progTexture, langersoVAO, projection, world2camera, {0.f, 0.f, 0.f}, textureID, langersoVertices );
-	
-		// Render 1st landingpad
-		render_model(progColor, landingpadVAO, projection, world2camera, kLandpadPosition1_, false, landingpadVertices );
-	
-		// Render 2nd landingpad
-		render_model(progColor, landingpadVAO, projection, world2camera, kLandpadPosition2_,false, landingpadVertices );
+		// Objects whose bounding spheres are outside of the view frustum are
+		// skipped. (The fleet is not culled; its instances are drawn with a
+		// single call anyway.) The others are recorded into the command lists,
+		// and drawn grouped by shader variant and texture, front to back within
+		// each group.
+		// Textured objects (the terrain) are the most expensive to shade. With
+		// the depth prepass, their depth is laid down first, so that each of
+		// their pixels is shaded at most once.
+		Mat44f const projCamera = projection * world2camera;
+		Frustum const frustum( projCamera );
+
+		std::size_t const partitions = std::clamp<std::size_t>( (drawables.size() + kDrawGrain_ - 1) / kDrawGrain_, 1, commandLists.size() );
+		threadPool.parallel_for( partitions, 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+			for( std::size_t p = aBegin; p < aEnd; ++p )
+			{
+				auto& list = commandLists[p];
+				list.clear();
+				listCulled[p] = 0;
+
+				std::size_t const end = drawables.size() * (p+1) / partitions;
+				for( std::size_t i = drawables.size() * p / partitions; i < end; ++i )
+				{
+					auto const& drawable = drawables[i];
+					auto const& world = scene.world( drawable.node );
+					if( !frustum.intersects_sphere( world, drawable.center, drawable.radius ) )
+					{
+						++listCulled[p];
+						continue;
+					}
+
+					DrawPacket packet{ drawable.vao, drawable.texture, std::uint32_t(drawable.first), std::uint32_t(drawable.vertices), 0, 0, drawable.decode };
+					set_packet_transform( packet, projCamera, world );
+					float const depth = view_depth_( world2camera, world, drawable.center, drawable.radius );
+
+					auto const item = list.record( packet );
+					list.submit( RenderPass::opaque, packet_features( packet ), packet.texture, depth, item );
+					if( depthPrepass && packet.texture )
+						list.submit( RenderPass::depthPrepass, packet_depth_features( packet ), 0, depth, item );
+				}
+			}
+		} );
+
+		for( std::size_t p = 0; p < partitions; ++p )
+			renderStats.culled += listCulled[p];
+
+		if( fleet.size() )
+		{
+			auto& list = commandLists[partitions-1];
+			DrawPacket packet{ vehicleVAO, 0, 0, std::uint32_t(vehicleVertices), std::uint32_t(fleet.size()), std::uint32_t(fleetInstances.offset / kInstanceStride), vehicleDecodePtr };
+			packet.projCameraWorld = projCamera;
+
+			auto const item = list.record( packet );
+			list.submit( RenderPass::opaque, packet_features( packet ), 0, 0.f, item );
+		}
+
+		merge_command_lists( commandLists.data(), partitions, renderQueue, drawPackets );
+		render_queue( objectShaders, renderQueue, drawPackets.data() );
 
-		// Render spaceship
-		render_model(progColor, vehicleVAO, projection, world2camera , state.spaceship.shipPosition, false, vehicleVertices );
+		// The terrain last: it covers most of the view, and much of it is
+		// hidden by the objects.
+		if( terrain )
+			terrain->render( terrainShaders, projCamera, translation_( invert( world2camera ) ), streamBuffer );
+
+		// Render exhaust (blended, so after all opaque geometry)
+		particleRenderer.render( particleShaders.get( 0 ).programId(), projection * world2camera, 0.5f * fbheight * projection(1,1) );
+		if( particleRenderer.size() )
+			++renderStats.drawCalls;
+
+		// Draw the HUD last, on top of everything
+		if( state.showHud )
+		{
+			FrameStats frame{};
+			frame.frameTime = dt;
+			frame.cpuTime = std::chrono::duration_cast<Secondsf>(Clock::now()-now).count();
+			frame.drawCalls = renderStats.drawCalls;
+			frame.prepassDraws = renderStats.prepassDraws;
+			frame.stateChanges = renderStats.stateChanges;
+			frame.triangles = renderStats.triangles;
+			frame.objects = drawables.size();
+			frame.culled = renderStats.culled;
+			frame.terrainPatches = terrain ? terrain->patch_count() : 0;
+			frame.particles = particleRenderer.size();
+			frame.picked = kNoSceneNode != pickedNode ? sceneDesc.nodes[pickedNode].name.c_str() : nullptr;
+			frame.queryCpuTime = queryTime;
+			frame.bodyContacts = collisions.stats().bodyContacts;
+			frame.padContacts = collisions.stats().obstacleContacts;
+			frame.seaContacts = collisions.stats().groundContacts;
+			frame.collisionCpuTime = collisionTime;
+			frame.streamUsed = streamBuffer.frame_used();
+			frame.streamSize = streamBuffer.frame_size();
+
+			if( pointLights )
+			{
+				frame.pointLights = clusteredLighting.light_count();
+				frame.maxLightsPerCluster = clusteredLighting.clusters().max_lights_per_cluster();
+				frame.lightCpuTime = lightBinTime;
+			}
+
+			if( shadowMaps )
+			{
+				frame.shadowCascades = shadowMaps->cascade_count();
+				frame.shadowResolution = shadowMaps->params().resolution;
+				frame.shadowCpuTime = shadowTime;
+				for( std::size_t i = 0; i < frame.shadowCascades; ++i )
+					frame.shadowGpuTimes[i] = shadowMaps->gpu_time( i );
+			}
+
+			hud.add_frame( frame );
+
+			hud.draw( text, kHudMargin_, kHudMargin_ );
+			text.flush( textShaders.get( 0 ).programId(), streamBuffer, fbwidth, fbheight );
+		}
 
 		OGL_CHECKPOINT_DEBUG();
 
@@ -359,16 +1251,20 @@ int main() try
 
 		// Display results
 		glfwSwapBuffers( window );
+
+		// The frame's commands have been submitted; move on to the next part
+		// of the ring buffer.
+		streamBuffer.end_frame();
 	}
 
 	// Cleanup.
-	state.progTexture = nullptr;
-	state.progColor = nullptr;
+	render_lighting().shadows = nullptr;
+	render_lighting().pointLights = nullptr;
+	state.objectShaders = nullptr;
+	state.ship = nullptr;
 
-	glDeleteVertexArrays(1, &langersoVAO);
-	glDeleteVertexArrays(1, &landingpadVAO);
+	destroy_scene_gpu( sceneGpu );
 	glDeleteVertexArrays(1, &vehicleVAO);
-	glDeleteTextures(1, &textureID);
 	return 0;
 }
 catch( std::exception const& eErr )
@@ -419,20 +1315,15 @@ namespace
 			
 			}
 
-			if ( GLFW_KEY_F == aKey && GLFW_PRESS == aAction )
+			if ( GLFW_KEY_F == aKey && GLFW_PRESS == aAction && state->ship )
+				state->ship->toggle_animation();
+			if ( GLFW_KEY_R == aKey && GLFW_PRESS == aAction && state->ship )
 			{
-				state->spaceship.isAnimation = !state->spaceship.isAnimation; 
-				state->spaceship.isAnimationPaused = !state->spaceship.isAnimationPaused;
-			}
-			if ( GLFW_KEY_R == aKey && GLFW_PRESS == aAction )
-			{
-				state->spaceship.isAnimation = false;
-				state->spaceship.isAnimationPaused = true;
-				state->spaceship.shipPosition = state->spaceship.shipInitPosition;
-				state->spaceship.shipSpeed = state->spaceship.shipInitSpeed; 
-				state->spaceship.angle = state->spaceship.initAngle; 
-				state->spaceship.shipDirection = {0.0f, 1.0f, 0.0f}; 
+				state->ship->reset();
+				state->fleetReset = true;
 			}
+			if ( GLFW_KEY_H == aKey && GLFW_PRESS == aAction )
+				state->showHud = !state->showHud;
 			if ( GLFW_KEY_C == aKey && GLFW_PRESS == aAction ) 
 			{
             	state->camMode = static_cast<CameraMode>((state->camMode + 1) % 3);
@@ -467,6 +1358,12 @@ namespace
 	{
 		if( auto* state = static_cast<State_*>(glfwGetWindowUserPointer( aWindow )) )
 		{
+			if ( GLFW_MOUSE_BUTTON_LEFT == aButton && GLFW_PRESS == aAction && !state->camControl.cameraActive )
+			{
+				glfwGetCursorPos( aWindow, &state->pickX, &state->pickY );
+				state->pickRequested = true;
+			}
+
 			if ( GLFW_MOUSE_BUTTON_RIGHT == aButton && GLFW_PRESS == aAction )
 			{
 				state->camControl.cameraActive = !state->camControl.cameraActive;
@@ -538,35 +1435,201 @@ namespace
 			case FixedTrackCamera:
 				state.camControl.phi = 0.f;
 				state.camControl.theta = 0.f;
-				directionToVehicle = normalize(state.spaceship.shipPosition - state.camControl.cameraPosition);
-				state.camControl.cameraPosition = state.trackCameraDistanceOffset - state.spaceship.shipPosition;
+				directionToVehicle = normalize(state.shipRender.position - state.camControl.cameraPosition);
+				state.camControl.cameraPosition = state.trackCameraDistanceOffset - state.shipRender.position;
 				break;
 			case GroundCamera:
-				state.camControl.cameraPosition = state.groundCameraPosition;
-				directionToVehicle = normalize(state.spaceship.shipPosition - state.camControl.cameraPosition);
+				// cameraPosition's y is negated (see world2camera), so this raises the camera.
+				state.camControl.cameraPosition = state.groundCameraPosition - Vec3f{ 0.f, state.groundCameraLift, 0.f };
+				directionToVehicle = normalize(state.shipRender.position - state.camControl.cameraPosition);
 				state.camControl.phi = std::atan2(directionToVehicle.x, -directionToVehicle.z);
 				state.camControl.theta = - std::atan2(directionToVehicle.y, std::sqrt(directionToVehicle.x * directionToVehicle.x + directionToVehicle.z * directionToVehicle.z));
 				break;
 		}
 	}
+}
 
-	void update_ship_position( State_::SpaceshipCtrl_ &aShipControl, float dt)
+namespace
+{
+	Vec3f translation_( Mat44f const& aTransform )
 	{
-		
-		if ( !aShipControl.isAnimation || aShipControl.isAnimationPaused ) return; // No movement if the animation is inactive
+		return { aTransform(0,3), aTransform(1,3), aTransform(2,3) };
+	}
+
+	// Ray through the point (aX, aY) in normalized device coordinates, from
+	// the near plane (t = 0) to the far plane (t = 1)
+	Ray make_pick_ray_( Mat44f const& aClip2world, float aX, float aY )
+	{
+		Vec4f const near = aClip2world * Vec4f{ aX, aY, -1.f, 1.f };
+		Vec4f const far = aClip2world * Vec4f{ aX, aY, 1.f, 1.f };
+
+		Vec3f const origin = Vec3f{ near.x, near.y, near.z } / near.w;
+		return Ray{ origin, Vec3f{ far.x, far.y, far.z } / far.w - origin, 0.f, 1.f };
+	}
+
+	// Distance along the view direction to the front of a bounding sphere
+	// (in model space). Large objects that surround the camera thus sort
+	// first.
+	float view_depth_( Mat44f const& aWorld2camera, Mat44f const& aModel2world, Vec3f aCenter, float aRadius )
+	{
+		Vec4f const center = aWorld2camera * (aModel2world * Vec4f{ aCenter.x, aCenter.y, aCenter.z, 1.f });
+
+		float const scale = std::sqrt( std::max( {
+			aModel2world(0,0)*aModel2world(0,0) + aModel2world(1,0)*aModel2world(1,0) + aModel2world(2,0)*aModel2world(2,0),
+			aModel2world(0,1)*aModel2world(0,1) + aModel2world(1,1)*aModel2world(1,1) + aModel2world(2,1)*aModel2world(2,1),
+			aModel2world(0,2)*aModel2world(0,2) + aModel2world(1,2)*aModel2world(1,2) + aModel2world(2,2)*aModel2world(2,2)
+		} ) );
+
+		return -center.z - scale * aRadius;
+	}
+
+	bool is_software_renderer_()
+	{
+		auto const* renderer = reinterpret_cast<char const*>(glGetString( GL_RENDERER ));
+		if( !renderer )
+			return false;
+
+		for( char const* name : { "llvmpipe", "softpipe", "SwiftShader" } )
+		{
+			if( std::strstr( renderer, name ) )
+				return true;
+		}
+		return false;
+	}
 
-		// Adjust ship movement speed
-        aShipControl.shipSpeed += aShipControl.acceleration * dt;
-        aShipControl.shipSpeed = std::min(aShipControl.shipSpeed, 5.f); // Prevent speed from going too fast
+	std::vector<SoftTexture const*> load_soft_textures_( SceneDesc const& aScene, std::vector<std::optional<SoftTexture>>& aStorage )
+	{
+		// Load each texture once, even if several materials share it.
+		aStorage.clear();
+		aStorage.resize( aScene.materials.size() );
+
+		std::vector<SoftTexture const*> materialTextures( aScene.materials.size(), nullptr );
+		for( std::size_t i = 0; i < aScene.materials.size(); ++i )
+		{
+			auto const& texture = aScene.materials[i].texture;
+			for( std::size_t j = 0; j < i && !texture.empty(); ++j )
+			{
+				if( aScene.materials[j].texture == texture )
+					materialTextures[i] = materialTextures[j];
+			}
 
-		// Adjust ship direction of movement
-		aShipControl.angle += dt * aShipControl.shipSpeed / aShipControl.radius;
-        aShipControl.angle = std::min(aShipControl.angle, static_cast<float>(M_PI) - 0.1f); 
+			if( !materialTextures[i] && !texture.empty() )
+				materialTextures[i] = &aStorage[i].emplace( load_soft_texture( texture.c_str() ) );
+		}
+
+		return materialTextures;
+	}
+
+	void path_trace_( char const* aSceneFile, char const* aOutput, std::size_t aSamples )
+	{
+		ThreadPool pool;
+		PathTracer tracer( pool, kPathTraceWidth_, kPathTraceHeight_ );
+
+		// The scene in its initial state, seen from the free camera's
+		// starting point
+		SceneDesc const scene = load_scene( aSceneFile, kSceneCacheDir_ );
+
+		std::vector<std::optional<SoftTexture>> textures;
+		auto const materialTextures = load_soft_textures_( scene, textures );
+
+		std::vector<Mat44f> world( scene.nodes.size() );
+		for( std::size_t i = 0; i < scene.nodes.size(); ++i )
+		{
+			auto const& node = scene.nodes[i];
+			world[i] = kNoSceneIndex == node.parent ? node.transform : world[node.parent] * node.transform;
+			if( kNoSceneIndex == node.mesh )
+				continue;
+
+			auto const& mesh = scene.meshes[node.mesh];
+			SoftTexture const* texture = kNoSceneIndex != mesh.material ? materialTextures[mesh.material] : nullptr;
+			tracer.add_mesh( mesh.data, world[i], texture, 0, mesh.data.positions.size() );
+		}
+
+		auto const buildStart = Clock::now();
+		tracer.build();
+		std::printf( "Path trace: %zu triangles, BVH built in %.2f s\n", tracer.triangle_count(), std::chrono::duration_cast<Secondsf>(Clock::now()-buildStart).count() );
+
+		State_ const state{};
+		Vec3f const& eye = state.camControl.cameraPosition;
+		Mat44f const world2camera = make_translation( { eye.x, eye.y, -eye.z } ); // as in the main loop
+		Mat44f const projection = make_perspective_projection( kFovY_, float(kPathTraceWidth_)/float(kPathTraceHeight_), kNear_, kFar_ );
+		tracer.set_camera( projection * world2camera );
+
+		// Progressive: the passes double in length, and the image is
+		// written after each, so that a preview is available early.
+		auto const start = Clock::now();
+		for( std::size_t pass = 1; tracer.samples() < aSamples; pass *= 2 )
+		{
+			tracer.render( std::min( pass, aSamples - tracer.samples() ) );
+			save_png( aOutput, tracer.width(), tracer.height(), tracer.image() );
 
-		// Define the curved trajectory
-		float heightFactor = 2.0;  // Adjust this factor to control the vertical lift speed
-		aShipControl.shipPosition.x += aShipControl.radius * sin(aShipControl.angle);  // Sine for horizontal motion
-		aShipControl.shipPosition.y += dt * heightFactor ;  // Linear ascent
+			float const seconds = std::chrono::duration_cast<Secondsf>(Clock::now()-start).count();
+			std::printf( "Path trace: %zu/%zu samples, %.1f s, %.2f Mrays/s (%u threads)\n", tracer.samples(), aSamples, seconds, double(tracer.rays()) / seconds * 1e-6, pool.thread_count() );
+		}
+	}
+
+	void software_render_( char const* aSceneFile, char const* aOutput )
+	{
+		ThreadPool pool;
+		SoftRasterizer raster( pool, kSoftRenderWidth_, kSoftRenderHeight_ );
+
+		// The same view as path_trace_(). Streamed meshes have no data in
+		// memory, and are left out.
+		SceneDesc const scene = load_scene( aSceneFile, kSceneCacheDir_ );
+
+		std::vector<std::optional<SoftTexture>> textures;
+		auto const materialTextures = load_soft_textures_( scene, textures );
+
+		State_ const state{};
+		Vec3f const& eye = state.camControl.cameraPosition;
+		Mat44f const world2camera = make_translation( { eye.x, eye.y, -eye.z } ); // as in the main loop
+		Mat44f const projection = make_perspective_projection( kFovY_, float(kSoftRenderWidth_)/float(kSoftRenderHeight_), kNear_, kFar_ );
+
+		auto const start = Clock::now();
+
+		raster.clear( { 0.2f, 0.2f, 0.2f } ); // as glClearColor() in main()
+
+		std::vector<Mat44f> world( scene.nodes.size() );
+		for( std::size_t i = 0; i < scene.nodes.size(); ++i )
+		{
+			auto const& node = scene.nodes[i];
+			world[i] = kNoSceneIndex == node.parent ? node.transform : world[node.parent] * node.transform;
+			if( kNoSceneIndex == node.mesh )
+				continue;
+
+			auto const& mesh = scene.meshes[node.mesh];
+			SoftTexture const* texture = kNoSceneIndex != mesh.material ? materialTextures[mesh.material] : nullptr;
+			render_model( raster, mesh.data, projection, world2camera, world[i], texture, mesh.data.positions.size() );
+		}
+
+		raster.finish();
+
+		float const seconds = std::chrono::duration_cast<Secondsf>(Clock::now()-start).count();
+		std::printf( "Software render: %zu triangles, %.1f ms (%u threads)\n", raster.triangle_count(), seconds * 1e3f, pool.thread_count() );
+
+		save_png( aOutput, raster.width(), raster.height(), raster.color() );
+	}
+
+	void compress_mesh_( char const* aInput, char const* aOutput )
+	{
+		auto const loadStart = Clock::now();
+		SimpleMeshData const mesh = load_wavefront_obj( aInput );
+		float const loadTime = std::chrono::duration_cast<Secondsf>(Clock::now()-loadStart).count();
+
+		MeshCodecStats stats;
+		save_compressed_mesh( mesh, aOutput, true, &stats );
+
+		// Reload, to see what the conversion buys
+		auto const reloadStart = Clock::now();
+		load_compressed_mesh( aOutput );
+		float const reloadTime = std::chrono::duration_cast<Secondsf>(Clock::now()-reloadStart).count();
+
+		double const inputSize = double(std::filesystem::file_size( aInput ));
+		std::printf( "Compressed '%s' to '%s': %zu vertices (%zu unique), %.1f kB -> %.1f kB (indices %.1f kB, vertices %.1f kB)\n",
+			aInput, aOutput, stats.vertices, stats.uniqueVertices,
+			inputSize / 1024., double(stats.totalBytes) / 1024., double(stats.indexBytes) / 1024., double(stats.vertexBytes) / 1024.
+		);
+		std::printf( "Load time: %.2f ms -> %.2f ms\n", loadTime * 1e3, reloadTime * 1e3 );
 	}
 }
 
@@ -0,0 +1,636 @@
+#include "mesh_codec.hpp"
+
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+#include <stb_image.h>
+
+#include "../support/error.hpp"
+
+#include "vertex_quant.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#	include <emmintrin.h>
+#	define MESH_CODEC_SSE2_ 1
+#endif
+
+// Part of stb_image_write's implementation, but not declared in its header
+extern "C" unsigned char* stbi_zlib_compress( unsigned char* aData, int aDataLength, int* aOutLength, int aQuality );
+
+namespace
+{
+	// File format: header, then the index and vertex sections. Each section
+	// is prefixed with its decoded and its stored size. All values are in
+	// native byte order.
+	constexpr char kMeshMagic_[4] = { 'M', 'S', 'H', 'Z' };
+	constexpr std::uint32_t kMeshVersion_ = 1;
+
+	constexpr std::uint32_t kFlagDeflate_ = 1u << 0;
+
+	// Per vertex in the vertex section: seven 16-bit streams (position xyz,
+	// normal xy, texcoord uv), then three 8-bit ones (color rgb).
+	constexpr std::size_t kStreams16_ = 7;
+	constexpr std::size_t kStreams8_ = 3;
+	constexpr std::size_t kVertexStreamBytes_ = 2*kStreams16_ + kStreams8_;
+
+	constexpr int kDeflateQuality_ = 8; // stb's default for PNGs
+
+	constexpr float kUnorm16_ = 65535.f;
+	constexpr float kSnorm16_ = 32767.f;
+
+	// Quantized vertex, for merging duplicates
+	struct Key_
+	{
+		std::uint64_t position; // xyz, 16 bits each
+		std::uint64_t normalTexcoord;
+		std::uint32_t color;
+
+		bool operator== (Key_ const&) const = default;
+	};
+	struct KeyHash_
+	{
+		std::size_t operator() (Key_ const& aKey) const noexcept
+		{
+			std::uint64_t h = aKey.position * 0x9e3779b97f4a7c15ull;
+			h = (h ^ (h >> 29) ^ aKey.normalTexcoord) * 0xbf58476d1ce4e5b9ull;
+			h = (h ^ (h >> 32) ^ aKey.color) * 0x94d049bb133111ebull;
+			return std::size_t(h ^ (h >> 31));
+		}
+	};
+
+	std::uint16_t zigzag16_( std::uint16_t aDelta ) noexcept
+	{
+		auto const d = std::int16_t(aDelta);
+		return std::uint16_t((std::uint16_t(d) << 1) ^ std::uint16_t(d >> 15));
+	}
+	std::uint32_t zigzag32_( std::uint32_t aDelta ) noexcept
+	{
+		auto const d = std::int32_t(aDelta);
+		return (std::uint32_t(d) << 1) ^ std::uint32_t(d >> 31);
+	}
+
+	void write_varint_( std::vector<std::uint8_t>& aOut, std::uint32_t aValue )
+	{
+		while( aValue >= 0x80 )
+		{
+			aOut.emplace_back( std::uint8_t(aValue | 0x80) );
+			aValue >>= 7;
+		}
+		aOut.emplace_back( std::uint8_t(aValue) );
+	}
+
+	template< typename tType >
+	void write_( std::vector<std::uint8_t>& aOut, tType const& aValue )
+	{
+		auto const* bytes = reinterpret_cast<std::uint8_t const*>(&aValue);
+		aOut.insert( aOut.end(), bytes, bytes + sizeof(tType) );
+	}
+
+	std::vector<std::uint8_t> deflate_( std::vector<std::uint8_t>& aData )
+	{
+		if( aData.empty() )
+			return {};
+		if( aData.size() > std::size_t(std::numeric_limits<int>::max()) )
+			throw Error( "Compressed mesh: section of %zu bytes is too large to deflate", aData.size() );
+
+		int size = 0;
+		unsigned char* packed = stbi_zlib_compress( aData.data(), int(aData.size()), &size, kDeflateQuality_ );
+		if( !packed )
+			throw Error( "Compressed mesh: deflate failed" );
+
+		std::vector<std::uint8_t> ret( packed, packed + size );
+		std::free( packed );
+		return ret;
+	}
+
+	void write_section_( std::vector<std::uint8_t>& aOut, std::vector<std::uint8_t>& aData, bool aDeflate, std::size_t& aStoredBytes )
+	{
+		write_( aOut, std::uint64_t(aData.size()) );
+		if( aDeflate )
+		{
+			auto const packed = deflate_( aData );
+			write_( aOut, std::uint64_t(packed.size()) );
+			aOut.insert( aOut.end(), packed.begin(), packed.end() );
+			aStoredBytes = packed.size();
+		}
+		else
+		{
+			write_( aOut, std::uint64_t(aData.size()) );
+			aOut.insert( aOut.end(), aData.begin(), aData.end() );
+			aStoredBytes = aData.size();
+		}
+	}
+
+	class Reader_
+	{
+		public:
+			Reader_( void const* aData, std::size_t aSize )
+				: mPos( static_cast<std::uint8_t const*>(aData) )
+				, mEnd( mPos + aSize )
+			{}
+
+			std::uint8_t const* bytes( std::uint64_t aCount )
+			{
+				if( aCount > std::uint64_t(mEnd - mPos) )
+					throw Error( "Compressed mesh: unexpected end of data" );
+
+				auto const* ret = mPos;
+				mPos += aCount;
+				return ret;
+			}
+
+			template< typename tType >
+			tType value()
+			{
+				tType ret;
+				std::memcpy( &ret, bytes( sizeof(tType) ), sizeof(tType) );
+				return ret;
+			}
+
+		private:
+			std::uint8_t const* mPos;
+			std::uint8_t const* mEnd;
+	};
+
+	// Returns the section's decoded bytes (aSize of them): either in place,
+	// or inflated into aBuffer.
+	std::uint8_t const* read_section_( Reader_& aIn, bool aDeflated, std::vector<std::uint8_t>& aBuffer, std::size_t& aSize )
+	{
+		auto const size = aIn.value<std::uint64_t>();
+		auto const stored = aIn.value<std::uint64_t>();
+		auto const* data = aIn.bytes( stored ); // so stored fits into a size_t
+		aSize = std::size_t(stored);
+
+		if( !aDeflated || 0 == size )
+		{
+			if( stored != size )
+				throw Error( "Compressed mesh: section size mismatch" );
+			return data;
+		}
+
+		auto constexpr kMaxInt = std::uint64_t(std::numeric_limits<int>::max());
+		if( size > kMaxInt || stored > kMaxInt )
+			throw Error( "Compressed mesh: section too large" );
+
+		aSize = std::size_t(size);
+		aBuffer.resize( aSize );
+		int const got = stbi_zlib_decode_buffer( reinterpret_cast<char*>(aBuffer.data()), int(size), reinterpret_cast<char const*>(data), int(stored) );
+		if( got < 0 || std::uint64_t(got) != size )
+			throw Error( "Compressed mesh: corrupt deflate stream" );
+
+		return aBuffer.data();
+	}
+
+#	if defined(MESH_CODEC_SSE2_)
+	// Undoes the zigzag and delta coding of eight values: a prefix sum in
+	// three steps, plus the last value of the previous group (in all lanes
+	// of aCarry). Returns the new carry.
+	__m128i decode8x16_( __m128i aValues, __m128i aCarry, std::uint16_t* aOut ) noexcept
+	{
+		__m128i const sign = _mm_sub_epi16( _mm_setzero_si128(), _mm_and_si128( aValues, _mm_set1_epi16( 1 ) ) );
+		__m128i v = _mm_xor_si128( _mm_srli_epi16( aValues, 1 ), sign );
+
+		v = _mm_add_epi16( v, _mm_slli_si128( v, 2 ) );
+		v = _mm_add_epi16( v, _mm_slli_si128( v, 4 ) );
+		v = _mm_add_epi16( v, _mm_slli_si128( v, 8 ) );
+		v = _mm_add_epi16( v, aCarry );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(aOut), v );
+
+		__m128i const last = _mm_shufflehi_epi16( v, 0xff );
+		return _mm_unpackhi_epi64( last, last );
+	}
+#	endif // ~ MESH_CODEC_SSE2_
+
+	// A 16-bit stream: aCount low bytes, then aCount high bytes
+	void decode_stream16_( std::uint8_t const* aData, std::size_t aCount, std::uint16_t* aOut ) noexcept
+	{
+		std::uint8_t const* lo = aData;
+		std::uint8_t const* hi = aData + aCount;
+
+		std::size_t i = 0;
+		std::uint16_t prev = 0;
+
+#		if defined(MESH_CODEC_SSE2_)
+		__m128i carry = _mm_setzero_si128();
+		for( ; i + 16 <= aCount; i += 16 )
+		{
+			__m128i const l = _mm_loadu_si128( reinterpret_cast<__m128i const*>(lo + i) );
+			__m128i const h = _mm_loadu_si128( reinterpret_cast<__m128i const*>(hi + i) );
+			carry = decode8x16_( _mm_unpacklo_epi8( l, h ), carry, aOut + i );
+			carry = decode8x16_( _mm_unpackhi_epi8( l, h ), carry, aOut + i + 8 );
+		}
+		prev = std::uint16_t(_mm_cvtsi128_si32( carry ));
+#		endif // ~ MESH_CODEC_SSE2_
+
+		for( ; i < aCount; ++i )
+		{
+			auto const z = std::uint16_t(lo[i] | (hi[i] << 8));
+			prev = std::uint16_t(prev + ((z >> 1) ^ (0u - (z & 1u))));
+			aOut[i] = prev;
+		}
+	}
+
+	// An 8-bit stream (delta coded only)
+	void decode_stream8_( std::uint8_t const* aData, std::size_t aCount, std::uint8_t* aOut ) noexcept
+	{
+		std::size_t i = 0;
+		std::uint8_t prev = 0;
+
+#		if defined(MESH_CODEC_SSE2_)
+		__m128i carry = _mm_setzero_si128();
+		for( ; i + 16 <= aCount; i += 16 )
+		{
+			__m128i v = _mm_loadu_si128( reinterpret_cast<__m128i const*>(aData + i) );
+			v = _mm_add_epi8( v, _mm_slli_si128( v, 1 ) );
+			v = _mm_add_epi8( v, _mm_slli_si128( v, 2 ) );
+			v = _mm_add_epi8( v, _mm_slli_si128( v, 4 ) );
+			v = _mm_add_epi8( v, _mm_slli_si128( v, 8 ) );
+			v = _mm_add_epi8( v, carry );
+			_mm_storeu_si128( reinterpret_cast<__m128i*>(aOut + i), v );
+
+			__m128i const last = _mm_shufflehi_epi16( _mm_unpackhi_epi8( v, v ), 0xff );
+			carry = _mm_unpackhi_epi64( last, last );
+		}
+		prev = std::uint8_t(_mm_cvtsi128_si32( carry ));
+#		endif // ~ MESH_CODEC_SSE2_
+
+		for( ; i < aCount; ++i )
+		{
+			prev = std::uint8_t(prev + aData[i]);
+			aOut[i] = prev;
+		}
+	}
+
+	// The conversions to float are written such that the compiler
+	// vectorizes them, and such that they give the same results as
+	// decode_position() etc.
+	void dequantize_( std::size_t aCount, std::uint16_t const* __restrict aIn, float aOffset, float aScale, float* __restrict aOut ) noexcept
+	{
+		for( std::size_t i = 0; i < aCount; ++i )
+			aOut[i] = aOffset + aScale * (float(aIn[i]) / kUnorm16_);
+	}
+
+	// The compiler does not vectorize the octahedral decode (the selects and
+	// the three output streams), so the SSE2 version is spelled out. It
+	// performs the same operations in the same order as the scalar loop and
+	// decode_normal(). This file and vertex_quant.cpp are compiled without
+	// floating point contraction (see premake5.lua), so that the scalar
+	// code is not fused into FMAs, and all give identical results.
+	void decode_normals_( std::size_t aCount, std::uint16_t const* __restrict aX, std::uint16_t const* __restrict aY, float* __restrict aNX, float* __restrict aNY, float* __restrict aNZ ) noexcept
+	{
+		std::size_t i = 0;
+
+#		if defined(MESH_CODEC_SSE2_)
+		__m128 const one = _mm_set1_ps( 1.f );
+		__m128 const minusOne = _mm_set1_ps( -1.f );
+		__m128 const snorm = _mm_set1_ps( kSnorm16_ );
+		__m128 const signBit = _mm_set1_ps( -0.f );
+
+		auto const load = [&] (std::uint16_t const* aIn) {
+			__m128i const v = _mm_loadl_epi64( reinterpret_cast<__m128i const*>(aIn) );
+			__m128i const s = _mm_srai_epi32( _mm_unpacklo_epi16( v, v ), 16 ); // sign extend
+			return _mm_max_ps( _mm_div_ps( _mm_cvtepi32_ps( s ), snorm ), minusOne );
+		};
+		auto const select = [] (__m128 aMask, __m128 aA, __m128 aB) {
+			return _mm_or_ps( _mm_and_ps( aMask, aA ), _mm_andnot_ps( aMask, aB ) );
+		};
+
+		for( ; i + 4 <= aCount; i += 4 )
+		{
+			__m128 const ex = load( aX + i );
+			__m128 const ey = load( aY + i );
+			__m128 const ax = _mm_andnot_ps( signBit, ex );
+			__m128 const ay = _mm_andnot_ps( signBit, ey );
+
+			__m128 const z = _mm_sub_ps( _mm_sub_ps( one, ax ), ay );
+			__m128 const fx = _mm_mul_ps( _mm_sub_ps( one, ay ), select( _mm_cmpge_ps( ex, _mm_setzero_ps() ), one, minusOne ) );
+			__m128 const fy = _mm_mul_ps( _mm_sub_ps( one, ax ), select( _mm_cmpge_ps( ey, _mm_setzero_ps() ), one, minusOne ) );
+			__m128 const fold = _mm_cmplt_ps( z, _mm_setzero_ps() );
+			__m128 const x = select( fold, fx, ex );
+			__m128 const y = select( fold, fy, ey );
+
+			__m128 const len = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) );
+			_mm_storeu_ps( aNX + i, _mm_div_ps( x, len ) );
+			_mm_storeu_ps( aNY + i, _mm_div_ps( y, len ) );
+			_mm_storeu_ps( aNZ + i, _mm_div_ps( z, len ) );
+		}
+#		endif // ~ MESH_CODEC_SSE2_
+
+		for( ; i < aCount; ++i )
+		{
+			float const ex = std::max( float(std::int16_t(aX[i])) / kSnorm16_, -1.f );
+			float const ey = std::max( float(std::int16_t(aY[i])) / kSnorm16_, -1.f );
+
+			// Both sides are computed, so that the selects need no branches.
+			float const z = 1.f - std::abs( ex ) - std::abs( ey );
+			float const fx = (1.f - std::abs( ey )) * (ex >= 0.f ? 1.f : -1.f);
+			float const fy = (1.f - std::abs( ex )) * (ey >= 0.f ? 1.f : -1.f);
+			float const x = z < 0.f ? fx : ex;
+			float const y = z < 0.f ? fy : ey;
+
+			float const len = std::sqrt( x*x + y*y + z*z );
+			aNX[i] = x / len;
+			aNY[i] = y / len;
+			aNZ[i] = z / len;
+		}
+	}
+
+	// Expands the triangles, one attribute at a time, so that the gathers
+	// stay within a few arrays.
+	template< typename tAttribute, typename tFetch >
+	void expand_( std::vector<std::uint32_t> const& aIndices, std::pmr::vector<tAttribute>& aOut, tFetch const& aFetch )
+	{
+		aOut.reserve( aIndices.size() );
+		for( auto const index : aIndices )
+			aOut.emplace_back( aFetch( index ) );
+	}
+
+	// Variable length integers; one byte for most indices
+	void decode_indices_( std::uint8_t const* aData, std::size_t aSize, std::size_t aCount, std::uint32_t aVertices, std::uint32_t* aOut )
+	{
+		std::uint8_t const* pos = aData;
+		std::uint8_t const* const end = aData + aSize;
+
+		std::uint32_t index = 0, outOfRange = 0;
+		for( std::size_t i = 0; i < aCount; ++i )
+		{
+			if( pos == end )
+				throw Error( "Compressed mesh: truncated index data" );
+
+			std::uint32_t z = *pos++;
+			if( z & 0x80 )
+			{
+				z &= 0x7f;
+				for( unsigned shift = 7; ; shift += 7 )
+				{
+					if( pos == end || shift > 28 )
+						throw Error( "Compressed mesh: corrupt index data" );
+
+					std::uint8_t const byte = *pos++;
+					z |= std::uint32_t(byte & 0x7f) << shift;
+					if( !(byte & 0x80) )
+						break;
+				}
+			}
+
+			index += (z >> 1) ^ (0u - (z & 1u));
+			outOfRange |= index >= aVertices;
+			aOut[i] = index;
+		}
+
+		if( outOfRange )
+			throw Error( "Compressed mesh: index out of range" );
+		if( pos != end )
+			throw Error( "Compressed mesh: trailing index data" );
+	}
+
+	std::array<float,256> const& srgb_decode_()
+	{
+		static auto const table = [] {
+			std::array<float,256> ret;
+			for( std::size_t i = 0; i < ret.size(); ++i )
+				ret[i] = decode_color( std::uint32_t(i) ).x;
+			return ret;
+		}();
+		return table;
+	}
+}
+
+std::vector<std::uint8_t> encode_mesh( SimpleMeshData const& aMesh, bool aDeflate, MeshCodecStats* aStats )
+{
+	QuantizedVertices quantized;
+	VertexDecode const decode = quantize_mesh( aMesh, quantized );
+	auto const count = quantized.size();
+
+	if( count > std::numeric_limits<std::uint32_t>::max() )
+		throw Error( "Compressed mesh: too many vertices (%zu)", count );
+
+	// Merge identical vertices. They are numbered in order of first use.
+	std::unordered_map<Key_, std::uint32_t, KeyHash_> ids;
+	ids.reserve( count );
+
+	std::vector<std::uint32_t> unique; // first use
+	std::vector<std::uint8_t> indexData;
+	indexData.reserve( count );
+
+	std::uint32_t prevIndex = 0;
+	for( std::size_t i = 0; i < count; ++i )
+	{
+		auto const* p = quantized.positions.data() + 4*i;
+		Key_ const key{
+			std::uint64_t(p[0]) | (std::uint64_t(p[1]) << 16) | (std::uint64_t(p[2]) << 32),
+			std::uint64_t(quantized.normals[i]) | (std::uint64_t(quantized.texcoords[i]) << 32),
+			quantized.colors[i]
+		};
+
+		auto const [it, inserted] = ids.try_emplace( key, std::uint32_t(unique.size()) );
+		if( inserted )
+			unique.emplace_back( std::uint32_t(i) );
+
+		write_varint_( indexData, zigzag32_( it->second - prevIndex ) );
+		prevIndex = it->second;
+	}
+
+	// Vertex streams
+	auto const n = unique.size();
+	std::vector<std::uint8_t> vertexData( n * kVertexStreamBytes_ );
+	auto* out = vertexData.data();
+
+	auto const stream16 = [&] (auto&& aComponent) {
+		std::uint16_t prev = 0;
+		for( std::size_t k = 0; k < n; ++k )
+		{
+			std::uint16_t const value = aComponent( unique[k] );
+			std::uint16_t const z = zigzag16_( std::uint16_t(value - prev) );
+			out[k] = std::uint8_t(z);
+			out[n+k] = std::uint8_t(z >> 8);
+			prev = value;
+		}
+		out += 2*n;
+	};
+	auto const stream8 = [&] (auto&& aComponent) {
+		std::uint8_t prev = 0;
+		for( std::size_t k = 0; k < n; ++k )
+		{
+			std::uint8_t const value = aComponent( unique[k] );
+			out[k] = std::uint8_t(value - prev);
+			prev = value;
+		}
+		out += n;
+	};
+
+	for( std::size_t c = 0; c < 3; ++c )
+		stream16( [&] (std::size_t aI) { return quantized.positions[4*aI+c]; } );
+
+	stream16( [&] (std::size_t aI) { return std::uint16_t(quantized.normals[aI]); } );
+	stream16( [&] (std::size_t aI) { return std::uint16_t(quantized.normals[aI] >> 16); } );
+	stream16( [&] (std::size_t aI) { return std::uint16_t(quantized.texcoords[aI]); } );
+	stream16( [&] (std::size_t aI) { return std::uint16_t(quantized.texcoords[aI] >> 16); } );
+
+	for( std::size_t c = 0; c < 3; ++c )
+		stream8( [&] (std::size_t aI) { return std::uint8_t(quantized.colors[aI] >> (8*c)); } );
+
+	assert( out == vertexData.data() + vertexData.size() );
+
+	// Write
+	std::vector<std::uint8_t> ret;
+	ret.reserve( 128 + indexData.size() + vertexData.size() );
+	write_( ret, kMeshMagic_ );
+	write_( ret, kMeshVersion_ );
+	write_( ret, std::uint32_t(aDeflate ? kFlagDeflate_ : 0) );
+	write_( ret, std::uint64_t(count) );
+	write_( ret, std::uint64_t(n) );
+	write_( ret, decode );
+
+	MeshCodecStats stats;
+	write_section_( ret, indexData, aDeflate, stats.indexBytes );
+	write_section_( ret, vertexData, aDeflate, stats.vertexBytes );
+
+	if( aStats )
+	{
+		stats.vertices = count;
+		stats.uniqueVertices = n;
+		stats.totalBytes = ret.size();
+		*aStats = stats;
+	}
+
+	return ret;
+}
+
+SimpleMeshData decode_mesh( void const* aData, std::size_t aSize, std::pmr::memory_resource* aResource )
+{
+	Reader_ in( aData, aSize );
+
+	char magic[4];
+	std::memcpy( magic, in.bytes( sizeof(magic) ), sizeof(magic) );
+	if( 0 != std::memcmp( magic, kMeshMagic_, sizeof(magic) ) )
+		throw Error( "Compressed mesh: bad magic" );
+
+	if( auto const version = in.value<std::uint32_t>(); kMeshVersion_ != version )
+		throw Error( "Compressed mesh: version %u, expected %u", version, kMeshVersion_ );
+
+	auto const flags = in.value<std::uint32_t>();
+	if( flags & ~kFlagDeflate_ )
+		throw Error( "Compressed mesh: unknown flags %x", flags );
+	bool const deflated = flags & kFlagDeflate_;
+
+	auto const count = in.value<std::uint64_t>();
+	auto const unique = in.value<std::uint64_t>();
+	auto const decode = in.value<VertexDecode>();
+
+	// Each index takes at least one byte; sanity checks before allocating.
+	if( unique > count || count > std::numeric_limits<std::uint32_t>::max() || count > aSize * 1024 )
+		throw Error( "Compressed mesh: bad vertex counts (%llu, %llu)", static_cast<unsigned long long>(count), static_cast<unsigned long long>(unique) );
+
+	auto const n = std::size_t(unique);
+
+	std::vector<std::uint8_t> indexBuffer, vertexBuffer;
+	std::size_t indexSize = 0, vertexSize = 0;
+	auto const* indexBytes = read_section_( in, deflated, indexBuffer, indexSize );
+	auto const* vertexBytes = read_section_( in, deflated, vertexBuffer, vertexSize );
+
+	if( vertexSize != n * kVertexStreamBytes_ )
+		throw Error( "Compressed mesh: vertex section has %zu bytes, expected %zu", vertexSize, n * kVertexStreamBytes_ );
+
+	// Vertex streams, into one array per component
+	enum { px, py, pz, nx, ny, nz, u, v, r, g, b, kComponents };
+	std::vector<float> components( kComponents * n );
+	auto const component = [&] (std::size_t aIndex) { return components.data() + aIndex * n; };
+
+	std::vector<std::uint16_t> q16( 2*n );
+	std::vector<std::uint8_t> q8( n );
+	auto const* stream = vertexBytes;
+
+	Vec3f const positionOffset = decode.positionOffset, positionScale = decode.positionScale;
+	float const offsets[] = { positionOffset.x, positionOffset.y, positionOffset.z };
+	float const scales[] = { positionScale.x, positionScale.y, positionScale.z };
+	for( std::size_t c = 0; c < 3; ++c, stream += 2*n )
+	{
+		decode_stream16_( stream, n, q16.data() );
+		dequantize_( n, q16.data(), offsets[c], scales[c], component( px+c ) );
+	}
+
+	decode_stream16_( stream, n, q16.data() );
+	stream += 2*n;
+	decode_stream16_( stream, n, q16.data() + n );
+	stream += 2*n;
+	decode_normals_( n, q16.data(), q16.data() + n, component( nx ), component( ny ), component( nz ) );
+
+	decode_stream16_( stream, n, q16.data() );
+	stream += 2*n;
+	dequantize_( n, q16.data(), decode.texcoordOffset.x, decode.texcoordScale.x, component( u ) );
+	decode_stream16_( stream, n, q16.data() );
+	stream += 2*n;
+	dequantize_( n, q16.data(), decode.texcoordOffset.y, decode.texcoordScale.y, component( v ) );
+
+	auto const& srgb = srgb_decode_();
+	for( std::size_t c = 0; c < 3; ++c, stream += n )
+	{
+		decode_stream8_( stream, n, q8.data() );
+		float* out = component( r+c );
+		for( std::size_t i = 0; i < n; ++i )
+			out[i] = srgb[q8[i]];
+	}
+
+	// Expand the triangles
+	std::vector<std::uint32_t> indices( count );
+	decode_indices_( indexBytes, indexSize, indices.size(), std::uint32_t(n), indices.data() );
+
+	float const* c[kComponents];
+	for( std::size_t i = 0; i < kComponents; ++i )
+		c[i] = component( i );
+
+	SimpleMeshData ret( aResource );
+	expand_( indices, ret.positions, [&] (std::uint32_t aI) { return Vec3f{ c[px][aI], c[py][aI], c[pz][aI] }; } );
+	expand_( indices, ret.colors, [&] (std::uint32_t aI) { return Vec3f{ c[r][aI], c[g][aI], c[b][aI] }; } );
+	expand_( indices, ret.normals, [&] (std::uint32_t aI) { return Vec3f{ c[nx][aI], c[ny][aI], c[nz][aI] }; } );
+	expand_( indices, ret.texcoords, [&] (std::uint32_t aI) { return Vec2f{ c[u][aI], c[v][aI] }; } );
+
+	return ret;
+}
+
+void save_compressed_mesh( SimpleMeshData const& aMesh, char const* aPath, bool aDeflate, MeshCodecStats* aStats )
+{
+	auto const data = encode_mesh( aMesh, aDeflate, aStats );
+
+	std::FILE* fout = std::fopen( aPath, "wb" );
+	if( !fout )
+		throw Error( "Unable to open '%s' for writing", aPath );
+
+	bool const ok = data.size() == std::fwrite( data.data(), 1, data.size(), fout );
+	bool const closed = 0 == std::fclose( fout );
+	if( !ok || !closed )
+		throw Error( "Unable to write compressed mesh '%s'", aPath );
+}
+
+SimpleMeshData load_compressed_mesh( char const* aPath, std::pmr::memory_resource* aResource )
+{
+	std::FILE* fin = std::fopen( aPath, "rb" );
+	if( !fin )
+		throw Error( "Unable to open compressed mesh '%s'", aPath );
+
+	// One read for the whole file
+	std::vector<std::uint8_t> data;
+	bool ok = 0 == std::fseek( fin, 0, SEEK_END );
+	if( long const size = ok ? std::ftell( fin ) : -1; size >= 0 )
+	{
+		data.resize( std::size_t(size) );
+		std::rewind( fin );
+		ok = data.size() == std::fread( data.data(), 1, data.size(), fin );
+	}
+	else
+		ok = false;
+
+	std::fclose( fin );
+	if( !ok )
+		throw Error( "Unable to read compressed mesh '%s'", aPath );
+
+	return decode_mesh( data.data(), data.size(), aResource );
+}
@@ -0,0 +1,54 @@
+#ifndef MESH_CODEC_HPP_8D41F6A3_2C95_4B7E_9E03_D7A5C16B48F2
+#define MESH_CODEC_HPP_8D41F6A3_2C95_4B7E_9E03_D7A5C16B48F2
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "simple_mesh.hpp"
+
+// Extension of compressed mesh files. load_wavefront_obj() loads these, too.
+constexpr char const* kCompressedMeshExtension = ".meshz";
+
+struct MeshCodecStats
+{
+	std::size_t vertices = 0; // three per triangle
+	std::size_t uniqueVertices = 0; // after quantization
+	std::size_t indexBytes = 0; // as stored
+	std::size_t vertexBytes = 0; // as stored
+	std::size_t totalBytes = 0;
+};
+
+/* Compressed mesh format
+ *
+ * A compact, quickly decoded replacement for OBJ files:
+ *  - The attributes are quantized as for the GPU (see QuantizedVertices).
+ *    Vertices that are identical after quantization are merged, and the
+ *    triangles index the remaining ones.
+ *  - Indices are delta coded (relative to the previous index), zigzag coded
+ *    and stored as variable length integers (LEB128). Vertices are numbered
+ *    in order of first use, so most deltas fit into a byte.
+ *  - Each vertex component is a separate stream, delta coded (relative to
+ *    the previous vertex) and zigzag coded. 16-bit streams are stored byte
+ *    transposed: all low bytes, then all high bytes. Neighbouring vertices
+ *    are usually close, so the high bytes are mostly zero.
+ *  - Optionally, both sections are deflated (zlib). The transformations
+ *    above leave data that compresses well.
+ *
+ * Decoding undoes the integer transformations with SSE2 (where available)
+ * and converts the vertices to floats in loops that the compiler
+ * vectorizes; the triangles are then expanded into SimpleMeshData. The
+ * result is exactly what the FEATURE_QUANTIZED shaders see of the same
+ * mesh (decode_position() etc.).
+ *
+ * Encoding is lossy: positions are accurate to 1/65535 of the mesh's extent
+ * per axis, normals to about 0.01 degrees, colors to 8-bit sRGB.
+ */
+std::vector<std::uint8_t> encode_mesh( SimpleMeshData const&, bool aDeflate = true, MeshCodecStats* = nullptr );
+SimpleMeshData decode_mesh( void const* aData, std::size_t aSize, std::pmr::memory_resource* = std::pmr::get_default_resource() );
+
+void save_compressed_mesh( SimpleMeshData const&, char const* aPath, bool aDeflate = true, MeshCodecStats* = nullptr );
+SimpleMeshData load_compressed_mesh( char const* aPath, std::pmr::memory_resource* = std::pmr::get_default_resource() );
+
+#endif // MESH_CODEC_HPP_8D41F6A3_2C95_4B7E_9E03_D7A5C16B48F2
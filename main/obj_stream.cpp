@@ -0,0 +1,748 @@
+#include "obj_stream.hpp"
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <string_view>
+
+#include <cstring>
+#include <cassert>
+
+#include "../support/error.hpp"
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	// Mesh cache: header, then blocks of { count, positions, colors,
+	// normals, texcoords }, terminated by an empty block. The material
+	// libraries come last (count and length-prefixed paths), followed by the
+	// size of that list, so that it can be found from the end of the file.
+	// Native byte order.
+	constexpr char kCacheMagic_[4] = { 'M', 'S', 'H', 'B' };
+	constexpr std::uint32_t kCacheVersion_ = 2;
+
+	struct CacheHeader_
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t vertices;
+		Vec3f min, max;
+	};
+
+	// Reference to a v/vt/vn attribute (zero based, -1 if absent). Negative
+	// OBJ indices count back from the attributes read so far. A slice does
+	// not know how many attributes the slices before it contain until all
+	// have been parsed, so those are stored relative to the slice's first
+	// attribute (local) and fixed up during expansion.
+	struct Ref_
+	{
+		std::int64_t index;
+		bool local;
+	};
+
+	struct Corner_
+	{
+		Ref_ v, t, n;
+	};
+
+	struct Face_
+	{
+		std::uint32_t first; // into Slice_::corners
+		std::uint32_t count;
+		std::int32_t material; // into Slice_::materials; -1: as before the slice
+	};
+
+	// A part of a chunk, parsed by one thread
+	struct Slice_
+	{
+		char const* begin;
+		char const* end;
+		std::uint64_t offset; // in the file, for error messages
+
+		std::vector<Vec3f> positions, normals;
+		std::vector<Vec2f> texcoords;
+
+		std::vector<Corner_> corners;
+		std::vector<Face_> faces;
+		std::vector<std::string> materials; // usemtl, in order
+		std::vector<std::string> libraries; // mtllib, in order
+
+		Vec3f min, max;
+
+		// Set between parsing and expansion
+		std::size_t basePositions, baseTexcoords, baseNormals;
+		std::vector<Vec3f> colors; // per entry of materials
+		Vec3f startColor;
+		std::size_t firstVertex; // in the chunk's output
+		std::size_t vertices;
+
+		void clear()
+		{
+			positions.clear();
+			normals.clear();
+			texcoords.clear();
+			corners.clear();
+			faces.clear();
+			materials.clear();
+			libraries.clear();
+			colors.clear();
+		}
+	};
+
+	struct Material_
+	{
+		std::string name;
+		Vec3f ambient;
+	};
+
+	[[noreturn]] void malformed_( char const* aPath, Slice_ const& aSlice, char const* aAt )
+	{
+		auto const offset = aSlice.offset + std::uint64_t(aAt - aSlice.begin);
+		throw Error( "OBJ '%s': malformed line near byte %llu", aPath, static_cast<unsigned long long>(offset) );
+	}
+
+	char const* skip_space_( char const* aPtr, char const* aEnd ) noexcept
+	{
+		while( aPtr != aEnd && (' ' == *aPtr || '\t' == *aPtr || '\r' == *aPtr) )
+			++aPtr;
+		return aPtr;
+	}
+
+	std::string_view rest_of_line_( char const* aPtr, char const* aEnd ) noexcept
+	{
+		aPtr = skip_space_( aPtr, aEnd );
+		while( aEnd != aPtr && (' ' == aEnd[-1] || '\t' == aEnd[-1] || '\r' == aEnd[-1]) )
+			--aEnd;
+		return std::string_view( aPtr, std::size_t(aEnd - aPtr) );
+	}
+
+	bool parse_float_( char const*& aPtr, char const* aEnd, float& aOut ) noexcept
+	{
+		aPtr = skip_space_( aPtr, aEnd );
+		if( aPtr != aEnd && '+' == *aPtr )
+			++aPtr;
+
+		auto const [ptr, ec] = std::from_chars( aPtr, aEnd, aOut );
+		aPtr = ptr;
+		return std::errc() == ec;
+	}
+
+	// A face corner's index. Returns false if absent (empty).
+	bool parse_ref_( char const*& aPtr, char const* aEnd, std::size_t aCount, Ref_& aOut, bool& aValid ) noexcept
+	{
+		if( aPtr == aEnd || '/' == *aPtr || ' ' == *aPtr || '\t' == *aPtr || '\r' == *aPtr )
+			return false;
+
+		std::int64_t value = 0;
+		auto const [ptr, ec] = std::from_chars( aPtr, aEnd, value );
+		aPtr = ptr;
+
+		if( std::errc() != ec || 0 == value )
+			aValid = false;
+		else if( value > 0 )
+			aOut = Ref_{ value - 1, false };
+		else
+			aOut = Ref_{ std::int64_t(aCount) + value, true };
+		return true;
+	}
+
+	void parse_slice_( Slice_& aSlice, char const* aPath )
+	{
+		aSlice.min = Vec3f{ +1e30f, +1e30f, +1e30f };
+		aSlice.max = Vec3f{ -1e30f, -1e30f, -1e30f };
+
+		char const* line = aSlice.begin;
+		while( line != aSlice.end )
+		{
+			char const* eol = static_cast<char const*>(std::memchr( line, '\n', std::size_t(aSlice.end - line) ));
+			if( !eol )
+				eol = aSlice.end;
+
+			char const* p = skip_space_( line, eol );
+			char const* const keyword = p;
+			while( p != eol && ' ' != *p && '\t' != *p && '\r' != *p )
+				++p;
+
+			std::string_view const key( keyword, std::size_t(p - keyword) );
+
+			if( "v" == key )
+			{
+				Vec3f v;
+				if( !parse_float_( p, eol, v.x ) || !parse_float_( p, eol, v.y ) || !parse_float_( p, eol, v.z ) )
+					malformed_( aPath, aSlice, line );
+
+				aSlice.positions.emplace_back( v );
+				aSlice.min = Vec3f{ std::min( aSlice.min.x, v.x ), std::min( aSlice.min.y, v.y ), std::min( aSlice.min.z, v.z ) };
+				aSlice.max = Vec3f{ std::max( aSlice.max.x, v.x ), std::max( aSlice.max.y, v.y ), std::max( aSlice.max.z, v.z ) };
+			}
+			else if( "vt" == key )
+			{
+				Vec2f t;
+				if( !parse_float_( p, eol, t.x ) || !parse_float_( p, eol, t.y ) )
+					malformed_( aPath, aSlice, line );
+
+				aSlice.texcoords.emplace_back( t );
+			}
+			else if( "vn" == key )
+			{
+				Vec3f n;
+				if( !parse_float_( p, eol, n.x ) || !parse_float_( p, eol, n.y ) || !parse_float_( p, eol, n.z ) )
+					malformed_( aPath, aSlice, line );
+
+				aSlice.normals.emplace_back( n );
+			}
+			else if( "f" == key )
+			{
+				auto const first = aSlice.corners.size();
+				bool valid = true;
+
+				for( p = skip_space_( p, eol ); p != eol; p = skip_space_( p, eol ) )
+				{
+					Corner_ corner{ { -1, false }, { -1, false }, { -1, false } };
+					if( !parse_ref_( p, eol, aSlice.positions.size(), corner.v, valid ) )
+						valid = false;
+
+					if( p != eol && '/' == *p )
+					{
+						++p;
+						parse_ref_( p, eol, aSlice.texcoords.size(), corner.t, valid );
+
+						if( p != eol && '/' == *p )
+						{
+							++p;
+							parse_ref_( p, eol, aSlice.normals.size(), corner.n, valid );
+						}
+					}
+
+					if( !valid || (p != eol && ' ' != *p && '\t' != *p && '\r' != *p) )
+						malformed_( aPath, aSlice, line );
+
+					aSlice.corners.emplace_back( corner );
+				}
+
+				auto const count = aSlice.corners.size() - first;
+				if( count < 3 )
+					malformed_( aPath, aSlice, line );
+
+				auto const material = std::int32_t(aSlice.materials.size()) - 1;
+				aSlice.faces.emplace_back( Face_{ std::uint32_t(first), std::uint32_t(count), material } );
+			}
+			else if( "usemtl" == key )
+			{
+				aSlice.materials.emplace_back( rest_of_line_( p, eol ) );
+			}
+			else if( "mtllib" == key )
+			{
+				aSlice.libraries.emplace_back( rest_of_line_( p, eol ) );
+			}
+			// Everything else (comments, groups, smoothing groups, lines,
+			// points) does not affect the triangles.
+
+			line = eol == aSlice.end ? eol : eol+1;
+		}
+	}
+
+	// mtllib paths are relative to the OBJ file.
+	std::filesystem::path library_path_( char const* aObjPath, std::string const& aLibrary )
+	{
+		return std::filesystem::path( aObjPath ).parent_path() / aLibrary;
+	}
+
+	void load_materials_( char const* aObjPath, std::filesystem::path const& aLibraryPath, std::vector<Material_>& aMaterials )
+	{
+		std::FILE* fin = std::fopen( aLibraryPath.string().c_str(), "rb" );
+		if( !fin )
+			throw Error( "OBJ '%s': unable to open material library '%s'", aObjPath, aLibraryPath.string().c_str() );
+
+		std::string text;
+		char buffer[4096];
+		while( auto const read = std::fread( buffer, 1, sizeof(buffer), fin ) )
+			text.append( buffer, read );
+		std::fclose( fin );
+
+		Material_* current = nullptr;
+		for( std::size_t pos = 0; pos < text.size(); )
+		{
+			auto eol = text.find( '\n', pos );
+			if( std::string::npos == eol )
+				eol = text.size();
+
+			char const* p = skip_space_( text.data()+pos, text.data()+eol );
+			char const* const end = text.data()+eol;
+
+			if( 0 == std::strncmp( p, "newmtl", 6 ) && (end == p+6 || ' ' == p[6] || '\t' == p[6]) )
+			{
+				current = &aMaterials.emplace_back( Material_{ std::string( rest_of_line_( p+6, end ) ), Vec3f{ 0.f, 0.f, 0.f } } );
+			}
+			else if( current && 0 == std::strncmp( p, "Ka", 2 ) && end != p+2 && (' ' == p[2] || '\t' == p[2]) )
+			{
+				p += 2;
+				Vec3f& ka = current->ambient;
+				if( !parse_float_( p, end, ka.x ) || !parse_float_( p, end, ka.y ) || !parse_float_( p, end, ka.z ) )
+					throw Error( "Material library '%s': malformed 'Ka'", aLibraryPath.string().c_str() );
+			}
+
+			pos = eol+1;
+		}
+	}
+
+	Vec3f find_material_( std::vector<Material_> const& aMaterials, std::string const& aName, Vec3f aDefault ) noexcept
+	{
+		// Later definitions win, as in rapidobj.
+		for( auto it = aMaterials.rbegin(); it != aMaterials.rend(); ++it )
+		{
+			if( it->name == aName )
+				return it->ambient;
+		}
+		return aDefault;
+	}
+
+	// Triangles of a face: quads along the shorter diagonal (as rapidobj
+	// does), everything else as a fan.
+	template< typename tEmit >
+	void triangulate_( Face_ const& aFace, Vec3f const* aPositions, tEmit&& aEmit )
+	{
+		if( 4 == aFace.count )
+		{
+			Vec3f const e02 = aPositions[0] - aPositions[2];
+			Vec3f const e13 = aPositions[1] - aPositions[3];
+			float const d02 = e02.x*e02.x + e02.y*e02.y + e02.z*e02.z;
+			float const d13 = e13.x*e13.x + e13.y*e13.y + e13.z*e13.z;
+
+			if( d02 < d13 )
+			{
+				aEmit( 0, 1, 2 );
+				aEmit( 0, 2, 3 );
+			}
+			else
+			{
+				aEmit( 0, 1, 3 );
+				aEmit( 1, 2, 3 );
+			}
+			return;
+		}
+
+		for( std::uint32_t i = 1; i+1 < aFace.count; ++i )
+			aEmit( 0, i, i+1 );
+	}
+
+	struct Attributes_
+	{
+		std::vector<Vec3f> positions, normals;
+		std::vector<Vec2f> texcoords;
+	};
+
+	void expand_slice_( Slice_ const& aSlice, Attributes_ const& aAttribs, SimpleMeshData& aOut, char const* aPath )
+	{
+		auto const resolve = [&] (Ref_ aRef, std::size_t aBase, std::size_t aCount) -> std::int64_t {
+			if( aRef.index < 0 && !aRef.local )
+				return -1;
+
+			auto const index = aRef.local ? aRef.index + std::int64_t(aBase) : aRef.index;
+			if( index < 0 || index >= std::int64_t(aCount) )
+				throw Error( "OBJ '%s': index out of range near byte %llu", aPath, static_cast<unsigned long long>(aSlice.offset) );
+			return index;
+		};
+
+		std::size_t out = aSlice.firstVertex;
+		for( auto const& face : aSlice.faces )
+		{
+			Vec3f const color = face.material < 0 ? aSlice.startColor : aSlice.colors[std::size_t(face.material)];
+
+			// Faces have a handful of corners in practice.
+			constexpr std::uint32_t kMaxCorners = 64;
+			if( face.count > kMaxCorners )
+				throw Error( "OBJ '%s': face with more than %u corners near byte %llu", aPath, kMaxCorners, static_cast<unsigned long long>(aSlice.offset) );
+
+			Vec3f pos[kMaxCorners];
+			std::int64_t tex[kMaxCorners], nrm[kMaxCorners];
+			for( std::uint32_t i = 0; i < face.count; ++i )
+			{
+				auto const& corner = aSlice.corners[face.first + i];
+				pos[i] = aAttribs.positions[std::size_t(resolve( corner.v, aSlice.basePositions, aAttribs.positions.size() ))];
+				tex[i] = resolve( corner.t, aSlice.baseTexcoords, aAttribs.texcoords.size() );
+				nrm[i] = resolve( corner.n, aSlice.baseNormals, aAttribs.normals.size() );
+			}
+
+			triangulate_( face, pos, [&] (std::uint32_t aA, std::uint32_t aB, std::uint32_t aC) {
+				Vec3f faceNormal{ 0.f, 0.f, 0.f };
+				if( nrm[aA] < 0 || nrm[aB] < 0 || nrm[aC] < 0 )
+				{
+					Vec3f const n = cross( pos[aB] - pos[aA], pos[aC] - pos[aA] );
+					if( float const len = length( n ); len > 0.f )
+						faceNormal = n / len;
+				}
+
+				for( auto const i : { aA, aB, aC } )
+				{
+					aOut.positions[out] = pos[i];
+					aOut.colors[out] = color;
+					aOut.normals[out] = nrm[i] < 0 ? faceNormal : aAttribs.normals[std::size_t(nrm[i])];
+					aOut.texcoords[out] = tex[i] < 0 ? Vec2f{ 0.f, 0.f } : aAttribs.texcoords[std::size_t(tex[i])];
+					++out;
+				}
+			} );
+		}
+
+		assert( out == aSlice.firstVertex + aSlice.vertices );
+	}
+
+	std::size_t face_vertices_( Face_ const& aFace ) noexcept
+	{
+		return 3 * (aFace.count - 2);
+	}
+
+	void write_( std::FILE* aFile, void const* aData, std::size_t aSize, char const* aPath )
+	{
+		if( aSize != std::fwrite( aData, 1, aSize, aFile ) )
+			throw Error( "import_wavefront_obj(): unable to write '%s'", aPath );
+	}
+}
+
+ObjStreamStats stream_wavefront_obj( char const* aPath, ThreadPool& aPool, ObjChunkSink const& aSink, Vec3f aDefaultColor, std::size_t aChunkBytes )
+{
+	assert( aChunkBytes > 0 );
+
+	std::FILE* fin = std::fopen( aPath, "rb" );
+	if( !fin )
+		throw Error( "Unable to open OBJ file '%s'", aPath );
+
+	struct Closer_
+	{
+		std::FILE* file;
+		~Closer_() { std::fclose( file ); }
+	} closer{ fin };
+
+	ObjStreamStats stats;
+	stats.min = Vec3f{ +1e30f, +1e30f, +1e30f };
+	stats.max = Vec3f{ -1e30f, -1e30f, -1e30f };
+
+	Attributes_ attribs;
+	std::vector<Material_> materials;
+	std::vector<std::string> loadedLibraries;
+	Vec3f currentColor = aDefaultColor;
+
+	// Several slices per thread, since their sizes vary.
+	std::vector<Slice_> slices( std::size_t(aPool.thread_count()) * 4 );
+	SimpleMeshData output;
+
+	std::vector<char> buffer;
+	std::size_t carry = 0; // incomplete last line of the previous read
+	std::uint64_t offset = 0; // of buffer[0] in the file
+
+	for( bool eof = false; !eof; )
+	{
+		buffer.resize( carry + aChunkBytes );
+		auto const read = std::fread( buffer.data() + carry, 1, aChunkBytes, fin );
+		if( std::ferror( fin ) )
+			throw Error( "Error while reading OBJ file '%s'", aPath );
+
+		stats.bytes += read;
+		eof = read < aChunkBytes;
+
+		// Process complete lines only. A line longer than a chunk is grown
+		// until it fits.
+		std::size_t const size = carry + read;
+		std::size_t cut = size;
+		if( !eof )
+		{
+			auto const last = std::string_view( buffer.data(), size ).rfind( '\n' );
+			if( std::string_view::npos == last )
+			{
+				carry = size;
+				continue;
+			}
+			cut = last + 1;
+		}
+
+		// Parse
+		char const* const begin = buffer.data();
+		for( std::size_t i = 0, start = 0; i < slices.size(); ++i )
+		{
+			std::size_t stop = (i+1 == slices.size()) ? cut : std::max( start, cut * (i+1) / slices.size() );
+			if( stop < cut )
+			{
+				auto const* nl = static_cast<char const*>(std::memchr( begin + stop, '\n', cut - stop ));
+				stop = nl ? std::size_t(nl - begin) + 1 : cut;
+			}
+
+			auto& slice = slices[i];
+			slice.clear();
+			slice.begin = begin + start;
+			slice.end = begin + stop;
+			slice.offset = offset + start;
+			start = stop;
+		}
+
+		aPool.parallel_for( slices.size(), 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+			for( std::size_t i = aBegin; i < aEnd; ++i )
+				parse_slice_( slices[i], aPath );
+		} );
+
+		// Append the attributes and resolve the materials, in file order
+		std::size_t vertices = 0;
+		for( auto& slice : slices )
+		{
+			slice.basePositions = attribs.positions.size();
+			slice.baseTexcoords = attribs.texcoords.size();
+			slice.baseNormals = attribs.normals.size();
+
+			attribs.positions.insert( attribs.positions.end(), slice.positions.begin(), slice.positions.end() );
+			attribs.texcoords.insert( attribs.texcoords.end(), slice.texcoords.begin(), slice.texcoords.end() );
+			attribs.normals.insert( attribs.normals.end(), slice.normals.begin(), slice.normals.end() );
+
+			if( !slice.positions.empty() )
+			{
+				stats.min = Vec3f{ std::min( stats.min.x, slice.min.x ), std::min( stats.min.y, slice.min.y ), std::min( stats.min.z, slice.min.z ) };
+				stats.max = Vec3f{ std::max( stats.max.x, slice.max.x ), std::max( stats.max.y, slice.max.y ), std::max( stats.max.z, slice.max.z ) };
+			}
+
+			for( auto const& library : slice.libraries )
+			{
+				if( std::find( loadedLibraries.begin(), loadedLibraries.end(), library ) == loadedLibraries.end() )
+				{
+					auto const path = library_path_( aPath, library );
+					load_materials_( aPath, path, materials );
+					loadedLibraries.emplace_back( library );
+					stats.libraries.emplace_back( path.string() );
+				}
+			}
+
+			slice.startColor = currentColor;
+			for( auto const& name : slice.materials )
+				slice.colors.emplace_back( find_material_( materials, name, aDefaultColor ) );
+			if( !slice.colors.empty() )
+				currentColor = slice.colors.back();
+
+			slice.firstVertex = vertices;
+			slice.vertices = 0;
+			for( auto const& face : slice.faces )
+				slice.vertices += face_vertices_( face );
+			vertices += slice.vertices;
+		}
+
+		// Expand
+		output.positions.resize( vertices );
+		output.colors.resize( vertices );
+		output.normals.resize( vertices );
+		output.texcoords.resize( vertices );
+
+		aPool.parallel_for( slices.size(), 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+			for( std::size_t i = aBegin; i < aEnd; ++i )
+				expand_slice_( slices[i], attribs, output, aPath );
+		} );
+
+		if( vertices )
+			aSink( output );
+
+		stats.vertices += vertices;
+		++stats.chunks;
+
+		std::size_t const attribBytes = attribs.positions.capacity() * sizeof(Vec3f) + attribs.normals.capacity() * sizeof(Vec3f) + attribs.texcoords.capacity() * sizeof(Vec2f);
+		stats.peakAttributeBytes = std::max( stats.peakAttributeBytes, attribBytes );
+
+		// Keep the incomplete line
+		std::memmove( buffer.data(), buffer.data() + cut, size - cut );
+		carry = size - cut;
+		offset += cut;
+	}
+
+	if( attribs.positions.empty() )
+		stats.min = stats.max = Vec3f{ 0.f, 0.f, 0.f };
+
+	return stats;
+}
+
+ObjStreamStats import_wavefront_obj( char const* aObjPath, char const* aCachePath, ThreadPool& aPool, Vec3f aDefaultColor, std::size_t aChunkBytes )
+{
+	// Write to a temporary file first, so that readers never observe a
+	// partially written file.
+	std::string const temp = std::string(aCachePath) + ".tmp";
+
+	std::FILE* fout = std::fopen( temp.c_str(), "wb" );
+	if( !fout )
+		throw Error( "import_wavefront_obj(): unable to open '%s' for writing", temp.c_str() );
+
+	ObjStreamStats stats;
+	try
+	{
+		CacheHeader_ header{};
+		write_( fout, &header, sizeof(header), temp.c_str() ); // placeholder
+
+		stats = stream_wavefront_obj( aObjPath, aPool, [&] (SimpleMeshData const& aChunk) {
+			auto const count = std::uint64_t(aChunk.positions.size());
+			write_( fout, &count, sizeof(count), temp.c_str() );
+			write_( fout, aChunk.positions.data(), aChunk.positions.size() * sizeof(Vec3f), temp.c_str() );
+			write_( fout, aChunk.colors.data(), aChunk.colors.size() * sizeof(Vec3f), temp.c_str() );
+			write_( fout, aChunk.normals.data(), aChunk.normals.size() * sizeof(Vec3f), temp.c_str() );
+			write_( fout, aChunk.texcoords.data(), aChunk.texcoords.size() * sizeof(Vec2f), temp.c_str() );
+		}, aDefaultColor, aChunkBytes );
+
+		std::uint64_t const end = 0;
+		write_( fout, &end, sizeof(end), temp.c_str() );
+
+		std::string libraries;
+		auto const append = [&libraries] (std::uint32_t aValue) {
+			libraries.append( reinterpret_cast<char const*>(&aValue), sizeof(aValue) );
+		};
+
+		append( std::uint32_t(stats.libraries.size()) );
+		for( auto const& library : stats.libraries )
+		{
+			append( std::uint32_t(library.size()) );
+			libraries += library;
+		}
+		append( std::uint32_t(libraries.size()) );
+
+		write_( fout, libraries.data(), libraries.size(), temp.c_str() );
+
+		std::memcpy( header.magic, kCacheMagic_, sizeof(kCacheMagic_) );
+		header.version = kCacheVersion_;
+		header.vertices = stats.vertices;
+		header.min = stats.min;
+		header.max = stats.max;
+
+		if( 0 != std::fseek( fout, 0, SEEK_SET ) )
+			throw Error( "import_wavefront_obj(): unable to write '%s'", temp.c_str() );
+		write_( fout, &header, sizeof(header), temp.c_str() );
+	}
+	catch( ... )
+	{
+		std::fclose( fout );
+
+		std::error_code ec;
+		std::filesystem::remove( temp, ec );
+		throw;
+	}
+
+	std::error_code ec;
+	if( 0 == std::fclose( fout ) )
+		std::filesystem::rename( temp, aCachePath, ec );
+	else
+		ec = std::make_error_code( std::errc::io_error );
+
+	if( ec )
+	{
+		std::filesystem::remove( temp, ec );
+		throw Error( "import_wavefront_obj(): unable to write '%s'", aCachePath );
+	}
+
+	return stats;
+}
+
+MeshCacheReader::MeshCacheReader( char const* aPath )
+	: mFile( std::fopen( aPath, "rb" ) )
+	, mPath( aPath )
+{
+	if( !mFile )
+		throw Error( "Unable to open mesh cache '%s'", aPath );
+
+	CacheHeader_ header{};
+	if( 1 != std::fread( &header, sizeof(header), 1, mFile ) || 0 != std::memcmp( header.magic, kCacheMagic_, sizeof(kCacheMagic_) ) || kCacheVersion_ != header.version )
+	{
+		std::fclose( mFile );
+		throw Error( "Mesh cache '%s': not a mesh cache, or unsupported version", aPath );
+	}
+
+	mVertexCount = header.vertices;
+	mMin = header.min;
+	mMax = header.max;
+
+	// The material libraries are at the end of the file. Their size is
+	// checked against the file before allocating.
+	std::error_code ec;
+	auto const fileSize = std::filesystem::file_size( aPath, ec );
+
+	std::uint32_t size = 0;
+	bool valid = !ec
+		&& fileSize >= sizeof(header) + sizeof(size)
+		&& 0 == std::fseek( mFile, -long(sizeof(size)), SEEK_END )
+		&& 1 == std::fread( &size, sizeof(size), 1, mFile )
+		&& size >= sizeof(std::uint32_t)
+		&& size <= fileSize - sizeof(header) - sizeof(size)
+		&& 0 == std::fseek( mFile, -long(sizeof(size)) - long(size), SEEK_END )
+	;
+
+	std::string libraries( valid ? size : 0, '\0' );
+	valid = valid && 1 == std::fread( libraries.data(), size, 1, mFile );
+
+	std::size_t pos = 0;
+	auto const next = [&] (std::uint32_t& aValue) {
+		if( !valid || libraries.size() - pos < sizeof(aValue) )
+			return valid = false;
+		std::memcpy( &aValue, libraries.data()+pos, sizeof(aValue) );
+		pos += sizeof(aValue);
+		return true;
+	};
+
+	std::uint32_t count = 0, length = 0;
+	next( count );
+	for( std::uint32_t i = 0; i < count && next( length ); ++i )
+	{
+		valid = length <= libraries.size() - pos;
+		if( !valid )
+			break;
+
+		mLibraries.emplace_back( libraries, pos, length );
+		pos += length;
+	}
+
+	if( !valid || pos != libraries.size() || 0 != std::fseek( mFile, long(sizeof(header)), SEEK_SET ) )
+	{
+		std::fclose( mFile );
+		throw Error( "Mesh cache '%s': truncated or corrupt", aPath );
+	}
+}
+
+MeshCacheReader::~MeshCacheReader()
+{
+	std::fclose( mFile );
+}
+
+std::uint64_t MeshCacheReader::vertex_count() const noexcept
+{
+	return mVertexCount;
+}
+Vec3f MeshCacheReader::bounds_min() const noexcept
+{
+	return mMin;
+}
+Vec3f MeshCacheReader::bounds_max() const noexcept
+{
+	return mMax;
+}
+
+std::vector<std::string> const& MeshCacheReader::libraries() const noexcept
+{
+	return mLibraries;
+}
+
+std::size_t MeshCacheReader::next_block()
+{
+	assert( 0 == mBlockSize ); // read_block() must come first
+
+	std::uint64_t count = 0;
+	if( 1 != std::fread( &count, sizeof(count), 1, mFile ) || count > mVertexCount - mRead || (0 == count && mRead != mVertexCount) )
+		throw Error( "Mesh cache '%s': truncated or corrupt", mPath.c_str() );
+
+	mBlockSize = std::size_t(count);
+	return mBlockSize;
+}
+
+void MeshCacheReader::read_block( Vec3f* aPositions, Vec3f* aColors, Vec3f* aNormals, Vec2f* aTexcoords )
+{
+	auto const n = mBlockSize;
+	if( n != std::fread( aPositions, sizeof(Vec3f), n, mFile )
+		|| n != std::fread( aColors, sizeof(Vec3f), n, mFile )
+		|| n != std::fread( aNormals, sizeof(Vec3f), n, mFile )
+		|| n != std::fread( aTexcoords, sizeof(Vec2f), n, mFile ) )
+	{
+		throw Error( "Mesh cache '%s': truncated", mPath.c_str() );
+	}
+
+	mRead += n;
+	mBlockSize = 0;
+}
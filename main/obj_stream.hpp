@@ -0,0 +1,111 @@
+#ifndef OBJ_STREAM_HPP_3E8C1B72_A4D9_4F06_B5E1_92C7D04A6F38
+#define OBJ_STREAM_HPP_3E8C1B72_A4D9_4F06_B5E1_92C7D04A6F38
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec2.hpp"
+#include "../vmlib/vec3.hpp"
+
+#include "simple_mesh.hpp"
+
+class ThreadPool;
+
+struct ObjStreamStats
+{
+	std::uint64_t bytes = 0; // read from the OBJ file
+	std::uint64_t vertices = 0; // output (three per triangle)
+	std::size_t chunks = 0;
+	std::size_t peakAttributeBytes = 0; // v/vt/vn data kept for indexing
+
+	Vec3f min{ 0.f, 0.f, 0.f }, max{ 0.f, 0.f, 0.f }; // bounds of the positions
+
+	std::vector<std::string> libraries; // material libraries read (mtllib, as opened)
+};
+
+/* stream_wavefront_obj(): imports an OBJ file in bounded chunks
+ *
+ * The counterpart to load_wavefront_obj() for files that do not fit into
+ * memory. The file is read in chunks of about aChunkBytes (cut at line
+ * boundaries). The chunk's lines are parsed on the pool's threads, and its
+ * faces are then triangulated and expanded into non-indexed vertices, again
+ * on the pool. Each chunk's vertices are passed to aSink and discarded
+ * afterwards.
+ *
+ * Faces may refer to any earlier vertex, so the v/vt/vn attributes are kept
+ * for the whole file. They are a fraction of the size of both the text and
+ * the expanded vertices, but they do grow with the file.
+ *
+ * The output matches load_wavefront_obj() (colors are the materials' ambient
+ * colors; quads are split along the shorter diagonal), except that larger
+ * polygons are triangulated as fans, faces before the first usemtl (or with
+ * unknown materials) get aDefaultColor, and faces without normals get their
+ * face normal.
+ */
+using ObjChunkSink = std::function<void(SimpleMeshData const&)>;
+
+ObjStreamStats stream_wavefront_obj(
+	char const* aPath,
+	ThreadPool&,
+	ObjChunkSink const& aSink,
+	Vec3f aDefaultColor = { 1.f, 1.f, 1.f },
+	std::size_t aChunkBytes = 32*1024*1024
+);
+
+/* Mesh cache: stream_wavefront_obj()'s output on disk
+ *
+ * import_wavefront_obj() writes the streamed vertices to a file, one block
+ * per chunk, so that they can be uploaded to the GPU without ever holding
+ * the whole mesh in memory (see create_scene_gpu()). The header holds the
+ * total vertex count and the bounds. The material libraries that were read
+ * are recorded too, so that a cache can be checked against them and not
+ * just against the OBJ file. The file is written to a temporary name first and
+ * renamed when complete.
+ */
+ObjStreamStats import_wavefront_obj(
+	char const* aObjPath,
+	char const* aCachePath,
+	ThreadPool&,
+	Vec3f aDefaultColor = { 1.f, 1.f, 1.f },
+	std::size_t aChunkBytes = 32*1024*1024
+);
+
+class MeshCacheReader final
+{
+	public:
+		explicit MeshCacheReader( char const* aPath );
+		~MeshCacheReader();
+
+		MeshCacheReader( MeshCacheReader const& ) = delete;
+		MeshCacheReader& operator= (MeshCacheReader const&) = delete;
+
+	public:
+		std::uint64_t vertex_count() const noexcept;
+		Vec3f bounds_min() const noexcept;
+		Vec3f bounds_max() const noexcept;
+
+		std::vector<std::string> const& libraries() const noexcept;
+
+		// Vertex count of the next block, or zero at the end. read_block()
+		// then reads that many vertices into each array.
+		std::size_t next_block();
+		void read_block( Vec3f* aPositions, Vec3f* aColors, Vec3f* aNormals, Vec2f* aTexcoords );
+
+	private:
+		std::FILE* mFile;
+		std::string mPath;
+
+		std::uint64_t mVertexCount;
+		Vec3f mMin, mMax;
+		std::vector<std::string> mLibraries;
+
+		std::uint64_t mRead = 0; // vertices in the blocks so far
+		std::size_t mBlockSize = 0;
+};
+
+#endif // OBJ_STREAM_HPP_3E8C1B72_A4D9_4F06_B5E1_92C7D04A6F38
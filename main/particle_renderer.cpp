@@ -0,0 +1,122 @@
+#include "particle_renderer.hpp"
+
+#include <vector>
+
+#include <cassert>
+
+namespace
+{
+	constexpr GLuint kWorkgroupSize_ = 256; // see particles.comp
+
+	// Per-particle layout of the state buffer (particles.comp)
+	struct GpuParticle_
+	{
+		float posAge[4];
+		float vel[4];
+	};
+}
+
+ParticleRenderer::ParticleRenderer( std::size_t aCapacity, ParticleParams const& aParams, bool aGpuSimulation )
+	: mCapacity( aCapacity )
+	, mParams( aParams )
+{
+	// A single attribute, whose source buffer is picked per draw.
+	glGenVertexArrays( 1, &mVAO );
+	glBindVertexArray( mVAO );
+	glVertexAttribFormat( 0, 4, GL_FLOAT, GL_FALSE, 0 );
+	glVertexAttribBinding( 0, 0 );
+	glEnableVertexAttribArray( 0 );
+	glBindVertexArray( 0 );
+
+	if( aGpuSimulation )
+	{
+		// Start with dead particles.
+		std::vector<GpuParticle_> initial( mCapacity, GpuParticle_{ { 0.f, 0.f, 0.f, aParams.lifetime }, {} } );
+
+		glGenBuffers( 1, &mStateBuffer );
+		glBindBuffer( GL_SHADER_STORAGE_BUFFER, mStateBuffer );
+		glBufferData( GL_SHADER_STORAGE_BUFFER, GLsizeiptr(initial.size() * sizeof(GpuParticle_)), initial.data(), GL_DYNAMIC_COPY );
+		glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+
+		mVertexBuffer = mStateBuffer;
+		mVertexStride = sizeof(GpuParticle_);
+	}
+}
+
+ParticleRenderer::~ParticleRenderer()
+{
+	glDeleteVertexArrays( 1, &mVAO );
+	glDeleteBuffers( 1, &mStateBuffer );
+}
+
+void ParticleRenderer::simulate( GLuint aComputeProgram, ParticleSpawn const& aSpawn, float aDt )
+{
+	assert( mStateBuffer );
+	if( 0 == mCapacity )
+		return;
+
+	glUseProgram( aComputeProgram );
+
+	glUniform1f( 0, aDt );
+	glUniform1ui( 1, GLuint(mCapacity) );
+	glUniform3ui( 2, aSpawn.first, aSpawn.count, aSpawn.seed );
+	glUniform1ui( 3, aSpawn.emitterCount );
+	glUniform4f( 4, mParams.speed, mParams.spread, mParams.drag, mParams.buoyancy );
+	glUniform1f( 13, mParams.lifetime );
+
+	for( std::uint32_t i = 0; i < aSpawn.emitterCount; ++i )
+	{
+		glUniform3fv( 5+GLint(i), 1, &aSpawn.emitters[i].position.x );
+		glUniform3fv( 9+GLint(i), 1, &aSpawn.emitters[i].direction.x );
+	}
+
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 0, mStateBuffer );
+	glDispatchCompute( GLuint((mCapacity + kWorkgroupSize_-1) / kWorkgroupSize_), 1, 1 );
+
+	// The results are read as vertex attributes (and by the next dispatch).
+	glMemoryBarrier( GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT );
+}
+
+void ParticleRenderer::set_vertices( GLuint aBuffer, std::size_t aOffset )
+{
+	assert( !mStateBuffer );
+
+	mVertexBuffer = aBuffer;
+	mVertexOffset = aOffset;
+	mVertexStride = 4 * sizeof(float);
+}
+
+void ParticleRenderer::render( GLuint aProgram, Mat44f const& aViewProjection, float aPointScale ) const
+{
+	if( 0 == mCapacity || 0 == mVertexBuffer )
+		return;
+
+	glUseProgram( aProgram );
+	glUniformMatrix4fv( 0, 1, GL_TRUE, aViewProjection.v );
+	glUniform1f( 1, mParams.lifetime );
+	glUniform1f( 2, aPointScale );
+	glUniform1f( 3, mParams.size );
+
+	glEnable( GL_PROGRAM_POINT_SIZE );
+	glEnable( GL_BLEND );
+	glBlendFunc( GL_SRC_ALPHA, GL_ONE );
+	glDepthMask( GL_FALSE );
+
+	glBindVertexArray( mVAO );
+	glBindVertexBuffer( 0, mVertexBuffer, GLintptr(mVertexOffset), mVertexStride );
+	glDrawArrays( GL_POINTS, 0, GLsizei(mCapacity) );
+
+	glDepthMask( GL_TRUE );
+	glDisable( GL_BLEND );
+	glDisable( GL_PROGRAM_POINT_SIZE );
+}
+
+bool ParticleRenderer::gpu_simulation() const noexcept
+{
+	return 0 != mStateBuffer;
+}
+
+std::size_t ParticleRenderer::size() const noexcept
+{
+	return mCapacity;
+}
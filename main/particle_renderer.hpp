@@ -0,0 +1,60 @@
+#ifndef PARTICLE_RENDERER_HPP_5B9E2C14_7A3D_4F68_B1C0_E83D6A4F9027
+#define PARTICLE_RENDERER_HPP_5B9E2C14_7A3D_4F68_B1C0_E83D6A4F9027
+
+#include <glad/glad.h>
+
+#include <cstdlib>
+
+#include "../vmlib/mat44.hpp"
+
+#include "particles.hpp"
+
+/* ParticleRenderer: draws a particle pool as point sprites
+ *
+ * With GPU simulation, the particle state lives in a shader storage buffer
+ * and is advanced by simulate(), which runs particles.comp. The sprites are
+ * then drawn straight from that buffer. Otherwise, the particles are
+ * simulated on the CPU (step_particles()), and the caller provides the
+ * vertices (write_particle_vertices()) via set_vertices() each frame.
+ *
+ * Draw after the opaque geometry: the sprites are blended additively and do
+ * not write depth.
+ */
+class ParticleRenderer final
+{
+	public:
+		ParticleRenderer( std::size_t aCapacity, ParticleParams const&, bool aGpuSimulation );
+		~ParticleRenderer();
+
+		ParticleRenderer( ParticleRenderer const& ) = delete;
+		ParticleRenderer& operator= (ParticleRenderer const&) = delete;
+
+	public:
+		// GPU simulation only.
+		void simulate( GLuint aComputeProgram, ParticleSpawn const&, float aDt );
+
+		// CPU simulation only. Four floats per particle, starting at aOffset
+		// bytes in aBuffer.
+		void set_vertices( GLuint aBuffer, std::size_t aOffset );
+
+		// aPointScale converts sizes to pixels at distance one: half the
+		// viewport height times the projection's (1,1) element.
+		void render( GLuint aProgram, Mat44f const& aViewProjection, float aPointScale ) const;
+
+	public:
+		bool gpu_simulation() const noexcept;
+		std::size_t size() const noexcept;
+
+	private:
+		std::size_t mCapacity;
+		ParticleParams mParams;
+
+		GLuint mVAO = 0;
+		GLuint mStateBuffer = 0; // GPU simulation only
+
+		GLuint mVertexBuffer = 0;
+		std::size_t mVertexOffset = 0;
+		GLsizei mVertexStride = 0;
+};
+
+#endif // PARTICLE_RENDERER_HPP_5B9E2C14_7A3D_4F68_B1C0_E83D6A4F9027
@@ -0,0 +1,182 @@
+#include "particles.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	// Random float in [0, 1) from the top 24 bits of a hash
+	inline
+	float unit_( std::uint32_t aHash ) noexcept
+	{
+		return float(aHash >> 8) * (1.f / 16777216.f);
+	}
+
+	// As with the fleet, the __restrict parameters are what allows GCC to
+	// vectorize the loop.
+	void integrate_kernel_( std::size_t aCount, float* __restrict aPosX, float* __restrict aPosY, float* __restrict aPosZ, float* __restrict aVelX, float* __restrict aVelY, float* __restrict aVelZ, float* __restrict aAge, ParticleParams const& aParams, float aDt ) noexcept
+	{
+		float const damping = std::max( 0.f, 1.f - aParams.drag * aDt );
+		float const lift = aParams.buoyancy * aDt;
+
+		for( std::size_t i = 0; i < aCount; ++i )
+		{
+			// Dead particles are stopped. Otherwise, their velocities would
+			// eventually decay into denormals, which are very slow.
+			float const d = aAge[i] < aParams.lifetime ? damping : 0.f;
+
+			float const vx = aVelX[i] * d;
+			float const vy = (aVelY[i] + lift) * d;
+			float const vz = aVelZ[i] * d;
+
+			aVelX[i] = vx;
+			aVelY[i] = vy;
+			aVelZ[i] = vz;
+
+			aPosX[i] += vx * aDt;
+			aPosY[i] = std::max( aPosY[i] + vy * aDt, 0.f ); // don't sink into the sea
+			aPosZ[i] += vz * aDt;
+
+			aAge[i] += aDt;
+		}
+	}
+
+	void spawn_( ParticleState& aState, ParticleParams const& aParams, ParticleSpawn const& aSpawn, float aDt, std::size_t aBegin, std::size_t aEnd ) noexcept
+	{
+		for( std::size_t i = aBegin; i < aEnd; ++i )
+		{
+			auto const& emitter = aSpawn.emitters[i % aSpawn.emitterCount];
+
+			std::uint32_t const h0 = particle_hash( std::uint32_t(i) ^ (aSpawn.seed * 0x9E3779B9u) );
+			std::uint32_t const h1 = particle_hash( h0 );
+			std::uint32_t const h2 = particle_hash( h1 );
+			std::uint32_t const h3 = particle_hash( h2 );
+
+			float const jitter = aParams.spread * aParams.speed;
+			Vec3f const vel = emitter.direction * aParams.speed + Vec3f{
+				(2.f * unit_( h0 ) - 1.f) * jitter,
+				(2.f * unit_( h1 ) - 1.f) * jitter,
+				(2.f * unit_( h2 ) - 1.f) * jitter
+			};
+
+			// Spread the particles of a step over its duration, so that
+			// they don't clump together at low frame rates.
+			float const age = unit_( h3 ) * aDt;
+			Vec3f const pos = emitter.position + vel * age;
+
+			aState.posX[i] = pos.x;
+			aState.posY[i] = pos.y;
+			aState.posZ[i] = pos.z;
+			aState.velX[i] = vel.x;
+			aState.velY[i] = vel.y;
+			aState.velZ[i] = vel.z;
+			aState.age[i] = age;
+		}
+	}
+}
+
+ParticleSpawner::ParticleSpawner( std::size_t aCapacity, ParticleParams const& aParams )
+	: mCapacity( aCapacity )
+	, mRate( float(aCapacity) / aParams.lifetime )
+{}
+
+ParticleSpawn ParticleSpawner::step( float aDt, ParticleEmitter const* aEmitters, std::size_t aEmitterCount ) noexcept
+{
+	ParticleSpawn ret{};
+	ret.first = mNext;
+	ret.seed = ++mSeed;
+	ret.emitterCount = std::uint32_t(std::min( aEmitterCount, kMaxParticleEmitters ));
+
+	if( 0 == ret.emitterCount || 0 == mCapacity )
+	{
+		mPending = 0.f;
+		return ret;
+	}
+
+	std::copy_n( aEmitters, ret.emitterCount, ret.emitters );
+
+	mPending += mRate * aDt;
+	auto const count = std::min( std::size_t(mPending), mCapacity );
+	mPending = std::min( mPending - float(count), 1.f );
+
+	ret.count = std::uint32_t(count);
+	mNext = std::uint32_t((mNext + count) % mCapacity);
+
+	return ret;
+}
+
+ParticleState::ParticleState( std::size_t aCapacity, ParticleParams const& aParams )
+	: posX( aCapacity, 0.f ), posY( aCapacity, 0.f ), posZ( aCapacity, 0.f )
+	, velX( aCapacity, 0.f ), velY( aCapacity, 0.f ), velZ( aCapacity, 0.f )
+	, age( aCapacity, aParams.lifetime ) // dead
+{}
+
+std::size_t ParticleState::size() const noexcept
+{
+	return posX.size();
+}
+
+void step_particles( ParticleState& aState, ParticleParams const& aParams, ParticleSpawn const& aSpawn, float aDt, std::size_t aBegin, std::size_t aEnd ) noexcept
+{
+	assert( aEnd <= aState.size() );
+
+	integrate_kernel_(
+		aEnd - aBegin,
+		aState.posX.data() + aBegin,
+		aState.posY.data() + aBegin,
+		aState.posZ.data() + aBegin,
+		aState.velX.data() + aBegin,
+		aState.velY.data() + aBegin,
+		aState.velZ.data() + aBegin,
+		aState.age.data() + aBegin,
+		aParams,
+		aDt
+	);
+
+	// Respawn the particles of [aBegin, aEnd) that are in the spawn range.
+	// The spawn range may wrap around the end of the pool, in which case it
+	// consists of two intervals.
+	if( 0 == aSpawn.count )
+		return;
+
+	std::size_t const capacity = aState.size();
+	std::size_t const first = aSpawn.first;
+	std::size_t const last = first + aSpawn.count;
+
+	spawn_( aState, aParams, aSpawn, aDt, std::max( aBegin, first ), std::min( aEnd, std::min( last, capacity ) ) );
+	if( last > capacity )
+		spawn_( aState, aParams, aSpawn, aDt, aBegin, std::min( aEnd, last - capacity ) );
+}
+
+void step_particles( ParticleState& aState, ParticleParams const& aParams, ParticleSpawn const& aSpawn, float aDt, ThreadPool& aPool )
+{
+	aPool.parallel_for( aState.size(), kParticleGrain, [&] (std::size_t aBegin, std::size_t aEnd) {
+		step_particles( aState, aParams, aSpawn, aDt, aBegin, aEnd );
+	} );
+}
+
+void write_particle_vertices( ParticleState const& aState, float* aOut, std::size_t aBegin, std::size_t aEnd ) noexcept
+{
+	for( std::size_t i = aBegin; i < aEnd; ++i )
+	{
+		float* v = aOut + 4*i;
+		v[0] = aState.posX[i];
+		v[1] = aState.posY[i];
+		v[2] = aState.posZ[i];
+		v[3] = aState.age[i];
+	}
+}
+
+std::uint32_t particle_hash( std::uint32_t aX ) noexcept
+{
+	// "lowbias32" by Chris Wellons
+	aX ^= aX >> 16;
+	aX *= 0x7feb352du;
+	aX ^= aX >> 15;
+	aX *= 0x846ca68bu;
+	aX ^= aX >> 16;
+	return aX;
+}
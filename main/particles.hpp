@@ -0,0 +1,106 @@
+#ifndef PARTICLES_HPP_D71B3E48_92A6_4C5F_8E0B_46F1A9C2D735
+#define PARTICLES_HPP_D71B3E48_92A6_4C5F_8E0B_46F1A9C2D735
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+
+class ThreadPool;
+
+constexpr std::size_t kMaxParticleEmitters = 4;
+
+// Particles per thread pool chunk, for step_particles() and the particle
+// loops in main.
+constexpr std::size_t kParticleGrain = 32*1024;
+
+struct ParticleEmitter
+{
+	Vec3f position;
+	Vec3f direction; // unit length
+};
+
+struct ParticleParams
+{
+	float lifetime = 1.2f; // seconds
+	float speed = 1.5f; // initial speed along the emitter's direction
+	float spread = 0.25f; // random initial velocity, relative to speed
+	float drag = 2.f; // fraction of the velocity lost per second
+	float buoyancy = 0.4f; // upwards acceleration
+	float size = 0.04f; // diameter of the rendered sprites
+};
+
+/* ParticleSpawn: particles to respawn in one simulation step
+ *
+ * Particles are never created or destroyed. Instead, a fixed pool is reused
+ * in round-robin order: each step respawns the next `count` particles,
+ * starting at `first` (wrapping around). The rate is chosen such that a
+ * particle is respawned just as it reaches the end of its lifetime.
+ *
+ * Respawned particle i takes emitter i % emitterCount, and derives its
+ * random initial velocity from a hash of i and `seed`. The simulation is
+ * therefore deterministic, and the CPU and GPU (particles.comp) versions
+ * produce the same results up to rounding.
+ */
+struct ParticleSpawn
+{
+	std::uint32_t first;
+	std::uint32_t count;
+	std::uint32_t seed;
+
+	std::uint32_t emitterCount;
+	ParticleEmitter emitters[kMaxParticleEmitters];
+};
+
+class ParticleSpawner final
+{
+	public:
+		ParticleSpawner( std::size_t aCapacity, ParticleParams const& );
+
+	public:
+		// Returns the particles to respawn in the next step. Without
+		// emitters, nothing is spawned (and the existing particles die out).
+		ParticleSpawn step( float aDt, ParticleEmitter const* aEmitters, std::size_t aEmitterCount ) noexcept;
+
+	private:
+		std::size_t mCapacity;
+		float mRate; // particles per second
+
+		std::uint32_t mNext = 0;
+		std::uint32_t mSeed = 0;
+		float mPending = 0.f; // fractional particles carried to the next step
+};
+
+/* ParticleState: particle pool in structure-of-arrays form
+ *
+ * A particle is alive while its age is below ParticleParams::lifetime. New
+ * pools contain only dead particles.
+ */
+struct ParticleState
+{
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> velX, velY, velZ;
+	std::vector<float> age;
+
+	explicit ParticleState( std::size_t aCapacity = 0, ParticleParams const& = {} );
+
+	std::size_t size() const noexcept;
+};
+
+// Advance particles [aBegin, aEnd) by aDt, and respawn those in aSpawn.
+void step_particles( ParticleState&, ParticleParams const&, ParticleSpawn const&, float aDt, std::size_t aBegin, std::size_t aEnd ) noexcept;
+
+// Advance all particles, using the thread pool for large pools.
+void step_particles( ParticleState&, ParticleParams const&, ParticleSpawn const&, float aDt, ThreadPool& );
+
+// Writes four floats per particle: the position and the age. This is the
+// vertex format expected by particles.vert. aOut must have room for
+// 4*size() floats.
+void write_particle_vertices( ParticleState const&, float* aOut, std::size_t aBegin, std::size_t aEnd ) noexcept;
+
+// Integer hash used for the random numbers (also in particles.comp).
+std::uint32_t particle_hash( std::uint32_t ) noexcept;
+
+#endif // PARTICLES_HPP_D71B3E48_92A6_4C5F_8E0B_46F1A9C2D735
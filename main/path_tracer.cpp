@@ -0,0 +1,384 @@
+#include "path_tracer.hpp"
+
+#include <cmath>
+#include <numbers>
+#include <algorithm>
+
+#include <cassert>
+
+#include <stb_image_write.h>
+
+#include "simple_mesh.hpp"
+
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat33.hpp"
+#include "../support/error.hpp"
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	constexpr std::uint32_t kNoTexture_ = ~std::uint32_t(0);
+
+	// Paths are terminated randomly (Russian roulette) after this many
+	// bounces, with a probability that depends on their throughput.
+	constexpr std::size_t kRouletteBounces_ = 2;
+
+	// New rays start this far off the surface (along its normal), relative
+	// to the magnitude of the hit point's coordinates.
+	constexpr float kRayOffset_ = 1e-4f;
+
+	// PCG hash (Jarzynski and Olano, 2020)
+	inline
+	std::uint32_t hash_( std::uint32_t aValue ) noexcept
+	{
+		std::uint32_t const state = aValue * 747796405u + 2891336453u;
+		std::uint32_t const word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	// Uniform in [0,1). The state is advanced by the hash.
+	inline
+	float uniform_( std::uint32_t& aState ) noexcept
+	{
+		aState = hash_( aState );
+		return float(aState >> 8) * 0x1p-24f;
+	}
+
+	inline
+	Vec3f mul_( Vec3f aLeft, Vec3f aRight ) noexcept
+	{
+		return { aLeft.x * aRight.x, aLeft.y * aRight.y, aLeft.z * aRight.z };
+	}
+
+	// Cosine-weighted direction on the hemisphere around aNormal. The
+	// tangent frame follows Duff et al. (2017).
+	Vec3f cosine_sample_( Vec3f aNormal, float aU1, float aU2 ) noexcept
+	{
+		float const sign = std::copysign( 1.f, aNormal.z );
+		float const a = -1.f / (sign + aNormal.z);
+		float const b = aNormal.x * aNormal.y * a;
+		Vec3f const tangent{ 1.f + sign * aNormal.x * aNormal.x * a, sign * b, -sign * aNormal.x };
+		Vec3f const bitangent{ b, sign + aNormal.y * aNormal.y * a, -aNormal.y };
+
+		float const r = std::sqrt( aU1 );
+		float const phi = 2.f * std::numbers::pi_v<float> * aU2;
+		return r * std::cos( phi ) * tangent + r * std::sin( phi ) * bitangent + std::sqrt( std::max( 0.f, 1.f - aU1 ) ) * aNormal;
+	}
+
+	std::uint32_t encode_srgb_( float aLinear ) noexcept
+	{
+		float const c = std::clamp( aLinear, 0.f, 1.f );
+		float const s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow( c, 1.f/2.4f ) - 0.055f;
+		return std::uint32_t(std::lround( s * 255.f ));
+	}
+}
+
+PathTracer::PathTracer( ThreadPool& aPool, std::size_t aWidth, std::size_t aHeight )
+	: mPool( &aPool )
+	, mWidth( aWidth )
+	, mHeight( aHeight )
+	, mTilesX( (aWidth + kTileSize-1) / kTileSize )
+	, mTilesY( (aHeight + kTileSize-1) / kTileSize )
+	, mSum( aWidth * aHeight, Vec3f{ 0.f, 0.f, 0.f } )
+{
+	assert( aWidth && aHeight );
+}
+
+void PathTracer::add_mesh( SimpleMeshData const& aMesh, Mat44f const& aModel2world, SoftTexture const* aTexture, std::size_t aFirstVertex, std::size_t aNumVertices )
+{
+	assert( aFirstVertex + aNumVertices <= aMesh.positions.size() );
+	assert( 0 == aNumVertices % 3 );
+
+	Mat33f const normalMatrix = mat44_to_mat33( transpose( invert( aModel2world ) ) );
+
+	std::uint32_t texture = kNoTexture_;
+	if( aTexture && !aMesh.texcoords.empty() )
+	{
+		auto const it = std::find( mTextures.begin(), mTextures.end(), aTexture );
+		texture = std::uint32_t(it - mTextures.begin());
+		if( mTextures.end() == it )
+			mTextures.emplace_back( aTexture );
+	}
+
+	for( std::size_t i = aFirstVertex; i < aFirstVertex+aNumVertices; i += 3 )
+	{
+		Vec3f p[3];
+		for( std::size_t j = 0; j < 3; ++j )
+		{
+			Vec3f const& v = aMesh.positions[i+j];
+			Vec4f const w = aModel2world * Vec4f{ v.x, v.y, v.z, 1.f };
+			p[j] = Vec3f{ w.x, w.y, w.z } / w.w;
+			mPositions.emplace_back( p[j] );
+		}
+
+		// Meshes without normals are flat shaded, as are vertices whose
+		// normal is zero.
+		Vec3f const face = cross( p[1] - p[0], p[2] - p[0] );
+		Vec3f const faceNormal = dot( face, face ) > 0.f ? normalize( face ) : Vec3f{ 0.f, 1.f, 0.f };
+
+		for( std::size_t j = i; j < i+3; ++j )
+		{
+			Vertex_ vertex{ faceNormal, { 1.f, 1.f, 1.f }, { 0.f, 0.f } };
+			if( !aMesh.normals.empty() )
+			{
+				Vec3f const normal = normalMatrix * aMesh.normals[j];
+				if( dot( normal, normal ) > 0.f )
+					vertex.normal = normalize( normal );
+			}
+			if( !aMesh.colors.empty() )
+				vertex.color = aMesh.colors[j];
+			if( !aMesh.texcoords.empty() )
+				vertex.texcoord = aMesh.texcoords[j];
+
+			mVertices.emplace_back( vertex );
+		}
+
+		mTextureIds.emplace_back( texture );
+	}
+}
+
+void PathTracer::build()
+{
+	mBvh = TriangleBvh( mPositions.data(), mPositions.size() / 3 );
+}
+
+void PathTracer::set_camera( Mat44f const& aProjCameraWorld )
+{
+	mClipToWorld = invert( aProjCameraWorld );
+}
+
+SoftLighting& PathTracer::lighting() noexcept
+{
+	return mLighting;
+}
+
+PathTracer::Params& PathTracer::params() noexcept
+{
+	return mParams;
+}
+
+void PathTracer::reset()
+{
+	std::fill( mSum.begin(), mSum.end(), Vec3f{ 0.f, 0.f, 0.f } );
+	mSamples = 0;
+	mRays = 0;
+}
+
+void PathTracer::render( std::size_t aSamples )
+{
+	assert( mBvh.triangle_count() == mPositions.size() / 3 ); // build()
+
+	if( 0 == aSamples )
+		return;
+
+	// One tile per claim. Tiles cost milliseconds, so claiming them from
+	// a shared counter does not limit scaling, even with many threads.
+	mPool->parallel_for( mTilesX * mTilesY, 1, [&] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t tile = aBegin; tile < aEnd; ++tile )
+			render_tile_( tile, aSamples );
+	} );
+
+	mSamples += aSamples;
+}
+
+std::size_t PathTracer::width() const noexcept
+{
+	return mWidth;
+}
+std::size_t PathTracer::height() const noexcept
+{
+	return mHeight;
+}
+
+std::size_t PathTracer::samples() const noexcept
+{
+	return mSamples;
+}
+std::uint64_t PathTracer::rays() const noexcept
+{
+	return mRays.load( std::memory_order_relaxed );
+}
+
+std::size_t PathTracer::triangle_count() const noexcept
+{
+	return mPositions.size() / 3;
+}
+
+std::vector<std::uint32_t> PathTracer::image() const
+{
+	float const scale = mSamples ? 1.f / float(mSamples) : 0.f;
+
+	std::vector<std::uint32_t> ret( mSum.size() );
+	for( std::size_t i = 0; i < mSum.size(); ++i )
+	{
+		Vec3f const c = mSum[i] * scale;
+		ret[i] = encode_srgb_( c.x ) | encode_srgb_( c.y ) << 8 | encode_srgb_( c.z ) << 16 | 0xffu << 24;
+	}
+	return ret;
+}
+
+void PathTracer::render_tile_( std::size_t aTile, std::size_t aSamples )
+{
+	constexpr std::size_t N = RayPacket::kSize;
+
+	std::size_t const x0 = (aTile % mTilesX) * kTileSize, x1 = std::min( x0 + kTileSize, mWidth );
+	std::size_t const y0 = (aTile / mTilesX) * kTileSize, y1 = std::min( y0 + kTileSize, mHeight );
+
+	std::uint64_t rays = 0;
+	for( std::size_t y = y0; y < y1; ++y )
+	{
+		for( std::size_t bx = x0; bx < x1; bx += N )
+		{
+			std::size_t const lanes = std::min( N, x1 - bx );
+
+			Vec3f sum[N] = {};
+			for( std::size_t s = 0; s < aSamples; ++s )
+			{
+				auto const sample = std::uint32_t(mSamples + s);
+
+				RayPacket packet;
+				std::uint32_t rng[N] = {};
+				for( std::size_t i = 0; i < N; ++i )
+				{
+					packet.tMin[i] = 0.f;
+					packet.tMax[i] = i < lanes ? 1.f : -1.f; // up to the far plane
+
+					std::size_t const x = std::min( bx + i, x1-1 );
+					rng[i] = hash_( std::uint32_t(y * mWidth + x) + hash_( sample ) );
+
+					// Jittered position in the pixel, through the near and
+					// far planes
+					float const nx = 2.f * (float(x) + uniform_( rng[i] )) / float(mWidth) - 1.f;
+					float const ny = 2.f * (float(y) + uniform_( rng[i] )) / float(mHeight) - 1.f;
+					Vec4f const n = mClipToWorld * Vec4f{ nx, ny, -1.f, 1.f };
+					Vec4f const f = mClipToWorld * Vec4f{ nx, ny, 1.f, 1.f };
+
+					Vec3f const origin = Vec3f{ n.x, n.y, n.z } / n.w;
+					Vec3f const dir = Vec3f{ f.x, f.y, f.z } / f.w - origin;
+
+					packet.ox[i] = origin.x; packet.oy[i] = origin.y; packet.oz[i] = origin.z;
+					packet.dx[i] = dir.x; packet.dy[i] = dir.y; packet.dz[i] = dir.z;
+				}
+
+				mBvh.intersect( packet );
+				rays += lanes;
+
+				for( std::size_t i = 0; i < lanes; ++i )
+				{
+					Ray const ray{ { packet.ox[i], packet.oy[i], packet.oz[i] }, { packet.dx[i], packet.dy[i], packet.dz[i] } };
+					RayHit const hit{ packet.t[i], packet.triangle[i], packet.u[i], packet.v[i] };
+					sum[i] += trace_( ray, hit, rng[i], rays );
+				}
+			}
+
+			for( std::size_t i = 0; i < lanes; ++i )
+				mSum[y * mWidth + bx + i] += sum[i];
+		}
+	}
+
+	mRays.fetch_add( rays, std::memory_order_relaxed );
+}
+
+Vec3f PathTracer::trace_( Ray aRay, RayHit const& aHit, std::uint32_t& aRng, std::uint64_t& aRays ) const noexcept
+{
+	Vec3f radiance{ 0.f, 0.f, 0.f };
+	Vec3f throughput{ 1.f, 1.f, 1.f };
+
+	RayHit hit = aHit;
+	for( std::size_t bounce = 0; ; ++bounce )
+	{
+		if( kNoTriangle == hit.triangle )
+		{
+			radiance += mul_( throughput, bounce ? mLighting.ambient : mParams.background );
+			break;
+		}
+
+		// Surface at the hit point. Both normals are flipped to the side
+		// that the ray arrives from.
+		std::size_t const base = 3 * std::size_t(hit.triangle);
+		Vec3f const* p = &mPositions[base];
+		Vertex_ const* v = &mVertices[base];
+		float const w0 = 1.f - hit.u - hit.v;
+
+		Vec3f const position = w0 * p[0] + hit.u * p[1] + hit.v * p[2];
+		Vec3f geometric = normalize( cross( p[1] - p[0], p[2] - p[0] ) );
+		if( dot( geometric, aRay.direction ) > 0.f )
+			geometric = -geometric;
+
+		// Opposing vertex normals can cancel out.
+		Vec3f normal = w0 * v[0].normal + hit.u * v[1].normal + hit.v * v[2].normal;
+		normal = dot( normal, normal ) > 0.f ? normalize( normal ) : geometric;
+		if( dot( normal, geometric ) < 0.f )
+			normal = -normal;
+
+		Vec3f albedo = w0 * v[0].color + hit.u * v[1].color + hit.v * v[2].color;
+		if( auto const texture = mTextureIds[hit.triangle]; kNoTexture_ != texture )
+		{
+			Vec2f const uv = w0 * v[0].texcoord + hit.u * v[1].texcoord + hit.v * v[2].texcoord;
+			albedo = mul_( albedo, mTextures[texture]->sample( uv.x, uv.y ) );
+		}
+
+		float const scale = 1.f + std::max( { std::abs( position.x ), std::abs( position.y ), std::abs( position.z ) } );
+		Vec3f const origin = position + geometric * (kRayOffset_ * scale);
+
+		// Directional light. For a diffuse surface, this matches the lit
+		// shaders: albedo/pi * irradiance, with an irradiance of pi * diffuse.
+		float const cosLight = dot( normal, mLighting.toLight );
+		if( cosLight > 0.f && dot( geometric, mLighting.toLight ) > 0.f )
+		{
+			++aRays;
+			if( !mBvh.occluded( Ray{ origin, mLighting.toLight } ) )
+				radiance += mul_( throughput, mul_( albedo, mLighting.diffuse ) ) * cosLight;
+		}
+
+		if( bounce == mParams.maxBounces )
+			break;
+
+		// Indirect light. With cosine-weighted sampling, the BRDF's cosine
+		// and pdf cancel, leaving only the albedo.
+		float const u1 = uniform_( aRng ), u2 = uniform_( aRng );
+		Vec3f const dir = cosine_sample_( normal, u1, u2 );
+		if( dot( dir, geometric ) <= 0.f )
+			break;
+
+		throughput = mul_( throughput, albedo );
+		if( bounce+1 >= kRouletteBounces_ )
+		{
+			float const survive = std::max( { throughput.x, throughput.y, throughput.z } );
+			if( survive < 1.f )
+			{
+				if( uniform_( aRng ) >= survive )
+					break;
+
+				throughput /= survive;
+			}
+		}
+
+		aRay = Ray{ origin, dir };
+		hit = RayHit{};
+		++aRays;
+		mBvh.intersect( aRay, hit );
+	}
+
+	return radiance;
+}
+
+void save_png( char const* aPath, std::size_t aWidth, std::size_t aHeight, std::vector<std::uint32_t> const& aImage )
+{
+	assert( aImage.size() == aWidth * aHeight );
+
+	// PNG rows are top first.
+	std::vector<std::uint8_t> rgba( 4 * aImage.size() );
+	for( std::size_t y = 0; y < aHeight; ++y )
+	{
+		for( std::size_t x = 0; x < aWidth; ++x )
+		{
+			std::uint32_t const c = aImage[(aHeight-1-y) * aWidth + x];
+			for( std::size_t i = 0; i < 4; ++i )
+				rgba[4 * (y * aWidth + x) + i] = std::uint8_t(c >> 8*i);
+		}
+	}
+
+	if( !stbi_write_png( aPath, int(aWidth), int(aHeight), 4, rgba.data(), int(4 * aWidth) ) )
+		throw Error( "Unable to write image '%s'", aPath );
+}
@@ -0,0 +1,123 @@
+#ifndef PATH_TRACER_HPP_7D1A3F58_C6E2_4B90_9A47_E05B2C8D16F3
+#define PATH_TRACER_HPP_7D1A3F58_C6E2_4B90_9A47_E05B2C8D16F3
+
+#include <atomic>
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec2.hpp"
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+#include "bvh.hpp"
+#include "soft_raster.hpp" // SoftTexture, SoftLighting
+
+struct SimpleMeshData;
+class ThreadPool;
+
+/* PathTracer: offline, progressive CPU path tracer
+ *
+ * Renders the same meshes as render_model(), with global illumination: all
+ * surfaces are diffuse, with the albedo given by the vertex colors (times
+ * the texture, if any). The directional light is sampled with shadow rays;
+ * rays that leave the scene see a uniform sky whose radiance is the
+ * ambient color. Without occlusion and interreflections, the result is
+ * therefore that of the lit object shaders. Camera rays that miss show the
+ * background color.
+ *
+ * add_mesh() copies the triangles in world space; build() then builds the
+ * BVH over all of them. Each render() adds samples to every pixel, such
+ * that the image converges progressively; reset() (required after changing
+ * the camera, lighting or parameters) discards them.
+ *
+ * The image is split into kTileSize x kTileSize tiles. The tiles are
+ * claimed dynamically by the pool's threads and only ever touched by one
+ * thread, so nothing is shared between threads except for the claiming.
+ * Each sample's random numbers depend only on the pixel and the sample
+ * index, so results do not depend on the thread count. Camera rays are
+ * traced as packets of RayPacket::kSize pixels of a row; the (incoherent)
+ * rays after the first bounce are traced individually.
+ */
+class PathTracer final
+{
+	public:
+		static constexpr std::size_t kTileSize = 16;
+
+		struct Params
+		{
+			std::size_t maxBounces = 4; // 0: direct light only
+			Vec3f background{ 0.2f, 0.2f, 0.2f }; // linear, like glClearColor()
+		};
+
+	public:
+		PathTracer( ThreadPool&, std::size_t aWidth, std::size_t aHeight );
+
+		PathTracer( PathTracer const& ) = delete;
+		PathTracer& operator= (PathTracer const&) = delete;
+
+	public:
+		// The texture must stay alive as long as the tracer.
+		void add_mesh( SimpleMeshData const&, Mat44f const& aModel2world, SoftTexture const*, std::size_t aFirstVertex, std::size_t aNumVertices );
+
+		void build();
+
+	public:
+		void set_camera( Mat44f const& aProjCameraWorld );
+
+		SoftLighting& lighting() noexcept;
+		Params& params() noexcept;
+
+		void reset();
+		void render( std::size_t aSamples );
+
+	public:
+		std::size_t width() const noexcept;
+		std::size_t height() const noexcept;
+
+		std::size_t samples() const noexcept; // per pixel, since reset()
+		std::uint64_t rays() const noexcept; // traced since reset()
+
+		std::size_t triangle_count() const noexcept;
+
+		// Average of the samples as 8-bit sRGB, packed as pack_rgba().
+		// Rows are bottom first, as SoftRasterizer::color().
+		std::vector<std::uint32_t> image() const;
+
+	private:
+		struct Vertex_
+		{
+			Vec3f normal; // world space, normalized
+			Vec3f color;
+			Vec2f texcoord;
+		};
+
+		void render_tile_( std::size_t aTile, std::size_t aSamples );
+		Vec3f trace_( Ray, RayHit const&, std::uint32_t& aRng, std::uint64_t& aRays ) const noexcept;
+
+	private:
+		ThreadPool* mPool;
+		std::size_t mWidth, mHeight;
+		std::size_t mTilesX, mTilesY;
+
+		SoftLighting mLighting;
+		Params mParams;
+		Mat44f mClipToWorld = kIdentity44f;
+
+		std::vector<Vec3f> mPositions; // three per triangle
+		std::vector<Vertex_> mVertices;
+		std::vector<std::uint32_t> mTextureIds; // per triangle, into mTextures
+		std::vector<SoftTexture const*> mTextures;
+		TriangleBvh mBvh;
+
+		std::vector<Vec3f> mSum; // per pixel
+		std::size_t mSamples = 0;
+		std::atomic<std::uint64_t> mRays{ 0 };
+};
+
+// Writes an image from PathTracer::image() (or SoftRasterizer::color()) to
+// a PNG file via stb_image_write.
+void save_png( char const* aPath, std::size_t aWidth, std::size_t aHeight, std::vector<std::uint32_t> const& aImage );
+
+#endif // PATH_TRACER_HPP_7D1A3F58_C6E2_4B90_9A47_E05B2C8D16F3
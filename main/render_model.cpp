@@ -1,6 +1,64 @@
 #include <glad/glad.h>
 
 #include "render_model.hpp"
+#include "shadow_maps.hpp"
+#include "clustered_lighting.hpp"
+#include "render_queue.hpp"
+#include "command_list.hpp"
+#include "vertex_quant.hpp"
+
+#include <optional>
+
+namespace
+{
+    // Maps the quantized attributes back to mesh coordinates; see
+    // FEATURE_QUANTIZED in default.vert.
+    void set_decode_uniforms_( const VertexDecode* aDecode, std::uint32_t aFeatures )
+    {
+        if( !aDecode )
+            return;
+
+        glUniform3fv( 24, 1, &aDecode->positionOffset.x );
+        glUniform3fv( 25, 1, &aDecode->positionScale.x );
+        if( aFeatures & kShaderTexture )
+            glUniform4f( 26, aDecode->texcoordOffset.x, aDecode->texcoordOffset.y, aDecode->texcoordScale.x, aDecode->texcoordScale.y );
+    }
+}
+
+RenderStats& render_stats() noexcept
+{
+    static RenderStats stats;
+    return stats;
+}
+
+RenderLighting& render_lighting() noexcept
+{
+    static RenderLighting lighting;
+    return lighting;
+}
+
+std::uint32_t lit_shader_features()
+{
+    std::uint32_t features = kShaderVertexColor | kShaderLighting;
+    if( render_lighting().shadows )
+        features |= kShaderShadows;
+    if( render_lighting().pointLights )
+        features |= kShaderPointLights;
+    return features;
+}
+
+void set_lighting_uniforms()
+{
+    auto const& lighting = render_lighting();
+    glUniform3fv( 2, 1, &lighting.toLight.x );
+    glUniform3fv( 3, 1, &lighting.diffuse.x );
+    glUniform3fv( 4, 1, &lighting.ambient.x );
+
+    if( lighting.shadows )
+        lighting.shadows->set_uniforms();
+    if( lighting.pointLights )
+        lighting.pointLights->set_uniforms();
+}
 
 void set_shader_uniforms( GLuint aShaderID, const Mat44f& aProjCameraWorld, const Mat33f& aNormalMatrix, GLuint aTextureID ) 
 {
@@ -9,10 +67,7 @@ void set_shader_uniforms( GLuint aShaderID, const Mat44f& aProjCameraWorld, cons
     glUniformMatrix3fv( 1, 1, GL_TRUE, aNormalMatrix.v );
 
     // Lighting
-    Vec3f lightDir = normalize( Vec3f{ 0.f, 1.f, -1.f } );
-    glUniform3fv( 2, 1, &lightDir.x );
-    glUniform3f( 3, 1.f, 1.f, 1.f );  // White light model
-    glUniform3f( 4, 0.05f, 0.05f, 0.05f );  
+    set_lighting_uniforms();
 
     if (aTextureID != 0)
     {
@@ -22,15 +77,188 @@ void set_shader_uniforms( GLuint aShaderID, const Mat44f& aProjCameraWorld, cons
 }
 
 
-void render_model( ShaderProgram& aShaderProg, GLuint aVAO, const Mat44f& aProjection, const Mat44f& aWorld2camera, const Vec3f& aPosition, GLuint aTextureID, std::size_t aNumVertices )
+void render_model( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aProjection, const Mat44f& aWorld2camera, const Vec3f& aPosition, GLuint aTextureID, std::size_t aNumVertices )
+{
+    render_model( aShaders, aVAO, aProjection, aWorld2camera, make_translation( aPosition ), aTextureID, aNumVertices );
+}
+
+void render_model( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aProjection, const Mat44f& aWorld2camera, const Mat44f& aModel2world, GLuint aTextureID, std::size_t aNumVertices, std::size_t aFirstVertex, const VertexDecode* aDecode )
 {
-    Mat44f model2world = make_translation( aPosition ); 
+    // Pick the shader variant. All our models carry per-vertex colors.
+    std::uint32_t features = lit_shader_features();
+    if( aTextureID != 0 )
+        features |= kShaderTexture;
+    if( aDecode )
+        features |= kShaderQuantized;
+
     set_shader_uniforms( 
-        aShaderProg.programId(), 
-        aProjection * aWorld2camera * model2world, 
-        mat44_to_mat33( transpose(invert(model2world)) ), 
+        aShaders.get( features ).programId(), 
+        aProjection * aWorld2camera * aModel2world, 
+        mat44_to_mat33( transpose(invert(aModel2world)) ), 
         aTextureID );
+    if( features & (kShaderShadows | kShaderPointLights) )
+        glUniformMatrix4fv( 6, 1, GL_TRUE, aModel2world.v ); // world position
+    set_decode_uniforms_( aDecode, features );
+
     glBindVertexArray( aVAO ); // Pass source input as defined in our VAO
-    glDrawArrays( GL_TRIANGLES, 0, aNumVertices ); // Draw <numVertices> vertices , starting at index 0
+    glDrawArrays( GL_TRIANGLES, GLint(aFirstVertex), aNumVertices ); // Draw <numVertices> vertices , starting at index <firstVertex>
+
+    auto& stats = render_stats();
+    ++stats.drawCalls;
+    stats.triangles += aNumVertices / 3;
+}
+
+void render_instanced( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aProjection, const Mat44f& aWorld2camera, std::size_t aNumVertices, std::size_t aInstanceCount, std::size_t aBaseInstance, const VertexDecode* aDecode )
+{
+    if( 0 == aInstanceCount )
+        return;
+
+    // With instancing, the shader applies the per-instance model matrix
+    // itself and takes only the view-projection matrix. It derives the
+    // normals from the model matrices, so there is no normal matrix uniform.
+    glUseProgram( aShaders.get( lit_shader_features() | kShaderInstancing | (aDecode ? kShaderQuantized : 0) ).programId() );
+    Mat44f const projCameraWorld = aProjection * aWorld2camera;
+    glUniformMatrix4fv( 0, 1, GL_TRUE, projCameraWorld.v );
+    set_decode_uniforms_( aDecode, 0 );
+
+    // Lighting (as in set_shader_uniforms())
+    set_lighting_uniforms();
+
+    glBindVertexArray( aVAO );
+    glDrawArraysInstancedBaseInstance( GL_TRIANGLES, 0, GLsizei(aNumVertices), GLsizei(aInstanceCount), GLuint(aBaseInstance) );
+
+    auto& stats = render_stats();
+    ++stats.drawCalls;
+    stats.triangles += aNumVertices / 3 * aInstanceCount;
 }
 
+void render_depth( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aViewProjection, const Mat44f& aModel2world, std::size_t aNumVertices, std::size_t aFirstVertex, const VertexDecode* aDecode )
+{
+    glUseProgram( aShaders.get( aDecode ? kShaderQuantized : 0 ).programId() );
+    Mat44f const projCameraWorld = aViewProjection * aModel2world;
+    glUniformMatrix4fv( 0, 1, GL_TRUE, projCameraWorld.v );
+    set_decode_uniforms_( aDecode, 0 );
+
+    glBindVertexArray( aVAO );
+    glDrawArrays( GL_TRIANGLES, GLint(aFirstVertex), GLsizei(aNumVertices) );
+
+    auto& stats = render_stats();
+    ++stats.drawCalls;
+    stats.triangles += aNumVertices / 3;
+}
+
+void render_instanced_depth( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aViewProjection, std::size_t aNumVertices, std::size_t aInstanceCount, std::size_t aBaseInstance, const VertexDecode* aDecode )
+{
+    if( 0 == aInstanceCount )
+        return;
+
+    glUseProgram( aShaders.get( kShaderInstancing | (aDecode ? kShaderQuantized : 0) ).programId() );
+    glUniformMatrix4fv( 0, 1, GL_TRUE, aViewProjection.v );
+    set_decode_uniforms_( aDecode, 0 );
+
+    glBindVertexArray( aVAO );
+    glDrawArraysInstancedBaseInstance( GL_TRIANGLES, 0, GLsizei(aNumVertices), GLsizei(aInstanceCount), GLuint(aBaseInstance) );
+
+    auto& stats = render_stats();
+    ++stats.drawCalls;
+    stats.triangles += aNumVertices / 3 * aInstanceCount;
+}
+
+std::uint32_t packet_features( const DrawPacket& aPacket )
+{
+    std::uint32_t features = lit_shader_features();
+    if( aPacket.texture != 0 )
+        features |= kShaderTexture;
+    if( aPacket.instanceCount )
+        features |= kShaderInstancing;
+    if( aPacket.decode )
+        features |= kShaderQuantized;
+    return features;
+}
+
+std::uint32_t packet_depth_features( const DrawPacket& aPacket )
+{
+    return (aPacket.instanceCount ? kShaderInstancing : 0) | (aPacket.decode ? kShaderQuantized : 0);
+}
+
+void render_queue( ShaderPermutations& aShaders, const RenderQueue& aQueue, const DrawPacket* const* aPackets )
+{
+    auto const& entries = aQueue.entries();
+    if( entries.empty() )
+        return;
+
+    auto& stats = render_stats();
+
+    // Currently bound state. Texture unit 0 is only used by the textured
+    // variants, so leaving a stale texture bound is harmless.
+    GLuint program = 0, vao = 0, texture = 0;
+    std::optional<RenderPass> pass;
+
+    for( auto const& entry : entries )
+    {
+        auto const& draw = *aPackets[entry.item];
+
+        auto const entryPass = sort_key_pass( entry.key );
+        bool const depthOnly = RenderPass::depthPrepass == entryPass;
+        if( entryPass != pass )
+        {
+            pass = entryPass;
+            GLboolean const color = depthOnly ? GL_FALSE : GL_TRUE;
+            glColorMask( color, color, color, color );
+            glDepthFunc( depthOnly ? GL_LESS : GL_LEQUAL );
+        }
+
+        std::uint32_t const features = sort_key_program( entry.key );
+        if( GLuint const id = aShaders.get( features ).programId(); id != program )
+        {
+            program = id;
+            glUseProgram( program );
+            if( features & kShaderLighting )
+                set_lighting_uniforms();
+            ++stats.stateChanges;
+        }
+
+        if( draw.vao != vao )
+        {
+            vao = draw.vao;
+            glBindVertexArray( vao );
+            ++stats.stateChanges;
+        }
+
+        if( (features & kShaderTexture) && draw.texture != texture )
+        {
+            texture = draw.texture;
+            glActiveTexture( GL_TEXTURE0 );
+            glBindTexture( GL_TEXTURE_2D, texture );
+            ++stats.stateChanges;
+        }
+
+        // Per-draw uniforms, as in render_model() and render_instanced()
+        set_decode_uniforms_( draw.decode, features );
+        glUniformMatrix4fv( 0, 1, GL_TRUE, draw.projCameraWorld.v );
+        if( draw.instanceCount )
+        {
+            glDrawArraysInstancedBaseInstance( GL_TRIANGLES, GLint(draw.first), GLsizei(draw.vertices), GLsizei(draw.instanceCount), GLuint(draw.baseInstance) );
+            stats.triangles += std::size_t(draw.vertices) / 3 * draw.instanceCount;
+        }
+        else
+        {
+            if( features & kShaderLighting )
+            {
+                glUniformMatrix3fv( 1, 1, GL_TRUE, draw.normalMatrix.v );
+                if( features & (kShaderShadows | kShaderPointLights) )
+                    glUniformMatrix4fv( 6, 1, GL_TRUE, draw.model2world.v ); // world position
+            }
+
+            glDrawArrays( GL_TRIANGLES, GLint(draw.first), GLsizei(draw.vertices) );
+            stats.triangles += draw.vertices / 3;
+        }
+
+        ++stats.drawCalls;
+        if( depthOnly )
+            ++stats.prepassDraws;
+    }
+
+    glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+    glDepthFunc( GL_LESS );
+}
@@ -4,13 +4,106 @@
 #include "../vmlib/mat44.hpp"
 #include "../vmlib/mat33.hpp"
 #include "../support/program.hpp"
+#include "../support/shader_permutations.hpp"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <cstdint>
+
+// Features of the object shaders (default.vert, objects.frag). Each bit
+// enables the corresponding FEATURE_* define; see kObjectShaderFeatures.
+enum EShaderFeature : std::uint32_t
+{
+	kShaderTexture = 1u << 0,
+	kShaderVertexColor = 1u << 1,
+	kShaderLighting = 1u << 2,
+	kShaderInstancing = 1u << 3,
+	kShaderShadows = 1u << 4,
+	kShaderPointLights = 1u << 5,
+	kShaderQuantized = 1u << 6
+};
+
+inline std::vector<ShaderPermutations::Feature> const kObjectShaderFeatures = {
+	{ kShaderTexture, "FEATURE_TEXTURE" },
+	{ kShaderVertexColor, "FEATURE_VERTEX_COLOR" },
+	{ kShaderLighting, "FEATURE_LIGHTING" },
+	{ kShaderInstancing, "FEATURE_INSTANCING" },
+	{ kShaderShadows, "FEATURE_SHADOWS" },
+	{ kShaderPointLights, "FEATURE_POINT_LIGHTS" },
+	{ kShaderQuantized, "FEATURE_QUANTIZED" }
+};
+
+class ShadowMaps;
+class ClusteredLighting;
+class RenderQueue;
+struct DrawPacket;
+struct VertexDecode;
+
+// The scene's lights: one directional light, and optionally point lights.
+// With shadow maps or point lights, the lit variants of the object shaders
+// use them (kShaderShadows, kShaderPointLights).
+struct RenderLighting
+{
+	Vec3f toLight = normalize( Vec3f{ 0.f, 1.f, -1.f } );
+	Vec3f diffuse{ 1.f, 1.f, 1.f };
+	Vec3f ambient{ 0.05f, 0.05f, 0.05f };
+
+	ShadowMaps const* shadows = nullptr;
+	ClusteredLighting const* pointLights = nullptr;
+};
+
+RenderLighting& render_lighting() noexcept;
+
+// The features of the lit, vertex colored object shader variants under the
+// current lighting
+std::uint32_t lit_shader_features();
+// Sets the lighting uniforms of objects.frag for the current program
+void set_lighting_uniforms();
+
+// Per-frame counters for the performance HUD. The render_*() functions
+// count their own draws; other draws are counted by their callers.
+struct RenderStats
+{
+	std::size_t drawCalls = 0;
+	std::size_t triangles = 0;
+	std::size_t culled = 0; // objects skipped by frustum culling
+	std::size_t stateChanges = 0; // program, VAO and texture binds by render_queue()
+	std::size_t prepassDraws = 0; // ... of the draw calls, in the depth prepass
+};
+
+RenderStats& render_stats() noexcept;
+
 // set uniforms
-void set_shader_uniforms( GLuint aShaderID, const Mat44f& aProjCameraWorld, const Mat33f& aNormalMatrix, const Vec3f& aMaterialColor );
-// render model 
-void render_model( ShaderProgram& aShaderProg, GLuint aVAO, const Mat44f& aProjection, const Mat44f& aWorld2camera, const Vec3f& aPosition, GLuint aTextureID, std::size_t aNumVertices );
+void set_shader_uniforms( GLuint aShaderID, const Mat44f& aProjCameraWorld, const Mat33f& aNormalMatrix, GLuint aTextureID );
+// render model. Models in a quantized VAO (see QuantizedVertices) pass their
+// VertexDecode, which selects the kShaderQuantized variants; the same goes
+// for the functions below.
+void render_model( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aProjection, const Mat44f& aWorld2camera, const Vec3f& aPosition, GLuint aTextureID, std::size_t aNumVertices );
+void render_model( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aProjection, const Mat44f& aWorld2camera, const Mat44f& aModel2world, GLuint aTextureID, std::size_t aNumVertices, std::size_t aFirstVertex = 0, const VertexDecode* aDecode = nullptr );
+// render aInstanceCount copies of a model; the per-instance model matrices come
+// from the VAO's instance buffer (see set_instance_buffer()), starting at
+// matrix aBaseInstance
+void render_instanced( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aProjection, const Mat44f& aWorld2camera, std::size_t aNumVertices, std::size_t aInstanceCount, std::size_t aBaseInstance = 0, const VertexDecode* aDecode = nullptr );
+
+// depth-only versions of the above, for shadow maps; the unlit, uncolored
+// variants of the object shaders are used
+void render_depth( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aViewProjection, const Mat44f& aModel2world, std::size_t aNumVertices, std::size_t aFirstVertex = 0, const VertexDecode* aDecode = nullptr );
+void render_instanced_depth( ShaderPermutations& aShaders, GLuint aVAO, const Mat44f& aViewProjection, std::size_t aNumVertices, std::size_t aInstanceCount, std::size_t aBaseInstance = 0, const VertexDecode* aDecode = nullptr );
+
+// the shader features with which render_queue() draws aPacket in the opaque
+// pass; use as the program part of its sort key
+std::uint32_t packet_features( const DrawPacket& aPacket );
+// ... and in the depth prepass
+std::uint32_t packet_depth_features( const DrawPacket& aPacket );
+
+// draw the queue's entries in order; each entry's item indexes aPackets (see
+// merge_command_lists()), and the program part of its key selects the shader
+// variant. The packets' matrices are uploaded as recorded. Depth prepass
+// entries are drawn with color writes disabled. Opaque entries then test
+// with GL_LEQUAL, such that they pass against their own prepass depths.
+// Programs, VAOs, textures and the lighting uniforms are only set when they
+// change between entries.
+void render_queue( ShaderPermutations& aShaders, const RenderQueue& aQueue, const DrawPacket* const* aPackets );
 
-#endif // RENDER_MODEL_HPP
\ No newline at end of file
+#endif // RENDER_MODEL_HPP
@@ -0,0 +1,105 @@
+#include "render_queue.hpp"
+
+#include <bit>
+#include <algorithm>
+
+#include <cassert>
+
+namespace
+{
+	constexpr unsigned kPassShift_ = 60;
+	constexpr unsigned kProgramShift_ = 48;
+	constexpr unsigned kMaterialShift_ = 32;
+
+	constexpr std::uint64_t kProgramMask_ = 0xfff;
+	constexpr std::uint64_t kMaterialMask_ = 0xffff;
+
+	// Maps a float to an unsigned integer with the same order. Negative
+	// depths (behind the camera) sort first.
+	std::uint32_t depth_bits_( float aDepth ) noexcept
+	{
+		auto const bits = std::bit_cast<std::uint32_t>( aDepth );
+		return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+	}
+}
+
+void RenderQueue::clear() noexcept
+{
+	mEntries.clear();
+}
+
+void RenderQueue::submit( RenderPass aPass, std::uint32_t aProgram, std::uint32_t aMaterial, float aDepth, std::uint32_t aItem )
+{
+	mEntries.emplace_back( Entry{ make_sort_key( aPass, aProgram, aMaterial, aDepth ), aItem } );
+}
+
+void RenderQueue::append( RenderQueue const& aOther, std::uint32_t aItemOffset )
+{
+	mEntries.reserve( mEntries.size() + aOther.mEntries.size() );
+	for( auto const& entry : aOther.mEntries )
+		mEntries.emplace_back( Entry{ entry.key, entry.item + aItemOffset } );
+}
+
+void RenderQueue::sort()
+{
+	std::size_t const count = mEntries.size();
+	mScratch.resize( count );
+
+	// Bits that differ between keys; the other digits need no pass.
+	std::uint64_t varying = 0;
+	for( auto const& entry : mEntries )
+		varying |= entry.key ^ mEntries.front().key;
+
+	// LSD radix sort, 8 bits per pass. Each pass is stable, so the result
+	// is ordered by the full key (and by submission order for equal keys).
+	for( unsigned shift = 0; shift < 64; shift += 8 )
+	{
+		if( 0 == ((varying >> shift) & 0xff) )
+			continue;
+
+		std::size_t offsets[256] = {};
+		for( auto const& entry : mEntries )
+			++offsets[(entry.key >> shift) & 0xff];
+
+		std::size_t total = 0;
+		for( auto& offset : offsets )
+		{
+			auto const n = offset;
+			offset = total;
+			total += n;
+		}
+
+		for( auto const& entry : mEntries )
+			mScratch[offsets[(entry.key >> shift) & 0xff]++] = entry;
+
+		mEntries.swap( mScratch );
+	}
+}
+
+std::vector<RenderQueue::Entry> const& RenderQueue::entries() const noexcept
+{
+	return mEntries;
+}
+
+std::uint64_t make_sort_key( RenderPass aPass, std::uint32_t aProgram, std::uint32_t aMaterial, float aDepth ) noexcept
+{
+	assert( aProgram <= kProgramMask_ && aMaterial <= kMaterialMask_ );
+
+	return std::uint64_t(aPass) << kPassShift_
+		| (std::uint64_t(aProgram) & kProgramMask_) << kProgramShift_
+		| (std::uint64_t(aMaterial) & kMaterialMask_) << kMaterialShift_
+		| depth_bits_( aDepth );
+}
+
+RenderPass sort_key_pass( std::uint64_t aKey ) noexcept
+{
+	return RenderPass(aKey >> kPassShift_);
+}
+std::uint32_t sort_key_program( std::uint64_t aKey ) noexcept
+{
+	return std::uint32_t((aKey >> kProgramShift_) & kProgramMask_);
+}
+std::uint32_t sort_key_material( std::uint64_t aKey ) noexcept
+{
+	return std::uint32_t((aKey >> kMaterialShift_) & kMaterialMask_);
+}
@@ -0,0 +1,70 @@
+#ifndef RENDER_QUEUE_HPP_B71F4D08_2C93_4A6E_9D15_E84A03C7F6B2
+#define RENDER_QUEUE_HPP_B71F4D08_2C93_4A6E_9D15_E84A03C7F6B2
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+// Passes, in the order in which they are drawn
+enum class RenderPass : std::uint8_t
+{
+	depthPrepass = 0,
+	opaque = 1
+};
+
+/* RenderQueue: sorted list of draws
+ *
+ * Each submitted draw gets a 64-bit sort key. Sorting the keys orders the
+ * draws by:
+ *
+ *   pass     (bits 60-63)
+ *   program  (bits 48-59; e.g., the shader feature bits)
+ *   material (bits 32-47; e.g., the texture)
+ *   depth    (bits  0-31; view distance, front to back)
+ *
+ * Draws that share a program and material are thus adjacent, such that
+ * state changes are minimal, and within those, nearby objects are drawn
+ * first, such that the depth test rejects more of the hidden fragments. In
+ * the depth prepass, program and material are irrelevant; callers should
+ * pass 0 so that the draws are sorted by depth only.
+ *
+ * The queue only stores the keys and an index per draw; the draws
+ * themselves live with the caller. Keys are sorted with an LSD radix sort,
+ * which skips the digits in which all keys agree.
+ */
+class RenderQueue final
+{
+	public:
+		struct Entry
+		{
+			std::uint64_t key;
+			std::uint32_t item; // caller's index
+		};
+
+	public:
+		void clear() noexcept;
+
+		void submit( RenderPass, std::uint32_t aProgram, std::uint32_t aMaterial, float aDepth, std::uint32_t aItem );
+
+		// Appends another queue's entries, with aItemOffset added to their
+		// items (see merge_command_lists())
+		void append( RenderQueue const&, std::uint32_t aItemOffset );
+
+		void sort();
+
+	public:
+		std::vector<Entry> const& entries() const noexcept;
+
+	private:
+		std::vector<Entry> mEntries;
+		std::vector<Entry> mScratch;
+};
+
+std::uint64_t make_sort_key( RenderPass, std::uint32_t aProgram, std::uint32_t aMaterial, float aDepth ) noexcept;
+
+RenderPass sort_key_pass( std::uint64_t ) noexcept;
+std::uint32_t sort_key_program( std::uint64_t ) noexcept;
+std::uint32_t sort_key_material( std::uint64_t ) noexcept;
+
+#endif // RENDER_QUEUE_HPP_B71F4D08_2C93_4A6E_9D15_E84A03C7F6B2
@@ -0,0 +1,924 @@
+#include "scene_file.hpp"
+
+#include <chrono>
+#include <numbers>
+#include <utility>
+#include <algorithm>
+#include <filesystem>
+#include <type_traits>
+
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+#include "../support/hash.hpp"
+#include "../support/json.hpp"
+#include "../support/error.hpp"
+#include "../support/thread_pool.hpp"
+
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat33.hpp"
+
+#include "load_obj.hpp"
+#include "obj_stream.hpp"
+#include "load_texture.hpp"
+#include "space_vehicle.hpp"
+
+namespace
+{
+	// Binary format: header, list of sources, then the four tables. Strings
+	// and arrays are prefixed with their length; all values are stored in
+	// native byte order.
+	constexpr char kSceneMagic_[4] = { 'S', 'C', 'N', 'B' };
+	constexpr std::uint32_t kSceneVersion_ = 2;
+
+	constexpr char const* kBinaryExtension_ = ".scnb";
+	constexpr char const* kMeshCacheExtension_ = ".meshb";
+
+	class Writer_
+	{
+		public:
+			void raw( void const* aData, std::size_t aSize )
+			{
+				auto const* bytes = static_cast<char const*>(aData);
+				mBuffer.insert( mBuffer.end(), bytes, bytes+aSize );
+			}
+
+			template< typename tType >
+			void value( tType const& aValue )
+			{
+				static_assert( std::is_trivially_copyable_v<tType> );
+				raw( &aValue, sizeof(tType) );
+			}
+
+			void string( std::string const& aString )
+			{
+				value( std::uint32_t(aString.size()) );
+				raw( aString.data(), aString.size() );
+			}
+
+			template< typename tArray > // std::vector or std::pmr::vector
+			void array( tArray const& aArray )
+			{
+				using Type_ = typename tArray::value_type;
+				static_assert( std::is_trivially_copyable_v<Type_> );
+				value( std::uint64_t(aArray.size()) );
+				raw( aArray.data(), aArray.size() * sizeof(Type_) );
+			}
+
+			std::vector<char> const& buffer() const noexcept
+			{
+				return mBuffer;
+			}
+
+		private:
+			std::vector<char> mBuffer;
+	};
+
+	class Reader_
+	{
+		public:
+			Reader_( std::vector<char> aBuffer, char const* aPath )
+				: mBuffer( std::move(aBuffer) )
+				, mPath( aPath )
+			{}
+
+			void raw( void* aData, std::size_t aSize )
+			{
+				if( aSize > mBuffer.size() - mPos )
+					throw Error( "Scene '%s': truncated", mPath );
+
+				std::memcpy( aData, mBuffer.data()+mPos, aSize );
+				mPos += aSize;
+			}
+
+			template< typename tType >
+			tType value()
+			{
+				tType ret;
+				raw( &ret, sizeof(tType) );
+				return ret;
+			}
+
+			std::string string()
+			{
+				auto const size = value<std::uint32_t>();
+				if( size > mBuffer.size() - mPos )
+					throw Error( "Scene '%s': truncated", mPath );
+
+				std::string ret( size, '\0' );
+				raw( ret.data(), ret.size() );
+				return ret;
+			}
+
+			// Number of entries in a table, each of which takes at least
+			// aMinSize bytes (checked before anything is allocated for them)
+			std::uint32_t count( std::size_t aMinSize )
+			{
+				auto const ret = value<std::uint32_t>();
+				if( ret > (mBuffer.size() - mPos) / aMinSize )
+					throw Error( "Scene '%s': truncated", mPath );
+				return ret;
+			}
+
+			template< typename tArray > // std::vector or std::pmr::vector
+			void array( tArray& aArray )
+			{
+				using Type_ = typename tArray::value_type;
+				auto const count = value<std::uint64_t>();
+				if( count > (mBuffer.size() - mPos) / sizeof(Type_) )
+					throw Error( "Scene '%s': truncated", mPath );
+
+				aArray.resize( std::size_t(count) );
+				raw( aArray.data(), aArray.size() * sizeof(Type_) );
+			}
+
+			std::uint32_t index( std::size_t aLimit )
+			{
+				auto const ret = value<std::uint32_t>();
+				if( kNoSceneIndex != ret && ret >= aLimit )
+					throw Error( "Scene '%s': invalid index %u", mPath, ret );
+				return ret;
+			}
+
+		private:
+			std::vector<char> mBuffer;
+			std::size_t mPos = 0;
+			char const* mPath;
+	};
+
+	struct SourceStamp_
+	{
+		std::uint64_t size;
+		std::int64_t time;
+	};
+
+	bool stamp_( std::string const& aPath, SourceStamp_& aOut ) noexcept
+	{
+		std::error_code ec;
+		aOut.size = std::filesystem::file_size( aPath, ec );
+		if( ec )
+			return false;
+
+		auto const time = std::filesystem::last_write_time( aPath, ec );
+		if( ec )
+			return false;
+
+		aOut.time = std::int64_t(time.time_since_epoch().count());
+		return true;
+	}
+
+	std::vector<char> read_file_( char const* aPath )
+	{
+		std::FILE* fin = std::fopen( aPath, "rb" );
+		if( !fin )
+			throw Error( "Unable to open scene '%s'", aPath );
+
+		std::fseek( fin, 0, SEEK_END );
+		auto const length = std::size_t(std::ftell( fin ));
+		std::fseek( fin, 0, SEEK_SET );
+
+		std::vector<char> ret( length );
+		auto const read = std::fread( ret.data(), 1, length, fin );
+		std::fclose( fin );
+
+		if( read != length )
+			throw Error( "Error while reading scene '%s' (%zu of %zu bytes)", aPath, read, length );
+
+		return ret;
+	}
+
+	Vec3f vec3_( JsonValue const& aValue )
+	{
+		auto const& arr = aValue.as_array();
+		if( 3 != arr.size() )
+			throw Error( "%s:%d: expected three numbers", aValue.source(), aValue.line() );
+		return { arr[0].as_float(), arr[1].as_float(), arr[2].as_float() };
+	}
+
+	template< typename tItem >
+	std::uint32_t lookup_( std::vector<tItem> const& aItems, JsonValue const& aName, char const* aWhat )
+	{
+		auto const& name = aName.as_string();
+		for( std::size_t i = 0; i < aItems.size(); ++i )
+		{
+			if( aItems[i].name == name )
+				return std::uint32_t(i);
+		}
+
+		throw Error( "%s:%d: unknown %s '%s' (must be declared before use)", aName.source(), aName.line(), aWhat, name.c_str() );
+	}
+
+	Mat44f node_transform_( JsonValue const& aNode )
+	{
+		Vec3f translate{ 0.f, 0.f, 0.f }, rotate{ 0.f, 0.f, 0.f }, scale{ 1.f, 1.f, 1.f };
+
+		if( auto const* t = aNode.find( "translate" ) )
+			translate = vec3_( *t );
+		if( auto const* r = aNode.find( "rotate" ) )
+			rotate = vec3_( *r ) * (std::numbers::pi_v<float> / 180.f);
+		if( auto const* s = aNode.find( "scale" ) )
+		{
+			if( s->is_number() )
+				scale = Vec3f{ 1.f, 1.f, 1.f } * s->as_float();
+			else
+				scale = vec3_( *s );
+		}
+
+		return make_translation( translate )
+			* make_rotation_z( rotate.z ) * make_rotation_y( rotate.y ) * make_rotation_x( rotate.x )
+			* make_scaling( scale.x, scale.y, scale.z );
+	}
+
+	SimpleMeshData make_mesh_( JsonValue const& aMesh, Vec3f aColor, std::vector<std::string>* aSources, std::pmr::memory_resource* aResource )
+	{
+		if( auto const* obj = aMesh.find( "obj" ) )
+		{
+			if( aSources )
+				aSources->emplace_back( obj->as_string() );
+
+			return load_wavefront_obj( obj->as_string().c_str(), aResource );
+		}
+
+		auto const& primitive = aMesh["primitive"];
+		auto const& kind = primitive.as_string();
+
+		auto const subdivs = std::size_t(aMesh.float_or( "subdivs", 64.f ));
+		bool const capped = aMesh.bool_or( "capped", true );
+
+		if( "cylinder" == kind )
+			return make_cylinder( capped, subdivs, aColor, kIdentity44f, aResource );
+		if( "cone" == kind )
+			return make_cone( capped, subdivs, aColor, kIdentity44f, aResource );
+		if( "cube" == kind )
+			return make_cube( aColor, kIdentity44f, aResource );
+
+		throw Error( "%s:%d: unknown primitive '%s'", primitive.source(), primitive.line(), kind.c_str() );
+	}
+
+	// Appends aMesh to aOut, transformed by aTransform. Missing attributes are
+	// filled in, so that the result can be drawn with a single VAO. Callers
+	// reserve aOut's arrays.
+	void append_mesh_( SimpleMeshData& aOut, SimpleMeshData const& aMesh, Mat44f const& aTransform )
+	{
+		auto const count = aMesh.positions.size();
+		Mat33f const normalMatrix = mat44_to_mat33( transpose( invert( aTransform ) ) );
+
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			auto const& p = aMesh.positions[i];
+			Vec4f const tp = aTransform * Vec4f{ p.x, p.y, p.z, 1.f };
+			aOut.positions.emplace_back( Vec3f{ tp.x, tp.y, tp.z } );
+
+			aOut.colors.emplace_back( i < aMesh.colors.size() ? aMesh.colors[i] : Vec3f{ 1.f, 1.f, 1.f } );
+			aOut.normals.emplace_back( i < aMesh.normals.size() ? normalize( normalMatrix * aMesh.normals[i] ) : Vec3f{ 0.f, 1.f, 0.f } );
+			aOut.texcoords.emplace_back( i < aMesh.texcoords.size() ? aMesh.texcoords[i] : Vec2f{ 0.f, 0.f } );
+		}
+	}
+
+	// Sphere around the bounding box. Not the tightest sphere, but cheap and
+	// good enough for culling.
+	std::pair<Vec3f, float> bounding_sphere_( std::pmr::vector<Vec3f> const& aPositions )
+	{
+		if( aPositions.empty() )
+			return { Vec3f{ 0.f, 0.f, 0.f }, 0.f };
+
+		Vec3f lo = aPositions.front(), hi = aPositions.front();
+		for( auto const& p : aPositions )
+		{
+			lo = Vec3f{ std::min( lo.x, p.x ), std::min( lo.y, p.y ), std::min( lo.z, p.z ) };
+			hi = Vec3f{ std::max( hi.x, p.x ), std::max( hi.y, p.y ), std::max( hi.z, p.z ) };
+		}
+
+		Vec3f const center = (lo + hi) * 0.5f;
+
+		float radius = 0.f;
+		for( auto const& p : aPositions )
+			radius = std::max( radius, length( p - center ) );
+
+		return { center, radius };
+	}
+
+	std::string cache_path_( char const* aPath, std::string const& aCacheDir, char const* aExtension = kBinaryExtension_ )
+	{
+		std::filesystem::path const source( aPath );
+		auto const hash = hash_fnv1a( aPath, std::strlen( aPath ) );
+
+		char name[32];
+		std::snprintf( name, sizeof(name), "-%016llx", static_cast<unsigned long long>(hash) );
+
+		return (std::filesystem::path( aCacheDir ) / (source.stem().string() + name + aExtension)).string();
+	}
+
+	// Imports a streamed mesh, unless its cache is up to date (newer than
+	// both the OBJ file and its material libraries). Returns the cache's
+	// path; the libraries are appended to aSources.
+	std::string import_streamed_mesh_( std::string const& aObjPath, Vec3f aColor, std::string const& aCacheDir, std::vector<std::string>* aSources )
+	{
+		std::string const dir = aCacheDir.empty() ? std::string( "." ) : aCacheDir;
+		std::string const cachePath = cache_path_( aObjPath.c_str(), dir, kMeshCacheExtension_ );
+
+		std::error_code ec;
+		auto const objTime = std::filesystem::last_write_time( aObjPath, ec );
+		if( ec )
+			throw Error( "Unable to open OBJ file '%s'", aObjPath.c_str() );
+
+		if( auto const cacheTime = std::filesystem::last_write_time( cachePath, ec ); !ec && cacheTime >= objTime )
+		{
+			try
+			{
+				MeshCacheReader check( cachePath.c_str() );
+
+				bool current = true;
+				for( auto const& library : check.libraries() )
+				{
+					auto const libraryTime = std::filesystem::last_write_time( library, ec );
+					current = current && !ec && libraryTime <= cacheTime;
+				}
+
+				if( current )
+				{
+					if( aSources )
+						aSources->insert( aSources->end(), check.libraries().begin(), check.libraries().end() );
+					return cachePath;
+				}
+			}
+			catch( Error const& eErr )
+			{
+				std::fprintf( stderr, "%s. Reimporting.\n", eErr.what() );
+			}
+		}
+
+		std::filesystem::create_directories( dir, ec );
+
+		ThreadPool pool;
+		auto const start = std::chrono::steady_clock::now();
+		auto const stats = import_wavefront_obj( aObjPath.c_str(), cachePath.c_str(), pool, aColor );
+		auto const seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+		std::printf( "Imported '%s': %llu triangles, %.1f MB in %.1f s (%.0f MB/s), %.1f MB of attributes\n",
+			aObjPath.c_str(),
+			static_cast<unsigned long long>(stats.vertices / 3),
+			double(stats.bytes) / (1024.*1024.),
+			seconds,
+			double(stats.bytes) / (1024.*1024.) / seconds,
+			double(stats.peakAttributeBytes) / (1024.*1024.)
+		);
+
+		if( aSources )
+			aSources->insert( aSources->end(), stats.libraries.begin(), stats.libraries.end() );
+		return cachePath;
+	}
+
+	// Uploads a mesh cache block by block, reading each block straight into
+	// the mapped buffers. Same layout as create_vao().
+	GLuint create_vao_streamed_( char const* aCachePath, SceneGpu::Range& aRange )
+	{
+		MeshCacheReader in( aCachePath );
+
+		auto const count = in.vertex_count();
+		GLsizeiptr const sizes[4] = { sizeof(Vec3f), sizeof(Vec3f), sizeof(Vec3f), sizeof(Vec2f) };
+		GLint const components[4] = { 3, 3, 3, 2 };
+
+		GLuint vao = 0;
+		glGenVertexArrays( 1, &vao );
+		glBindVertexArray( vao );
+
+		GLuint buffers[4];
+		glGenBuffers( 4, buffers );
+		for( GLuint i = 0; i < 4; ++i )
+		{
+			glBindBuffer( GL_ARRAY_BUFFER, buffers[i] );
+			glBufferData( GL_ARRAY_BUFFER, sizes[i] * GLsizeiptr(count), nullptr, GL_STATIC_DRAW );
+			glVertexAttribPointer( i, components[i], GL_FLOAT, GL_FALSE, 0, nullptr );
+			glEnableVertexAttribArray( i );
+		}
+
+		glBindVertexArray( 0 );
+
+		std::uint64_t offset = 0;
+		while( auto const block = in.next_block() )
+		{
+			void* mapped[4];
+			for( std::size_t i = 0; i < 4; ++i )
+			{
+				glBindBuffer( GL_ARRAY_BUFFER, buffers[i] );
+				mapped[i] = glMapBufferRange( GL_ARRAY_BUFFER, sizes[i] * GLintptr(offset), sizes[i] * GLsizeiptr(block), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT );
+			}
+
+			bool const ok = mapped[0] && mapped[1] && mapped[2] && mapped[3];
+			if( ok )
+			{
+				in.read_block( static_cast<Vec3f*>(mapped[0]), static_cast<Vec3f*>(mapped[1]), static_cast<Vec3f*>(mapped[2]), static_cast<Vec2f*>(mapped[3]) );
+			}
+
+			for( std::size_t i = 0; i < 4; ++i )
+			{
+				glBindBuffer( GL_ARRAY_BUFFER, buffers[i] );
+				if( mapped[i] )
+					glUnmapBuffer( GL_ARRAY_BUFFER );
+			}
+
+			if( !ok )
+				throw Error( "Unable to map buffers for mesh cache '%s'", aCachePath );
+
+			offset += block;
+		}
+
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+		// As in create_vao(), the VAO keeps the buffers alive.
+		glDeleteBuffers( 4, buffers );
+
+		Vec3f const lo = in.bounds_min(), hi = in.bounds_max();
+		aRange = SceneGpu::Range{ vao, 0, std::size_t(count), (lo + hi) * 0.5f, 0.5f * length( hi - lo ) };
+		return vao;
+	}
+}
+
+std::uint32_t SceneDesc::find_node( std::string_view aName ) const noexcept
+{
+	for( std::size_t i = 0; i < nodes.size(); ++i )
+	{
+		if( nodes[i].name == aName )
+			return std::uint32_t(i);
+	}
+	return kNoSceneIndex;
+}
+std::uint32_t SceneDesc::find_path( std::string_view aName ) const noexcept
+{
+	for( std::size_t i = 0; i < paths.size(); ++i )
+	{
+		if( paths[i].name == aName )
+			return std::uint32_t(i);
+	}
+	return kNoSceneIndex;
+}
+
+SceneDesc compile_scene( char const* aJsonPath, std::vector<std::string>* aSources, std::string const& aCacheDir, std::pmr::memory_resource* aResource )
+{
+	auto const doc = load_json( aJsonPath );
+	auto const& root = doc.root();
+
+	if( aSources )
+		aSources->emplace_back( aJsonPath );
+
+	SceneDesc scene;
+
+	if( auto const* materials = root.find( "materials" ) )
+	{
+		for( auto const& mat : materials->as_array() )
+		{
+			auto& out = scene.materials.emplace_back();
+			out.name = mat["name"].as_string();
+			if( auto const* color = mat.find( "color" ) )
+				out.color = vec3_( *color );
+			out.texture = mat.string_or( "texture", "" );
+		}
+	}
+
+	if( auto const* meshes = root.find( "meshes" ) )
+	{
+		for( auto const& mesh : meshes->as_array() )
+		{
+			std::string name = mesh["name"].as_string();
+
+			std::uint32_t material = kNoSceneIndex;
+			Vec3f color{ 1.f, 1.f, 1.f };
+			if( auto const* mat = mesh.find( "material" ) )
+			{
+				material = lookup_( scene.materials, *mat, "material" );
+				color = scene.materials[material].color;
+			}
+
+			if( mesh.bool_or( "stream", false ) )
+			{
+				auto const& obj = mesh["obj"].as_string();
+				if( aSources )
+					aSources->emplace_back( obj );
+
+				scene.meshes.emplace_back( SceneMesh{ std::move(name), material, SimpleMeshData( aResource ), import_streamed_mesh_( obj, color, aCacheDir, aSources ) } );
+				continue;
+			}
+
+			// Constructed in place: assigning the data would copy it out of
+			// aResource.
+			scene.meshes.emplace_back( SceneMesh{ std::move(name), material, make_mesh_( mesh, color, aSources, aResource ), {} } );
+		}
+	}
+
+	if( auto const* nodes = root.find( "nodes" ) )
+	{
+		for( auto const& node : nodes->as_array() )
+		{
+			SceneNodeDesc out;
+			out.name = node["name"].as_string();
+
+			if( auto const* parent = node.find( "parent" ) )
+				out.parent = lookup_( scene.nodes, *parent, "parent node" );
+			if( auto const* mesh = node.find( "mesh" ) )
+				out.mesh = lookup_( scene.meshes, *mesh, "mesh" );
+
+			out.transform = node_transform_( node );
+			scene.nodes.emplace_back( std::move(out) );
+		}
+	}
+
+	if( auto const* paths = root.find( "paths" ) )
+	{
+		for( auto const& path : paths->as_array() )
+		{
+			auto& out = scene.paths.emplace_back();
+			out.name = path["name"].as_string();
+
+			auto const curve = path.string_or( "curve", "catmull-rom" );
+			if( "catmull-rom" == curve )
+				out.curve = EPathCurve::catmullRom;
+			else if( "bezier" == curve )
+				out.curve = EPathCurve::bezier;
+			else
+				throw Error( "%s:%d: unknown curve '%s'", path.source(), path.line(), curve.c_str() );
+
+			out.duration = path["duration"].as_float();
+			out.loop = path.bool_or( "loop", false );
+
+			for( auto const& point : path["points"].as_array() )
+				out.points.emplace_back( vec3_( point ) );
+
+			make_flight_path( out ); // validate
+		}
+	}
+
+	return scene;
+}
+
+void save_scene_binary( SceneDesc const& aScene, char const* aPath, std::vector<std::string> const& aSources )
+{
+	Writer_ out;
+	out.raw( kSceneMagic_, sizeof(kSceneMagic_) );
+	out.value( kSceneVersion_ );
+
+	out.value( std::uint32_t(aSources.size()) );
+	for( auto const& source : aSources )
+	{
+		SourceStamp_ stamp{};
+		if( !stamp_( source, stamp ) )
+			throw Error( "save_scene_binary(): unable to stat source '%s'", source.c_str() );
+
+		out.string( source );
+		out.value( stamp );
+	}
+
+	out.value( std::uint32_t(aScene.materials.size()) );
+	for( auto const& mat : aScene.materials )
+	{
+		out.string( mat.name );
+		out.value( mat.color );
+		out.string( mat.texture );
+	}
+
+	out.value( std::uint32_t(aScene.meshes.size()) );
+	for( auto const& mesh : aScene.meshes )
+	{
+		out.string( mesh.name );
+		out.value( mesh.material );
+		out.string( mesh.streamed );
+		out.array( mesh.data.positions );
+		out.array( mesh.data.colors );
+		out.array( mesh.data.normals );
+		out.array( mesh.data.texcoords );
+	}
+
+	out.value( std::uint32_t(aScene.nodes.size()) );
+	for( auto const& node : aScene.nodes )
+	{
+		out.string( node.name );
+		out.value( node.parent );
+		out.value( node.mesh );
+		out.value( node.transform );
+	}
+
+	out.value( std::uint32_t(aScene.paths.size()) );
+	for( auto const& path : aScene.paths )
+	{
+		out.string( path.name );
+		out.value( std::uint32_t(path.curve) );
+		out.value( path.duration );
+		out.value( std::uint8_t(path.loop) );
+		out.array( path.points );
+	}
+
+	// Write to a temporary file first, so that readers never observe a
+	// partially written file.
+	std::string const temp = std::string(aPath) + ".tmp";
+
+	std::FILE* fout = std::fopen( temp.c_str(), "wb" );
+	if( !fout )
+		throw Error( "save_scene_binary(): unable to open '%s' for writing", temp.c_str() );
+
+	auto const& buffer = out.buffer();
+	auto const written = std::fwrite( buffer.data(), 1, buffer.size(), fout );
+	bool const failed = 0 != std::fclose( fout ) || written != buffer.size();
+
+	std::error_code ec;
+	if( !failed )
+		std::filesystem::rename( temp, aPath, ec );
+
+	if( failed || ec )
+	{
+		std::filesystem::remove( temp, ec );
+		throw Error( "save_scene_binary(): unable to write '%s'", aPath );
+	}
+}
+
+SceneDesc load_scene_binary( char const* aPath, bool aCheckSources, std::pmr::memory_resource* aResource )
+{
+	Reader_ in( read_file_( aPath ), aPath );
+
+	char magic[4];
+	in.raw( magic, sizeof(magic) );
+	if( 0 != std::memcmp( magic, kSceneMagic_, sizeof(magic) ) )
+		throw Error( "Scene '%s': not a binary scene", aPath );
+	if( auto const version = in.value<std::uint32_t>(); kSceneVersion_ != version )
+		throw Error( "Scene '%s': unsupported version %u", aPath, version );
+
+	for( auto i = in.value<std::uint32_t>(); i > 0; --i )
+	{
+		auto const source = in.string();
+		auto const expected = in.value<SourceStamp_>();
+
+		SourceStamp_ current{};
+		if( aCheckSources && (!stamp_( source, current ) || current.size != expected.size || current.time != expected.time) )
+			throw Error( "Scene '%s': source '%s' has changed", aPath, source.c_str() );
+	}
+
+	SceneDesc scene;
+
+	// Smallest encodings: empty strings and arrays
+	constexpr std::size_t kString = sizeof(std::uint32_t), kArray = sizeof(std::uint64_t);
+
+	scene.materials.resize( in.count( kString + sizeof(Vec3f) + kString ) );
+	for( auto& mat : scene.materials )
+	{
+		mat.name = in.string();
+		mat.color = in.value<Vec3f>();
+		mat.texture = in.string();
+	}
+
+	auto const meshCount = in.count( kString + sizeof(std::uint32_t) + kString + 4*kArray );
+	scene.meshes.reserve( meshCount );
+	for( std::uint32_t i = 0; i < meshCount; ++i )
+	{
+		auto& mesh = scene.meshes.emplace_back( SceneMesh{ {}, kNoSceneIndex, SimpleMeshData( aResource ), {} } );
+		mesh.name = in.string();
+		mesh.material = in.index( scene.materials.size() );
+		mesh.streamed = in.string();
+
+		std::error_code ec;
+		if( aCheckSources && !mesh.streamed.empty() && !std::filesystem::exists( mesh.streamed, ec ) )
+			throw Error( "Scene '%s': mesh cache '%s' is missing", aPath, mesh.streamed.c_str() );
+
+		in.array( mesh.data.positions );
+		in.array( mesh.data.colors );
+		in.array( mesh.data.normals );
+		in.array( mesh.data.texcoords );
+	}
+
+	scene.nodes.resize( in.count( kString + 2*sizeof(std::uint32_t) + sizeof(Mat44f) ) );
+	for( std::size_t i = 0; i < scene.nodes.size(); ++i )
+	{
+		auto& node = scene.nodes[i];
+		node.name = in.string();
+		node.parent = in.index( i ); // parents come first
+		node.mesh = in.index( scene.meshes.size() );
+		node.transform = in.value<Mat44f>();
+	}
+
+	scene.paths.resize( in.count( kString + sizeof(std::uint32_t) + sizeof(float) + sizeof(std::uint8_t) + kArray ) );
+	for( auto& path : scene.paths )
+	{
+		path.name = in.string();
+		auto const curve = in.value<std::uint32_t>();
+		if( curve > std::uint32_t(EPathCurve::bezier) )
+			throw Error( "Scene '%s': invalid curve %u", aPath, curve );
+
+		path.curve = EPathCurve(curve);
+		path.duration = in.value<float>();
+		path.loop = 0 != in.value<std::uint8_t>();
+		in.array( path.points );
+	}
+
+	return scene;
+}
+
+SceneDesc load_scene( char const* aPath, std::string const& aCacheDir, std::pmr::memory_resource* aResource )
+{
+	if( std::string_view( aPath ).ends_with( kBinaryExtension_ ) )
+		return load_scene_binary( aPath, false, aResource );
+
+	std::string cachePath;
+	if( !aCacheDir.empty() )
+	{
+		cachePath = cache_path_( aPath, aCacheDir );
+
+		std::error_code ec;
+		if( std::filesystem::exists( cachePath, ec ) )
+		{
+			try
+			{
+				return load_scene_binary( cachePath.c_str(), true, aResource );
+			}
+			catch( Error const& eErr )
+			{
+				std::fprintf( stderr, "%s. Recompiling.\n", eErr.what() );
+			}
+		}
+	}
+
+	std::vector<std::string> sources;
+	auto scene = compile_scene( aPath, &sources, aCacheDir, aResource );
+
+	if( !cachePath.empty() )
+	{
+		// The cache is an optimization only; failing to write it is not fatal.
+		try
+		{
+			std::error_code ec;
+			std::filesystem::create_directories( aCacheDir, ec );
+			save_scene_binary( scene, cachePath.c_str(), sources );
+		}
+		catch( Error const& eErr )
+		{
+			std::fprintf( stderr, "%s\n", eErr.what() );
+		}
+	}
+
+	return scene;
+}
+
+FlightPath make_flight_path( ScenePath const& aPath )
+{
+	return FlightPath( aPath.curve, aPath.points, aPath.duration, aPath.loop );
+}
+
+SimpleMeshData bake_scene_subtree( SceneDesc const& aScene, std::uint32_t aRoot, std::pmr::memory_resource* aResource )
+{
+	assert( aRoot < aScene.nodes.size() );
+
+	// Transforms relative to aRoot. Since parents come before their children,
+	// a single pass from aRoot onwards finds the whole subtree.
+	std::vector<Mat44f> relative( aScene.nodes.size(), kIdentity44f );
+	std::vector<std::uint8_t> inside( aScene.nodes.size(), 0 );
+
+	std::vector<std::uint32_t> meshNodes;
+	std::size_t total = 0;
+	for( std::size_t i = aRoot; i < aScene.nodes.size(); ++i )
+	{
+		auto const& node = aScene.nodes[i];
+		if( i != aRoot )
+		{
+			if( kNoSceneIndex == node.parent || !inside[node.parent] )
+				continue;
+
+			relative[i] = relative[node.parent] * node.transform;
+		}
+
+		inside[i] = 1;
+
+		if( kNoSceneIndex != node.mesh )
+		{
+			meshNodes.emplace_back( std::uint32_t(i) );
+			total += aScene.meshes[node.mesh].data.positions.size();
+		}
+	}
+
+	SimpleMeshData ret( aResource );
+	ret.positions.reserve( total );
+	ret.colors.reserve( total );
+	ret.normals.reserve( total );
+	ret.texcoords.reserve( total );
+
+	for( auto const i : meshNodes )
+		append_mesh_( ret, aScene.meshes[aScene.nodes[i].mesh].data, relative[i] );
+
+	return ret;
+}
+
+SceneGpu create_scene_gpu( SceneDesc const& aScene, bool aQuantize )
+{
+	SceneGpu ret;
+
+	// Pack all meshes into one set of buffers.
+	std::size_t total = 0;
+	for( auto const& mesh : aScene.meshes )
+		total += mesh.data.positions.size();
+
+	SimpleMeshData packed;
+	QuantizedVertices quantized;
+	if( aQuantize )
+	{
+		quantized.positions.reserve( 4*total );
+		quantized.normals.reserve( total );
+		quantized.colors.reserve( total );
+		quantized.texcoords.reserve( total );
+	}
+	else
+	{
+		packed.positions.reserve( total );
+		packed.colors.reserve( total );
+		packed.normals.reserve( total );
+		packed.texcoords.reserve( total );
+	}
+
+	for( auto const& mesh : aScene.meshes )
+	{
+		auto& range = ret.meshes.emplace_back();
+		if( !mesh.streamed.empty() )
+		{
+			create_vao_streamed_( mesh.streamed.c_str(), range );
+			continue;
+		}
+
+		auto const [center, radius] = bounding_sphere_( mesh.data.positions );
+		auto const count = mesh.data.positions.size();
+		if( !aQuantize )
+		{
+			range = SceneGpu::Range{ 0, packed.positions.size(), count, center, radius };
+			append_mesh_( packed, mesh.data, kIdentity44f );
+			continue;
+		}
+
+		auto const first = quantized.size();
+		auto const decode = quantize_mesh( mesh.data, quantized );
+		range = SceneGpu::Range{ 0, first, count, center, radius, true, decode };
+
+		auto const error = quantization_error( mesh.data, quantized, first, decode );
+		std::printf( "Quantized '%s': %zu vertices, %.1f kB saved; max. error: position %g, normal %.3f deg, color %.4f, texcoord %g\n",
+			mesh.name.c_str(), count, double(count * (kFloatVertexBytes - kQuantizedVertexBytes)) / 1024.,
+			double(error.position), double(error.normal), double(error.color), double(error.texcoord)
+		);
+	}
+
+	if( aQuantize )
+	{
+		ret.vao = create_vao( quantized );
+		std::printf( "Quantized %zu vertices: %.1f MB instead of %.1f MB\n", quantized.size(),
+			double(quantized.size() * kQuantizedVertexBytes) / (1024.*1024.),
+			double(quantized.size() * kFloatVertexBytes) / (1024.*1024.)
+		);
+	}
+	else
+	{
+		ret.vao = create_vao( packed );
+	}
+
+	for( auto& range : ret.meshes )
+	{
+		if( 0 == range.vao )
+			range.vao = ret.vao;
+	}
+
+	// Load each texture once, even if several materials share it.
+	for( std::size_t i = 0; i < aScene.materials.size(); ++i )
+	{
+		auto const& texture = aScene.materials[i].texture;
+
+		GLuint id = 0;
+		for( std::size_t j = 0; j < i && !texture.empty(); ++j )
+		{
+			if( aScene.materials[j].texture == texture )
+				id = ret.textures[j];
+		}
+
+		if( 0 == id && !texture.empty() )
+			id = load_texture_2d( texture.c_str() );
+
+		ret.textures.emplace_back( id );
+	}
+
+	return ret;
+}
+
+void destroy_scene_gpu( SceneGpu& aScene )
+{
+	for( auto const& range : aScene.meshes )
+	{
+		if( range.vao != aScene.vao )
+			glDeleteVertexArrays( 1, &range.vao );
+	}
+
+	glDeleteVertexArrays( 1, &aScene.vao );
+	aScene.vao = 0;
+
+	// Shared textures appear more than once.
+	std::sort( aScene.textures.begin(), aScene.textures.end() );
+	aScene.textures.erase( std::unique( aScene.textures.begin(), aScene.textures.end() ), aScene.textures.end() );
+	for( auto const id : aScene.textures )
+	{
+		if( id )
+			glDeleteTextures( 1, &id );
+	}
+
+	aScene.textures.clear();
+	aScene.meshes.clear();
+}
@@ -0,0 +1,150 @@
+#ifndef SCENE_FILE_HPP_A63F0D95_1E7B_4C2A_8D54_F290B7E3C618
+#define SCENE_FILE_HPP_A63F0D95_1E7B_4C2A_8D54_F290B7E3C618
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <string_view>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+#include "simple_mesh.hpp"
+#include "flight_path.hpp"
+#include "vertex_quant.hpp"
+
+constexpr std::uint32_t kNoSceneIndex = ~std::uint32_t(0);
+
+struct SceneMaterial
+{
+	std::string name;
+	Vec3f color{ 1.f, 1.f, 1.f }; // vertex color of procedural meshes
+	std::string texture; // path, or empty
+};
+
+struct SceneMesh
+{
+	std::string name;
+	std::uint32_t material = kNoSceneIndex;
+	SimpleMeshData data; // empty if streamed
+	std::string streamed; // mesh cache (see import_wavefront_obj()), or empty
+};
+
+struct SceneNodeDesc
+{
+	std::string name;
+	std::uint32_t parent = kNoSceneIndex; // always < own index
+	std::uint32_t mesh = kNoSceneIndex;
+	Mat44f transform = kIdentity44f; // relative to parent
+};
+
+struct ScenePath
+{
+	std::string name;
+	EPathCurve curve = EPathCurve::catmullRom;
+	float duration = 1.f;
+	bool loop = false;
+	std::vector<Vec3f> points;
+};
+
+/* SceneDesc: contents of a scene file
+ *
+ * Scenes are authored as JSON (see assets/cw2/scene.json), with four arrays:
+ *  - materials: { name, color: [r,g,b], texture: path }
+ *  - meshes: { name, material, obj: path, stream } or { name, material,
+ *    primitive: "cylinder" | "cone" | "cube", subdivs, capped }. Primitives
+ *    are colored with their material's color.
+ *  - nodes: { name, parent, mesh, translate: [x,y,z], rotate: [x,y,z] in
+ *    degrees, scale: s or [x,y,z] }. The transform is T * Rz * Ry * Rx * S.
+ *  - paths: { name, curve: "catmull-rom" | "bezier", duration, loop, points }
+ * Only name is required (and primitive/obj for meshes, duration/points for
+ * paths). References are by name, to entries declared earlier.
+ * The obj path may also name a compressed mesh (see mesh_codec.hpp), except
+ * for streamed meshes.
+ *
+ * Scenes are compiled into a binary form. Compiling loads the OBJ files and
+ * generates the procedural meshes; the binary form stores the resulting
+ * vertex data, such that loading it is little more than a few large reads.
+ *
+ * OBJ meshes with "stream": true (for files too large to load into memory)
+ * are instead imported into a mesh cache file of their own, which the binary
+ * refers to. Their data is never loaded into memory as a whole; it goes
+ * straight from the cache file to the GPU. They are not included in
+ * bake_scene_subtree() and the path tracer.
+ */
+struct SceneDesc
+{
+	std::vector<SceneMaterial> materials;
+	std::vector<SceneMesh> meshes;
+	std::vector<SceneNodeDesc> nodes;
+	std::vector<ScenePath> paths;
+
+	// kNoSceneIndex if not found
+	std::uint32_t find_node( std::string_view ) const noexcept;
+	std::uint32_t find_path( std::string_view ) const noexcept;
+};
+
+// Parses a JSON scene and builds all meshes. If aSources is given, it
+// receives the files that the result depends on. Streamed meshes are
+// imported into aCacheDir (the current directory if empty); their caches are
+// reused while they are newer than the OBJ file and its material libraries.
+//
+// The loaders allocate the meshes' vertex data from aResource (see
+// MeshArena). Everything else uses the heap.
+SceneDesc compile_scene( char const* aJsonPath, std::vector<std::string>* aSources = nullptr, std::string const& aCacheDir = {}, std::pmr::memory_resource* = std::pmr::get_default_resource() );
+
+// Binary form. The binary records the files that it was compiled from (the
+// JSON file and any OBJ files), so that stale binaries can be detected.
+void save_scene_binary( SceneDesc const&, char const* aPath, std::vector<std::string> const& aSources );
+SceneDesc load_scene_binary( char const* aPath, bool aCheckSources, std::pmr::memory_resource* = std::pmr::get_default_resource() );
+
+// Loads a scene from either form. For JSON scenes, the compiled binary is
+// cached in aCacheDir and reused until one of its sources changes. An empty
+// aCacheDir disables the cache.
+SceneDesc load_scene( char const* aPath, std::string const& aCacheDir, std::pmr::memory_resource* = std::pmr::get_default_resource() );
+
+FlightPath make_flight_path( ScenePath const& );
+
+// Merges the meshes below (and including) aRoot into one mesh, expressed in
+// aRoot's coordinate system.
+SimpleMeshData bake_scene_subtree( SceneDesc const&, std::uint32_t aRoot, std::pmr::memory_resource* = std::pmr::get_default_resource() );
+
+/* SceneGpu: GPU resources of a scene
+ *
+ * All meshes share a single VAO (and one buffer per attribute); each mesh is
+ * a range of vertices in it, with a bounding sphere in mesh coordinates for
+ * culling. Textures are loaded once per material.
+ *
+ * With aQuantize, the shared buffers hold QuantizedVertices instead, and each
+ * range carries its VertexDecode (draw those with the kShaderQuantized
+ * variants). The quantization error and the memory saved are printed per
+ * mesh. Streamed meshes keep their float attributes.
+ */
+struct SceneGpu
+{
+	struct Range
+	{
+		GLuint vao; // the shared VAO, or the mesh's own if streamed
+		std::size_t first;
+		std::size_t count;
+
+		Vec3f center;
+		float radius;
+
+		bool quantized = false;
+		VertexDecode decode; // if quantized
+	};
+
+	GLuint vao = 0;
+	std::vector<Range> meshes;
+	std::vector<GLuint> textures; // per material; 0 if untextured
+};
+
+SceneGpu create_scene_gpu( SceneDesc const&, bool aQuantize = false );
+void destroy_scene_gpu( SceneGpu& );
+
+#endif // SCENE_FILE_HPP_A63F0D95_1E7B_4C2A_8D54_F290B7E3C618
@@ -0,0 +1,116 @@
+#include "scene_graph.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+
+#if defined(__SSE__) || defined(_M_X64)
+#	include <xmmintrin.h>
+#	define SCENE_GRAPH_SSE_ 1
+#endif
+
+SceneNode SceneGraph::add_node( SceneNode aParent, Mat44f const& aLocal )
+{
+	assert( kNoSceneNode == aParent || aParent < mParents.size() );
+
+	auto const node = SceneNode(mParents.size());
+	mParents.emplace_back( aParent );
+	mLocal.emplace_back( aLocal );
+	mWorld.emplace_back( kIdentity44f );
+	mDirty.emplace_back( 1 );
+
+	mAnyDirty = true;
+	return node;
+}
+
+void SceneGraph::set_local( SceneNode aNode, Mat44f const& aLocal )
+{
+	assert( aNode < mLocal.size() );
+	mLocal[aNode] = aLocal;
+	mDirty[aNode] = 1;
+	mAnyDirty = true;
+}
+
+std::size_t SceneGraph::update()
+{
+	if( !mAnyDirty )
+		return 0;
+
+	mBatchLeft.clear();
+	mBatchRight.clear();
+	mBatchOut.clear();
+
+	// Parents come first, so a single pass propagates the dirty flags down
+	// the hierarchy, and produces the updates in a valid order.
+	for( std::size_t i = 0; i < mParents.size(); ++i )
+	{
+		auto const parent = mParents[i];
+		if( kNoSceneNode != parent )
+			mDirty[i] |= mDirty[parent];
+
+		if( !mDirty[i] )
+			continue;
+
+		mBatchLeft.emplace_back( kNoSceneNode != parent ? &mWorld[parent] : &kIdentity44f );
+		mBatchRight.emplace_back( &mLocal[i] );
+		mBatchOut.emplace_back( &mWorld[i] );
+	}
+
+	multiply_batch( mBatchLeft.data(), mBatchRight.data(), mBatchOut.data(), mBatchOut.size() );
+
+	std::fill( mDirty.begin(), mDirty.end(), std::uint8_t(0) );
+	mAnyDirty = false;
+
+	return mBatchOut.size();
+}
+
+std::size_t SceneGraph::size() const noexcept
+{
+	return mParents.size();
+}
+
+SceneNode SceneGraph::parent( SceneNode aNode ) const noexcept
+{
+	assert( aNode < mParents.size() );
+	return mParents[aNode];
+}
+
+Mat44f const& SceneGraph::local( SceneNode aNode ) const noexcept
+{
+	assert( aNode < mLocal.size() );
+	return mLocal[aNode];
+}
+Mat44f const& SceneGraph::world( SceneNode aNode ) const noexcept
+{
+	assert( aNode < mWorld.size() );
+	return mWorld[aNode];
+}
+
+void multiply_batch( Mat44f const* const* aLeft, Mat44f const* const* aRight, Mat44f* const* aOut, std::size_t aCount ) noexcept
+{
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		float const* a = aLeft[i]->v;
+		float const* b = aRight[i]->v;
+		float* c = aOut[i]->v;
+
+#		if defined(SCENE_GRAPH_SSE_)
+		// Row-major: row r of the result is sum_k a(r,k) * (row k of b).
+		__m128 const b0 = _mm_loadu_ps( b+0 );
+		__m128 const b1 = _mm_loadu_ps( b+4 );
+		__m128 const b2 = _mm_loadu_ps( b+8 );
+		__m128 const b3 = _mm_loadu_ps( b+12 );
+
+		for( std::size_t r = 0; r < 4; ++r )
+		{
+			__m128 row = _mm_mul_ps( _mm_set1_ps( a[4*r+0] ), b0 );
+			row = _mm_add_ps( row, _mm_mul_ps( _mm_set1_ps( a[4*r+1] ), b1 ) );
+			row = _mm_add_ps( row, _mm_mul_ps( _mm_set1_ps( a[4*r+2] ), b2 ) );
+			row = _mm_add_ps( row, _mm_mul_ps( _mm_set1_ps( a[4*r+3] ), b3 ) );
+			_mm_storeu_ps( c + 4*r, row );
+		}
+#		else // !SCENE_GRAPH_SSE_
+		*aOut[i] = *aLeft[i] * *aRight[i];
+#		endif // ~ SCENE_GRAPH_SSE_
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef SCENE_GRAPH_HPP_8F4A1C27_6D3E_4B95_B0E2_93A7C5D16F48
+#define SCENE_GRAPH_HPP_8F4A1C27_6D3E_4B95_B0E2_93A7C5D16F48
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/mat44.hpp"
+
+using SceneNode = std::uint32_t;
+
+constexpr SceneNode kNoSceneNode = ~SceneNode(0);
+
+/* SceneGraph: hierarchy of transforms
+ *
+ * Each node has a local transform (relative to its parent) and a world
+ * transform (model-to-world). Nodes are stored in flat arrays. A node can
+ * only be added after its parent, so the arrays are always topologically
+ * sorted: parents come before their children.
+ *
+ * set_local() only marks the node as dirty. update() then recomputes the
+ * world transforms of dirty nodes and of everything below them, in a single
+ * forward pass over the arrays. Clean subtrees are skipped entirely. The
+ * multiplications themselves are batched and use SSE where available.
+ */
+class SceneGraph final
+{
+	public:
+		SceneNode add_node( SceneNode aParent = kNoSceneNode, Mat44f const& aLocal = kIdentity44f );
+
+		void set_local( SceneNode, Mat44f const& );
+
+	public:
+		// Recomputes the dirty world transforms. Returns the number of
+		// nodes that were updated.
+		std::size_t update();
+
+	public:
+		std::size_t size() const noexcept;
+
+		SceneNode parent( SceneNode ) const noexcept;
+
+		Mat44f const& local( SceneNode ) const noexcept;
+		Mat44f const& world( SceneNode ) const noexcept; // valid after update()
+
+	private:
+		std::vector<SceneNode> mParents;
+		std::vector<Mat44f> mLocal;
+		std::vector<Mat44f> mWorld;
+		std::vector<std::uint8_t> mDirty;
+
+		bool mAnyDirty = false;
+
+		// Scratch space for update()
+		std::vector<Mat44f const*> mBatchLeft, mBatchRight;
+		std::vector<Mat44f*> mBatchOut;
+};
+
+// *aOut[i] = *aLeft[i] * *aRight[i] for i = 0, 1, ..., aCount-1, in order.
+// An input may refer to an earlier output (e.g., aLeft[j] == aOut[i] with
+// i < j), but not to the output of the same or a later entry.
+void multiply_batch( Mat44f const* const* aLeft, Mat44f const* const* aRight, Mat44f* const* aOut, std::size_t aCount ) noexcept;
+
+#endif // SCENE_GRAPH_HPP_8F4A1C27_6D3E_4B95_B0E2_93A7C5D16F48
@@ -0,0 +1,149 @@
+#include "shadow_maps.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+
+#include "../support/error.hpp"
+
+namespace
+{
+	// Slope-scaled depth offset while rendering the casters
+	constexpr float kOffsetFactor_ = 2.f;
+	constexpr float kOffsetUnits_ = 4.f;
+
+	// Normal offset during lookups, in texels of the cascade
+	constexpr float kNormalOffset_ = 1.5f;
+}
+
+ShadowMaps::ShadowMaps( CascadeParams const& aParams )
+	: mParams( aParams )
+{
+	mParams.count = std::min( mParams.count, kMaxShadowCascades );
+	assert( mParams.count > 0 && mParams.resolution > 0 );
+
+	auto const size = GLsizei(mParams.resolution);
+
+	glGenTextures( 1, &mTexture );
+	glBindTexture( GL_TEXTURE_2D_ARRAY, mTexture );
+	glTexStorage3D( GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, size, size, GLsizei(mParams.count) );
+
+	// Linear filtering of a depth comparison gives a 2x2 PCF per lookup.
+	// Outside of the map, everything is lit.
+	GLfloat const border[] = { 1.f, 1.f, 1.f, 1.f };
+	glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE );
+	glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL );
+	glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
+	glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
+	glTexParameterfv( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border );
+
+	glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+
+	glGenFramebuffers( GLsizei(mParams.count), mFramebuffers );
+	for( std::size_t i = 0; i < mParams.count; ++i )
+	{
+		glBindFramebuffer( GL_FRAMEBUFFER, mFramebuffers[i] );
+		glFramebufferTextureLayer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTexture, 0, GLint(i) );
+		glDrawBuffer( GL_NONE );
+		glReadBuffer( GL_NONE );
+
+		if( auto const status = glCheckFramebufferStatus( GL_FRAMEBUFFER ); GL_FRAMEBUFFER_COMPLETE != status )
+		{
+			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+			glDeleteFramebuffers( GLsizei(mParams.count), mFramebuffers );
+			glDeleteTextures( 1, &mTexture );
+			throw Error( "ShadowMaps: framebuffer incomplete (%x)", unsigned(status) );
+		}
+	}
+
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+ShadowMaps::~ShadowMaps()
+{
+	glDeleteFramebuffers( GLsizei(mParams.count), mFramebuffers );
+	glDeleteTextures( 1, &mTexture );
+}
+
+void ShadowMaps::update( CascadeView const& aView, Vec3f aToLight )
+{
+	[[maybe_unused]] auto const count = fit_cascades( aView, aToLight, mParams, mCascades );
+	assert( count == mParams.count );
+
+	for( std::size_t i = 0; i < mParams.count; ++i )
+	{
+		std::copy_n( mCascades[i].viewProjection.v, 16, mMatrices + 16*i );
+		mSplits[i] = mCascades[i].splitFar;
+		mNormalOffsets[i] = kNormalOffset_ * mCascades[i].texelSize;
+	}
+}
+
+void ShadowMaps::begin_cascade( std::size_t aCascade )
+{
+	assert( aCascade < mParams.count );
+
+	mTimers[aCascade].begin();
+
+	glBindFramebuffer( GL_FRAMEBUFFER, mFramebuffers[aCascade] );
+	glViewport( 0, 0, GLsizei(mParams.resolution), GLsizei(mParams.resolution) );
+	glClear( GL_DEPTH_BUFFER_BIT );
+
+	// Casters between the light and the cascade are clamped to its near
+	// plane, rather than clipped.
+	glEnable( GL_DEPTH_CLAMP );
+	glEnable( GL_POLYGON_OFFSET_FILL );
+	glPolygonOffset( kOffsetFactor_, kOffsetUnits_ );
+}
+
+void ShadowMaps::end_cascade( std::size_t aCascade )
+{
+	assert( aCascade < mParams.count );
+	mTimers[aCascade].end();
+}
+
+void ShadowMaps::end_pass( GLsizei aViewportWidth, GLsizei aViewportHeight )
+{
+	glDisable( GL_POLYGON_OFFSET_FILL );
+	glDisable( GL_DEPTH_CLAMP );
+
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	glViewport( 0, 0, aViewportWidth, aViewportHeight );
+}
+
+void ShadowMaps::set_uniforms() const
+{
+	auto const count = GLsizei(mParams.count);
+
+	glUniformMatrix4fv( 8, count, GL_TRUE, mMatrices );
+	glUniform1fv( 12, count, mSplits );
+	glUniform1i( 16, GLint(count) );
+	glUniform1fv( 17, count, mNormalOffsets );
+
+	glActiveTexture( GL_TEXTURE1 );
+	glBindTexture( GL_TEXTURE_2D_ARRAY, mTexture );
+	glActiveTexture( GL_TEXTURE0 );
+}
+
+CascadeParams const& ShadowMaps::params() const noexcept
+{
+	return mParams;
+}
+
+std::size_t ShadowMaps::cascade_count() const noexcept
+{
+	return mParams.count;
+}
+
+Cascade const& ShadowMaps::cascade( std::size_t aCascade ) const noexcept
+{
+	assert( aCascade < mParams.count );
+	return mCascades[aCascade];
+}
+
+float ShadowMaps::gpu_time( std::size_t aCascade ) const noexcept
+{
+	assert( aCascade < mParams.count );
+	return mTimers[aCascade].elapsed();
+}
@@ -0,0 +1,73 @@
+#ifndef SHADOW_MAPS_HPP_C3E07B5A_84D1_4F29_A6B3_5D92E1F07C48
+#define SHADOW_MAPS_HPP_C3E07B5A_84D1_4F29_A6B3_5D92E1F07C48
+
+#include <glad/glad.h>
+
+#include <cstdlib>
+
+#include "../support/gpu_timer.hpp"
+
+#include "cascades.hpp"
+
+/* ShadowMaps: cascaded shadow maps for the directional light
+ *
+ * One depth layer per cascade, in a single array texture. Each frame,
+ * update() refits the cascades to the view. The caller then renders the
+ * shadow casters into each cascade, between begin_cascade() and
+ * end_cascade(), and finishes with end_pass().
+ *
+ * The object shaders (FEATURE_SHADOWS) pick the cascade by view depth and
+ * filter with 3x3 PCF; set_uniforms() sets up the current program. Shadow
+ * acne is avoided with slope-scaled depth offsets during rendering and a
+ * normal offset of about a texel during lookups.
+ *
+ * Each cascade is timed on the GPU.
+ */
+class ShadowMaps final
+{
+	public:
+		explicit ShadowMaps( CascadeParams const& );
+		~ShadowMaps();
+
+		ShadowMaps( ShadowMaps const& ) = delete;
+		ShadowMaps& operator= (ShadowMaps const&) = delete;
+
+	public:
+		void update( CascadeView const&, Vec3f aToLight );
+
+		// Binds and clears the cascade's depth layer.
+		void begin_cascade( std::size_t );
+		void end_cascade( std::size_t );
+
+		// Rebinds the default framebuffer.
+		void end_pass( GLsizei aViewportWidth, GLsizei aViewportHeight );
+
+		// Sets the FEATURE_SHADOWS uniforms of the current program (see
+		// objects.frag) and binds the shadow map to texture unit 1.
+		void set_uniforms() const;
+
+	public:
+		CascadeParams const& params() const noexcept;
+
+		std::size_t cascade_count() const noexcept;
+		Cascade const& cascade( std::size_t ) const noexcept;
+
+		float gpu_time( std::size_t ) const noexcept; // seconds
+
+	private:
+		CascadeParams mParams;
+
+		GLuint mTexture = 0;
+		GLuint mFramebuffers[kMaxShadowCascades] = {};
+
+		Cascade mCascades[kMaxShadowCascades];
+
+		// Uniforms, in the form the shaders want them
+		float mMatrices[16*kMaxShadowCascades];
+		float mSplits[kMaxShadowCascades];
+		float mNormalOffsets[kMaxShadowCascades];
+
+		GpuTimer mTimers[kMaxShadowCascades];
+};
+
+#endif // SHADOW_MAPS_HPP_C3E07B5A_84D1_4F29_A6B3_5D92E1F07C48
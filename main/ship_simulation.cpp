@@ -0,0 +1,172 @@
+#include "ship_simulation.hpp"
+
+#include <numbers>
+#include <algorithm>
+
+namespace
+{
+	constexpr std::uint32_t kCmdToggle_ = 1u << 0;
+	constexpr std::uint32_t kCmdReset_ = 1u << 1;
+
+	constexpr auto kStepDuration_ = std::chrono::duration_cast<Clock::duration>( Secondsf( ShipSimulation::kTimeStep ) );
+
+	Vec3f lerp_( Vec3f aA, Vec3f aB, float aT ) noexcept
+	{
+		return aA + (aB - aA) * aT;
+	}
+}
+
+ShipState make_initial_ship_state( ShipParams const& aParams ) noexcept
+{
+	ShipState state;
+	state.speed = aParams.initSpeed;
+	state.angle = aParams.initAngle;
+	state.position = aParams.initPosition;
+	return state;
+}
+
+void step_ship( ShipState& aShip, ShipParams const& aParams, float aDt ) noexcept
+{
+	if( !aShip.isAnimation ) return; // No movement if the animation is inactive
+
+	// Adjust ship movement speed
+	aShip.speed += aParams.acceleration * aDt;
+	aShip.speed = std::min( aShip.speed, aParams.maxSpeed );
+
+	// Adjust ship direction of movement
+	aShip.angle += aDt * aShip.speed / aParams.radius;
+	aShip.angle = std::min( aShip.angle, std::numbers::pi_v<float> - 0.1f );
+
+	// Define the curved trajectory
+	aShip.position.x += aDt * aParams.radius * std::sin( aShip.angle ); // Sine for horizontal motion
+	aShip.position.y += aDt * aParams.climbRate; // Linear ascent
+}
+
+ShipState interpolate( ShipState const& aPrev, ShipState const& aNext, float aAlpha ) noexcept
+{
+	ShipState ret = aNext;
+	ret.speed = aPrev.speed + (aNext.speed - aPrev.speed) * aAlpha;
+	ret.angle = aPrev.angle + (aNext.angle - aPrev.angle) * aAlpha;
+	ret.position = lerp_( aPrev.position, aNext.position, aAlpha );
+	ret.direction = lerp_( aPrev.direction, aNext.direction, aAlpha );
+	return ret;
+}
+
+ShipSimulation::ShipSimulation( ShipParams aParams, bool aOwnThread )
+	: mParams( aParams )
+	, mCommands( 0 )
+	, mTicks( 0 )
+	, mThreaded( aOwnThread )
+	, mStop( false )
+{
+	mState.current = make_initial_ship_state( mParams );
+	mState.previous = mState.current;
+	mState.currentTime = Clock::now();
+
+	mSnapshots.write_buffer() = mState;
+	mSnapshots.publish();
+
+	if( mThreaded )
+		mThread = std::thread( [this] { run_(); } );
+}
+
+ShipSimulation::~ShipSimulation()
+{
+	if( mThread.joinable() )
+	{
+		mStop = true;
+		mThread.join();
+	}
+}
+
+void ShipSimulation::toggle_animation() noexcept
+{
+	// Toggling twice before the next step cancels out, as it should.
+	mCommands.fetch_xor( kCmdToggle_ );
+}
+
+void ShipSimulation::reset() noexcept
+{
+	// A reset overrides any earlier toggles.
+	mCommands.store( kCmdReset_ );
+}
+
+ShipState ShipSimulation::update( Clock::time_point aNow )
+{
+	if( mThreaded )
+	{
+		mSnapshots.update();
+		return interpolate_( mSnapshots.read(), aNow );
+	}
+
+	unsigned steps = 0;
+	while( mState.currentTime + kStepDuration_ <= aNow )
+	{
+		if( kMaxStepsPerUpdate == steps++ )
+		{
+			// Too far behind. Drop the remaining time.
+			mState.currentTime = aNow - kStepDuration_;
+			break;
+		}
+
+		step_();
+	}
+
+	return interpolate_( mState, aNow );
+}
+
+std::uint64_t ShipSimulation::ticks() const noexcept
+{
+	return mTicks.load( std::memory_order_relaxed );
+}
+
+ShipParams const& ShipSimulation::params() const noexcept
+{
+	return mParams;
+}
+
+void ShipSimulation::step_()
+{
+	mState.previous = mState.current;
+
+	auto const cmds = mCommands.exchange( 0 );
+	if( cmds & kCmdReset_ )
+	{
+		mState.current = make_initial_ship_state( mParams );
+		mState.previous = mState.current; // don't interpolate across resets
+	}
+	if( cmds & kCmdToggle_ )
+		mState.current.isAnimation = !mState.current.isAnimation;
+
+	step_ship( mState.current, mParams, kTimeStep );
+
+	mState.currentTime += kStepDuration_;
+	mTicks.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void ShipSimulation::run_()
+{
+	while( !mStop )
+	{
+		auto const now = Clock::now();
+		if( mState.currentTime + kStepDuration_ > now )
+		{
+			std::this_thread::sleep_until( mState.currentTime + kStepDuration_ );
+			continue;
+		}
+
+		if( now - mState.currentTime > kStepDuration_ * kMaxStepsPerUpdate )
+			mState.currentTime = now - kStepDuration_;
+
+		step_();
+
+		mSnapshots.write_buffer() = mState;
+		mSnapshots.publish();
+	}
+}
+
+ShipState ShipSimulation::interpolate_( Snapshot_ const& aSnapshot, Clock::time_point aNow ) const noexcept
+{
+	float const alpha = std::chrono::duration_cast<Secondsf>(aNow - aSnapshot.currentTime).count() / kTimeStep;
+	return interpolate( aSnapshot.previous, aSnapshot.current, std::clamp( alpha, 0.f, 1.f ) );
+}
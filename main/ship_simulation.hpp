@@ -0,0 +1,113 @@
+#ifndef SHIP_SIMULATION_HPP_3E9A57C1_D842_4B6F_91A3_5C0E7F28B4D6
+#define SHIP_SIMULATION_HPP_3E9A57C1_D842_4B6F_91A3_5C0E7F28B4D6
+
+#include <atomic>
+#include <thread>
+
+#include <cstdint>
+
+#include "../vmlib/vec3.hpp"
+#include "../support/triple_buffer.hpp"
+
+#include "defaults.hpp"
+
+struct ShipParams
+{
+	Vec3f initPosition;
+
+	float initSpeed = 0.f, initAngle = 0.f, radius = 5.f, acceleration = 0.01f;
+	float maxSpeed = 5.f; // Prevent speed from going too fast
+	float climbRate = 2.f; // Vertical lift speed, units per second
+};
+
+struct ShipState
+{
+	bool isAnimation = false;
+
+	float speed = 0.f;
+	float angle = 0.f;
+
+	Vec3f position{};
+	Vec3f direction{ 0.f, 1.f, 0.f }; // up to Y axis direction
+};
+
+ShipState make_initial_ship_state( ShipParams const& ) noexcept;
+
+// Advance the ship by aDt seconds. All motion is scaled by aDt, so the
+// trajectory only depends on the total simulated time (for a fixed aDt, it
+// is fully deterministic).
+void step_ship( ShipState&, ShipParams const&, float aDt ) noexcept;
+
+// Blend two states for rendering; aAlpha = 0 gives aPrev, 1 gives aNext.
+ShipState interpolate( ShipState const& aPrev, ShipState const& aNext, float aAlpha ) noexcept;
+
+/* ShipSimulation: fixed-timestep simulation of the spaceship
+ *
+ * The simulation always advances in steps of kTimeStep, independently of the
+ * frame rate. The state shown on screen is interpolated between the last two
+ * simulated steps (so it lags the simulation by up to one step). At high
+ * frame rates, most frames therefore perform no simulation steps at all. If
+ * the simulation falls behind by more than kMaxStepsPerUpdate steps (e.g.,
+ * after a stall), the excess time is dropped rather than caught up.
+ *
+ * Optionally, the simulation runs on its own thread. That thread sleeps
+ * between steps, and publishes each step via a triple buffer, which the
+ * render thread reads without ever blocking.
+ *
+ * Input (toggle_animation(), reset()) may be issued from any thread, and
+ * takes effect at the start of the next step.
+ */
+class ShipSimulation final
+{
+	public:
+		static constexpr float kTimeStep = 1.f / 120.f;
+		static constexpr unsigned kMaxStepsPerUpdate = 8;
+
+	public:
+		explicit ShipSimulation( ShipParams, bool aOwnThread = false );
+		~ShipSimulation();
+
+		ShipSimulation( ShipSimulation const& ) = delete;
+		ShipSimulation& operator= (ShipSimulation const&) = delete;
+
+	public:
+		void toggle_animation() noexcept;
+		void reset() noexcept;
+
+		// Returns the state to render at time aNow. Without a simulation
+		// thread, this also runs any steps that are due.
+		ShipState update( Clock::time_point aNow );
+
+		// Number of steps simulated so far (approximate when threaded)
+		std::uint64_t ticks() const noexcept;
+
+		ShipParams const& params() const noexcept;
+
+	private:
+		struct Snapshot_
+		{
+			ShipState previous, current;
+			Clock::time_point currentTime;
+		};
+
+		void step_();
+		void run_();
+
+		ShipState interpolate_( Snapshot_ const&, Clock::time_point ) const noexcept;
+
+	private:
+		ShipParams mParams;
+
+		// Owned by whichever thread runs the simulation
+		Snapshot_ mState;
+
+		std::atomic<std::uint32_t> mCommands;
+		std::atomic<std::uint64_t> mTicks;
+
+		bool mThreaded;
+		std::atomic<bool> mStop;
+		TripleBuffer<Snapshot_> mSnapshots;
+		std::thread mThread;
+};
+
+#endif // SHIP_SIMULATION_HPP_3E9A57C1_D842_4B6F_91A3_5C0E7F28B4D6
@@ -1,8 +1,37 @@
 #include "simple_mesh.hpp"
 
-SimpleMeshData concatenate( std::vector<SimpleMeshData> const& aMeshes )
+#include "vertex_quant.hpp"
+
+SimpleMeshData::SimpleMeshData( std::pmr::memory_resource* aResource )
+	: positions( aResource )
+	, colors( aResource )
+	, normals( aResource )
+	, texcoords( aResource )
+{}
+
+std::pmr::memory_resource* SimpleMeshData::resource() const noexcept
+{
+	return positions.get_allocator().resource();
+}
+
+SimpleMeshData concatenate( std::vector<SimpleMeshData> const& aMeshes, std::pmr::memory_resource* aResource )
 {
-	SimpleMeshData result;
+	SimpleMeshData result( aResource );
+
+	std::size_t total[4] = {};
+	for( auto const& mesh : aMeshes )
+	{
+		total[0] += mesh.positions.size();
+		total[1] += mesh.colors.size();
+		total[2] += mesh.normals.size();
+		total[3] += mesh.texcoords.size();
+	}
+
+	result.positions.reserve( total[0] );
+	result.colors.reserve( total[1] );
+	result.normals.reserve( total[2] );
+	result.texcoords.reserve( total[3] );
+
 	for (const auto& mesh : aMeshes) 
 	{
         result.positions.insert(result.positions.end(), mesh.positions.begin(), mesh.positions.end());
@@ -14,6 +43,65 @@ SimpleMeshData concatenate( std::vector<SimpleMeshData> const& aMeshes )
     return result;
 }
 
+void release( SimpleMeshData& aMeshData )
+{
+	// Swapping with empty arrays frees the storage; shrink_to_fit() is only
+	// a request.
+	std::pmr::memory_resource* const resource = aMeshData.resource();
+	aMeshData = SimpleMeshData( resource );
+}
+
+
+MeshArena::MeshArena( std::size_t aInitialSize )
+	: mArena( aInitialSize, &mUpstream )
+{}
+
+void MeshArena::release()
+{
+	mArena.release();
+	mAllocations = 0;
+	mBytes = 0;
+}
+
+MeshArena::Stats MeshArena::stats() const noexcept
+{
+	return Stats{ mAllocations, mBytes, mUpstream.reserved, mUpstream.peakReserved };
+}
+
+void* MeshArena::do_allocate( std::size_t aBytes, std::size_t aAlignment )
+{
+	void* ret = mArena.allocate( aBytes, aAlignment );
+	++mAllocations;
+	mBytes += aBytes;
+	return ret;
+}
+void MeshArena::do_deallocate( void*, std::size_t, std::size_t )
+{
+	// Memory is returned by release().
+}
+bool MeshArena::do_is_equal( std::pmr::memory_resource const& aOther ) const noexcept
+{
+	return this == &aOther;
+}
+
+void* MeshArena::Upstream_::do_allocate( std::size_t aBytes, std::size_t aAlignment )
+{
+	void* ret = std::pmr::new_delete_resource()->allocate( aBytes, aAlignment );
+	reserved += aBytes;
+	if( reserved > peakReserved )
+		peakReserved = reserved;
+	return ret;
+}
+void MeshArena::Upstream_::do_deallocate( void* aPtr, std::size_t aBytes, std::size_t aAlignment )
+{
+	std::pmr::new_delete_resource()->deallocate( aPtr, aBytes, aAlignment );
+	reserved -= aBytes;
+}
+bool MeshArena::Upstream_::do_is_equal( std::pmr::memory_resource const& aOther ) const noexcept
+{
+	return this == &aOther;
+}
+
 
 GLuint create_vao( SimpleMeshData const& aMeshData )
 {
@@ -89,4 +177,67 @@ GLuint create_vao( SimpleMeshData const& aMeshData )
 	return vao;
 }
 
+GLuint create_vao( QuantizedVertices const& aVertices )
+{
+	GLuint vao = 0;
+	glGenVertexArrays( 1, &vao );
+	glBindVertexArray( vao );
+
+	// One VBO per attribute, as above. The integers are normalized to [0,1]
+	// (or [-1,1]); the shader maps them back with the mesh's VertexDecode.
+	struct Attribute_
+	{
+		void const* data;
+		std::size_t bytes; // per vertex
+		GLint size;
+		GLenum type;
+	};
+
+	Attribute_ const attributes[] = {
+		{ aVertices.positions.data(), 4*sizeof(std::uint16_t), 3, GL_UNSIGNED_SHORT }, // location = 0, xyz of xyz_
+		{ aVertices.colors.data(), sizeof(std::uint32_t), 3, GL_UNSIGNED_BYTE }, // location = 1, sRGB; rgb of rgb_
+		{ aVertices.normals.data(), sizeof(std::uint32_t), 2, GL_SHORT }, // location = 2, octahedral
+		{ aVertices.texcoords.data(), sizeof(std::uint32_t), 2, GL_UNSIGNED_SHORT } // location = 3
+	};
 
+	GLuint vbos[4];
+	glGenBuffers( 4, vbos );
+	for( GLuint i = 0; i < 4; ++i )
+	{
+		auto const& attrib = attributes[i];
+		glBindBuffer( GL_ARRAY_BUFFER, vbos[i] );
+		glBufferData( GL_ARRAY_BUFFER, GLsizeiptr(attrib.bytes * aVertices.size()), attrib.data, GL_STATIC_DRAW );
+		glVertexAttribPointer( i, attrib.size, attrib.type, GL_TRUE, GLsizei(attrib.bytes), 0 );
+		glEnableVertexAttribArray( i );
+	}
+
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	// The VAO keeps the buffers alive.
+	glDeleteBuffers( 4, vbos );
+
+	return vao;
+}
+
+void set_instance_buffer( GLuint aVAO, GLuint aBuffer )
+{
+	glBindVertexArray( aVAO );
+	glBindBuffer( GL_ARRAY_BUFFER, aBuffer );
+
+	// A mat4 attribute occupies four consecutive locations, one per column.
+	for( GLuint i = 0; i < 4; ++i )
+	{
+		glVertexAttribPointer(
+			4+i, // locations = 4..7 in vertex shader
+			4, GL_FLOAT, GL_FALSE, // 4 floats, not normalized to [0..1] (GL FALSE)
+			kInstanceStride, // stride = one full matrix
+			reinterpret_cast<void const*>(4 * sizeof(float) * i) // column i
+		);
+		glVertexAttribDivisor( 4+i, 1 ); // advance once per instance
+		glEnableVertexAttribArray( 4+i );
+	}
+
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
@@ -4,22 +4,110 @@
 #include <glad/glad.h>
 
 #include <vector>
+#include <memory_resource>
+
+#include <cstdlib>
 
 #include "../vmlib/vec3.hpp"
 #include "../vmlib/vec2.hpp"
 
+// The attribute arrays allocate from a memory resource, which defaults to
+// the global heap. Geometry that only lives while loading can use a
+// MeshArena instead. Copies use the default resource; moves keep the
+// source's.
 struct SimpleMeshData
 {
-	std::vector<Vec3f> positions;
-	std::vector<Vec3f> colors;
-	std::vector<Vec3f> normals;
-	std::vector<Vec2f> texcoords;
-	
+	SimpleMeshData() = default;
+	explicit SimpleMeshData( std::pmr::memory_resource* );
+
+	std::pmr::vector<Vec3f> positions;
+	std::pmr::vector<Vec3f> colors;
+	std::pmr::vector<Vec3f> normals;
+	std::pmr::vector<Vec2f> texcoords;
+
+	std::pmr::memory_resource* resource() const noexcept;
 };
 
-SimpleMeshData concatenate( std::vector<SimpleMeshData> const& );
+SimpleMeshData concatenate( std::vector<SimpleMeshData> const&, std::pmr::memory_resource* = std::pmr::get_default_resource() );
+
+// Frees the mesh's arrays (clear() alone keeps their capacity). Meshes in a
+// MeshArena must be released (or destroyed) before the arena is.
+void release( SimpleMeshData& );
+
+/* MeshArena: memory for geometry that only lives while loading
+ *
+ * A std::pmr::monotonic_buffer_resource: allocating is little more than a
+ * pointer increment, deallocating does nothing, and release() returns all
+ * memory at once. Arrays that grow step by step leave their old blocks
+ * behind, so loaders reserve their arrays up front where they can.
+ *
+ * The arena counts the allocations made from it and the memory it holds.
+ * It is not thread-safe.
+ */
+class MeshArena final : public std::pmr::memory_resource
+{
+	public:
+		struct Stats
+		{
+			std::size_t allocations; // since the last release()
+			std::size_t bytes; // requested since the last release()
+			std::size_t reserved; // held by the arena
+			std::size_t peakReserved; // over the arena's lifetime
+		};
+
+	public:
+		explicit MeshArena( std::size_t aInitialSize = 1024*1024 );
+
+		MeshArena( MeshArena const& ) = delete;
+		MeshArena& operator= (MeshArena const&) = delete;
+
+	public:
+		void release();
+
+		Stats stats() const noexcept;
+
+	private:
+		void* do_allocate( std::size_t, std::size_t ) override;
+		void do_deallocate( void*, std::size_t, std::size_t ) override;
+		bool do_is_equal( std::pmr::memory_resource const& ) const noexcept override;
+
+	private:
+		// Counts the memory that the arena takes from the heap
+		class Upstream_ final : public std::pmr::memory_resource
+		{
+			public:
+				std::size_t reserved = 0, peakReserved = 0;
+
+			private:
+				void* do_allocate( std::size_t, std::size_t ) override;
+				void do_deallocate( void*, std::size_t, std::size_t ) override;
+				bool do_is_equal( std::pmr::memory_resource const& ) const noexcept override;
+		};
+
+		Upstream_ mUpstream; // must precede mArena
+		std::pmr::monotonic_buffer_resource mArena;
+
+		std::size_t mAllocations = 0;
+		std::size_t mBytes = 0;
+};
 
 
 GLuint create_vao( SimpleMeshData const& );
 
+// Same attribute locations, in the compact formats (see QuantizedVertices).
+// Only the FEATURE_QUANTIZED variants of the object shaders can draw these.
+struct QuantizedVertices;
+GLuint create_vao( QuantizedVertices const& );
+
+// Adds a per-instance model matrix to aVAO (attributes 4-7, one column each,
+// advancing once per instance), sourced from aBuffer. The matrices are
+// column-major 4x4 (16 floats each), tightly packed from the start of the
+// buffer; draws select their matrices with a base instance (see
+// render_instanced()). The buffer is usually a StreamBuffer.
+void set_instance_buffer( GLuint aVAO, GLuint aBuffer );
+
+// Size and required alignment of one instance in the instance buffer. With
+// this alignment, any offset corresponds to a whole base instance.
+constexpr std::size_t kInstanceStride = 16 * sizeof(float);
+
 #endif // SIMPLE_MESH_HPP_C6B749D6_C83B_434C_9E58_F05FC27FEFC9
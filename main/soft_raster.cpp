@@ -0,0 +1,765 @@
+#include "soft_raster.hpp"
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#include <cassert>
+
+#include "simple_mesh.hpp"
+
+#include "../vmlib/vec4.hpp"
+#include "../support/thread_pool.hpp"
+
+namespace
+{
+	// Triangles per geometry job
+	constexpr std::size_t kGeometryGrain_ = 2048;
+
+	// Triangles are clipped against the near plane only, and against a
+	// guard band at this multiple of the viewport's extent (which keeps the
+	// fixed-point coordinates small). Pixels outside of the viewport are
+	// never visited, so nothing else needs clipping.
+	constexpr float kGuardBand_ = 64.f;
+
+	constexpr std::int64_t kSubpixels_ = 16; // 28.4 fixed point
+	constexpr std::int64_t kHalfPixel_ = kSubpixels_ / 2;
+
+	// Clip space vertex: position, then the attributes
+	constexpr std::size_t kVertexSize_ = 12;
+	using Vertex_ = float[kVertexSize_];
+
+	constexpr std::size_t kMaxClipVertices_ = 3 + 5; // one more per plane
+
+	std::array<float,256> const& srgb_decode_()
+	{
+		static auto const table = [] {
+			std::array<float,256> ret;
+			for( std::size_t i = 0; i < ret.size(); ++i )
+			{
+				float const c = float(i) / 255.f;
+				ret[i] = c <= 0.04045f ? c / 12.92f : std::pow( (c + 0.055f) / 1.055f, 2.4f );
+			}
+			return ret;
+		}();
+		return table;
+	}
+
+	// Indexed by the linear value in [0,1], quantized to 12 bits. The
+	// entries are 32 bits wide, so that lookups can be vectorized (gathers).
+	std::array<std::uint32_t,4096> const& srgb_encode_()
+	{
+		static auto const table = [] {
+			std::array<std::uint32_t,4096> ret;
+			for( std::size_t i = 0; i < ret.size(); ++i )
+			{
+				float const c = float(i) / 4095.f;
+				float const s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow( c, 1.f/2.4f ) - 0.055f;
+				ret[i] = std::uint32_t(std::lround( std::clamp( s, 0.f, 1.f ) * 255.f ));
+			}
+			return ret;
+		}();
+		return table;
+	}
+
+	inline
+	std::uint32_t encode_( float aR, float aG, float aB, std::array<std::uint32_t,4096> const& aTable ) noexcept
+	{
+		auto const q = [&] (float aC) {
+			return aTable[std::size_t(std::clamp( aC, 0.f, 1.f ) * 4095.f + 0.5f)];
+		};
+		return q( aR ) | q( aG ) << 8 | q( aB ) << 16 | 0xffu << 24;
+	}
+
+	// Division rounding towards -inf and +inf, for aB > 0
+	inline
+	std::int64_t floor_div_( std::int64_t aA, std::int64_t aB ) noexcept
+	{
+		std::int64_t const q = aA / aB;
+		return (aA % aB != 0 && aA < 0) ? q - 1 : q;
+	}
+	inline
+	std::int64_t ceil_div_( std::int64_t aA, std::int64_t aB ) noexcept
+	{
+		return -floor_div_( -aA, aB );
+	}
+
+	// Bilinear, clamped to the edge (texel centers at half-integers)
+	void sample_( SoftTexture::Level const& aLevel, float aU, float aV, float* aOut, std::array<float,256> const& aDecode ) noexcept
+	{
+		float const x = aU * float(aLevel.width) - 0.5f;
+		float const y = aV * float(aLevel.height) - 0.5f;
+
+		float const fx = std::floor( x ), fy = std::floor( y );
+		float const tx = x - fx, ty = y - fy;
+
+		auto const maxX = std::int64_t(aLevel.width) - 1;
+		auto const maxY = std::int64_t(aLevel.height) - 1;
+		auto const x0 = std::clamp( std::int64_t(fx), std::int64_t(0), maxX );
+		auto const x1 = std::clamp( std::int64_t(fx) + 1, std::int64_t(0), maxX );
+		auto const y0 = std::clamp( std::int64_t(fy), std::int64_t(0), maxY );
+		auto const y1 = std::clamp( std::int64_t(fy) + 1, std::int64_t(0), maxY );
+
+		auto const* texels = aLevel.texels.data();
+		std::uint32_t const t00 = texels[y0 * (maxX+1) + x0];
+		std::uint32_t const t10 = texels[y0 * (maxX+1) + x1];
+		std::uint32_t const t01 = texels[y1 * (maxX+1) + x0];
+		std::uint32_t const t11 = texels[y1 * (maxX+1) + x1];
+
+		for( unsigned c = 0; c < 3; ++c )
+		{
+			unsigned const s = 8*c;
+			float const a = aDecode[(t00 >> s) & 0xff] + tx * (aDecode[(t10 >> s) & 0xff] - aDecode[(t00 >> s) & 0xff]);
+			float const b = aDecode[(t01 >> s) & 0xff] + tx * (aDecode[(t11 >> s) & 0xff] - aDecode[(t01 >> s) & 0xff]);
+			aOut[c] = a + ty * (b - a);
+		}
+	}
+}
+
+SoftTexture::SoftTexture( std::size_t aWidth, std::size_t aHeight, std::uint8_t const* aRGBA )
+{
+	assert( aWidth && aHeight && aRGBA );
+
+	Level base{ aWidth, aHeight, std::vector<std::uint32_t>( aWidth * aHeight ) };
+	for( std::size_t i = 0; i < base.texels.size(); ++i )
+	{
+		auto const* t = aRGBA + 4*i;
+		base.texels[i] = std::uint32_t(t[0]) | std::uint32_t(t[1]) << 8 | std::uint32_t(t[2]) << 16 | std::uint32_t(t[3]) << 24;
+	}
+	mLevels.emplace_back( std::move(base) );
+
+	// Mip chain, averaging 2x2 blocks in linear space (alpha is linear)
+	auto const& decode = srgb_decode_();
+	auto const& encode = srgb_encode_();
+
+	while( mLevels.back().width > 1 || mLevels.back().height > 1 )
+	{
+		auto const& src = mLevels.back();
+		std::size_t const w = std::max<std::size_t>( 1, src.width / 2 );
+		std::size_t const h = std::max<std::size_t>( 1, src.height / 2 );
+
+		Level level{ w, h, std::vector<std::uint32_t>( w * h ) };
+		for( std::size_t y = 0; y < h; ++y )
+		{
+			for( std::size_t x = 0; x < w; ++x )
+			{
+				std::size_t const sx0 = std::min( 2*x, src.width-1 ), sx1 = std::min( 2*x+1, src.width-1 );
+				std::size_t const sy0 = std::min( 2*y, src.height-1 ), sy1 = std::min( 2*y+1, src.height-1 );
+				std::uint32_t const texels[4] = {
+					src.texels[sy0*src.width + sx0], src.texels[sy0*src.width + sx1],
+					src.texels[sy1*src.width + sx0], src.texels[sy1*src.width + sx1]
+				};
+
+				float rgb[3] = {};
+				float alpha = 0.f;
+				for( auto const t : texels )
+				{
+					for( unsigned c = 0; c < 3; ++c )
+						rgb[c] += 0.25f * decode[(t >> 8*c) & 0xff];
+					alpha += 0.25f * float(t >> 24);
+				}
+
+				level.texels[y*w + x] = (encode_( rgb[0], rgb[1], rgb[2], encode ) & 0xffffffu) | std::uint32_t(std::lround( alpha )) << 24;
+			}
+		}
+
+		mLevels.emplace_back( std::move(level) );
+	}
+}
+
+std::vector<SoftTexture::Level> const& SoftTexture::levels() const noexcept
+{
+	return mLevels;
+}
+
+Vec3f SoftTexture::sample( float aU, float aV, std::size_t aLevel ) const noexcept
+{
+	assert( aLevel < mLevels.size() );
+
+	float rgb[3];
+	sample_( mLevels[aLevel], aU, aV, rgb, srgb_decode_() );
+	return { rgb[0], rgb[1], rgb[2] };
+}
+
+
+SoftRasterizer::SoftRasterizer( ThreadPool& aPool, std::size_t aWidth, std::size_t aHeight )
+	: mPool( &aPool )
+	, mWidth( aWidth )
+	, mHeight( aHeight )
+	, mTilesX( (aWidth + kTileSize - 1) / kTileSize )
+	, mTilesY( (aHeight + kTileSize - 1) / kTileSize )
+	, mColor( aWidth * aHeight, 0 )
+	, mDepth( aWidth * aHeight, 1.f )
+{
+	assert( aWidth && aHeight );
+}
+
+void SoftRasterizer::clear( Vec3f aColor )
+{
+	std::fill( mColor.begin(), mColor.end(), encode_( aColor.x, aColor.y, aColor.z, srgb_encode_() ) );
+	std::fill( mDepth.begin(), mDepth.end(), 1.f );
+}
+
+void SoftRasterizer::draw( SimpleMeshData const& aMesh, Mat44f const& aProjCameraWorld, Mat44f const& aModel2world, SoftTexture const* aTexture, std::size_t aFirstVertex, std::size_t aNumVertices )
+{
+	assert( aFirstVertex + aNumVertices <= aMesh.positions.size() );
+
+	mDraws.emplace_back( Draw_{
+		&aMesh,
+		aProjCameraWorld,
+		mat44_to_mat33( transpose( invert( aModel2world ) ) ),
+		aTexture,
+		aFirstVertex, aNumVertices
+	} );
+}
+
+void SoftRasterizer::finish()
+{
+	// Split the draws into geometry jobs. Jobs (and their bins) are kept
+	// between frames to reuse their memory.
+	mJobCount = 0;
+	for( std::size_t d = 0; d < mDraws.size(); ++d )
+	{
+		std::size_t const triangles = mDraws[d].count / 3;
+		for( std::size_t begin = 0; begin < triangles; begin += kGeometryGrain_ )
+		{
+			if( mJobCount == mJobs.size() )
+				mJobs.emplace_back();
+
+			auto& job = mJobs[mJobCount++];
+			job.draw = d;
+			job.begin = begin;
+			job.end = std::min( begin + kGeometryGrain_, triangles );
+			job.bins.resize( mTilesX * mTilesY );
+		}
+	}
+
+	mPool->parallel_for( mJobCount, 1, [this] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t i = aBegin; i < aEnd; ++i )
+			geometry_( mJobs[i] );
+	} );
+
+	mTriangles = 0;
+	for( std::size_t i = 0; i < mJobCount; ++i )
+		mTriangles += mJobs[i].triangles.size();
+
+	mPool->parallel_for( mTilesX * mTilesY, 1, [this] (std::size_t aBegin, std::size_t aEnd) {
+		for( std::size_t i = aBegin; i < aEnd; ++i )
+			raster_( i );
+	} );
+
+	mDraws.clear();
+}
+
+SoftLighting& SoftRasterizer::lighting() noexcept
+{
+	return mLighting;
+}
+
+std::size_t SoftRasterizer::width() const noexcept
+{
+	return mWidth;
+}
+std::size_t SoftRasterizer::height() const noexcept
+{
+	return mHeight;
+}
+
+std::vector<std::uint32_t> const& SoftRasterizer::color() const noexcept
+{
+	return mColor;
+}
+std::vector<float> const& SoftRasterizer::depth() const noexcept
+{
+	return mDepth;
+}
+
+std::size_t SoftRasterizer::triangle_count() const noexcept
+{
+	return mTriangles;
+}
+
+void SoftRasterizer::geometry_( Job_& aJob )
+{
+	aJob.triangles.clear();
+	for( auto& bin : aJob.bins )
+		bin.clear();
+
+	auto const& draw = mDraws[aJob.draw];
+	auto const& mesh = *draw.mesh;
+	auto const& m = draw.projCameraWorld;
+
+	// Planes as (x, y, z, w) coefficients; inside is >= 0
+	static constexpr float kClipPlanes[5][4] = {
+		{ 0.f, 0.f, 1.f, 1.f }, // near
+		{ -1.f, 0.f, 0.f, kGuardBand_ },
+		{ 1.f, 0.f, 0.f, kGuardBand_ },
+		{ 0.f, -1.f, 0.f, kGuardBand_ },
+		{ 0.f, 1.f, 0.f, kGuardBand_ }
+	};
+
+	for( std::size_t t = aJob.begin; t < aJob.end; ++t )
+	{
+		Vertex_ verts[3];
+		for( std::size_t k = 0; k < 3; ++k )
+		{
+			std::size_t const i = draw.first + 3*t + k;
+			auto const& p = mesh.positions[i];
+			Vec4f const c = m * Vec4f{ p.x, p.y, p.z, 1.f };
+
+			// Missing attributes default as in the shaders' inputs
+			Vec3f const color = i < mesh.colors.size() ? mesh.colors[i] : Vec3f{ 1.f, 1.f, 1.f };
+			Vec3f const normal = i < mesh.normals.size() ? draw.normalMatrix * mesh.normals[i] : Vec3f{ 0.f, 0.f, 0.f };
+			Vec2f const uv = i < mesh.texcoords.size() ? mesh.texcoords[i] : Vec2f{ 0.f, 0.f };
+
+			float* v = verts[k];
+			v[0] = c.x; v[1] = c.y; v[2] = c.z; v[3] = c.w;
+			v[4] = color.x; v[5] = color.y; v[6] = color.z;
+			v[7] = normal.x; v[8] = normal.y; v[9] = normal.z;
+			v[10] = uv.x; v[11] = uv.y;
+		}
+
+		// Reject triangles that are entirely outside one of the view
+		// volume's planes.
+		unsigned outside = ~0u, clip = 0;
+		for( auto const& v : verts )
+		{
+			unsigned code = 0;
+			code |= (v[0] > v[3]) << 0;
+			code |= (v[0] < -v[3]) << 1;
+			code |= (v[1] > v[3]) << 2;
+			code |= (v[1] < -v[3]) << 3;
+			code |= (v[2] > v[3]) << 4;
+			code |= (v[2] < -v[3]) << 5;
+			outside &= code;
+
+			for( std::size_t p = 0; p < 5; ++p )
+			{
+				auto const& pl = kClipPlanes[p];
+				clip |= unsigned(pl[0]*v[0] + pl[1]*v[1] + pl[2]*v[2] + pl[3]*v[3] < 0.f) << p;
+			}
+		}
+
+		if( outside )
+			continue;
+
+		if( !clip )
+		{
+			setup_( aJob, verts, std::uint32_t(aJob.draw) );
+			continue;
+		}
+
+		// Sutherland-Hodgman against the planes that the triangle crosses
+		Vertex_ bufA[kMaxClipVertices_], bufB[kMaxClipVertices_];
+		std::copy_n( &verts[0][0], 3*kVertexSize_, &bufA[0][0] );
+
+		Vertex_* in = bufA;
+		Vertex_* out = bufB;
+		std::size_t count = 3;
+
+		for( std::size_t p = 0; p < 5 && count >= 3; ++p )
+		{
+			if( !(clip & (1u << p)) )
+				continue;
+
+			auto const& pl = kClipPlanes[p];
+			auto const dist = [&] (float const* aV) {
+				return pl[0]*aV[0] + pl[1]*aV[1] + pl[2]*aV[2] + pl[3]*aV[3];
+			};
+
+			std::size_t outCount = 0;
+			for( std::size_t i = 0; i < count; ++i )
+			{
+				float const* a = in[i];
+				float const* b = in[(i+1) % count];
+				float const da = dist( a ), db = dist( b );
+
+				if( da >= 0.f )
+					std::copy_n( a, kVertexSize_, out[outCount++] );
+
+				if( (da >= 0.f) != (db >= 0.f) )
+				{
+					float const s = da / (da - db);
+					for( std::size_t j = 0; j < kVertexSize_; ++j )
+						out[outCount][j] = a[j] + s * (b[j] - a[j]);
+					++outCount;
+				}
+			}
+
+			std::swap( in, out );
+			count = outCount;
+		}
+
+		for( std::size_t i = 2; i < count; ++i )
+		{
+			Vertex_ fan[3];
+			std::copy_n( in[0], kVertexSize_, fan[0] );
+			std::copy_n( in[i-1], kVertexSize_, fan[1] );
+			std::copy_n( in[i], kVertexSize_, fan[2] );
+			setup_( aJob, fan, std::uint32_t(aJob.draw) );
+		}
+	}
+}
+
+void SoftRasterizer::setup_( Job_& aJob, float const (*aVerts)[4+kAttributes_], std::uint32_t aDraw )
+{
+	Triangle_ tri;
+	tri.draw = aDraw;
+
+	float z[3], iw[3];
+	for( std::size_t k = 0; k < 3; ++k )
+	{
+		float const* v = aVerts[k];
+		iw[k] = 1.f / v[3];
+
+		float const x = (v[0] * iw[k] * 0.5f + 0.5f) * float(mWidth);
+		float const y = (v[1] * iw[k] * 0.5f + 0.5f) * float(mHeight);
+		tri.x[k] = std::int32_t(std::lround( x * float(kSubpixels_) ));
+		tri.y[k] = std::int32_t(std::lround( y * float(kSubpixels_) ));
+		z[k] = v[2] * iw[k] * 0.5f + 0.5f;
+	}
+
+	// Twice the signed area. Counter-clockwise triangles are front facing;
+	// back faces and degenerate triangles are culled.
+	std::int64_t const area = std::int64_t(tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - std::int64_t(tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+	if( area <= 0 )
+		return;
+
+	// Pixels whose centers are inside the bounding box
+	auto const [minX, maxX] = std::minmax( { tri.x[0], tri.x[1], tri.x[2] } );
+	auto const [minY, maxY] = std::minmax( { tri.y[0], tri.y[1], tri.y[2] } );
+
+	tri.minX = std::int32_t(std::max<std::int64_t>( 0, ceil_div_( minX - kHalfPixel_, kSubpixels_ ) ));
+	tri.minY = std::int32_t(std::max<std::int64_t>( 0, ceil_div_( minY - kHalfPixel_, kSubpixels_ ) ));
+	tri.maxX = std::int32_t(std::min<std::int64_t>( std::int64_t(mWidth) - 1, floor_div_( maxX - kHalfPixel_, kSubpixels_ ) ));
+	tri.maxY = std::int32_t(std::min<std::int64_t>( std::int64_t(mHeight) - 1, floor_div_( maxY - kHalfPixel_, kSubpixels_ ) ));
+
+	if( tri.minX > tri.maxX || tri.minY > tri.maxY )
+		return;
+
+	// Barycentric planes, relative to the pixel (minX, minY). The weight of
+	// vertex k is the edge function of the opposite edge over the area.
+	double const invArea = 1.0 / double(area);
+	double bary[3][3];
+	for( std::size_t k = 0; k < 3; ++k )
+	{
+		std::size_t const a = (k+1) % 3, b = (k+2) % 3;
+		std::int64_t const ea = -std::int64_t(tri.y[b] - tri.y[a]);
+		std::int64_t const eb = std::int64_t(tri.x[b] - tri.x[a]);
+
+		std::int64_t const ox = std::int64_t(tri.minX) * kSubpixels_ + kHalfPixel_ - tri.x[a];
+		std::int64_t const oy = std::int64_t(tri.minY) * kSubpixels_ + kHalfPixel_ - tri.y[a];
+
+		bary[k][0] = double(ea * ox + eb * oy) * invArea;
+		bary[k][1] = double(ea * kSubpixels_) * invArea;
+		bary[k][2] = double(eb * kSubpixels_) * invArea;
+	}
+
+	for( std::size_t q = 0; q < 2+kAttributes_; ++q )
+	{
+		double values[3];
+		for( std::size_t k = 0; k < 3; ++k )
+			values[k] = 0 == q ? z[k] : 1 == q ? iw[k] : aVerts[k][4+q-2] * iw[k];
+
+		for( std::size_t c = 0; c < 3; ++c )
+			tri.planes[q][c] = float(bary[0][c] * values[0] + bary[1][c] * values[1] + bary[2][c] * values[2]);
+	}
+
+	// Bin
+	auto const index = std::uint32_t(aJob.triangles.size());
+	aJob.triangles.emplace_back( tri );
+
+	std::size_t const tx0 = std::size_t(tri.minX) / kTileSize, tx1 = std::size_t(tri.maxX) / kTileSize;
+	std::size_t const ty0 = std::size_t(tri.minY) / kTileSize, ty1 = std::size_t(tri.maxY) / kTileSize;
+	for( std::size_t ty = ty0; ty <= ty1; ++ty )
+	{
+		for( std::size_t tx = tx0; tx <= tx1; ++tx )
+			aJob.bins[ty * mTilesX + tx].emplace_back( index );
+	}
+}
+
+void SoftRasterizer::raster_( std::size_t aTile )
+{
+	std::size_t const x0 = (aTile % mTilesX) * kTileSize;
+	std::size_t const y0 = (aTile / mTilesX) * kTileSize;
+	std::size_t const x1 = std::min( x0 + kTileSize, mWidth ) - 1;
+	std::size_t const y1 = std::min( y0 + kTileSize, mHeight ) - 1;
+
+	for( std::size_t j = 0; j < mJobCount; ++j )
+	{
+		auto const& job = mJobs[j];
+		for( auto const index : job.bins[aTile] )
+			raster_triangle_( job.triangles[index], x0, y0, x1, y1 );
+	}
+}
+
+void SoftRasterizer::raster_triangle_( Triangle_ const& aTri, std::size_t aX0, std::size_t aY0, std::size_t aX1, std::size_t aY1 )
+{
+	auto const& draw = mDraws[aTri.draw];
+	auto const& decode = srgb_decode_();
+	auto const& encode = srgb_encode_();
+
+	bool const lit = !draw.mesh->normals.empty();
+	auto const& texture = draw.texture;
+
+	std::int64_t const sx0 = std::max<std::int64_t>( std::int64_t(aX0), aTri.minX );
+	std::int64_t const sx1 = std::min<std::int64_t>( std::int64_t(aX1), aTri.maxX );
+	std::int64_t const sy0 = std::max<std::int64_t>( std::int64_t(aY0), aTri.minY );
+	std::int64_t const sy1 = std::min<std::int64_t>( std::int64_t(aY1), aTri.maxY );
+	if( sx0 > sx1 || sy0 > sy1 )
+		return;
+
+	// Edge i runs from vertex i to vertex i+1. Counter-clockwise triangles
+	// have their inside on the left: e(x,y) = -dy*(x-xi) + dx*(y-yi) >= 0.
+	// Pixels exactly on an edge belong to it if it is a top or left edge;
+	// for the others, the bias makes the test strict.
+	//
+	// Along a row, e = a*x + k, so each edge bounds the row's span from one
+	// side (or, if a is zero, includes or excludes the whole row). The
+	// bound is found by an exact division for the first row only. From row
+	// to row, k grows by a constant, and the bound and the remainder e at
+	// the bound are stepped incrementally (as in Bresenham's algorithm).
+	struct EdgeStep_
+	{
+		std::int64_t a; // |a| for a < 0
+		std::int64_t bound; // first (a > 0) or last (a < 0) inside pixel
+		std::int64_t rem; // in [0, a)
+		std::int64_t q, r; // the row's step, as q*a + r
+	};
+
+	EdgeStep_ edges[3];
+	std::int64_t flatK[3], flatStep[3]; // for a == 0
+	int sides[3]; // sign of a
+
+	for( std::size_t i = 0; i < 3; ++i )
+	{
+		std::size_t const n = (i+1) % 3;
+		std::int64_t const dx = std::int64_t(aTri.x[n]) - aTri.x[i];
+		std::int64_t const dy = std::int64_t(aTri.y[n]) - aTri.y[i];
+		bool const topLeft = dy < 0 || (0 == dy && dx < 0);
+
+		std::int64_t const a = -dy * kSubpixels_;
+		std::int64_t const k = -dy * (kHalfPixel_ - aTri.x[i]) + dx * (sy0 * kSubpixels_ + kHalfPixel_ - aTri.y[i]) - (topLeft ? 0 : 1);
+		std::int64_t const step = dx * kSubpixels_;
+
+		sides[i] = a > 0 ? 1 : a < 0 ? -1 : 0;
+		flatK[i] = k;
+		flatStep[i] = step;
+
+		auto& edge = edges[i];
+		if( a > 0 )
+		{
+			// Smallest x with a*x + k >= 0; rem = a*x + k
+			edge.a = a;
+			edge.bound = ceil_div_( -k, a );
+			edge.rem = a * edge.bound + k;
+			edge.q = floor_div_( step, a );
+			edge.r = step - edge.q * a;
+		}
+		else if( a < 0 )
+		{
+			// Largest x with k - |a|*x >= 0; rem = k - |a|*x
+			edge.a = -a;
+			edge.bound = floor_div_( k, -a );
+			edge.rem = k + a * edge.bound;
+			edge.q = floor_div_( step, -a );
+			edge.r = step - edge.q * -a;
+		}
+	}
+
+	auto const& P = aTri.planes;
+	Vec3f const toLight = mLighting.toLight;
+	Vec3f const diffuse = mLighting.diffuse;
+	Vec3f const ambient = mLighting.ambient;
+
+	for( std::int64_t py = sy0; py <= sy1; ++py )
+	{
+		std::int64_t lo = sx0, hi = sx1;
+		for( std::size_t i = 0; i < 3; ++i )
+		{
+			auto& edge = edges[i];
+			if( sides[i] > 0 )
+			{
+				lo = std::max( lo, edge.bound );
+
+				// k grows by q*a + r: the bound moves by -q, or by -q-1 if
+				// the remainder overflows.
+				edge.rem += edge.r;
+				edge.bound -= edge.q;
+				if( edge.rem >= edge.a )
+				{
+					edge.rem -= edge.a;
+					edge.bound -= 1;
+				}
+			}
+			else if( sides[i] < 0 )
+			{
+				hi = std::min( hi, edge.bound );
+
+				edge.rem += edge.r;
+				edge.bound += edge.q;
+				if( edge.rem >= edge.a )
+				{
+					edge.rem -= edge.a;
+					edge.bound += 1;
+				}
+			}
+			else
+			{
+				if( flatK[i] < 0 )
+					hi = lo - 1;
+				flatK[i] += flatStep[i];
+			}
+		}
+
+		if( lo > hi )
+			continue;
+
+		float const fy = float(py - aTri.minY);
+		auto* const colorRow = mColor.data() + std::size_t(py) * mWidth;
+		auto* const depthRow = mDepth.data() + std::size_t(py) * mWidth;
+
+		// Blocks are aligned to kLanes pixels. Tiles start at multiples of
+		// kLanes, so blocks never straddle tiles; only blocks at the right
+		// edge of the viewport can be partial.
+		for( std::int64_t bx = lo & ~std::int64_t(kLanes-1); bx <= hi; bx += std::int64_t(kLanes) )
+		{
+			std::size_t const n = std::size_t(std::min<std::int64_t>( std::int64_t(kLanes), std::int64_t(aX1) + 1 - bx ));
+			float const fx0 = float(bx - aTri.minX);
+
+			// (A copy of constant size is a single vector load.)
+			float dst[kLanes] = {};
+			if( kLanes == n )
+				std::copy_n( depthRow + bx, kLanes, dst );
+			else
+				std::copy_n( depthRow + bx, n, dst );
+
+			// Depth test, for the lanes in the span. The lane loops are kept
+			// free of branches, so that they vectorize.
+			float z[kLanes];
+			std::int32_t live[kLanes];
+			for( std::size_t l = 0; l < kLanes; ++l )
+			{
+				float const fx = fx0 + float(l);
+				std::int64_t const x = bx + std::int64_t(l);
+				z[l] = P[0][0] + P[0][1] * fx + P[0][2] * fy;
+				live[l] = (x >= lo) & (x <= hi) & (z[l] < dst[l]) & (z[l] <= 1.f);
+			}
+
+			std::int32_t any = 0;
+			for( std::size_t l = 0; l < kLanes; ++l )
+				any |= live[l];
+
+			if( !any )
+				continue;
+
+			// Perspective-correct attributes. Normals are only needed with
+			// lighting, and texture coordinates with a texture.
+			std::size_t const attributes = texture ? kAttributes_ : lit ? 6 : 3;
+
+			float w[kLanes];
+			for( std::size_t l = 0; l < kLanes; ++l )
+				w[l] = 1.f / (P[1][0] + P[1][1] * (fx0 + float(l)) + P[1][2] * fy);
+
+			float attr[kAttributes_][kLanes];
+			for( std::size_t a = 0; a < attributes; ++a )
+			{
+				for( std::size_t l = 0; l < kLanes; ++l )
+					attr[a][l] = (P[2+a][0] + P[2+a][1] * (fx0 + float(l)) + P[2+a][2] * fy) * w[l];
+			}
+
+			// Shading, as objects.frag: color * (ambient + nDotL * diffuse)
+			float r[kLanes], g[kLanes], b[kLanes];
+			if( lit )
+			{
+				for( std::size_t l = 0; l < kLanes; ++l )
+				{
+					float const nx = attr[3][l], ny = attr[4][l], nz = attr[5][l];
+					float const len2 = nx*nx + ny*ny + nz*nz;
+					float const d = (nx * toLight.x + ny * toLight.y + nz * toLight.z) / std::sqrt( len2 > 1e-20f ? len2 : 1e-20f );
+					float const nDotL = d > 0.f ? d : 0.f;
+
+					r[l] = attr[0][l] * (ambient.x + nDotL * diffuse.x);
+					g[l] = attr[1][l] * (ambient.y + nDotL * diffuse.y);
+					b[l] = attr[2][l] * (ambient.z + nDotL * diffuse.z);
+				}
+			}
+			else
+			{
+				std::copy_n( attr[0], kLanes, r );
+				std::copy_n( attr[1], kLanes, g );
+				std::copy_n( attr[2], kLanes, b );
+			}
+
+			if( texture )
+			{
+				// Mip level from the texture coordinates' screen space
+				// derivatives at the block's center
+				auto const& levels = texture->levels();
+				float const cx = float(std::max( bx, lo ) + std::min( bx + std::int64_t(kLanes) - 1, hi ) - 2*std::int64_t(aTri.minX)) * 0.5f;
+				float const iw = P[1][0] + P[1][1] * cx + P[1][2] * fy;
+				float const u = (P[10][0] + P[10][1] * cx + P[10][2] * fy) / iw;
+				float const v = (P[11][0] + P[11][1] * cx + P[11][2] * fy) / iw;
+
+				float const dudx = (P[10][1] - u * P[1][1]) / iw * float(levels[0].width);
+				float const dvdx = (P[11][1] - v * P[1][1]) / iw * float(levels[0].height);
+				float const dudy = (P[10][2] - u * P[1][2]) / iw * float(levels[0].width);
+				float const dvdy = (P[11][2] - v * P[1][2]) / iw * float(levels[0].height);
+
+				float const rho2 = std::max( dudx*dudx + dvdx*dvdx, dudy*dudy + dvdy*dvdy );
+				float const lod = rho2 > 1.f ? 0.5f * std::log2( rho2 ) : 0.f;
+				auto const& level = levels[std::min( std::size_t(lod + 0.5f), levels.size() - 1 )];
+
+				for( std::size_t l = 0; l < kLanes; ++l )
+				{
+					if( !live[l] )
+						continue;
+
+					float texel[3];
+					sample_( level, attr[6][l], attr[7][l], texel, decode );
+					r[l] *= texel[0];
+					g[l] *= texel[1];
+					b[l] *= texel[2];
+				}
+			}
+
+			// Output, sRGB encoded via the table
+			std::uint32_t packed[kLanes];
+			for( std::size_t l = 0; l < kLanes; ++l )
+			{
+				auto const ir = std::int32_t(std::clamp( r[l], 0.f, 1.f ) * 4095.f + 0.5f);
+				auto const ig = std::int32_t(std::clamp( g[l], 0.f, 1.f ) * 4095.f + 0.5f);
+				auto const ib = std::int32_t(std::clamp( b[l], 0.f, 1.f ) * 4095.f + 0.5f);
+				packed[l] = encode[ir] | encode[ig] << 8 | encode[ib] << 16 | 0xff000000u;
+			}
+
+			auto* const color = colorRow + bx;
+			auto* const depth = depthRow + bx;
+			if( kLanes == n )
+			{
+				// Full block: masked stores, as blends
+				for( std::size_t l = 0; l < kLanes; ++l )
+				{
+					color[l] = live[l] ? packed[l] : color[l];
+					depth[l] = live[l] ? z[l] : dst[l];
+				}
+			}
+			else
+			{
+				for( std::size_t l = 0; l < n; ++l )
+				{
+					if( live[l] )
+					{
+						color[l] = packed[l];
+						depth[l] = z[l];
+					}
+				}
+			}
+		}
+	}
+}
+
+void render_model( SoftRasterizer& aRaster, SimpleMeshData const& aMesh, const Mat44f& aProjection, const Mat44f& aWorld2camera, const Mat44f& aModel2world, SoftTexture const* aTexture, std::size_t aNumVertices, std::size_t aFirstVertex )
+{
+	aRaster.draw( aMesh, aProjection * aWorld2camera * aModel2world, aModel2world, aTexture, aFirstVertex, aNumVertices );
+}
@@ -0,0 +1,166 @@
+#ifndef SOFT_RASTER_HPP_4A9C1E72_D83B_4F06_A5E1_7B2C90F6D438
+#define SOFT_RASTER_HPP_4A9C1E72_D83B_4F06_A5E1_7B2C90F6D438
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat33.hpp"
+#include "../vmlib/mat44.hpp"
+
+struct SimpleMeshData;
+class ThreadPool;
+
+/* SoftTexture: texture for the software rasterizer
+ *
+ * Holds 8-bit sRGB RGBA texels and a box-filtered mip chain (filtered in
+ * linear space). Like the textures from load_texture_2d(), the first row is
+ * the bottom of the image, and coordinates are clamped to the edge.
+ * Sampling is bilinear within the nearest mip level.
+ */
+class SoftTexture final
+{
+	public:
+		struct Level
+		{
+			std::size_t width, height;
+			std::vector<std::uint32_t> texels; // packed as pack_rgba()
+		};
+
+	public:
+		SoftTexture( std::size_t aWidth, std::size_t aHeight, std::uint8_t const* aRGBA );
+
+	public:
+		std::vector<Level> const& levels() const noexcept;
+
+		// Bilinear sample of aLevel, in linear RGB
+		Vec3f sample( float aU, float aV, std::size_t aLevel = 0 ) const noexcept;
+
+	private:
+		std::vector<Level> mLevels;
+};
+
+// The directional light, as in RenderLighting
+struct SoftLighting
+{
+	Vec3f toLight = normalize( Vec3f{ 0.f, 1.f, -1.f } );
+	Vec3f diffuse{ 1.f, 1.f, 1.f };
+	Vec3f ambient{ 0.05f, 0.05f, 0.05f };
+};
+
+/* SoftRasterizer: multithreaded CPU renderer for the object meshes
+ *
+ * Renders what render_model() renders with the lit, vertex colored (and
+ * optionally textured) variants of the object shaders, without shadows
+ * and point lights: back faces are culled, the depth test is GL_LESS, and
+ * colors are written as sRGB, as with GL_FRAMEBUFFER_SRGB.
+ *
+ * draw() only records the draw. finish() renders all recorded draws in two
+ * phases on the thread pool:
+ *
+ *  - Geometry: chunks of triangles are transformed, clipped against the
+ *    near plane and a guard band, and culled. The survivors are set up
+ *    (fixed-point edges, attribute planes) and binned into the screen's
+ *    kTileSize x kTileSize tiles. Each chunk has its own bins.
+ *  - Raster: each tile walks the bins of all chunks in submission order,
+ *    so results do not depend on the thread count. Edges are evaluated
+ *    exactly (28.4 fixed point, top-left fill rule) once per row to find
+ *    each row's span; the spans are then interpolated (perspective
+ *    correct), depth tested and shaded kLanes pixels at a time in loops
+ *    that the compiler vectorizes.
+ *
+ * Meshes and textures must stay alive until finish() returns. Rows are
+ * stored bottom first, like glReadPixels().
+ */
+class SoftRasterizer final
+{
+	public:
+		static constexpr std::size_t kTileSize = 64;
+		static constexpr std::size_t kLanes = 8;
+
+	public:
+		SoftRasterizer( ThreadPool&, std::size_t aWidth, std::size_t aHeight );
+
+		SoftRasterizer( SoftRasterizer const& ) = delete;
+		SoftRasterizer& operator= (SoftRasterizer const&) = delete;
+
+	public:
+		// aColor is linear. Resets the depth to 1.
+		void clear( Vec3f aColor );
+
+		void draw( SimpleMeshData const&, Mat44f const& aProjCameraWorld, Mat44f const& aModel2world, SoftTexture const*, std::size_t aFirstVertex, std::size_t aNumVertices );
+
+		void finish();
+
+	public:
+		SoftLighting& lighting() noexcept;
+
+		std::size_t width() const noexcept;
+		std::size_t height() const noexcept;
+
+		std::vector<std::uint32_t> const& color() const noexcept; // packed as pack_rgba()
+		std::vector<float> const& depth() const noexcept;
+
+		// Triangles rasterized by the last finish(), after clipping and
+		// culling.
+		std::size_t triangle_count() const noexcept;
+
+	private:
+		static constexpr std::size_t kAttributes_ = 8; // color, normal, texcoord
+
+		struct Draw_
+		{
+			SimpleMeshData const* mesh;
+			Mat44f projCameraWorld;
+			Mat33f normalMatrix;
+			SoftTexture const* texture;
+			std::size_t first, count;
+		};
+
+		// A triangle after setup. Plane q is evaluated as
+		// planes[q][0] + planes[q][1]*(x-minX) + planes[q][2]*(y-minY) at
+		// pixel (x,y); q is depth, 1/w, then the attributes divided by w.
+		struct Triangle_
+		{
+			std::int32_t x[3], y[3]; // window coordinates, 28.4
+			std::int32_t minX, minY, maxX, maxY; // pixels, inclusive
+			float planes[2+kAttributes_][3];
+			std::uint32_t draw;
+		};
+
+		struct Job_
+		{
+			std::size_t draw;
+			std::size_t begin, end; // triangles of the draw
+			std::vector<Triangle_> triangles;
+			std::vector<std::vector<std::uint32_t>> bins; // per tile
+		};
+
+		void geometry_( Job_& );
+		void setup_( Job_&, float const (*aVerts)[4+kAttributes_], std::uint32_t aDraw );
+		void raster_( std::size_t aTile );
+		void raster_triangle_( Triangle_ const&, std::size_t aX0, std::size_t aY0, std::size_t aX1, std::size_t aY1 );
+
+	private:
+		ThreadPool* mPool;
+		std::size_t mWidth, mHeight;
+		std::size_t mTilesX, mTilesY;
+
+		SoftLighting mLighting;
+
+		std::vector<std::uint32_t> mColor;
+		std::vector<float> mDepth;
+
+		std::vector<Draw_> mDraws;
+		std::vector<Job_> mJobs;
+		std::size_t mJobCount = 0;
+		std::size_t mTriangles = 0;
+};
+
+// CPU counterpart of the render_model() overload with a model-to-world
+// matrix. The draw is rendered by aRaster.finish().
+void render_model( SoftRasterizer& aRaster, SimpleMeshData const& aMesh, const Mat44f& aProjection, const Mat44f& aWorld2camera, const Mat44f& aModel2world, SoftTexture const* aTexture, std::size_t aNumVertices, std::size_t aFirstVertex = 0 );
+
+#endif // SOFT_RASTER_HPP_4A9C1E72_D83B_4F06_A5E1_7B2C90F6D438
@@ -4,10 +4,15 @@
 #include <numbers>
 #include <iostream>
 
-SimpleMeshData make_cylinder( bool aCapped, std::size_t aSubdivs, Vec3f aColor, Mat44f aPreTransform )
+SimpleMeshData make_cylinder( bool aCapped, std::size_t aSubdivs, Vec3f aColor, Mat44f aPreTransform, std::pmr::memory_resource* aResource )
 {
-    SimpleMeshData meshData;
-	std::vector<Vec3f> pos, normals;
+    SimpleMeshData meshData( aResource );
+    auto& pos = meshData.positions;
+    auto& normals = meshData.normals;
+
+    std::size_t const vertices = (aCapped ? 12 : 6) * aSubdivs; // shell (and caps)
+    pos.reserve( vertices );
+    normals.reserve( vertices );
 
     float prevY = std::cos(0.f);
     float prevZ = std::sin(0.f);
@@ -95,18 +100,19 @@ SimpleMeshData make_cylinder( bool aCapped, std::size_t aSubdivs, Vec3f aColor,
         normals[i] = normalize(Vec3f{ tn.x, tn.y, tn.z });
     }
 
-    std::vector col( pos.size(), aColor ); // Apply a color to each vertex
-    meshData.positions = std::move(pos);
-    meshData.colors = std::move(col);
-    meshData.normals = std::move(normals);
+    meshData.colors.assign( pos.size(), aColor ); // Apply a color to each vertex
 
     return meshData;
 }
 
-SimpleMeshData make_cone( bool aCapped, std::size_t aSubdivs, Vec3f aColor, Mat44f aPreTransform )
+SimpleMeshData make_cone( bool aCapped, std::size_t aSubdivs, Vec3f aColor, Mat44f aPreTransform, std::pmr::memory_resource* aResource )
 {
-    SimpleMeshData meshData;
-	std::vector<Vec3f> pos, normals;
+    SimpleMeshData meshData( aResource );
+    auto& pos = meshData.positions;
+    auto& normals = meshData.normals;
+
+    pos.reserve( 3 * aSubdivs );
+    normals.reserve( 3 * aSubdivs );
 
     float prevY = 1.0f; 
     float prevZ = 0.0f; 
@@ -139,21 +145,21 @@ SimpleMeshData make_cone( bool aCapped, std::size_t aSubdivs, Vec3f aColor, Mat4
         pos[i] = { tp.x, tp.y, tp.z };
         normals[i] = normalize(Vec3f{ tn.x, tn.y, tn.z });
     }
-    std::vector col( pos.size(), aColor ); // Apply a color to each vertex
-
-    meshData.positions = std::move(pos);
-    meshData.colors = std::move(col);
-    meshData.normals = std::move(normals);
-
+    meshData.colors.assign( pos.size(), aColor ); // Apply a color to each vertex
 
     return meshData;
 }
 
-SimpleMeshData make_cube( Vec3f aColor, Mat44f aPreTransform )
+SimpleMeshData make_cube( Vec3f aColor, Mat44f aPreTransform, std::pmr::memory_resource* aResource )
 {
-    SimpleMeshData meshData;
+    SimpleMeshData meshData( aResource );
+
+    std::size_t const vertices = sizeof(kCubePositions) / sizeof(float) / 3;
+    meshData.positions.reserve( vertices );
+    meshData.colors.reserve( vertices );
+    meshData.normals.reserve( vertices );
 
-    for (std::size_t i = 0; i < sizeof(kCubePositions) / sizeof(float) / 3; i++) 
+    for (std::size_t i = 0; i < vertices; i++) 
     {
         Vec4f tp = aPreTransform * Vec4f{ kCubePositions[3*i], kCubePositions[3*i+1], kCubePositions[3*i+2], 1.f };
         Vec4f tn = aPreTransform * Vec4f{ kCubeNormals[3*i], kCubeNormals[3*i+1], kCubeNormals[3*i+2], 1.f };
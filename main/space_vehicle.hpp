@@ -14,20 +14,23 @@ SimpleMeshData make_cylinder(
     bool aCapped,
     std::size_t aSubdivs,
     Vec3f aColor,
-    Mat44f aPreTransform = kIdentity44f
+    Mat44f aPreTransform = kIdentity44f,
+    std::pmr::memory_resource* = std::pmr::get_default_resource()
 );
 
 SimpleMeshData make_cone(
 	bool aCapped,
 	std::size_t aSubdivs,
 	Vec3f aColor,
-	Mat44f aPreTransform = kIdentity44f
+	Mat44f aPreTransform = kIdentity44f,
+	std::pmr::memory_resource* = std::pmr::get_default_resource()
 );
 
 
 SimpleMeshData make_cube(
     Vec3f aColor, 
-    Mat44f aPreTransform 
+    Mat44f aPreTransform,
+    std::pmr::memory_resource* = std::pmr::get_default_resource()
 );
 
 #endif // VEHICLE_HPP_E4D1E8EC_6CDA_4800_ABDD_264F643AF5DB
@@ -0,0 +1,398 @@
+#include "terrain.hpp"
+
+#include <memory>
+#include <limits>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include <stb_image.h>
+
+#include "../support/error.hpp"
+
+#include "frustum.hpp"
+
+namespace
+{
+	// Solves the 3x3 system aA * x = aB (Cramer's rule). Returns false if
+	// it is (nearly) singular.
+	bool solve3_( double const aA[3][3], double const aB[3], double aX[3] ) noexcept
+	{
+		auto const det = [] (double const m[3][3]) {
+			return m[0][0] * (m[1][1]*m[2][2] - m[1][2]*m[2][1])
+				- m[0][1] * (m[1][0]*m[2][2] - m[1][2]*m[2][0])
+				+ m[0][2] * (m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+		};
+
+		double const d = det( aA );
+		if( !(std::abs( d ) > 1e-12) )
+			return false;
+
+		for( int c = 0; c < 3; ++c )
+		{
+			double m[3][3];
+			for( int r = 0; r < 3; ++r )
+			{
+				for( int k = 0; k < 3; ++k )
+					m[r][k] = k == c ? aB[r] : aA[r][k];
+			}
+			aX[c] = det( m ) / d;
+		}
+		return true;
+	}
+
+	// Least-squares fit of the texture coordinates as affine functions of x
+	// and z. Falls back to mapping the heightfield's extent to [0,1]^2.
+	void fit_texcoords_( SimpleMeshData const& aMesh, Heightfield& aField )
+	{
+		aField.texcoordU = Vec3f{ 1.f / aField.size_x(), 0.f, -aField.origin.x / aField.size_x() };
+		aField.texcoordV = Vec3f{ 0.f, 1.f / aField.size_z(), -aField.origin.y / aField.size_z() };
+
+		if( aMesh.texcoords.size() != aMesh.positions.size() )
+			return;
+
+		// Relative to the origin, for precision
+		double ata[3][3] = {}, atu[3] = {}, atv[3] = {};
+		for( std::size_t i = 0; i < aMesh.positions.size(); ++i )
+		{
+			double const row[3] = { aMesh.positions[i].x - aField.origin.x, aMesh.positions[i].z - aField.origin.y, 1. };
+			for( int r = 0; r < 3; ++r )
+			{
+				for( int c = 0; c < 3; ++c )
+					ata[r][c] += row[r] * row[c];
+				atu[r] += row[r] * aMesh.texcoords[i].x;
+				atv[r] += row[r] * aMesh.texcoords[i].y;
+			}
+		}
+
+		double u[3], v[3];
+		if( !solve3_( ata, atu, u ) || !solve3_( ata, atv, v ) )
+			return;
+
+		aField.texcoordU = Vec3f{ float(u[0]), float(u[1]), float(u[2] - u[0]*aField.origin.x - u[1]*aField.origin.y) };
+		aField.texcoordV = Vec3f{ float(v[0]), float(v[1]), float(v[2] - v[0]*aField.origin.x - v[1]*aField.origin.y) };
+	}
+
+	// Squared distance from a point to a box
+	float distance2_( Vec3f aPoint, Vec3f aMin, Vec3f aMax ) noexcept
+	{
+		float const dx = std::max( { aMin.x - aPoint.x, 0.f, aPoint.x - aMax.x } );
+		float const dy = std::max( { aMin.y - aPoint.y, 0.f, aPoint.y - aMax.y } );
+		float const dz = std::max( { aMin.z - aPoint.z, 0.f, aPoint.z - aMax.z } );
+		return dx*dx + dy*dy + dz*dz;
+	}
+}
+
+float Heightfield::sample( std::size_t aI, std::size_t aJ ) const noexcept
+{
+	assert( aI < samplesX && aJ < samplesZ );
+	return heights[aJ * samplesX + aI];
+}
+
+float Heightfield::height_at( float aX, float aZ ) const noexcept
+{
+	assert( samplesX >= 2 && samplesZ >= 2 );
+
+	float const gx = std::clamp( (aX - origin.x) / spacing, 0.f, float(samplesX - 1) );
+	float const gz = std::clamp( (aZ - origin.y) / spacing, 0.f, float(samplesZ - 1) );
+
+	std::size_t const i = std::min( std::size_t(gx), samplesX - 2 );
+	std::size_t const j = std::min( std::size_t(gz), samplesZ - 2 );
+	float const fx = gx - float(i), fz = gz - float(j);
+
+	float const h0 = sample( i, j ) + fx * (sample( i+1, j ) - sample( i, j ));
+	float const h1 = sample( i, j+1 ) + fx * (sample( i+1, j+1 ) - sample( i, j+1 ));
+	return h0 + fz * (h1 - h0);
+}
+
+float Heightfield::size_x() const noexcept
+{
+	return float(samplesX - 1) * spacing;
+}
+float Heightfield::size_z() const noexcept
+{
+	return float(samplesZ - 1) * spacing;
+}
+
+Heightfield make_heightfield( SimpleMeshData const& aMesh, std::size_t aResolution )
+{
+	if( aMesh.positions.size() < 3 )
+		throw Error( "make_heightfield(): empty mesh" );
+	if( aResolution < 2 )
+		throw Error( "make_heightfield(): resolution must be at least 2 (got %zu)", aResolution );
+
+	Vec3f lo = aMesh.positions.front(), hi = lo;
+	for( auto const& p : aMesh.positions )
+	{
+		lo = Vec3f{ std::min( lo.x, p.x ), std::min( lo.y, p.y ), std::min( lo.z, p.z ) };
+		hi = Vec3f{ std::max( hi.x, p.x ), std::max( hi.y, p.y ), std::max( hi.z, p.z ) };
+	}
+
+	float const extent = std::max( hi.x - lo.x, hi.z - lo.z );
+	if( !(extent > 0.f) )
+		throw Error( "make_heightfield(): mesh has no extent in the xz plane" );
+
+	Heightfield field;
+	field.origin = Vec2f{ lo.x, lo.z };
+	field.spacing = extent / float(aResolution - 1);
+	field.samplesX = std::max<std::size_t>( 2, std::size_t(std::ceil( (hi.x - lo.x) / field.spacing )) + 1 );
+	field.samplesZ = std::max<std::size_t>( 2, std::size_t(std::ceil( (hi.z - lo.z) / field.spacing )) + 1 );
+
+	float const none = -std::numeric_limits<float>::infinity();
+	field.heights.assign( field.samplesX * field.samplesZ, none );
+
+	// Rasterize each triangle's top-down projection at the sample points
+	for( std::size_t t = 0; t + 2 < aMesh.positions.size(); t += 3 )
+	{
+		Vec3f const& a = aMesh.positions[t];
+		Vec3f const& b = aMesh.positions[t+1];
+		Vec3f const& c = aMesh.positions[t+2];
+
+		float const area = (b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z);
+		if( 0.f == area )
+			continue; // vertical or degenerate
+
+		auto const grid = [&] (float aMin, float aMax, float aOrigin, std::size_t aCount, std::size_t& aFirst, std::size_t& aLast) {
+			float const first = std::ceil( (aMin - aOrigin) / field.spacing );
+			float const last = std::floor( (aMax - aOrigin) / field.spacing );
+			aFirst = std::size_t(std::max( first, 0.f ));
+			aLast = std::size_t(std::clamp( last, -1.f, float(aCount - 1) ) + 1.f); // exclusive
+		};
+
+		std::size_t i0, i1, j0, j1;
+		grid( std::min( { a.x, b.x, c.x } ), std::max( { a.x, b.x, c.x } ), field.origin.x, field.samplesX, i0, i1 );
+		grid( std::min( { a.z, b.z, c.z } ), std::max( { a.z, b.z, c.z } ), field.origin.y, field.samplesZ, j0, j1 );
+
+		float const tolerance = -1e-5f * std::abs( area );
+		for( std::size_t j = j0; j < j1; ++j )
+		{
+			float const z = field.origin.y + float(j) * field.spacing;
+			for( std::size_t i = i0; i < i1; ++i )
+			{
+				float const x = field.origin.x + float(i) * field.spacing;
+
+				float const wa = (b.x - x) * (c.z - z) - (c.x - x) * (b.z - z);
+				float const wb = (c.x - x) * (a.z - z) - (a.x - x) * (c.z - z);
+				float const wc = area - wa - wb;
+				if( area > 0.f ? (wa < tolerance || wb < tolerance || wc < tolerance) : (wa > -tolerance || wb > -tolerance || wc > -tolerance) )
+					continue;
+
+				float const y = (wa * a.y + wb * b.y + wc * c.y) / area;
+				float& h = field.heights[j * field.samplesX + i];
+				h = std::max( h, y );
+			}
+		}
+	}
+
+	for( auto& h : field.heights )
+	{
+		if( none == h )
+			h = lo.y;
+	}
+
+	fit_texcoords_( aMesh, field );
+	return field;
+}
+
+Heightfield load_heightfield( char const* aPath, Vec3f aOrigin, float aSizeX, float aHeightScale )
+{
+	assert( aPath );
+
+	// The first row is at origin.z.
+	stbi_set_flip_vertically_on_load( false );
+
+	int w, h, channels;
+	std::unique_ptr<stbi_us, void (*)(void*)> ptr( stbi_load_16( aPath, &w, &h, &channels, 1 ), &stbi_image_free );
+	if( !ptr )
+		throw Error( "Unable to load heightfield '%s': %s", aPath, stbi_failure_reason() );
+	if( w < 2 || h < 2 )
+		throw Error( "Heightfield '%s': need at least 2x2 samples (got %dx%d)", aPath, w, h );
+
+	Heightfield field;
+	field.samplesX = std::size_t(w);
+	field.samplesZ = std::size_t(h);
+	field.origin = Vec2f{ aOrigin.x, aOrigin.z };
+	field.spacing = aSizeX / float(w - 1);
+
+	field.heights.resize( field.samplesX * field.samplesZ );
+	for( std::size_t i = 0; i < field.heights.size(); ++i )
+		field.heights[i] = aOrigin.y + aHeightScale * (float(ptr.get()[i]) / 65535.f);
+
+	field.texcoordU = Vec3f{ 1.f / field.size_x(), 0.f, -field.origin.x / field.size_x() };
+	field.texcoordV = Vec3f{ 0.f, 1.f / field.size_z(), -field.origin.y / field.size_z() };
+	return field;
+}
+
+
+CdlodTree::CdlodTree( Heightfield const& aField, CdlodParams const& aParams )
+	: mParams( aParams )
+	, mOrigin( aField.origin )
+	, mLeafSize( float(aParams.patchQuads) * aField.spacing )
+{
+	if( aParams.patchQuads < 4 || aParams.patchQuads % 4 )
+		throw Error( "CdlodTree: patchQuads must be a positive multiple of 4 (got %u)", aParams.patchQuads );
+	if( aField.samplesX < 2 || aField.samplesZ < 2 )
+		throw Error( "CdlodTree: empty heightfield" );
+
+	std::size_t const n = aParams.patchQuads;
+	std::size_t const cellsX = aField.samplesX - 1, cellsZ = aField.samplesZ - 1;
+
+	// Leaves: the samples of their cells, including the shared edges
+	Level_ leaves;
+	leaves.nodesX = (cellsX + n-1) / n;
+	leaves.nodesZ = (cellsZ + n-1) / n;
+	leaves.heights.resize( leaves.nodesX * leaves.nodesZ );
+	for( std::size_t z = 0; z < leaves.nodesZ; ++z )
+	{
+		for( std::size_t x = 0; x < leaves.nodesX; ++x )
+		{
+			Vec2f range{ std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+			for( std::size_t j = z*n; j <= std::min( (z+1)*n, cellsZ ); ++j )
+			{
+				for( std::size_t i = x*n; i <= std::min( (x+1)*n, cellsX ); ++i )
+				{
+					float const h = aField.sample( i, j );
+					range = Vec2f{ std::min( range.x, h ), std::max( range.y, h ) };
+				}
+			}
+			leaves.heights[z * leaves.nodesX + x] = range;
+		}
+	}
+	mLevels.emplace_back( std::move( leaves ) );
+
+	// Coarser levels until a single node covers the field
+	float const extent = std::max( aField.size_x(), aField.size_z() );
+	while( mLevels.size() < kMaxLevels && node_size( mLevels.size() - 1 ) < extent )
+	{
+		auto const& below = mLevels.back();
+
+		Level_ level;
+		level.nodesX = (below.nodesX + 1) / 2;
+		level.nodesZ = (below.nodesZ + 1) / 2;
+		level.heights.resize( level.nodesX * level.nodesZ );
+		for( std::size_t z = 0; z < level.nodesZ; ++z )
+		{
+			for( std::size_t x = 0; x < level.nodesX; ++x )
+			{
+				Vec2f range{ std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+				for( std::size_t cz = 2*z; cz < std::min( 2*z+2, below.nodesZ ); ++cz )
+				{
+					for( std::size_t cx = 2*x; cx < std::min( 2*x+2, below.nodesX ); ++cx )
+					{
+						auto const child = below.heights[cz * below.nodesX + cx];
+						range = Vec2f{ std::min( range.x, child.x ), std::max( range.y, child.y ) };
+					}
+				}
+				level.heights[z * level.nodesX + x] = range;
+			}
+		}
+		mLevels.emplace_back( std::move( level ) );
+	}
+}
+
+void CdlodTree::select( Vec3f aCamera, Frustum const& aFrustum, Selection& aOut ) const
+{
+	aOut.full.clear();
+	aOut.half.clear();
+
+	// Roots beyond the top level's range are still drawn, at that level.
+	std::size_t const top = mLevels.size() - 1;
+	float const size = node_size( top );
+	for( std::size_t z = 0; z < mLevels[top].nodesZ; ++z )
+	{
+		for( std::size_t x = 0; x < mLevels[top].nodesX; ++x )
+		{
+			if( select_( top, x, z, aCamera, aFrustum, aOut ) )
+				continue;
+
+			Vec2f const h = node_heights( top, x, z );
+			float const x0 = mOrigin.x + float(x) * size, z0 = mOrigin.y + float(z) * size;
+			if( aFrustum.intersects_box( Vec3f{ x0, h.x, z0 }, Vec3f{ x0 + size, h.y, z0 + size } ) )
+				aOut.full.emplace_back( TerrainPatch{ x0, z0, size, float(top) } );
+		}
+	}
+}
+
+std::size_t CdlodTree::level_count() const noexcept
+{
+	return mLevels.size();
+}
+CdlodParams const& CdlodTree::params() const noexcept
+{
+	return mParams;
+}
+
+float CdlodTree::node_size( std::size_t aLevel ) const noexcept
+{
+	return std::ldexp( mLeafSize, int(aLevel) );
+}
+float CdlodTree::lod_range( std::size_t aLevel ) const noexcept
+{
+	return mParams.lodRange * node_size( aLevel );
+}
+
+Vec2f CdlodTree::morph_range( std::size_t aLevel ) const noexcept
+{
+	float const prev = aLevel ? lod_range( aLevel - 1 ) : 0.f;
+	float const end = lod_range( aLevel );
+	return Vec2f{ prev + (end - prev) * mParams.morphStart, end };
+}
+
+Vec2f CdlodTree::node_heights( std::size_t aLevel, std::size_t aX, std::size_t aZ ) const noexcept
+{
+	assert( aLevel < mLevels.size() );
+	auto const& level = mLevels[aLevel];
+	assert( aX < level.nodesX && aZ < level.nodesZ );
+	return level.heights[aZ * level.nodesX + aX];
+}
+
+// Returns false if the node is out of its level's range; the caller then
+// covers its area at the caller's level. Nodes outside of the frustum (or of
+// the heightfield) are in range, but add nothing.
+bool CdlodTree::select_( std::size_t aLevel, std::size_t aX, std::size_t aZ, Vec3f aCamera, Frustum const& aFrustum, Selection& aOut ) const
+{
+	auto const& level = mLevels[aLevel];
+	if( aX >= level.nodesX || aZ >= level.nodesZ )
+		return true;
+
+	float const size = node_size( aLevel );
+	Vec2f const h = level.heights[aZ * level.nodesX + aX];
+	Vec3f const lo{ mOrigin.x + float(aX) * size, h.x, mOrigin.y + float(aZ) * size };
+	Vec3f const hi{ lo.x + size, h.y, lo.z + size };
+
+	float const range = lod_range( aLevel );
+	if( distance2_( aCamera, lo, hi ) > range*range )
+		return false;
+
+	if( !aFrustum.intersects_box( lo, hi ) )
+		return true;
+
+	if( 0 == aLevel )
+	{
+		aOut.full.emplace_back( TerrainPatch{ lo.x, lo.z, size, 0.f } );
+		return true;
+	}
+
+	float const childRange = lod_range( aLevel - 1 );
+	if( distance2_( aCamera, lo, hi ) > childRange*childRange )
+	{
+		aOut.full.emplace_back( TerrainPatch{ lo.x, lo.z, size, float(aLevel) } );
+		return true;
+	}
+
+	for( std::size_t c = 0; c < 4; ++c )
+	{
+		std::size_t const cx = 2*aX + (c & 1), cz = 2*aZ + (c >> 1);
+		if( select_( aLevel - 1, cx, cz, aCamera, aFrustum, aOut ) )
+			continue;
+
+		float const half = 0.5f * size;
+		Vec2f const ch = node_heights( aLevel - 1, cx, cz );
+		Vec3f const clo{ lo.x + float(c & 1) * half, ch.x, lo.z + float(c >> 1) * half };
+		if( aFrustum.intersects_box( clo, Vec3f{ clo.x + half, ch.y, clo.z + half } ) )
+			aOut.half.emplace_back( TerrainPatch{ clo.x, clo.z, half, float(aLevel) } );
+	}
+
+	return true;
+}
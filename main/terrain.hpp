@@ -0,0 +1,138 @@
+#ifndef TERRAIN_HPP_71C3E9A4_58D2_4B0F_A6E7_2D94F13B8C60
+#define TERRAIN_HPP_71C3E9A4_58D2_4B0F_A6E7_2D94F13B8C60
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec2.hpp"
+#include "../vmlib/vec3.hpp"
+
+#include "simple_mesh.hpp"
+
+struct Frustum;
+
+/* Heightfield: heights on a regular grid in the xz plane
+ *
+ * Sample (i, j) lies at origin + (i, j) * spacing; heights are stored row by
+ * row, rows along +z. Between samples, the height is interpolated bilinearly
+ * (as the GPU's linear filtering does).
+ *
+ * The terrain's texture coordinates are affine functions of x and z:
+ * u = dot( texcoordU, (x, z, 1) ), and likewise for v.
+ */
+struct Heightfield
+{
+	std::size_t samplesX = 0, samplesZ = 0;
+	Vec2f origin{ 0.f, 0.f }; // x, z
+	float spacing = 1.f;
+	std::vector<float> heights;
+
+	Vec3f texcoordU{ 0.f, 0.f, 0.f };
+	Vec3f texcoordV{ 0.f, 0.f, 0.f };
+
+	float sample( std::size_t aI, std::size_t aJ ) const noexcept;
+
+	// Clamped to the grid outside of it
+	float height_at( float aX, float aZ ) const noexcept;
+
+	float size_x() const noexcept; // world units
+	float size_z() const noexcept;
+};
+
+// Resamples a terrain mesh (e.g., an OBJ landscape) into a heightfield with
+// aResolution samples along its longer side. Where triangles overlap, the
+// highest one wins; samples that no triangle covers get the lowest height.
+// The texture coordinates are a least-squares fit of the mesh's.
+Heightfield make_heightfield( SimpleMeshData const&, std::size_t aResolution );
+
+// Loads an 8- or 16-bit grayscale image; black maps to aOrigin.y, white to
+// aOrigin.y + aHeightScale. The image spans aSizeX along x, and its rows run
+// along +z. The texture coordinates map the image's extent to [0,1]^2.
+Heightfield load_heightfield( char const* aPath, Vec3f aOrigin, float aSizeX, float aHeightScale );
+
+
+struct CdlodParams
+{
+	std::uint32_t patchQuads = 32; // grid size of a patch; a multiple of 4
+	float lodRange = 4.f; // view distance of the finest level, in leaf node sizes
+	float morphStart = 0.7f; // fraction of each level's range at which morphing starts
+};
+
+// A node to draw, as a grid of patchQuads^2 quads (or, for half patches,
+// (patchQuads/2)^2) over [x, x+size] x [z, z+size]. This is also the
+// per-instance data of the terrain vertex shader.
+struct TerrainPatch
+{
+	float x, z;
+	float size;
+	float level;
+};
+
+/* CdlodTree: continuous distance-dependent level of detail (Strugar, 2009)
+ *
+ * A quadtree over the heightfield, stored level by level, with each node's
+ * height range. Leaf nodes (level 0) cover patchQuads^2 cells of the
+ * heightfield, so their patches have the heightfield's full resolution; each
+ * level up doubles the node size and halves the resolution.
+ *
+ * Each level has a view distance range, doubling from level to level. The
+ * selection walks the tree from the top and picks the coarsest node whose
+ * children are all beyond their own level's range, skipping nodes outside
+ * of the frustum. Where only some of a node's children are in range, the
+ * others are drawn as half patches (quarter nodes at the parent's grid
+ * spacing).
+ *
+ * In the vertex shader, the grid vertices morph towards the next coarser
+ * grid over the last part of their level's range (see morph_range()), such
+ * that neighbouring levels meet without cracks, and levels change without
+ * popping.
+ */
+class CdlodTree final
+{
+	public:
+		static constexpr std::size_t kMaxLevels = 16;
+
+		struct Selection
+		{
+			std::vector<TerrainPatch> full;
+			std::vector<TerrainPatch> half;
+		};
+
+	public:
+		CdlodTree( Heightfield const&, CdlodParams const& = {} );
+
+	public:
+		void select( Vec3f aCamera, Frustum const&, Selection& aOut ) const;
+
+		std::size_t level_count() const noexcept;
+		CdlodParams const& params() const noexcept;
+
+		float node_size( std::size_t aLevel ) const noexcept; // world units
+		float lod_range( std::size_t aLevel ) const noexcept;
+
+		// View distance at which a level starts to morph to the next, and
+		// where it is fully morphed (its range).
+		Vec2f morph_range( std::size_t aLevel ) const noexcept;
+
+		// Height range of a node, in world units
+		Vec2f node_heights( std::size_t aLevel, std::size_t aX, std::size_t aZ ) const noexcept;
+
+	private:
+		struct Level_
+		{
+			std::size_t nodesX, nodesZ;
+			std::vector<Vec2f> heights; // min, max
+		};
+
+		bool select_( std::size_t aLevel, std::size_t aX, std::size_t aZ, Vec3f aCamera, Frustum const&, Selection& ) const;
+
+	private:
+		CdlodParams mParams;
+		Vec2f mOrigin;
+		float mLeafSize;
+		std::vector<Level_> mLevels;
+};
+
+#endif // TERRAIN_HPP_71C3E9A4_58D2_4B0F_A6E7_2D94F13B8C60
@@ -0,0 +1,191 @@
+#include "terrain_renderer.hpp"
+
+#include <vector>
+
+#include <cstring>
+#include <cassert>
+
+#include "../support/stream_buffer.hpp"
+#include "../support/shader_permutations.hpp"
+
+#include "render_model.hpp"
+#include "frustum.hpp"
+
+namespace
+{
+	constexpr GLuint kHeightBinding_ = 5; // see terrain.vert
+
+	// Uniform locations in terrain.vert. These must not collide with the
+	// ones of objects.frag.
+	constexpr GLint kCameraLocation_ = 27;
+	constexpr GLint kHeightfieldLocation_ = 28;
+	constexpr GLint kExtentLocation_ = 29;
+	constexpr GLint kTexcoordLocation_ = 30; // U and V
+	constexpr GLint kGridLocation_ = 32;
+	constexpr GLint kMorphLocation_ = 33; // one per level
+}
+
+TerrainRenderer::TerrainRenderer( Heightfield const& aField, CdlodParams const& aParams, GLuint aTexture )
+	: mTree( aField, aParams )
+	, mOrigin( aField.origin )
+	, mSpacing( aField.spacing )
+	, mSize{ aField.size_x(), aField.size_z() }
+	, mHeightTexel{ 1.f / float(aField.samplesX), 1.f / float(aField.samplesZ) }
+	, mTexcoordU( aField.texcoordU )
+	, mTexcoordV( aField.texcoordV )
+	, mTexture( aTexture )
+{
+	glGenTextures( 1, &mHeightTexture );
+	glBindTexture( GL_TEXTURE_2D, mHeightTexture );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_R32F, GLsizei(aField.samplesX), GLsizei(aField.samplesZ), 0, GL_RED, GL_FLOAT, aField.heights.data() );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	mFull = create_grid_( aParams.patchQuads );
+	mHalf = create_grid_( aParams.patchQuads / 2 );
+}
+
+TerrainRenderer::~TerrainRenderer()
+{
+	for( auto const* grid : { &mFull, &mHalf } )
+	{
+		glDeleteVertexArrays( 1, &grid->vao );
+		glDeleteBuffers( 1, &grid->vertices );
+		glDeleteBuffers( 1, &grid->indices );
+	}
+	glDeleteTextures( 1, &mHeightTexture );
+}
+
+std::uint32_t TerrainRenderer::features() const
+{
+	return (lit_shader_features() & ~std::uint32_t(kShaderVertexColor)) | (mTexture ? kShaderTexture : 0);
+}
+
+void TerrainRenderer::render( ShaderPermutations& aShaders, Mat44f const& aViewProjection, Vec3f aCamera, StreamBuffer& aStream )
+{
+	mTree.select( aCamera, Frustum( aViewProjection ), mSelection );
+	if( mSelection.full.empty() && mSelection.half.empty() )
+		return;
+
+	glUseProgram( aShaders.get( features() ).programId() );
+	set_lighting_uniforms();
+
+	glUniformMatrix4fv( 0, 1, GL_TRUE, aViewProjection.v );
+	glUniform3fv( kCameraLocation_, 1, &aCamera.x );
+	glUniform3f( kHeightfieldLocation_, mOrigin.x, mOrigin.y, mSpacing );
+	glUniform4f( kExtentLocation_, mSize.x, mSize.y, mHeightTexel.x, mHeightTexel.y );
+	glUniform3fv( kTexcoordLocation_, 1, &mTexcoordU.x );
+	glUniform3fv( kTexcoordLocation_+1, 1, &mTexcoordV.x );
+
+	for( std::size_t i = 0; i < mTree.level_count(); ++i )
+	{
+		Vec2f const range = mTree.morph_range( i );
+		glUniform2f( kMorphLocation_ + GLint(i), range.x, range.y );
+	}
+
+	glActiveTexture( GL_TEXTURE0 + kHeightBinding_ );
+	glBindTexture( GL_TEXTURE_2D, mHeightTexture );
+	if( mTexture )
+	{
+		glActiveTexture( GL_TEXTURE0 );
+		glBindTexture( GL_TEXTURE_2D, mTexture );
+	}
+
+	draw_grid_( mFull, mSelection.full.size(), aStream, mSelection.full.data() );
+	draw_grid_( mHalf, mSelection.half.size(), aStream, mSelection.half.data() );
+
+	glBindVertexArray( 0 );
+}
+
+CdlodTree const& TerrainRenderer::tree() const noexcept
+{
+	return mTree;
+}
+
+std::size_t TerrainRenderer::patch_count() const noexcept
+{
+	return mSelection.full.size() + mSelection.half.size();
+}
+
+TerrainRenderer::Grid_ TerrainRenderer::create_grid_( std::size_t aQuads )
+{
+	assert( aQuads > 0 && (aQuads+1) * (aQuads+1) <= 65536 );
+
+	// Vertices are grid coordinates; terrain.vert scales them to the patch.
+	std::vector<float> vertices;
+	for( std::size_t j = 0; j <= aQuads; ++j )
+	{
+		for( std::size_t i = 0; i <= aQuads; ++i )
+			vertices.insert( vertices.end(), { float(i), float(j) } );
+	}
+
+	// Counter-clockwise when seen from above (+y)
+	std::vector<std::uint16_t> indices;
+	auto const index = [&] (std::size_t aI, std::size_t aJ) { return std::uint16_t(aJ * (aQuads+1) + aI); };
+	for( std::size_t j = 0; j < aQuads; ++j )
+	{
+		for( std::size_t i = 0; i < aQuads; ++i )
+		{
+			indices.insert( indices.end(), {
+				index( i, j ), index( i, j+1 ), index( i+1, j ),
+				index( i+1, j ), index( i, j+1 ), index( i+1, j+1 )
+			} );
+		}
+	}
+
+	Grid_ grid;
+	grid.indexCount = GLsizei(indices.size());
+	grid.quads = float(aQuads);
+
+	glGenBuffers( 1, &grid.vertices );
+	glBindBuffer( GL_ARRAY_BUFFER, grid.vertices );
+	glBufferData( GL_ARRAY_BUFFER, GLsizeiptr(vertices.size() * sizeof(float)), vertices.data(), GL_STATIC_DRAW );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	glGenVertexArrays( 1, &grid.vao );
+	glBindVertexArray( grid.vao );
+
+	glGenBuffers( 1, &grid.indices );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, grid.indices );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(indices.size() * sizeof(std::uint16_t)), indices.data(), GL_STATIC_DRAW );
+
+	// Binding 0: the grid; binding 1: the patches (per instance), whose
+	// buffer is bound per draw.
+	glVertexAttribFormat( 0, 2, GL_FLOAT, GL_FALSE, 0 );
+	glVertexAttribBinding( 0, 0 );
+	glEnableVertexAttribArray( 0 );
+	glBindVertexBuffer( 0, grid.vertices, 0, 2 * sizeof(float) );
+
+	glVertexAttribFormat( 1, 4, GL_FLOAT, GL_FALSE, 0 );
+	glVertexAttribBinding( 1, 1 );
+	glEnableVertexAttribArray( 1 );
+	glVertexBindingDivisor( 1, 1 );
+
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	return grid;
+}
+
+void TerrainRenderer::draw_grid_( Grid_ const& aGrid, std::size_t aCount, StreamBuffer& aStream, TerrainPatch const* aPatches )
+{
+	if( 0 == aCount )
+		return;
+
+	auto const patches = aStream.allocate( aCount * sizeof(TerrainPatch), alignof(TerrainPatch) );
+	std::memcpy( patches.data, aPatches, patches.size );
+	aStream.commit( patches );
+
+	glUniform1f( kGridLocation_, aGrid.quads );
+
+	glBindVertexArray( aGrid.vao );
+	glBindVertexBuffer( 1, aStream.buffer(), GLintptr(patches.offset), sizeof(TerrainPatch) );
+	glDrawElementsInstanced( GL_TRIANGLES, aGrid.indexCount, GL_UNSIGNED_SHORT, nullptr, GLsizei(aCount) );
+
+	auto& stats = render_stats();
+	++stats.drawCalls;
+	stats.triangles += std::size_t(aGrid.indexCount) / 3 * aCount;
+}
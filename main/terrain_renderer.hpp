@@ -0,0 +1,80 @@
+#ifndef TERRAIN_RENDERER_HPP_0B6E4D28_93A1_4C75_8F2D_6A1C57E0B9F3
+#define TERRAIN_RENDERER_HPP_0B6E4D28_93A1_4C75_8F2D_6A1C57E0B9F3
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+#include "terrain.hpp"
+
+class StreamBuffer;
+class ShaderPermutations;
+
+/* TerrainRenderer: draws a heightfield with CDLOD (see CdlodTree)
+ *
+ * The heights live in a single-channel float texture; the terrain's color
+ * texture is the caller's. Each frame, the tree selects patches for the
+ * view, and their TerrainPatch records go into the stream buffer as
+ * instance data. All full patches are then drawn with one instanced draw of
+ * a patchQuads^2 grid, and all half patches with one of a (patchQuads/2)^2
+ * grid. terrain.vert displaces and morphs the grid vertices, and computes
+ * the normals from the heights.
+ *
+ * The shaders are terrain.vert with objects.frag, as permutations over
+ * kObjectShaderFeatures; the lit, textured variants are used (with shadows
+ * and point lights as in render_lighting()).
+ */
+class TerrainRenderer final
+{
+	public:
+		TerrainRenderer( Heightfield const&, CdlodParams const&, GLuint aTexture );
+		~TerrainRenderer();
+
+		TerrainRenderer( TerrainRenderer const& ) = delete;
+		TerrainRenderer& operator= (TerrainRenderer const&) = delete;
+
+	public:
+		// The shader features with which render() draws
+		std::uint32_t features() const;
+
+		void render( ShaderPermutations&, Mat44f const& aViewProjection, Vec3f aCamera, StreamBuffer& );
+
+	public:
+		CdlodTree const& tree() const noexcept;
+
+		// Patches drawn by the last render()
+		std::size_t patch_count() const noexcept;
+
+	private:
+		struct Grid_
+		{
+			GLuint vao = 0;
+			GLuint vertices = 0, indices = 0;
+			GLsizei indexCount = 0;
+			float quads = 0.f;
+		};
+
+		static Grid_ create_grid_( std::size_t aQuads );
+		void draw_grid_( Grid_ const&, std::size_t aCount, StreamBuffer&, TerrainPatch const* );
+
+	private:
+		CdlodTree mTree;
+		CdlodTree::Selection mSelection;
+
+		Vec2f mOrigin;
+		float mSpacing;
+		Vec2f mSize;
+		Vec2f mHeightTexel; // 1 / samples
+		Vec3f mTexcoordU, mTexcoordV;
+
+		GLuint mHeightTexture = 0;
+		GLuint mTexture;
+
+		Grid_ mFull, mHalf;
+};
+
+#endif // TERRAIN_RENDERER_HPP_0B6E4D28_93A1_4C75_8F2D_6A1C57E0B9F3
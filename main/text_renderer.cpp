@@ -0,0 +1,252 @@
+#include "text_renderer.hpp"
+
+#include <fontstash.h>
+
+#include <algorithm>
+
+#include <cassert>
+#include <cstddef>
+
+#include "../support/error.hpp"
+#include "../support/stream_buffer.hpp"
+
+namespace
+{
+	// Initial atlas size. Plenty for a single font at HUD sizes; grows by
+	// doubling when needed.
+	constexpr int kInitialAtlasSize_ = 256;
+	constexpr int kMaxAtlasSize_ = 4096;
+}
+
+TextRenderer::TextRenderer( char const* aFontPath, float aSize )
+{
+	assert( aFontPath );
+
+	FONSparams params{};
+	params.width = kInitialAtlasSize_;
+	params.height = kInitialAtlasSize_;
+	params.flags = FONS_ZERO_TOPLEFT;
+	params.userPtr = this;
+	params.renderCreate = &TextRenderer::create_;
+	params.renderResize = &TextRenderer::resize_;
+	params.renderUpdate = &TextRenderer::update_;
+	params.renderDraw = &TextRenderer::draw_;
+	params.renderDelete = &TextRenderer::delete_;
+
+	mContext = fonsCreateInternal( &params );
+	if( !mContext )
+		throw Error( "TextRenderer: unable to create fontstash context" );
+
+	fonsSetErrorCallback( mContext, &TextRenderer::error_, this );
+
+	mFont = fonsAddFont( mContext, "default", aFontPath );
+	if( FONS_INVALID == mFont )
+	{
+		fonsDeleteInternal( mContext );
+		throw Error( "TextRenderer: unable to load font '%s'", aFontPath );
+	}
+
+	fonsSetFont( mContext, mFont );
+	fonsSetSize( mContext, aSize );
+	fonsSetAlign( mContext, FONS_ALIGN_LEFT | FONS_ALIGN_TOP );
+
+	float ascender, descender;
+	fonsVertMetrics( mContext, &ascender, &descender, &mLineHeight );
+
+	// Vertex format. The buffer is bound per flush.
+	glGenVertexArrays( 1, &mVAO );
+	glBindVertexArray( mVAO );
+
+	glVertexAttribFormat( 0, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex_, x) );
+	glVertexAttribBinding( 0, 0 );
+	glEnableVertexAttribArray( 0 );
+
+	glVertexAttribFormat( 1, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex_, s) );
+	glVertexAttribBinding( 1, 0 );
+	glEnableVertexAttribArray( 1 );
+
+	glVertexAttribFormat( 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(Vertex_, color) );
+	glVertexAttribBinding( 2, 0 );
+	glEnableVertexAttribArray( 2 );
+
+	glBindVertexArray( 0 );
+}
+
+TextRenderer::~TextRenderer()
+{
+	fonsDeleteInternal( mContext ); // deletes the texture via delete_()
+	glDeleteVertexArrays( 1, &mVAO );
+}
+
+float TextRenderer::text( float aX, float aY, char const* aText, std::uint32_t aColor )
+{
+	fonsSetColor( mContext, aColor );
+	return fonsDrawText( mContext, aX, aY, aText, nullptr );
+}
+
+float TextRenderer::text_width( char const* aText )
+{
+	return fonsTextBounds( mContext, 0.f, 0.f, aText, nullptr, nullptr );
+}
+
+void TextRenderer::rect( float aX0, float aY0, float aX1, float aY1, std::uint32_t aColor )
+{
+	// fontstash reserves a 2x2 block of white texels at the origin of the
+	// atlas. Sample its center.
+	float const s = 1.f / float(mAtlasWidth);
+	float const t = 1.f / float(mAtlasHeight);
+
+	Vertex_ const v0{ aX0, aY0, s, t, aColor };
+	Vertex_ const v1{ aX1, aY0, s, t, aColor };
+	Vertex_ const v2{ aX1, aY1, s, t, aColor };
+	Vertex_ const v3{ aX0, aY1, s, t, aColor };
+
+	mBatch.insert( mBatch.end(), { v0, v1, v2, v0, v2, v3 } );
+}
+
+void TextRenderer::flush( GLuint aProgram, StreamBuffer& aStream, float aViewportWidth, float aViewportHeight )
+{
+	// Upload any glyphs that were rasterized since the last flush (and the
+	// white texels, on the first flush).
+	int dirty[4];
+	if( fonsValidateTexture( mContext, dirty ) )
+	{
+		int width, height;
+		auto const* data = fonsGetTextureData( mContext, &width, &height );
+		update_( this, dirty, data );
+	}
+
+	if( mBatch.empty() )
+		return;
+
+	auto const bytes = mBatch.size() * sizeof(Vertex_);
+	auto const alloc = aStream.allocate( bytes, sizeof(float) );
+	std::copy( mBatch.begin(), mBatch.end(), static_cast<Vertex_*>(alloc.data) );
+	aStream.commit( alloc );
+
+	glUseProgram( aProgram );
+	glUniform2f( 0, aViewportWidth, aViewportHeight );
+
+	glActiveTexture( GL_TEXTURE0 );
+	glBindTexture( GL_TEXTURE_2D, mTexture );
+
+	GLboolean const depthTest = glIsEnabled( GL_DEPTH_TEST );
+	GLboolean const cullFace = glIsEnabled( GL_CULL_FACE );
+
+	glDisable( GL_DEPTH_TEST );
+	glDisable( GL_CULL_FACE );
+	glEnable( GL_BLEND );
+	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+	// The offset is not necessarily a multiple of the vertex size, so the
+	// vertices are addressed through the binding's offset rather than the
+	// first vertex.
+	glBindVertexArray( mVAO );
+	glBindVertexBuffer( 0, aStream.buffer(), GLintptr(alloc.offset), sizeof(Vertex_) );
+	glDrawArrays( GL_TRIANGLES, 0, GLsizei(mBatch.size()) );
+	glBindVertexArray( 0 );
+
+	glDisable( GL_BLEND );
+	if( depthTest ) glEnable( GL_DEPTH_TEST );
+	if( cullFace ) glEnable( GL_CULL_FACE );
+
+	mBatch.clear();
+}
+
+float TextRenderer::line_height() const noexcept
+{
+	return mLineHeight;
+}
+
+int TextRenderer::create_( void* aSelf, int aWidth, int aHeight )
+{
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	glGenTextures( 1, &self->mTexture );
+	glBindTexture( GL_TEXTURE_2D, self->mTexture );
+	glTexStorage2D( GL_TEXTURE_2D, 1, GL_R8, aWidth, aHeight );
+
+	// Glyphs are rasterized at their final size, no filtering needed.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	self->mAtlasWidth = aWidth;
+	self->mAtlasHeight = aHeight;
+	return 1;
+}
+
+int TextRenderer::resize_( void* aSelf, int aWidth, int aHeight )
+{
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	// Vertices already in the batch were normalized against the old size.
+	// Glyphs keep their position in the atlas, so rescaling is sufficient.
+	float const sx = float(self->mAtlasWidth) / float(aWidth);
+	float const sy = float(self->mAtlasHeight) / float(aHeight);
+	for( auto& v : self->mBatch )
+	{
+		v.s *= sx;
+		v.t *= sy;
+	}
+
+	// fontstash marks the whole atlas as dirty after resizing, so the new
+	// texture is filled by the next update.
+	delete_( aSelf );
+	return create_( aSelf, aWidth, aHeight );
+}
+
+void TextRenderer::update_( void* aSelf, int* aRect, unsigned char const* aData )
+{
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	int const x = aRect[0], y = aRect[1];
+	int const w = aRect[2] - aRect[0], h = aRect[3] - aRect[1];
+
+	glBindTexture( GL_TEXTURE_2D, self->mTexture );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, self->mAtlasWidth );
+	glTexSubImage2D( GL_TEXTURE_2D, 0, x, y, w, h, GL_RED, GL_UNSIGNED_BYTE, aData + y*self->mAtlasWidth + x );
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+void TextRenderer::draw_( void* aSelf, float const* aVerts, float const* aTexCoords, unsigned int const* aColors, int aCount )
+{
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	for( int i = 0; i < aCount; ++i )
+	{
+		self->mBatch.emplace_back( Vertex_{
+			aVerts[2*i+0], aVerts[2*i+1],
+			aTexCoords[2*i+0], aTexCoords[2*i+1],
+			aColors[i]
+		} );
+	}
+}
+
+void TextRenderer::delete_( void* aSelf )
+{
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	glDeleteTextures( 1, &self->mTexture );
+	self->mTexture = 0;
+}
+
+void TextRenderer::error_( void* aSelf, int aError, int )
+{
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	// Grow the atlas; fontstash then retries the glyph. Past the maximum,
+	// the glyph is simply not drawn.
+	if( FONS_ATLAS_FULL == aError && self->mAtlasWidth < kMaxAtlasSize_ )
+	{
+		int const w = std::min( self->mAtlasWidth * 2, kMaxAtlasSize_ );
+		int const h = std::min( self->mAtlasHeight * 2, kMaxAtlasSize_ );
+		fonsExpandAtlas( self->mContext, w, h );
+	}
+}
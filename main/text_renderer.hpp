@@ -0,0 +1,87 @@
+#ifndef TEXT_RENDERER_HPP_E2A47C19_3B8D_4F5E_96C1_0D7B52E8A3F6
+#define TEXT_RENDERER_HPP_E2A47C19_3B8D_4F5E_96C1_0D7B52E8A3F6
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+struct FONScontext;
+class StreamBuffer;
+
+// Packed 8-bit RGBA color, as used by fontstash (red in the lowest byte)
+constexpr std::uint32_t pack_rgba( std::uint8_t aR, std::uint8_t aG, std::uint8_t aB, std::uint8_t aA = 255 ) noexcept
+{
+	return std::uint32_t(aR) | std::uint32_t(aG) << 8 | std::uint32_t(aB) << 16 | std::uint32_t(aA) << 24;
+}
+
+/* TextRenderer: batched screen-space text and rectangles
+ *
+ * Glyphs are rasterized by fontstash into a single-channel atlas texture,
+ * which is created at a modest size and doubled whenever it fills up. Only
+ * the parts of the atlas that changed are uploaded.
+ *
+ * text() and rect() only append vertices to a CPU-side batch. flush() copies
+ * the batch into a StreamBuffer and draws all of it with a single draw call
+ * (rectangles sample the atlas' white texels). Coordinates are in pixels,
+ * with the origin in the top left corner.
+ *
+ * Uses text.vert and text.frag.
+ */
+class TextRenderer final
+{
+	public:
+		explicit TextRenderer( char const* aFontPath, float aSize = 16.f );
+		~TextRenderer();
+
+		TextRenderer( TextRenderer const& ) = delete;
+		TextRenderer& operator= (TextRenderer const&) = delete;
+
+	public:
+		// aY is the top of the line. Returns the x coordinate after the
+		// text.
+		float text( float aX, float aY, char const* aText, std::uint32_t aColor );
+
+		void rect( float aX0, float aY0, float aX1, float aY1, std::uint32_t aColor );
+
+		// Draws and clears the batch. Blending is enabled and depth testing
+		// disabled while drawing; both are restored afterwards.
+		void flush( GLuint aProgram, StreamBuffer&, float aViewportWidth, float aViewportHeight );
+
+		// Horizontal advance of aText, without drawing it.
+		float text_width( char const* aText );
+
+	public:
+		float line_height() const noexcept;
+
+	private:
+		struct Vertex_
+		{
+			float x, y;
+			float s, t;
+			std::uint32_t color;
+		};
+
+		// fontstash callbacks
+		static int create_( void*, int, int );
+		static int resize_( void*, int, int );
+		static void update_( void*, int*, unsigned char const* );
+		static void draw_( void*, float const*, float const*, unsigned int const*, int );
+		static void delete_( void* );
+		static void error_( void*, int, int );
+
+	private:
+		FONScontext* mContext = nullptr;
+		int mFont = -1;
+		float mLineHeight = 0.f;
+
+		GLuint mTexture = 0;
+		int mAtlasWidth = 0, mAtlasHeight = 0;
+
+		GLuint mVAO = 0;
+		std::vector<Vertex_> mBatch;
+};
+
+#endif // TEXT_RENDERER_HPP_E2A47C19_3B8D_4F5E_96C1_0D7B52E8A3F6
@@ -0,0 +1,237 @@
+#include "vertex_quant.hpp"
+
+#include <numbers>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include "simple_mesh.hpp"
+
+namespace
+{
+	constexpr float kUnorm16_ = 65535.f;
+	constexpr float kSnorm16_ = 32767.f;
+
+	std::uint16_t unorm16_( float aValue, float aOffset, float aScale ) noexcept
+	{
+		float const t = aScale > 0.f ? (aValue - aOffset) / aScale : 0.f;
+		return std::uint16_t(std::lround( std::clamp( t, 0.f, 1.f ) * kUnorm16_ ));
+	}
+
+	float sign_not_zero_( float aValue ) noexcept
+	{
+		return aValue >= 0.f ? 1.f : -1.f;
+	}
+
+	// Octahedral mapping of the unit sphere onto [-1,1]^2
+	Vec2f octahedral_( Vec3f aNormal ) noexcept
+	{
+		float const l1 = std::abs( aNormal.x ) + std::abs( aNormal.y ) + std::abs( aNormal.z );
+		if( 0.f == l1 )
+			return Vec2f{ 0.f, 0.f };
+
+		Vec3f const n = aNormal / l1;
+		if( n.z >= 0.f )
+			return Vec2f{ n.x, n.y };
+
+		return Vec2f{ (1.f - std::abs( n.y )) * sign_not_zero_( n.x ), (1.f - std::abs( n.x )) * sign_not_zero_( n.y ) };
+	}
+
+	std::uint32_t pack_snorm16x2_( float aX, float aY ) noexcept
+	{
+		auto const x = std::int16_t(std::clamp( aX, -kSnorm16_, kSnorm16_ ));
+		auto const y = std::int16_t(std::clamp( aY, -kSnorm16_, kSnorm16_ ));
+		return std::uint32_t(std::uint16_t(x)) | (std::uint32_t(std::uint16_t(y)) << 16);
+	}
+
+	// Of the four neighbouring grid points, picks the one that decodes
+	// closest to the normal, rather than just rounding.
+	std::uint32_t encode_normal_( Vec3f aNormal ) noexcept
+	{
+		float const len = length( aNormal );
+		if( !(len > 0.f) )
+			return pack_snorm16x2_( 0.f, 0.f ) ; // decodes to +z
+
+		Vec3f const n = aNormal / len;
+		Vec2f const e = octahedral_( n );
+		float const fx = std::floor( e.x * kSnorm16_ ), fy = std::floor( e.y * kSnorm16_ );
+
+		std::uint32_t best = 0;
+		float bestDot = -2.f;
+		for( float dy = 0.f; dy <= 1.f; dy += 1.f )
+		{
+			for( float dx = 0.f; dx <= 1.f; dx += 1.f )
+			{
+				std::uint32_t const packed = pack_snorm16x2_( fx + dx, fy + dy );
+				if( float const d = dot( decode_normal( packed ), n ); d > bestDot )
+				{
+					bestDot = d;
+					best = packed;
+				}
+			}
+		}
+		return best;
+	}
+
+	float linear_to_srgb_( float aValue ) noexcept
+	{
+		float const c = std::clamp( aValue, 0.f, 1.f );
+		return c <= 0.0031308f ? 12.92f * c : 1.055f * std::pow( c, 1.f/2.4f ) - 0.055f;
+	}
+	float srgb_to_linear_( float aValue ) noexcept
+	{
+		return aValue <= 0.04045f ? aValue / 12.92f : std::pow( (aValue + 0.055f) / 1.055f, 2.4f );
+	}
+
+	std::uint32_t encode_color_( Vec3f aColor ) noexcept
+	{
+		auto const channel = [] (float aValue) {
+			return std::uint32_t(std::lround( linear_to_srgb_( aValue ) * 255.f ));
+		};
+		return channel( aColor.x ) | (channel( aColor.y ) << 8) | (channel( aColor.z ) << 16) | (0xffu << 24);
+	}
+}
+
+std::size_t QuantizedVertices::size() const noexcept
+{
+	assert( positions.size() == 4*normals.size() && normals.size() == colors.size() && colors.size() == texcoords.size() );
+	return normals.size();
+}
+
+VertexDecode quantize_mesh( SimpleMeshData const& aMesh, QuantizedVertices& aOut )
+{
+	auto const count = aMesh.positions.size();
+
+	VertexDecode decode;
+	if( count )
+	{
+		Vec3f lo = aMesh.positions.front(), hi = lo;
+		for( auto const& p : aMesh.positions )
+		{
+			lo = Vec3f{ std::min( lo.x, p.x ), std::min( lo.y, p.y ), std::min( lo.z, p.z ) };
+			hi = Vec3f{ std::max( hi.x, p.x ), std::max( hi.y, p.y ), std::max( hi.z, p.z ) };
+		}
+		decode.positionOffset = lo;
+		decode.positionScale = hi - lo;
+	}
+
+	if( !aMesh.texcoords.empty() )
+	{
+		Vec2f lo = aMesh.texcoords.front(), hi = lo;
+		for( auto const& t : aMesh.texcoords )
+		{
+			lo = Vec2f{ std::min( lo.x, t.x ), std::min( lo.y, t.y ) };
+			hi = Vec2f{ std::max( hi.x, t.x ), std::max( hi.y, t.y ) };
+		}
+		decode.texcoordOffset = lo;
+		decode.texcoordScale = Vec2f{ hi.x - lo.x, hi.y - lo.y };
+	}
+
+	aOut.positions.reserve( aOut.positions.size() + 4*count );
+	aOut.normals.reserve( aOut.normals.size() + count );
+	aOut.colors.reserve( aOut.colors.size() + count );
+	aOut.texcoords.reserve( aOut.texcoords.size() + count );
+
+	auto const& o = decode.positionOffset;
+	auto const& s = decode.positionScale;
+	for( std::size_t i = 0; i < count; ++i )
+	{
+		auto const& p = aMesh.positions[i];
+		aOut.positions.insert( aOut.positions.end(), { unorm16_( p.x, o.x, s.x ), unorm16_( p.y, o.y, s.y ), unorm16_( p.z, o.z, s.z ), 0 } );
+
+		aOut.normals.emplace_back( encode_normal_( i < aMesh.normals.size() ? aMesh.normals[i] : Vec3f{ 0.f, 1.f, 0.f } ) );
+		aOut.colors.emplace_back( encode_color_( i < aMesh.colors.size() ? aMesh.colors[i] : Vec3f{ 1.f, 1.f, 1.f } ) );
+
+		Vec2f const t = i < aMesh.texcoords.size() ? aMesh.texcoords[i] : Vec2f{ 0.f, 0.f };
+		aOut.texcoords.emplace_back( std::uint32_t(unorm16_( t.x, decode.texcoordOffset.x, decode.texcoordScale.x ))
+			| (std::uint32_t(unorm16_( t.y, decode.texcoordOffset.y, decode.texcoordScale.y )) << 16) );
+	}
+
+	return decode;
+}
+
+QuantizationError quantization_error( SimpleMeshData const& aMesh, QuantizedVertices const& aVertices, std::size_t aFirst, VertexDecode const& aDecode )
+{
+	assert( aFirst + aMesh.positions.size() <= aVertices.size() );
+
+	QuantizationError ret{ 0.f, 0.f, 0.f, 0.f };
+	for( std::size_t i = 0; i < aMesh.positions.size(); ++i )
+	{
+		auto const v = aFirst + i;
+		ret.position = std::max( ret.position, length( decode_position( aVertices, v, aDecode ) - aMesh.positions[i] ) );
+
+		if( i < aMesh.normals.size() )
+		{
+			float const len = length( aMesh.normals[i] );
+			if( len > 0.f )
+			{
+				// Unlike acos() of the dot product, accurate for small angles
+				float const chord = length( decode_normal( aVertices.normals[v] ) - aMesh.normals[i] / len );
+				float const angle = 2.f * std::asin( std::min( 0.5f * chord, 1.f ) );
+				ret.normal = std::max( ret.normal, angle * 180.f / std::numbers::pi_v<float> );
+			}
+		}
+
+		if( i < aMesh.colors.size() )
+		{
+			Vec3f const c = decode_color( aVertices.colors[v] );
+			Vec3f const ref = aMesh.colors[i];
+			ret.color = std::max( { ret.color,
+				std::abs( c.x - std::clamp( ref.x, 0.f, 1.f ) ),
+				std::abs( c.y - std::clamp( ref.y, 0.f, 1.f ) ),
+				std::abs( c.z - std::clamp( ref.z, 0.f, 1.f ) )
+			} );
+		}
+
+		if( i < aMesh.texcoords.size() )
+		{
+			Vec2f const t = decode_texcoord( aVertices.texcoords[v], aDecode );
+			ret.texcoord = std::max( { ret.texcoord, std::abs( t.x - aMesh.texcoords[i].x ), std::abs( t.y - aMesh.texcoords[i].y ) } );
+		}
+	}
+
+	return ret;
+}
+
+Vec3f decode_position( QuantizedVertices const& aVertices, std::size_t aIndex, VertexDecode const& aDecode ) noexcept
+{
+	auto const* q = aVertices.positions.data() + 4*aIndex;
+	Vec3f const t{ float(q[0]) / kUnorm16_, float(q[1]) / kUnorm16_, float(q[2]) / kUnorm16_ };
+	auto const& o = aDecode.positionOffset;
+	auto const& s = aDecode.positionScale;
+	return Vec3f{ o.x + s.x * t.x, o.y + s.y * t.y, o.z + s.z * t.z };
+}
+
+Vec3f decode_normal( std::uint32_t aPacked ) noexcept
+{
+	// As glVertexAttribPointer() normalizes GL_SHORT
+	float const ex = std::max( float(std::int16_t(aPacked & 0xffff)) / kSnorm16_, -1.f );
+	float const ey = std::max( float(std::int16_t(aPacked >> 16)) / kSnorm16_, -1.f );
+
+	Vec3f n{ ex, ey, 1.f - std::abs( ex ) - std::abs( ey ) };
+	if( n.z < 0.f )
+	{
+		float const x = (1.f - std::abs( n.y )) * sign_not_zero_( n.x );
+		float const y = (1.f - std::abs( n.x )) * sign_not_zero_( n.y );
+		n.x = x;
+		n.y = y;
+	}
+	return normalize( n );
+}
+
+Vec3f decode_color( std::uint32_t aPacked ) noexcept
+{
+	return Vec3f{
+		srgb_to_linear_( float(aPacked & 0xff) / 255.f ),
+		srgb_to_linear_( float((aPacked >> 8) & 0xff) / 255.f ),
+		srgb_to_linear_( float((aPacked >> 16) & 0xff) / 255.f )
+	};
+}
+
+Vec2f decode_texcoord( std::uint32_t aPacked, VertexDecode const& aDecode ) noexcept
+{
+	float const u = float(aPacked & 0xffff) / kUnorm16_;
+	float const v = float(aPacked >> 16) / kUnorm16_;
+	return Vec2f{ aDecode.texcoordOffset.x + aDecode.texcoordScale.x * u, aDecode.texcoordOffset.y + aDecode.texcoordScale.y * v };
+}
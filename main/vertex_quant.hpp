@@ -0,0 +1,75 @@
+#ifndef VERTEX_QUANT_HPP_C5E0A2F1_7B38_4D9E_A1C6_3F84B92D5E07
+#define VERTEX_QUANT_HPP_C5E0A2F1_7B38_4D9E_A1C6_3F84B92D5E07
+
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "../vmlib/vec2.hpp"
+#include "../vmlib/vec3.hpp"
+
+struct SimpleMeshData;
+
+// Bytes per vertex in the attribute buffers
+constexpr std::size_t kFloatVertexBytes = 3*sizeof(Vec3f) + sizeof(Vec2f);
+constexpr std::size_t kQuantizedVertexBytes = 8 + 4 + 4 + 4;
+
+// Maps a mesh's quantized positions and texture coordinates back into the
+// mesh's coordinates: offset + scale * q, with q in [0,1]. Passed to the
+// FEATURE_QUANTIZED variants of the object shaders as uniforms.
+struct VertexDecode
+{
+	Vec3f positionOffset{ 0.f, 0.f, 0.f };
+	Vec3f positionScale{ 1.f, 1.f, 1.f };
+	Vec2f texcoordOffset{ 0.f, 0.f };
+	Vec2f texcoordScale{ 1.f, 1.f };
+};
+
+/* QuantizedVertices: compact vertex attributes (20 instead of 44 bytes)
+ *
+ *  - positions: 3x unorm16 within the mesh's bounding box (padded to four
+ *    components, for alignment)
+ *  - normals: octahedral encoding, 2x snorm16
+ *  - colors: 3x unorm8, sRGB encoded (padded to four components)
+ *  - texcoords: 2x unorm16 within the mesh's texture coordinate bounds
+ *
+ * Each mesh is quantized relative to its own bounds, so several meshes can
+ * share the buffers (with a VertexDecode each). create_vao() sets up the
+ * matching attribute formats; the FEATURE_QUANTIZED shaders decode the
+ * normals and colors themselves.
+ */
+struct QuantizedVertices
+{
+	std::vector<std::uint16_t> positions; // four per vertex
+	std::vector<std::uint32_t> normals;
+	std::vector<std::uint32_t> colors;
+	std::vector<std::uint32_t> texcoords;
+
+	std::size_t size() const noexcept;
+};
+
+// Per-attribute maximum errors over a mesh's vertices
+struct QuantizationError
+{
+	float position; // distance, in mesh units
+	float normal; // angle, in degrees
+	float color; // per channel, linear
+	float texcoord; // per component
+};
+
+// Appends aMesh's vertices to aOut. Missing attributes are filled in as in
+// the scene's packed meshes (white, up, zero).
+VertexDecode quantize_mesh( SimpleMeshData const& aMesh, QuantizedVertices& aOut );
+
+// Worst case error of aMesh's vertices, starting at aFirst in aVertices,
+// after decoding them the way the shaders do.
+QuantizationError quantization_error( SimpleMeshData const& aMesh, QuantizedVertices const& aVertices, std::size_t aFirst, VertexDecode const& );
+
+// Decoding, as in default.vert
+Vec3f decode_position( QuantizedVertices const&, std::size_t aIndex, VertexDecode const& ) noexcept;
+Vec3f decode_normal( std::uint32_t ) noexcept;
+Vec3f decode_color( std::uint32_t ) noexcept;
+Vec2f decode_texcoord( std::uint32_t, VertexDecode const& ) noexcept;
+
+#endif // VERTEX_QUANT_HPP_C5E0A2F1_7B38_4D9E_A1C6_3F84B92D5E07
@@ -66,6 +66,12 @@ workspace "COMP3811-glcode"
 		optimize "On"
 		defines { "NDEBUG=1" }
 
+	-- At -O2, GCC only vectorizes loops whose trip count is known to need no
+	-- scalar epilogue ("very-cheap" cost model). This excludes most of the
+	-- data-parallel loops (e.g., step_fleet()).
+	filter { "release", "toolset:gcc" }
+		buildoptions { "-fvect-cost-model=dynamic" }
+
 	filter "*"
 
 -- Third party dependencies
@@ -96,6 +102,21 @@ project "main"
 	links "x-glfw"
 	links "x-fontstash"
 
+	-- Nothing checks errno after math functions. Without this, each sqrt()
+	-- keeps a branch to the library call that sets it, which prevents
+	-- vectorization (e.g., the software rasterizer's shading loops). Only
+	-- set for our own code; the third party projects build as shipped.
+	filter "toolset:gcc or toolset:clang"
+		buildoptions { "-fno-math-errno" }
+
+	-- The mesh codec's SSE2 normal decode must match decode_normal() bit
+	-- for bit. With -march=native, GCC would otherwise contract the scalar
+	-- code (but not the intrinsics) into FMAs.
+	filter { "toolset:gcc or toolset:clang", "files:main/mesh_codec.cpp or files:main/vertex_quant.cpp" }
+		buildoptions { "-ffp-contract=off" }
+
+	filter "*"
+
 project "main-shaders"
 	local shaders = { 
 		"assets/cw2/*.vert",
@@ -128,6 +149,63 @@ project "vmlib-test"
 
 	links "x-catch2"
 
+project "main-bench"
+	local sources = { 
+		"bench/**.cpp",
+		"bench/**.hpp",
+		"bench/**.hxx",
+		"bench/**.inl"
+	}
+
+	kind "ConsoleApp"
+	location "bench"
+
+	files( sources )
+
+	-- Code under test from main (must not depend on GLFW or need an OpenGL
+	-- context; create_vao() is linked, but never called)
+	files {
+		"main/bvh.cpp",
+		"main/cascades.cpp",
+		"main/collision.cpp",
+		"main/command_list.cpp",
+		"main/fleet.cpp",
+		"main/flight_path.cpp",
+		"main/frustum.cpp",
+		"main/light_clusters.cpp",
+		"main/load_obj.cpp",
+		"main/load_texture.cpp",
+		"main/mesh_codec.cpp",
+		"main/obj_stream.cpp",
+		"main/particles.cpp",
+		"main/path_tracer.cpp",
+		"main/render_queue.cpp",
+		"main/soft_raster.cpp",
+		"main/scene_file.cpp",
+		"main/scene_graph.cpp",
+		"main/ship_simulation.cpp",
+		"main/simple_mesh.cpp",
+		"main/space_vehicle.cpp",
+		"main/terrain.cpp",
+		"main/vertex_quant.cpp"
+	}
+
+	links "vmlib"
+	links "support"
+
+	links "x-stb"
+	links "x-glad"
+	links "x-catch2"
+
+	-- As for main (shares its sources)
+	filter "toolset:gcc or toolset:clang"
+		buildoptions { "-fno-math-errno" }
+
+	filter { "toolset:gcc or toolset:clang", "files:main/mesh_codec.cpp or files:main/vertex_quant.cpp" }
+		buildoptions { "-ffp-contract=off" }
+
+	filter "*"
+
 project "support"
 	local sources = { 
 		"support/**.cpp",
@@ -0,0 +1,141 @@
+#include "file_watch.hpp"
+
+#include <system_error>
+#include <unordered_set>
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#	include <unistd.h>
+#	include <sys/inotify.h>
+#endif // ~ __linux__
+
+namespace
+{
+	std::string normalize_( std::string const& aPath )
+	{
+		return std::filesystem::path( aPath ).lexically_normal().generic_string();
+	}
+
+	std::string parent_dir_( std::string const& aNormalizedPath )
+	{
+		auto dir = std::filesystem::path( aNormalizedPath ).parent_path().generic_string();
+		return dir.empty() ? std::string(".") : dir;
+	}
+
+	std::filesystem::file_time_type modified_( std::string const& aPath )
+	{
+		std::error_code ec;
+		auto const time = std::filesystem::last_write_time( aPath, ec );
+		return ec ? std::filesystem::file_time_type{} : time;
+	}
+}
+
+FileWatcher::FileWatcher()
+	: mInotify( -1 )
+	, mNextPoll( std::chrono::steady_clock::now() )
+{
+#	if defined(__linux__)
+	mInotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if( -1 == mInotify )
+		std::fprintf( stderr, "Note: inotify unavailable (%s); polling for file changes\n", std::strerror(errno) );
+#	endif // ~ __linux__
+}
+
+FileWatcher::~FileWatcher()
+{
+#	if defined(__linux__)
+	if( -1 != mInotify )
+		close( mInotify );
+#	endif // ~ __linux__
+}
+
+void FileWatcher::watch( std::string const& aPath )
+{
+	auto const key = normalize_( aPath );
+	if( mFiles.count( key ) )
+		return;
+
+	mFiles.emplace( key, File_{ aPath, modified_( aPath ) } );
+
+#	if defined(__linux__)
+	if( -1 != mInotify )
+	{
+		auto const dir = parent_dir_( key );
+
+		// inotify returns the existing watch descriptor if the directory is
+		// already watched, so this can't create duplicates.
+		int const wd = inotify_add_watch( mInotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE );
+		if( -1 == wd )
+			std::fprintf( stderr, "Note: unable to watch '%s': %s\n", dir.c_str(), std::strerror(errno) );
+		else
+			mWatchDirs[wd] = dir;
+	}
+#	endif // ~ __linux__
+}
+
+std::vector<std::string> FileWatcher::poll()
+{
+	std::unordered_set<std::string> changed;
+
+#	if defined(__linux__)
+	if( -1 != mInotify )
+	{
+		// Events are variable length; the buffer must be aligned for the
+		// inotify_event header.
+		alignas(inotify_event) char buffer[4096];
+
+		while( true )
+		{
+			auto const bytes = read( mInotify, buffer, sizeof(buffer) );
+			if( bytes <= 0 )
+				break; // EAGAIN: no more events
+
+			for( char const* ptr = buffer; ptr < buffer + bytes; )
+			{
+				auto const* event = reinterpret_cast<inotify_event const*>(ptr);
+				ptr += sizeof(inotify_event) + event->len;
+
+				if( 0 == event->len )
+					continue;
+
+				auto const dir = mWatchDirs.find( event->wd );
+				if( mWatchDirs.end() == dir )
+					continue;
+
+				auto const key = normalize_( dir->second + "/" + event->name );
+				if( auto const it = mFiles.find( key ); mFiles.end() != it )
+					changed.insert( it->second.path );
+			}
+		}
+
+		return { changed.begin(), changed.end() };
+	}
+#	endif // ~ __linux__
+
+	// Fallback: compare modification times.
+	auto const now = std::chrono::steady_clock::now();
+	if( now < mNextPoll )
+		return {};
+
+	mNextPoll = now + kPollInterval;
+
+	for( auto& [key, file] : mFiles )
+	{
+		auto const time = modified_( file.path );
+		if( time != file.modified )
+		{
+			file.modified = time;
+			changed.insert( file.path );
+		}
+	}
+
+	return { changed.begin(), changed.end() };
+}
+
+bool FileWatcher::uses_inotify() const noexcept
+{
+	return -1 != mInotify;
+}
@@ -0,0 +1,59 @@
+#ifndef FILE_WATCH_HPP_7B2E5D18_94A3_4C6F_A0E1_3F8D2C57B9A4
+#define FILE_WATCH_HPP_7B2E5D18_94A3_4C6F_A0E1_3F8D2C57B9A4
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+/* FileWatcher: reports modifications to a set of files
+ *
+ * On Linux, this uses inotify. The directories containing the files are
+ * watched (rather than the files themselves), since many editors save by
+ * writing a new file and renaming it over the old one. Elsewhere, or if
+ * inotify is unavailable, the modification times are polled instead (at most
+ * every kPollInterval).
+ *
+ * poll() never blocks and is intended to be called once per frame.
+ */
+class FileWatcher final
+{
+	public:
+		static constexpr auto kPollInterval = std::chrono::milliseconds(250);
+
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		FileWatcher( FileWatcher const& ) = delete;
+		FileWatcher& operator= (FileWatcher const&) = delete;
+
+	public:
+		// Start watching a file. Watching the same file twice has no effect.
+		void watch( std::string const& aPath );
+
+		// Returns the watched files that changed since the last call. Each
+		// file is reported at most once per call. Paths are returned exactly
+		// as passed to watch().
+		std::vector<std::string> poll();
+
+		bool uses_inotify() const noexcept;
+
+	private:
+		struct File_
+		{
+			std::string path; // as given to watch()
+			std::filesystem::file_time_type modified;
+		};
+
+		// Keyed by the normalized path.
+		std::unordered_map<std::string,File_> mFiles;
+
+		int mInotify;
+		std::unordered_map<int,std::string> mWatchDirs; // inotify watch -> dir
+
+		std::chrono::steady_clock::time_point mNextPoll;
+};
+
+#endif // FILE_WATCH_HPP_7B2E5D18_94A3_4C6F_A0E1_3F8D2C57B9A4
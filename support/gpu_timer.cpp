@@ -0,0 +1,56 @@
+#include "gpu_timer.hpp"
+
+GpuTimer::GpuTimer()
+{
+	glGenQueries( GLsizei(kQueries), mQueries );
+}
+
+GpuTimer::~GpuTimer()
+{
+	glDeleteQueries( GLsizei(kQueries), mQueries );
+}
+
+void GpuTimer::begin()
+{
+	collect_();
+
+	// If the oldest query is still pending, its result is dropped. This
+	// only happens if the GPU is more than kQueries frames behind.
+	glBeginQuery( GL_TIME_ELAPSED, mQueries[mNext] );
+}
+
+void GpuTimer::end()
+{
+	glEndQuery( GL_TIME_ELAPSED );
+
+	mPending[mNext] = true;
+	mNext = (mNext+1) % kQueries;
+}
+
+float GpuTimer::elapsed() const noexcept
+{
+	return mElapsed;
+}
+
+void GpuTimer::collect_()
+{
+	// Oldest first, such that mElapsed ends up with the newest result.
+	for( std::size_t i = 0; i < kQueries; ++i )
+	{
+		std::size_t const index = (mNext + i) % kQueries;
+		if( !mPending[index] )
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv( mQueries[index], GL_QUERY_RESULT_AVAILABLE, &available );
+		if( !available )
+			break; // later queries aren't either
+
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v( mQueries[index], GL_QUERY_RESULT, &ns );
+		mElapsed = float(double(ns) * 1e-9);
+		mPending[index] = false;
+	}
+
+	mPending[mNext] = false;
+}
@@ -0,0 +1,48 @@
+#ifndef GPU_TIMER_HPP_0A93D6E4_27BF_4C18_B5E2_C14F8A7D9360
+#define GPU_TIMER_HPP_0A93D6E4_27BF_4C18_B5E2_C14F8A7D9360
+
+#include <glad/glad.h>
+
+#include <cstdlib>
+
+/* GpuTimer: GPU time of a sequence of commands
+ *
+ * Wraps GL_TIME_ELAPSED queries. Results become available a few frames
+ * later, so the timer keeps a small ring of queries and reports the most
+ * recent result that is available; it never waits for the GPU. Timers cannot
+ * be nested (an OpenGL restriction), and each timer should be used at most
+ * once per frame.
+ *
+ * The timer must not outlive the OpenGL context.
+ */
+class GpuTimer final
+{
+	public:
+		static constexpr std::size_t kQueries = 4;
+
+	public:
+		GpuTimer();
+		~GpuTimer();
+
+		GpuTimer( GpuTimer const& ) = delete;
+		GpuTimer& operator= (GpuTimer const&) = delete;
+
+	public:
+		void begin();
+		void end();
+
+		// Seconds; 0 until the first result is available.
+		float elapsed() const noexcept;
+
+	private:
+		void collect_();
+
+	private:
+		GLuint mQueries[kQueries] = {};
+		bool mPending[kQueries] = {};
+		std::size_t mNext = 0;
+
+		float mElapsed = 0.f;
+};
+
+#endif // GPU_TIMER_HPP_0A93D6E4_27BF_4C18_B5E2_C14F8A7D9360
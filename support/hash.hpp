@@ -0,0 +1,27 @@
+#ifndef HASH_HPP_3E34F6E8_C553_49F3_BD3B_375B73316D57
+#define HASH_HPP_3E34F6E8_C553_49F3_BD3B_375B73316D57
+
+#include <cstdint>
+#include <cstdlib>
+
+// 64-bit FNV-1a hash. Used to key cached shader stages, program binaries and
+// compiled scenes. Pass the result of a previous call as aSeed to hash
+// several buffers in sequence.
+constexpr std::uint64_t kFnv1aOffset64 = 0xcbf29ce484222325ull;
+
+inline
+std::uint64_t hash_fnv1a( void const* aData, std::size_t aSize, std::uint64_t aSeed = kFnv1aOffset64 ) noexcept
+{
+	auto const* bytes = static_cast<unsigned char const*>(aData);
+
+	std::uint64_t hash = aSeed;
+	for( std::size_t i = 0; i < aSize; ++i )
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+#endif // HASH_HPP_3E34F6E8_C553_49F3_BD3B_375B73316D57
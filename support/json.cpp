@@ -0,0 +1,463 @@
+#include "json.hpp"
+
+#include <tuple>
+
+#include <cstdio>
+#include <cstdint>
+
+#include "error.hpp"
+
+namespace
+{
+	constexpr int kMaxDepth_ = 256;
+
+	char const* type_name_( JsonValue::EType aType ) noexcept
+	{
+		switch( aType )
+		{
+			case JsonValue::EType::null: return "null";
+			case JsonValue::EType::boolean: return "boolean";
+			case JsonValue::EType::number: return "number";
+			case JsonValue::EType::string: return "string";
+			case JsonValue::EType::array: return "array";
+			case JsonValue::EType::object: return "object";
+		}
+		return "?";
+	}
+
+	void append_utf8_( std::string& aOut, std::uint32_t aCodePoint )
+	{
+		if( aCodePoint < 0x80 )
+			aOut += char(aCodePoint);
+		else if( aCodePoint < 0x800 )
+		{
+			aOut += char(0xC0 | (aCodePoint >> 6));
+			aOut += char(0x80 | (aCodePoint & 0x3F));
+		}
+		else if( aCodePoint < 0x10000 )
+		{
+			aOut += char(0xE0 | (aCodePoint >> 12));
+			aOut += char(0x80 | ((aCodePoint >> 6) & 0x3F));
+			aOut += char(0x80 | (aCodePoint & 0x3F));
+		}
+		else
+		{
+			aOut += char(0xF0 | (aCodePoint >> 18));
+			aOut += char(0x80 | ((aCodePoint >> 12) & 0x3F));
+			aOut += char(0x80 | ((aCodePoint >> 6) & 0x3F));
+			aOut += char(0x80 | (aCodePoint & 0x3F));
+		}
+	}
+}
+
+class JsonParser_ final
+{
+	public:
+		JsonParser_( std::string_view aText, std::string const* aSource )
+			: mText( aText )
+			, mSource( aSource )
+		{}
+
+	public:
+		void parse( JsonValue& aOut )
+		{
+			value_( aOut, 0 );
+			skip_space_();
+			if( mPos != mText.size() )
+				fail_( "unexpected trailing characters" );
+		}
+
+	private:
+		[[noreturn]] void fail_( char const* aWhat ) const
+		{
+			throw Error( "%s:%d: JSON: %s", mSource->c_str(), mLine, aWhat );
+		}
+
+		void skip_space_() noexcept
+		{
+			for( ; mPos < mText.size(); ++mPos )
+			{
+				char const c = mText[mPos];
+				if( '\n' == c )
+					++mLine;
+				else if( ' ' != c && '\t' != c && '\r' != c )
+					break;
+			}
+		}
+
+		bool consume_( std::string_view aWord ) noexcept
+		{
+			if( mText.substr( mPos, aWord.size() ) != aWord )
+				return false;
+			mPos += aWord.size();
+			return true;
+		}
+
+		void value_( JsonValue& aOut, int aDepth )
+		{
+			if( aDepth > kMaxDepth_ )
+				fail_( "nesting too deep" );
+
+			skip_space_();
+			if( mPos >= mText.size() )
+				fail_( "unexpected end of input" );
+
+			aOut.mSource = mSource;
+			aOut.mLine = mLine;
+
+			switch( mText[mPos] )
+			{
+				case '{': object_( aOut, aDepth ); return;
+				case '[': array_( aOut, aDepth ); return;
+				case '"': aOut.mValue = string_(); return;
+			}
+
+			if( consume_( "true" ) )
+				aOut.mValue = true;
+			else if( consume_( "false" ) )
+				aOut.mValue = false;
+			else if( consume_( "null" ) )
+				aOut.mValue = nullptr;
+			else
+				aOut.mValue = number_();
+		}
+
+		void object_( JsonValue& aOut, int aDepth )
+		{
+			++mPos; // {
+			JsonValue::Object members;
+
+			skip_space_();
+			if( mPos < mText.size() && '}' == mText[mPos] )
+			{
+				++mPos;
+				aOut.mValue = std::move(members);
+				return;
+			}
+
+			while( true )
+			{
+				skip_space_();
+				if( mPos >= mText.size() || '"' != mText[mPos] )
+					fail_( "expected member name" );
+
+				auto name = string_();
+
+				skip_space_();
+				if( mPos >= mText.size() || ':' != mText[mPos] )
+					fail_( "expected ':'" );
+				++mPos;
+
+				members.emplace_back( std::piecewise_construct, std::forward_as_tuple( std::move(name) ), std::forward_as_tuple() );
+				value_( members.back().second, aDepth+1 );
+
+				skip_space_();
+				if( mPos < mText.size() && ',' == mText[mPos] )
+				{
+					++mPos;
+					continue;
+				}
+				if( mPos < mText.size() && '}' == mText[mPos] )
+				{
+					++mPos;
+					break;
+				}
+				fail_( "expected ',' or '}'" );
+			}
+
+			aOut.mValue = std::move(members);
+		}
+
+		void array_( JsonValue& aOut, int aDepth )
+		{
+			++mPos; // [
+			JsonValue::Array elements;
+
+			skip_space_();
+			if( mPos < mText.size() && ']' == mText[mPos] )
+			{
+				++mPos;
+				aOut.mValue = std::move(elements);
+				return;
+			}
+
+			while( true )
+			{
+				elements.emplace_back();
+				value_( elements.back(), aDepth+1 );
+
+				skip_space_();
+				if( mPos < mText.size() && ',' == mText[mPos] )
+				{
+					++mPos;
+					continue;
+				}
+				if( mPos < mText.size() && ']' == mText[mPos] )
+				{
+					++mPos;
+					break;
+				}
+				fail_( "expected ',' or ']'" );
+			}
+
+			aOut.mValue = std::move(elements);
+		}
+
+		std::string string_()
+		{
+			++mPos; // "
+			std::string ret;
+
+			while( true )
+			{
+				if( mPos >= mText.size() )
+					fail_( "unterminated string" );
+
+				char const c = mText[mPos++];
+				if( '"' == c )
+					return ret;
+				if( '\n' == c )
+					fail_( "newline in string" );
+				if( '\\' != c )
+				{
+					ret += c;
+					continue;
+				}
+
+				if( mPos >= mText.size() )
+					fail_( "unterminated string" );
+
+				switch( char const e = mText[mPos++] )
+				{
+					case '"': case '\\': case '/': ret += e; break;
+					case 'b': ret += '\b'; break;
+					case 'f': ret += '\f'; break;
+					case 'n': ret += '\n'; break;
+					case 'r': ret += '\r'; break;
+					case 't': ret += '\t'; break;
+					case 'u':
+					{
+						std::uint32_t cp = hex4_();
+						if( cp >= 0xD800 && cp < 0xDC00 && consume_( "\\u" ) )
+						{
+							// Surrogate pair
+							std::uint32_t const low = hex4_();
+							if( low < 0xDC00 || low >= 0xE000 )
+								fail_( "invalid surrogate pair" );
+							cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+						}
+						append_utf8_( ret, cp );
+					} break;
+					default:
+						fail_( "invalid escape sequence" );
+				}
+			}
+		}
+
+		std::uint32_t hex4_()
+		{
+			if( mPos + 4 > mText.size() )
+				fail_( "truncated \\u escape" );
+
+			std::uint32_t ret = 0;
+			for( int i = 0; i < 4; ++i )
+			{
+				char const c = mText[mPos++];
+				ret <<= 4;
+				if( c >= '0' && c <= '9' ) ret |= std::uint32_t(c - '0');
+				else if( c >= 'a' && c <= 'f' ) ret |= std::uint32_t(c - 'a' + 10);
+				else if( c >= 'A' && c <= 'F' ) ret |= std::uint32_t(c - 'A' + 10);
+				else fail_( "invalid \\u escape" );
+			}
+			return ret;
+		}
+
+		double number_()
+		{
+			// Validate the JSON number syntax, then let strtod() convert it.
+			auto const start = mPos;
+			auto const digits_ = [this] {
+				auto const first = mPos;
+				while( mPos < mText.size() && mText[mPos] >= '0' && mText[mPos] <= '9' )
+					++mPos;
+				return mPos != first;
+			};
+
+			if( mPos < mText.size() && '-' == mText[mPos] )
+				++mPos;
+			if( !digits_() )
+				fail_( "unexpected character" );
+			if( mPos < mText.size() && '.' == mText[mPos] )
+			{
+				++mPos;
+				if( !digits_() )
+					fail_( "expected digits after '.'" );
+			}
+			if( mPos < mText.size() && ('e' == mText[mPos] || 'E' == mText[mPos]) )
+			{
+				++mPos;
+				if( mPos < mText.size() && ('+' == mText[mPos] || '-' == mText[mPos]) )
+					++mPos;
+				if( !digits_() )
+					fail_( "expected exponent" );
+			}
+
+			std::string const num( mText.substr( start, mPos-start ) );
+			return std::strtod( num.c_str(), nullptr );
+		}
+
+	private:
+		std::string_view mText;
+		std::string const* mSource;
+
+		std::size_t mPos = 0;
+		int mLine = 1;
+};
+
+JsonValue::EType JsonValue::type() const noexcept
+{
+	return EType(mValue.index());
+}
+
+bool JsonValue::is_null() const noexcept
+{
+	return EType::null == type();
+}
+bool JsonValue::is_number() const noexcept
+{
+	return EType::number == type();
+}
+bool JsonValue::is_string() const noexcept
+{
+	return EType::string == type();
+}
+bool JsonValue::is_array() const noexcept
+{
+	return EType::array == type();
+}
+bool JsonValue::is_object() const noexcept
+{
+	return EType::object == type();
+}
+
+void JsonValue::expect_( EType aType ) const
+{
+	if( aType != type() )
+		throw Error( "%s:%d: JSON: expected %s, got %s", source(), mLine, type_name_( aType ), type_name_( type() ) );
+}
+
+bool JsonValue::as_bool() const
+{
+	expect_( EType::boolean );
+	return std::get<bool>( mValue );
+}
+double JsonValue::as_number() const
+{
+	expect_( EType::number );
+	return std::get<double>( mValue );
+}
+float JsonValue::as_float() const
+{
+	return float(as_number());
+}
+std::string const& JsonValue::as_string() const
+{
+	expect_( EType::string );
+	return std::get<std::string>( mValue );
+}
+JsonValue::Array const& JsonValue::as_array() const
+{
+	expect_( EType::array );
+	return std::get<Array>( mValue );
+}
+JsonValue::Object const& JsonValue::as_object() const
+{
+	expect_( EType::object );
+	return std::get<Object>( mValue );
+}
+
+JsonValue const* JsonValue::find( std::string_view aName ) const
+{
+	if( !is_object() )
+		return nullptr;
+
+	for( auto const& [name, value] : std::get<Object>( mValue ) )
+	{
+		if( name == aName )
+			return &value;
+	}
+
+	return nullptr;
+}
+
+JsonValue const& JsonValue::operator[] ( std::string_view aName ) const
+{
+	as_object(); // throws if not an object
+
+	if( auto const* value = find( aName ) )
+		return *value;
+
+	throw Error( "%s:%d: JSON: missing member '%.*s'", source(), mLine, int(aName.size()), aName.data() );
+}
+
+bool JsonValue::bool_or( std::string_view aName, bool aDefault ) const
+{
+	auto const* value = find( aName );
+	return value ? value->as_bool() : aDefault;
+}
+float JsonValue::float_or( std::string_view aName, float aDefault ) const
+{
+	auto const* value = find( aName );
+	return value ? value->as_float() : aDefault;
+}
+std::string JsonValue::string_or( std::string_view aName, std::string_view aDefault ) const
+{
+	auto const* value = find( aName );
+	return value ? value->as_string() : std::string(aDefault);
+}
+
+char const* JsonValue::source() const noexcept
+{
+	return mSource ? mSource->c_str() : "?";
+}
+int JsonValue::line() const noexcept
+{
+	return mLine;
+}
+
+JsonDocument::JsonDocument( std::string_view aText, std::string aSourceName )
+	: mSource( std::move(aSourceName) )
+{
+	JsonParser_ parser( aText, &mSource );
+	parser.parse( mRoot );
+}
+
+JsonValue const& JsonDocument::root() const noexcept
+{
+	return mRoot;
+}
+std::string const& JsonDocument::source() const noexcept
+{
+	return mSource;
+}
+
+JsonDocument load_json( char const* aPath )
+{
+	std::FILE* fin = std::fopen( aPath, "rb" );
+	if( !fin )
+		throw Error( "load_json(): unable to open '%s'", aPath );
+
+	std::string text;
+
+	char buffer[4096];
+	while( auto const ret = std::fread( buffer, 1, sizeof(buffer), fin ) )
+		text.append( buffer, ret );
+
+	bool const failed = std::ferror( fin );
+	std::fclose( fin );
+
+	if( failed )
+		throw Error( "load_json(): error while reading '%s'", aPath );
+
+	return JsonDocument( text, aPath );
+}
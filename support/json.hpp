@@ -0,0 +1,93 @@
+#ifndef JSON_HPP_2D7E91B4_5A63_4C08_8F1D_E6B3A0C47952
+#define JSON_HPP_2D7E91B4_5A63_4C08_8F1D_E6B3A0C47952
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <variant>
+#include <string_view>
+
+#include <cstdlib>
+
+/* JsonValue: parsed JSON document
+ *
+ * A small reader for configuration and scene files; not a general purpose
+ * JSON library. Objects keep their members in file order. Numbers are
+ * stored as double. Parse errors and failed lookups throw Error, with the
+ * source name and line of the offending value.
+ */
+class JsonValue final
+{
+	public:
+		enum class EType { null, boolean, number, string, array, object };
+
+		using Array = std::vector<JsonValue>;
+		using Object = std::vector<std::pair<std::string,JsonValue>>;
+
+	public:
+		JsonValue() = default;
+
+	public:
+		EType type() const noexcept;
+
+		bool is_null() const noexcept;
+		bool is_number() const noexcept;
+		bool is_string() const noexcept;
+		bool is_array() const noexcept;
+		bool is_object() const noexcept;
+
+		// These throw if the value has a different type.
+		bool as_bool() const;
+		double as_number() const;
+		float as_float() const;
+		std::string const& as_string() const;
+		Array const& as_array() const;
+		Object const& as_object() const;
+
+		// Object members. find() returns nullptr if the member is missing (or
+		// if this is not an object); operator[] throws.
+		JsonValue const* find( std::string_view ) const;
+		JsonValue const& operator[] ( std::string_view ) const;
+
+		// Optional members with defaults.
+		bool bool_or( std::string_view, bool ) const;
+		float float_or( std::string_view, float ) const;
+		std::string string_or( std::string_view, std::string_view ) const;
+
+		// Source name and line, for error messages.
+		char const* source() const noexcept;
+		int line() const noexcept;
+
+	private:
+		friend class JsonParser_;
+
+		void expect_( EType ) const;
+
+		std::variant<std::nullptr_t, bool, double, std::string, Array, Object> mValue;
+		std::string const* mSource = nullptr; // owned by the root document
+		int mLine = 0;
+};
+
+/* JsonDocument: owns the root value and the source name.
+ */
+class JsonDocument final
+{
+	public:
+		JsonDocument( std::string_view aText, std::string aSourceName );
+
+		JsonDocument( JsonDocument const& ) = delete;
+		JsonDocument& operator= (JsonDocument const&) = delete;
+
+	public:
+		JsonValue const& root() const noexcept;
+		std::string const& source() const noexcept;
+
+	private:
+		std::string mSource; // declared first, referenced by mRoot
+		JsonValue mRoot;
+};
+
+// Reads and parses a file. Throws Error on I/O and parse errors.
+JsonDocument load_json( char const* aPath );
+
+#endif // JSON_HPP_2D7E91B4_5A63_4C08_8F1D_E6B3A0C47952
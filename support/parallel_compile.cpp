@@ -0,0 +1,119 @@
+#include "parallel_compile.hpp"
+
+#include <cstring>
+
+namespace
+{
+	using PfnMaxShaderCompilerThreads_ = void (GLAPIENTRY*)( GLuint );
+
+	bool gHaveParallelCompile_ = false;
+
+	bool have_extension_( char const* aName )
+	{
+		GLint count = 0;
+		glGetIntegerv( GL_NUM_EXTENSIONS, &count );
+
+		for( GLint i = 0; i < count; ++i )
+		{
+			auto const* ext = reinterpret_cast<char const*>(glGetStringi( GL_EXTENSIONS, GLuint(i) ));
+			if( ext && 0 == std::strcmp( ext, aName ) )
+				return true;
+		}
+
+		return false;
+	}
+}
+
+bool setup_parallel_shader_compile( GLADloadproc aLoader, GLuint aMaxThreads )
+{
+	char const* setThreads = nullptr;
+	if( have_extension_( "GL_KHR_parallel_shader_compile" ) )
+		setThreads = "glMaxShaderCompilerThreadsKHR";
+	else if( have_extension_( "GL_ARB_parallel_shader_compile" ) )
+		setThreads = "glMaxShaderCompilerThreadsARB";
+
+	gHaveParallelCompile_ = false;
+	if( !setThreads )
+		return false;
+
+	// The default number of compiler threads is implementation-defined and
+	// may well be zero, i.e., the extension would only report completion
+	// status without actually compiling anything in parallel.
+	if( auto const fn = reinterpret_cast<PfnMaxShaderCompilerThreads_>(aLoader( setThreads )) )
+		fn( aMaxThreads );
+
+	gHaveParallelCompile_ = true;
+	return true;
+}
+
+bool have_parallel_shader_compile() noexcept
+{
+	return gHaveParallelCompile_;
+}
+
+ShaderCompileThread::ShaderCompileThread( std::function<void()> aMakeCurrent, std::function<void()> aRelease )
+	: mMakeCurrent( std::move(aMakeCurrent) )
+	, mRelease( std::move(aRelease) )
+	, mStop( false )
+{
+	// Start the thread last, once everything it accesses has been set up.
+	mThread = std::thread( [this] { run_(); } );
+}
+
+ShaderCompileThread::~ShaderCompileThread()
+{
+	{
+		std::scoped_lock lock( mMutex );
+		mStop = true;
+	}
+
+	mWake.notify_one();
+	mThread.join();
+}
+
+std::future<void> ShaderCompileThread::submit( std::function<void()> aJob )
+{
+	std::packaged_task<void()> task( std::move(aJob) );
+	auto result = task.get_future();
+
+	{
+		std::scoped_lock lock( mMutex );
+		mJobs.emplace_back( std::move(task) );
+	}
+
+	mWake.notify_one();
+	return result;
+}
+
+void ShaderCompileThread::run_()
+{
+	if( mMakeCurrent )
+		mMakeCurrent();
+
+	while( true )
+	{
+		std::packaged_task<void()> job;
+
+		{
+			std::unique_lock lock( mMutex );
+			mWake.wait( lock, [this] { return mStop || !mJobs.empty(); } );
+
+			// Finish any queued jobs before exiting. Somebody might be
+			// waiting on their futures.
+			if( mJobs.empty() )
+				break;
+
+			job = std::move(mJobs.front());
+			mJobs.pop_front();
+		}
+
+		job();
+
+		// Make sure the work is submitted, such that the main context will
+		// see the results.
+		glFlush();
+	}
+
+	if( mRelease )
+		mRelease();
+}
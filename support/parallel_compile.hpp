@@ -0,0 +1,78 @@
+#ifndef PARALLEL_COMPILE_HPP_A1C94E27_3B6D_4F08_8E15_C7D2B90F4E63
+#define PARALLEL_COMPILE_HPP_A1C94E27_3B6D_4F08_8E15_C7D2B90F4E63
+
+#include <glad/glad.h>
+
+#include <deque>
+#include <mutex>
+#include <future>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile. Our GLAD
+// loader does not include either extension, so the relevant bits are
+// defined here. (Both extensions use the same token values.)
+#if !defined(GL_COMPLETION_STATUS_KHR)
+#	define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#if !defined(GL_MAX_SHADER_COMPILER_THREADS_KHR)
+#	define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+
+// Detects GL_KHR_parallel_shader_compile (or the ARB variant) and, if found,
+// lets the driver use up to aMaxThreads compiler threads. The default lets
+// the driver decide. Call once after the GL API has been loaded. Returns true
+// if the extension is available.
+bool setup_parallel_shader_compile( GLADloadproc, GLuint aMaxThreads = 0xFFFFFFFFu );
+
+// Returns true if setup_parallel_shader_compile() found the extension. If so,
+// GL_COMPLETION_STATUS_KHR may be queried on shader and program objects.
+bool have_parallel_shader_compile() noexcept;
+
+/* ShaderCompileThread: worker thread with its own (shared) OpenGL context
+ *
+ * Fallback for drivers without parallel shader compilation. Jobs submitted to
+ * the thread run in a context that shares objects with the main context, so
+ * shaders and programs created there may be used by the main thread once the
+ * job has finished and its commands have been flushed.
+ *
+ * The thread does not create the context itself (this requires the windowing
+ * system). Instead, aMakeCurrent is called on the worker thread before any
+ * jobs are run, and aRelease is called before the thread exits. With GLFW,
+ * these would call glfwMakeContextCurrent() on a hidden window that shares
+ * its context with the main window.
+ */
+class ShaderCompileThread final
+{
+	public:
+		explicit ShaderCompileThread(
+			std::function<void()> aMakeCurrent,
+			std::function<void()> aRelease = {}
+		);
+		~ShaderCompileThread();
+
+		ShaderCompileThread( ShaderCompileThread const& ) = delete;
+		ShaderCompileThread& operator= (ShaderCompileThread const&) = delete;
+
+	public:
+		// Queue a job. Exceptions thrown by the job are stored in the
+		// returned future.
+		std::future<void> submit( std::function<void()> );
+
+	private:
+		void run_();
+
+	private:
+		std::function<void()> mMakeCurrent;
+		std::function<void()> mRelease;
+
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		std::deque<std::packaged_task<void()>> mJobs;
+		bool mStop;
+
+		std::thread mThread;
+};
+
+#endif // PARALLEL_COMPILE_HPP_A1C94E27_3B6D_4F08_8E15_C7D2B90F4E63
@@ -1,5 +1,7 @@
 #include "program.hpp"
 
+#include <chrono>
+#include <future>
 #include <vector>
 #include <utility>
 
@@ -9,12 +11,21 @@
 
 #include "error.hpp"
 #include "checkpoint.hpp"
+#include "hash.hpp"
+#include "shader_cache.hpp"
+#include "parallel_compile.hpp"
 
 namespace
 {
-	GLuint load_shader_( 
-		GLenum aShaderType, 
-		char const* aSourcePath
+	std::string load_source_( 
+		ShaderProgram::ShaderSource const&
+	);
+
+	std::vector<GLuint> begin_link_(
+		GLuint aProgram,
+		ShaderCache&,
+		std::vector<ShaderProgram::ShaderSource> const&,
+		std::vector<std::string> const&
 	);
 
 	// lightweight std::experimental::scope_exit alternative
@@ -36,15 +47,67 @@ namespace
 	}
 }
 
-ShaderProgram::ShaderProgram( std::vector<ShaderSource> aShaderSources )
+struct ShaderProgram::Pending_
+{
+	GLuint program = 0;
+	std::uint64_t key = 0;
+	bool fromBinary = false;
+
+	std::vector<GLuint> shaders;
+
+	// Cache used if the program wasn't given one. Must stay alive until the
+	// stages have been checked.
+	std::unique_ptr<ShaderCache> localCache;
+
+	// Set if the work was handed to a ShaderCompileThread. The fence is
+	// created by the worker after issuing the link.
+	std::future<void> job;
+	GLsync fence = nullptr;
+
+	~Pending_()
+	{
+		// The worker may still be using the program object.
+		if( job.valid() )
+			job.wait();
+
+		if( fence )
+			glDeleteSync( fence );
+
+		for( auto const shader : shaders )
+			glDetachShader( program, shader );
+
+		if( 0 != program )
+			glDeleteProgram( program );
+	}
+};
+
+ShaderProgram::ShaderProgram( std::vector<ShaderSource> aShaderSources, ShaderCache* aCache )
 	: mProgram( 0 )
 	, mSources( std::move(aShaderSources) )
+	, mCache( aCache )
+	, mWorker( nullptr )
 {
 	reload();
 }
 
+ShaderProgram::ShaderProgram( DeferredTag_, std::vector<ShaderSource> aShaderSources, ShaderCache* aCache, ShaderCompileThread* aWorker )
+	: mProgram( 0 )
+	, mSources( std::move(aShaderSources) )
+	, mCache( aCache )
+	, mWorker( aWorker )
+{
+	reload_async();
+}
+
+ShaderProgram ShaderProgram::deferred( std::vector<ShaderSource> aShaderSources, ShaderCache* aCache, ShaderCompileThread* aWorker )
+{
+	return ShaderProgram( DeferredTag_{}, std::move(aShaderSources), aCache, aWorker );
+}
+
 ShaderProgram::~ShaderProgram()
 {
+	mPending.reset();
+
 	if( 0 != mProgram )
 		glDeleteProgram( mProgram );
 }
@@ -52,97 +115,194 @@ ShaderProgram::~ShaderProgram()
 ShaderProgram::ShaderProgram( ShaderProgram&& aOther ) noexcept
 	: mProgram( std::exchange( aOther.mProgram, 0 ) )
 	, mSources( std::move(aOther.mSources) )
+	, mCache( aOther.mCache )
+	, mWorker( aOther.mWorker )
+	, mPending( std::move(aOther.mPending) )
 {}
 ShaderProgram& ShaderProgram::operator= (ShaderProgram&& aOther) noexcept
 {
 	std::swap( mProgram, aOther.mProgram );
 	std::swap( mSources, aOther.mSources );
+	std::swap( mCache, aOther.mCache );
+	std::swap( mWorker, aOther.mWorker );
+	std::swap( mPending, aOther.mPending );
 	return *this;
 }
 
-GLuint ShaderProgram::programId() const noexcept
+GLuint ShaderProgram::programId()
 {
+	if( mPending && 0 == mProgram )
+		finish();
+
 	return mProgram;
 }
 
+std::vector<ShaderProgram::ShaderSource> const& ShaderProgram::sources() const noexcept
+{
+	return mSources;
+}
+
 void ShaderProgram::reload()
 {
-	// Space to hold the shaders when we load them
-	std::vector<GLuint> shaders;
-	shaders.reserve( mSources.size() );
+	reload_async();
+	finish();
+}
 
-	// Ensure that shaders are cleaned up properly, regardless of how we leave
-	// the function (e.g., either by returning or by exception)
-	auto const scopeShaders_ = scope_exit_( [&shaders] {
-		for( auto const shader : shaders )
-			glDeleteShader( shader );
-	} );
+void ShaderProgram::reload_async()
+{
+	auto pending = std::make_unique<Pending_>();
+
+	// Without a shared cache, use a private one. This still deduplicates
+	// identical stages within this program; the stages are released
+	// together with the pending state.
+	if( !mCache )
+		pending->localCache = std::make_unique<ShaderCache>();
+
+	ShaderCache* cache = mCache ? mCache : pending->localCache.get();
 
-	// Load shaders
+	// Load sources. These are needed even if the program binary is cached, as
+	// the cache key is derived from them.
+	std::vector<std::string> sources;
+	sources.reserve( mSources.size() );
+
+	std::uint64_t key = cache->driver_key();
 	for( auto const& source : mSources )
-		shaders.emplace_back( load_shader_( source.type, source.sourcePath.c_str() ) );
+	{
+		sources.emplace_back( load_source_( source ) );
+
+		key = hash_fnv1a( &source.type, sizeof(source.type), key );
+		key = hash_fnv1a( sources.back().data(), sources.back().size(), key );
+	}
 
 	// Create program object
 	OGL_CHECKPOINT_ALWAYS();
 
-	GLuint prog = glCreateProgram();
+	pending->program = glCreateProgram();
+	pending->key = key;
+
+	if( cache->load_program( pending->program, key ) )
+	{
+		pending->fromBinary = true;
+	}
+	else if( mWorker && !have_parallel_shader_compile() )
+	{
+		auto* target = pending.get();
+		pending->job = mWorker->submit( [target, cache, stages = mSources, sources = std::move(sources)] {
+			target->shaders = begin_link_( target->program, *cache, stages, sources );
+			target->fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+		} );
+	}
+	else
+	{
+		pending->shaders = begin_link_( pending->program, *cache, mSources, sources );
+	}
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	// This discards any earlier pending reload.
+	mPending = std::move(pending);
+}
 
-	// Ensure that the program is cleaned up. 
+bool ShaderProgram::ready() const
+{
+	if( !mPending || mPending->fromBinary )
+		return true;
 
-	/* There is a small trick here. If we successfully compile and link the new
-	 * program, we will replace the value of the "prog" variable with the old
-	 * program's ID. In this case, the following will delete the old program
-	 * (if there was any). If we do not reach the end (e.g. exception thrown),
-	 * the new program ID will still be in the "prog" variable, and we will
-	 * delete it appropriately. (However, the old program in mProgram is left
-	 * intact).
-	 */
-	auto const scopeProgram_ = scope_exit_( [&prog] {
-		if( 0 != prog )
-			glDeleteProgram( prog );
-	} );
+	if( mPending->job.valid() )
+	{
+		if( std::future_status::ready != mPending->job.wait_for( std::chrono::seconds(0) ) )
+			return false;
 
-	// Link individual shaders to create the final shader program
-	for( auto const shader : shaders )
-		glAttachShader( prog, shader );
+		// The job might have thrown, in which case there's no fence. finish()
+		// will report the error.
+		if( mPending->fence && GL_TIMEOUT_EXPIRED == glClientWaitSync( mPending->fence, 0, 0 ) )
+			return false;
 
-	glLinkProgram( prog );
+		return true;
+	}
 
+	if( have_parallel_shader_compile() )
 	{
+		GLint done = GL_FALSE;
+		glGetProgramiv( mPending->program, GL_COMPLETION_STATUS_KHR, &done );
+		return GL_TRUE == done;
+	}
+
+	return true;
+}
+
+void ShaderProgram::finish()
+{
+	if( !mPending )
+		return;
+
+	// Take ownership of the pending state. If anything below throws, it is
+	// destroyed (and the new program deleted), but mProgram is left intact.
+	auto pending = std::move(mPending);
+
+	if( pending->job.valid() )
+	{
+		pending->job.get(); // rethrows errors from the worker
+
+		if( pending->fence )
+			glClientWaitSync( pending->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED );
+	}
+
+	if( !pending->fromBinary )
+	{
+		ShaderCache& cache = mCache ? *mCache : *pending->localCache;
+
 		// Get info log
 		GLint logLength = 0;
-		glGetProgramiv( prog, GL_INFO_LOG_LENGTH, &logLength );
+		glGetProgramiv( pending->program, GL_INFO_LOG_LENGTH, &logLength );
 
 		std::vector<GLchar> log;
 		if( logLength )
 		{
 			log.resize( logLength );
-			glGetProgramInfoLog( prog, GLsizei(log.size()), nullptr, log.data() );
+			glGetProgramInfoLog( pending->program, GLsizei(log.size()), nullptr, log.data() );
 		}
 
+		// Check the individual stages first. If one of them failed, its
+		// compile log is much more useful than the linker's complaints.
+		for( std::size_t i = 0; i < pending->shaders.size(); ++i )
+			cache.check_stage( pending->shaders[i], mSources[i].type, mSources[i].sourcePath.c_str() );
+
 		// Check link status
 		GLint status = 0;
-		glGetProgramiv( prog, GL_LINK_STATUS, &status );
+		glGetProgramiv( pending->program, GL_LINK_STATUS, &status );
 
 		if( GL_TRUE != status )
 			throw Error( "Shader program linking failed: \n%s\n", log.data() );
 
 		if( !log.empty() )
 			std::fprintf( stderr, "Note: shader program linking log:\n%s\n", log.data() );
+
+		// The shaders are owned by the cache and may be shared with other
+		// programs. Detach them, so that they can be freed independently.
+		for( auto const shader : pending->shaders )
+			glDetachShader( pending->program, shader );
+
+		pending->shaders.clear();
+
+		cache.store_program( pending->program, pending->key );
 	}
-	
+
 	OGL_CHECKPOINT_ALWAYS();
 
-	// Replace the old shader program (if any) with the new one
-	std::swap( mProgram, prog );
+	// Replace the old shader program (if any) with the new one. The old one is
+	// deleted along with the pending state.
+	std::swap( mProgram, pending->program );
 }
 
 namespace
 {
-	GLuint load_shader_( GLenum aShaderType, char const* aSourcePath )
+	std::string load_source_( ShaderProgram::ShaderSource const& aSource )
 	{
+		char const* aSourcePath = aSource.sourcePath.c_str();
+
 		// Load the shader source code from file
-		std::vector<GLchar> source;
+		std::string source;
 
 		if( std::FILE* fin = std::fopen( aSourcePath, "rb" ) )
 		{
@@ -162,9 +322,9 @@ namespace
 				if( 0 == ret )
 				{
 					if( auto const err = std::ferror( fin ) )
-						throw Error( "load_shader_(): error while reading from '%s': %d (%zu bytes read, %zu total)", aSourcePath, err, read, length );
+						throw Error( "load_source_(): error while reading from '%s': %d (%zu bytes read, %zu total)", aSourcePath, err, read, length );
 					if( std::feof( fin ) )
-						throw Error( "load_shader_(): unexpected EOF in '%s' (%zu bytes read, %zu total)", aSourcePath, read, length );
+						throw Error( "load_source_(): unexpected EOF in '%s' (%zu bytes read, %zu total)", aSourcePath, read, length );
 				}
 			
 				read += ret;
@@ -172,69 +332,58 @@ namespace
 		}
 		else
 		{
-			throw Error( "load_shader_(): unable to open input file '%s'", aSourcePath );
+			throw Error( "load_source_(): unable to open input file '%s'", aSourcePath );
 		}
 
-		// Create shader object
-		OGL_CHECKPOINT_ALWAYS();
+		if( aSource.defines.empty() )
+			return source;
 
-		GLuint shader = glCreateShader( aShaderType );
+		// GLSL requires the #version directive to come first, so the defines
+		// are inserted directly after it. A #line directive restores the
+		// original line numbers for compiler messages.
+		std::size_t insertAt = 0, line = 1;
+		if( auto const version = source.find( "#version" ); std::string::npos != version )
+		{
+			auto const eol = source.find( '\n', version );
+			insertAt = std::string::npos == eol ? source.size() : eol+1;
 
-		// Compile shader
-		GLchar const* sources[] = {
-			source.data()
-		};
-		GLsizei lengths[] = {
-			GLsizei(source.size())
-		};
+			for( std::size_t i = 0; i < insertAt; ++i )
+				line += ('\n' == source[i]);
+		}
 
-		glShaderSource( shader, sizeof(sources)/sizeof(sources[0]), sources, lengths );
+		std::string defines;
+		if( insertAt == source.size() && (source.empty() || '\n' != source.back()) )
+			defines += '\n';
 
-		glCompileShader( shader );
+		for( auto const& def : aSource.defines )
+			defines += "#define " + def + "\n";
 
-		OGL_CHECKPOINT_ALWAYS();
+		defines += "#line " + std::to_string( line ) + "\n";
 
-		// Get compile info log
-		/* The compile log is mainly relevant if there is an error. However, on some
-		 * systems, it can include additional information even if compilation was
-		 * successful. This might include warnings and/or usage hints.
-		 */
-		GLint logLength = 0;
-		glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &logLength );
-
-		std::vector<GLchar> log;
-		if( logLength )
-		{
-			log.resize( logLength );
-			glGetShaderInfoLog( shader, GLsizei(log.size()), nullptr, log.data() );
-		}
+		source.insert( insertAt, defines );
+		return source;
+	}
 
-		char const* shaderTypeName = "unknown shader";
-		switch( aShaderType )
-		{
-			case GL_VERTEX_SHADER: shaderTypeName = "vertex shader"; break;
-			case GL_FRAGMENT_SHADER: shaderTypeName = "fragment shader"; break;
-			case GL_GEOMETRY_SHADER: shaderTypeName = "geometry shader"; break;
-			case GL_TESS_CONTROL_SHADER: shaderTypeName = "tessellation control shader"; break;
-			case GL_TESS_EVALUATION_SHADER: shaderTypeName = "tessellation evaluation shader"; break;
-			case GL_COMPUTE_SHADER: shaderTypeName = "compute shader"; break;
-		}
+	std::vector<GLuint> begin_link_( GLuint aProgram, ShaderCache& aCache, std::vector<ShaderProgram::ShaderSource> const& aStages, std::vector<std::string> const& aSources )
+	{
+		// Compile (or reuse) the individual shaders. This does not wait for
+		// the compilation to finish; errors are picked up in finish().
+		std::vector<GLuint> shaders;
+		shaders.reserve( aStages.size() );
 
-		// Check compile status
-		GLint status = 0;
-		glGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+		for( std::size_t i = 0; i < aStages.size(); ++i )
+			shaders.emplace_back( aCache.compile_stage( aStages[i].type, aSources[i] ) );
 
-		if( GL_TRUE != status )
-		{
-			glDeleteShader( shader );
-			throw Error( "%s \"%s\" compilation failed:\n%s\n", shaderTypeName, aSourcePath, log.data() );
-		}
+		// Link individual shaders to create the final shader program. Don't
+		// query the status here - that would wait for the link to complete.
+		for( auto const shader : shaders )
+			glAttachShader( aProgram, shader );
 
-		if( !log.empty() )
-			std::fprintf( stderr, "Note: %s \"%s\" log:\n%s\n", shaderTypeName, aSourcePath, log.data() );
+		if( aCache.binaries_enabled() )
+			glProgramParameteri( aProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
 
-		OGL_CHECKPOINT_ALWAYS();
+		glLinkProgram( aProgram );
 
-		return shader;
+		return shaders;
 	}
 }
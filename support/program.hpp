@@ -3,12 +3,16 @@
 
 #include <glad/glad.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <cstdint>
 #include <cstdlib>
 
+class ShaderCache;
+class ShaderCompileThread;
+
 class ShaderProgram final
 {
 	public:
@@ -16,11 +20,25 @@ class ShaderProgram final
 		{
 			GLenum type;
 			std::string sourcePath;
+
+			// Preprocessor definitions ("NAME" or "NAME VALUE") inserted
+			// after the #version directive.
+			std::vector<std::string> defines = {};
 		};
 
 	public:
-		explicit ShaderProgram( 
-			std::vector<ShaderSource> = {}
+		// If a ShaderCache is given, it must outlive the ShaderProgram.
+		explicit ShaderProgram(
+			std::vector<ShaderSource> = {},
+			ShaderCache* = nullptr
+		);
+
+		// Starts creating the program, but does not wait for it. See
+		// reload_async(). The worker (optional) must outlive the program.
+		static ShaderProgram deferred(
+			std::vector<ShaderSource>,
+			ShaderCache* = nullptr,
+			ShaderCompileThread* = nullptr
 		);
 
 		~ShaderProgram();
@@ -32,13 +50,49 @@ class ShaderProgram final
 		ShaderProgram& operator= (ShaderProgram&&) noexcept;
 
 	public:
-		GLuint programId() const noexcept;
+		// Returns the current program. If the program is still being created
+		// and there is no previous version, this blocks until it is ready.
+		GLuint programId();
+
+		std::vector<ShaderSource> const& sources() const noexcept;
 
+		// Recompile and relink. Blocks until done. On failure, an exception is
+		// thrown and the current program is kept.
 		void reload();
 
+		// Start recompiling/relinking without waiting for the result.
+		//
+		// With GL_KHR_parallel_shader_compile, the compile and link commands
+		// are issued immediately and the driver works on them in the
+		// background. Otherwise, if a ShaderCompileThread was provided, the
+		// work is handed to it. Failing both, the commands are issued as-is;
+		// drivers will still defer some of the work until it is needed.
+		//
+		// The current program (if any) remains in use until finish() is
+		// called. A second call replaces the pending reload.
+		void reload_async();
+
+		// Non-blocking check: true if there is no pending reload, or if the
+		// pending reload can be completed by finish() without waiting.
+		bool ready() const;
+
+		// Complete a pending reload, blocking if necessary. On failure, an
+		// exception is thrown and the current program is kept.
+		void finish();
+
+	private:
+		struct Pending_;
+		struct DeferredTag_ {};
+
+		ShaderProgram( DeferredTag_, std::vector<ShaderSource>, ShaderCache*, ShaderCompileThread* );
+
 	private:
 		GLuint mProgram;
 		std::vector<ShaderSource> mSources;
+		ShaderCache* mCache;
+		ShaderCompileThread* mWorker;
+
+		std::unique_ptr<Pending_> mPending;
 };
 
 #endif // PROGRAM_HPP_39793FD2_7845_47A7_9E21_6DDAD42C9A09
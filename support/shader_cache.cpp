@@ -0,0 +1,346 @@
+#include "shader_cache.hpp"
+
+#include <limits>
+#include <vector>
+#include <system_error>
+#include <filesystem>
+
+#include <cstdio>
+#include <cstring>
+
+#include "hash.hpp"
+#include "error.hpp"
+#include "checkpoint.hpp"
+
+namespace
+{
+	// On-disk layout of a cached program binary. The header is followed by
+	// `length` bytes of driver-specific binary data.
+	struct BinaryHeader_
+	{
+		char magic[4];
+		std::uint32_t format;
+		std::uint64_t key;
+		std::uint64_t length;
+	};
+
+	constexpr char kBinaryMagic_[4] = { 'S', 'P', 'B', '1' };
+
+	char const* shader_type_name_( GLenum ) noexcept;
+}
+
+ShaderCache::ShaderCache( std::string aCacheDir )
+	: mCacheDir( std::move(aCacheDir) )
+	, mBinariesEnabled( false )
+	, mHaveDriverKey( false )
+	, mDriverKey( 0 )
+	, mStats{}
+{
+	if( !mCacheDir.empty() )
+	{
+		// Some drivers (notably some Mesa configurations) support zero binary
+		// formats. glGetProgramBinary() is useless in that case.
+		GLint formats = 0;
+		glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formats );
+
+		std::error_code ec;
+		std::filesystem::create_directories( mCacheDir, ec );
+
+		if( ec )
+			std::fprintf( stderr, "Note: shader cache disabled - can't create '%s': %s\n", mCacheDir.c_str(), ec.message().c_str() );
+
+		mBinariesEnabled = formats > 0 && !ec;
+	}
+}
+
+ShaderCache::~ShaderCache()
+{
+	release_stages();
+}
+
+GLuint ShaderCache::stage( GLenum aType, std::string const& aSource, char const* aLabel )
+{
+	auto const shader = compile_stage( aType, aSource );
+	check_stage( shader, aType, aLabel );
+	return shader;
+}
+
+GLuint ShaderCache::compile_stage( GLenum aType, std::string const& aSource )
+{
+	auto const key = hash_fnv1a( aSource.data(), aSource.size(), hash_fnv1a( &aType, sizeof(aType) ) );
+
+	std::scoped_lock lock( mMutex );
+
+	if( auto const it = mStages.find( key ); mStages.end() != it )
+	{
+		++mStats.stagesShared;
+		return it->second;
+	}
+
+	// Create shader object
+	OGL_CHECKPOINT_ALWAYS();
+
+	GLuint shader = glCreateShader( aType );
+
+	// Compile shader
+	GLchar const* sources[] = {
+		aSource.data()
+	};
+	GLsizei lengths[] = {
+		GLsizei(aSource.size())
+	};
+
+	glShaderSource( shader, sizeof(sources)/sizeof(sources[0]), sources, lengths );
+
+	glCompileShader( shader );
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	++mStats.stagesCompiled;
+	mStages.emplace( key, shader );
+	return shader;
+}
+
+void ShaderCache::check_stage( GLuint aShader, GLenum aType, char const* aLabel )
+{
+	std::scoped_lock lock( mMutex );
+
+	if( mVerifiedStages.count( aShader ) )
+		return;
+
+	// Get compile info log
+	/* The compile log is mainly relevant if there is an error. However, on some
+	 * systems, it can include additional information even if compilation was
+	 * successful. This might include warnings and/or usage hints.
+	 */
+	GLint logLength = 0;
+	glGetShaderiv( aShader, GL_INFO_LOG_LENGTH, &logLength );
+
+	std::vector<GLchar> log;
+	if( logLength )
+	{
+		log.resize( logLength );
+		glGetShaderInfoLog( aShader, GLsizei(log.size()), nullptr, log.data() );
+	}
+
+	// Check compile status
+	GLint status = 0;
+	glGetShaderiv( aShader, GL_COMPILE_STATUS, &status );
+
+	if( GL_TRUE != status )
+	{
+		for( auto it = mStages.begin(); mStages.end() != it; ++it )
+		{
+			if( aShader == it->second )
+			{
+				mStages.erase( it );
+				glDeleteShader( aShader );
+				break;
+			}
+		}
+
+		throw Error( "%s \"%s\" compilation failed:\n%s\n", shader_type_name_(aType), aLabel, log.data() );
+	}
+
+	if( !log.empty() )
+		std::fprintf( stderr, "Note: %s \"%s\" log:\n%s\n", shader_type_name_(aType), aLabel, log.data() );
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	mVerifiedStages.insert( aShader );
+}
+
+std::uint64_t ShaderCache::driver_key()
+{
+	std::scoped_lock lock( mMutex );
+
+	if( !mHaveDriverKey )
+	{
+		std::uint64_t key = kFnv1aOffset64;
+		for( GLenum const name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION } )
+		{
+			if( auto const* str = reinterpret_cast<char const*>(glGetString( name )) )
+				key = hash_fnv1a( str, std::strlen(str), key );
+		}
+
+		mDriverKey = key;
+		mHaveDriverKey = true;
+	}
+
+	return mDriverKey;
+}
+
+bool ShaderCache::load_program( GLuint aProgram, std::uint64_t aKey )
+{
+	std::scoped_lock lock( mMutex );
+
+	if( !mBinariesEnabled )
+	{
+		++mStats.programMisses;
+		return false;
+	}
+
+	auto const path = entry_path_( aKey );
+
+	std::FILE* fin = std::fopen( path.c_str(), "rb" );
+	if( !fin )
+	{
+		++mStats.programMisses;
+		return false;
+	}
+
+	BinaryHeader_ header{};
+	std::vector<char> binary;
+
+	// The length is checked against the file before allocating; a corrupt
+	// entry is a miss. (glProgramBinary() takes a GLsizei.)
+	std::error_code sizeError;
+	auto const fileSize = std::filesystem::file_size( path, sizeError );
+
+	bool valid = !sizeError
+		&& 1 == std::fread( &header, sizeof(header), 1, fin )
+		&& 0 == std::memcmp( header.magic, kBinaryMagic_, sizeof(kBinaryMagic_) )
+		&& header.key == aKey
+		&& header.length > 0
+		&& header.length <= fileSize - sizeof(header)
+		&& header.length <= std::uint64_t(std::numeric_limits<GLsizei>::max())
+	;
+
+	if( valid )
+	{
+		binary.resize( header.length );
+		valid = 1 == std::fread( binary.data(), binary.size(), 1, fin );
+	}
+
+	std::fclose( fin );
+
+	if( valid )
+	{
+		glProgramBinary( aProgram, header.format, binary.data(), GLsizei(binary.size()) );
+
+		// glProgramBinary() may fail with GL_INVALID_ENUM if the format is no
+		// longer supported. Clear it, so that it is not reported elsewhere.
+		while( GL_NO_ERROR != glGetError() )
+			;
+
+		GLint status = 0;
+		glGetProgramiv( aProgram, GL_LINK_STATUS, &status );
+		valid = GL_TRUE == status;
+	}
+
+	if( !valid )
+	{
+		// Stale or corrupt entry. Remove it; it will be recreated once the
+		// program has been compiled from source.
+		std::error_code ec;
+		std::filesystem::remove( path, ec );
+
+		++mStats.programRejected;
+		return false;
+	}
+
+	++mStats.programHits;
+	return true;
+}
+
+void ShaderCache::store_program( GLuint aProgram, std::uint64_t aKey )
+{
+	if( !mBinariesEnabled )
+		return;
+
+	GLint length = 0;
+	glGetProgramiv( aProgram, GL_PROGRAM_BINARY_LENGTH, &length );
+	if( length <= 0 )
+		return;
+
+	BinaryHeader_ header{};
+	std::memcpy( header.magic, kBinaryMagic_, sizeof(kBinaryMagic_) );
+	header.key = aKey;
+
+	std::vector<char> binary( static_cast<std::size_t>(length) );
+
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary( aProgram, length, &written, &format, binary.data() );
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	header.format = format;
+	header.length = std::uint64_t(written);
+
+	// Write to a temporary file first, and then move it into place. This way,
+	// a crash (or a second instance) never observes a partially written entry.
+	auto const path = entry_path_( aKey );
+	auto const temp = path + ".tmp";
+
+	std::FILE* fout = std::fopen( temp.c_str(), "wb" );
+	if( !fout )
+	{
+		std::fprintf( stderr, "Note: unable to write shader cache entry '%s'\n", temp.c_str() );
+		return;
+	}
+
+	bool const ok = 1 == std::fwrite( &header, sizeof(header), 1, fout )
+		&& 1 == std::fwrite( binary.data(), header.length, 1, fout )
+	;
+
+	std::fclose( fout );
+
+	std::error_code ec;
+	if( ok )
+		std::filesystem::rename( temp, path, ec );
+
+	if( !ok || ec )
+	{
+		std::fprintf( stderr, "Note: unable to write shader cache entry '%s'\n", path.c_str() );
+		std::filesystem::remove( temp, ec );
+	}
+}
+
+void ShaderCache::release_stages() noexcept
+{
+	std::scoped_lock lock( mMutex );
+
+	for( auto const& [key, shader] : mStages )
+		glDeleteShader( shader );
+
+	mStages.clear();
+	mVerifiedStages.clear();
+}
+
+bool ShaderCache::binaries_enabled() const noexcept
+{
+	return mBinariesEnabled;
+}
+
+ShaderCache::Stats ShaderCache::stats() const
+{
+	std::scoped_lock lock( mMutex );
+	return mStats;
+}
+
+std::string ShaderCache::entry_path_( std::uint64_t aKey ) const
+{
+	char name[32]{};
+	std::snprintf( name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(aKey) );
+
+	return mCacheDir + "/" + name;
+}
+
+namespace
+{
+	char const* shader_type_name_( GLenum aShaderType ) noexcept
+	{
+		switch( aShaderType )
+		{
+			case GL_VERTEX_SHADER: return "vertex shader";
+			case GL_FRAGMENT_SHADER: return "fragment shader";
+			case GL_GEOMETRY_SHADER: return "geometry shader";
+			case GL_TESS_CONTROL_SHADER: return "tessellation control shader";
+			case GL_TESS_EVALUATION_SHADER: return "tessellation evaluation shader";
+			case GL_COMPUTE_SHADER: return "compute shader";
+		}
+
+		return "unknown shader";
+	}
+}
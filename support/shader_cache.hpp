@@ -0,0 +1,107 @@
+#ifndef SHADER_CACHE_HPP_5E0C6A3B_8F2D_4C1E_9B7A_2D4F61E8C0A5
+#define SHADER_CACHE_HPP_5E0C6A3B_8F2D_4C1E_9B7A_2D4F61E8C0A5
+
+#include <glad/glad.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <cstdint>
+#include <cstdlib>
+
+/* ShaderCache: avoids redundant shader work across ShaderPrograms.
+ *
+ * The cache does two things:
+ *  - Shader stages are deduplicated. If two programs use an identical stage
+ *    (same type and same source text after defines have been applied), the
+ *    stage is compiled once and the shader object is reused. default.vert,
+ *    which is shared by all our programs, is therefore only compiled once.
+ *  - Linked programs are stored on disk via glGetProgramBinary() and restored
+ *    with glProgramBinary() on later runs. The entries are keyed by a hash of
+ *    all stage sources and the driver identification strings (vendor,
+ *    renderer, version). Drivers may reject binaries at any time (e.g., after
+ *    an update that does not change the version string); a rejected entry is
+ *    deleted and the program is compiled from source instead.
+ *
+ * Pass an empty directory to disable the on-disk cache. Stage deduplication
+ * is still performed in that case.
+ *
+ * Shader objects are kept alive until release_stages() is called or the cache
+ * is destroyed. The cache must therefore not outlive the OpenGL context.
+ *
+ * The cache may be used concurrently from a thread with a shared context (see
+ * ShaderCompileThread).
+ */
+class ShaderCache final
+{
+	public:
+		struct Stats
+		{
+			std::size_t programHits;
+			std::size_t programMisses;
+			std::size_t programRejected;
+			std::size_t stagesCompiled;
+			std::size_t stagesShared;
+		};
+
+	public:
+		explicit ShaderCache( std::string aCacheDir = {} );
+		~ShaderCache();
+
+		ShaderCache( ShaderCache const& ) = delete;
+		ShaderCache& operator= (ShaderCache const&) = delete;
+
+	public:
+		// Returns a compiled shader object for the given source. The returned
+		// object is owned by the cache. Throws Error if compilation fails.
+		GLuint stage( GLenum aType, std::string const& aSource, char const* aLabel );
+
+		// As stage(), but does not wait for the compilation to finish. With
+		// parallel shader compilation, this returns immediately. The result
+		// must be verified with check_stage() before relying on it.
+		GLuint compile_stage( GLenum aType, std::string const& aSource );
+
+		// Throws Error if the stage failed to compile. Failed stages are
+		// evicted from the cache.
+		void check_stage( GLuint aShader, GLenum aType, char const* aLabel );
+
+		// Hash identifying the current driver. Used as the seed for program
+		// keys, such that binaries from a different driver are never loaded.
+		std::uint64_t driver_key();
+
+		// Attempts to restore aProgram from the on-disk cache. Returns true if
+		// the binary was accepted and the program is linked.
+		bool load_program( GLuint aProgram, std::uint64_t aKey );
+
+		// Stores the (linked) program in the on-disk cache. Failures are
+		// reported on stderr but are otherwise ignored.
+		void store_program( GLuint aProgram, std::uint64_t aKey );
+
+		// Deletes the cached shader objects. Programs that were linked with
+		// them remain valid.
+		void release_stages() noexcept;
+
+		bool binaries_enabled() const noexcept;
+		Stats stats() const;
+
+	private:
+		std::string entry_path_( std::uint64_t ) const;
+
+	private:
+		std::string mCacheDir;
+		bool mBinariesEnabled;
+
+		bool mHaveDriverKey;
+		std::uint64_t mDriverKey;
+
+		std::unordered_map<std::uint64_t,GLuint> mStages;
+		std::unordered_set<GLuint> mVerifiedStages;
+
+		Stats mStats;
+
+		mutable std::mutex mMutex;
+};
+
+#endif // SHADER_CACHE_HPP_5E0C6A3B_8F2D_4C1E_9B7A_2D4F61E8C0A5
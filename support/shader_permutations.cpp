@@ -0,0 +1,66 @@
+#include "shader_permutations.hpp"
+
+#include "error.hpp"
+#include "shader_reload.hpp"
+
+ShaderPermutations::ShaderPermutations( std::vector<ShaderProgram::ShaderSource> aStages, std::vector<Feature> aFeatures, ShaderCache* aCache, ShaderCompileThread* aWorker, ShaderHotReload* aReload )
+	: mStages( std::move(aStages) )
+	, mFeatures( std::move(aFeatures) )
+	, mCache( aCache )
+	, mWorker( aWorker )
+	, mReload( aReload )
+{}
+
+ShaderPermutations::~ShaderPermutations()
+{
+	if( mReload )
+	{
+		for( auto& [mask, program] : mVariants )
+			mReload->remove( *program );
+	}
+}
+
+ShaderProgram& ShaderPermutations::get( std::uint32_t aFeatures )
+{
+	if( auto const it = mVariants.find( aFeatures ); mVariants.end() != it )
+		return *it->second;
+
+	std::vector<std::string> defines;
+	std::uint32_t known = 0;
+	for( auto const& feature : mFeatures )
+	{
+		known |= feature.bit;
+		if( aFeatures & feature.bit )
+			defines.emplace_back( feature.define );
+	}
+
+	if( aFeatures & ~known )
+		throw Error( "ShaderPermutations::get(): unknown feature bits %#x", unsigned(aFeatures & ~known) );
+
+	auto stages = mStages;
+	for( auto& stage : stages )
+		stage.defines.insert( stage.defines.end(), defines.begin(), defines.end() );
+
+	auto program = std::make_unique<ShaderProgram>( ShaderProgram::deferred( std::move(stages), mCache, mWorker ) );
+
+	if( mReload )
+		mReload->add( *program );
+
+	return *mVariants.emplace( aFeatures, std::move(program) ).first->second;
+}
+
+void ShaderPermutations::prepare( std::uint32_t aFeatures )
+{
+	get( aFeatures );
+}
+
+void ShaderPermutations::finish()
+{
+	for( auto& [mask, program] : mVariants )
+		program->finish();
+}
+
+std::size_t ShaderPermutations::variant_count() const noexcept
+{
+	return mVariants.size();
+}
@@ -0,0 +1,80 @@
+#ifndef SHADER_PERMUTATIONS_HPP_0D6B3E92_71F4_4A8C_B5E2_9C47A1F03D68
+#define SHADER_PERMUTATIONS_HPP_0D6B3E92_71F4_4A8C_B5E2_9C47A1F03D68
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include <cstdint>
+
+#include "program.hpp"
+
+class ShaderCache;
+class ShaderHotReload;
+class ShaderCompileThread;
+
+/* ShaderPermutations: variants of one set of shader sources
+ *
+ * The sources are written as uber-shaders, where each optional feature is
+ * enclosed in #if defined(<feature define>) blocks. A variant is identified
+ * by a feature bit mask; its program is compiled with exactly the defines of
+ * the bits that are set, so it contains only the code it needs.
+ *
+ * Variants are created lazily, the first time they are requested, and are
+ * cached afterwards. Use prepare() to start compiling variants that are
+ * known to be needed ahead of time.
+ *
+ * The optional cache, worker and hot reload instances are passed on to each
+ * variant and must outlive the ShaderPermutations.
+ */
+class ShaderPermutations final
+{
+	public:
+		struct Feature
+		{
+			std::uint32_t bit;
+			char const* define;
+		};
+
+	public:
+		ShaderPermutations(
+			std::vector<ShaderProgram::ShaderSource> aStages,
+			std::vector<Feature> aFeatures,
+			ShaderCache* = nullptr,
+			ShaderCompileThread* = nullptr,
+			ShaderHotReload* = nullptr
+		);
+
+		~ShaderPermutations();
+
+		ShaderPermutations( ShaderPermutations const& ) = delete;
+		ShaderPermutations& operator= (ShaderPermutations const&) = delete;
+
+	public:
+		// Returns the variant for the feature mask, creating it if necessary.
+		// Note that the program may still be compiling; it is waited for
+		// when the program ID is first requested.
+		ShaderProgram& get( std::uint32_t aFeatures );
+
+		// Start compiling the variant without waiting for it.
+		void prepare( std::uint32_t aFeatures );
+
+		// Wait for all variants that are still being created.
+		void finish();
+
+		std::size_t variant_count() const noexcept;
+
+	private:
+		std::vector<ShaderProgram::ShaderSource> mStages;
+		std::vector<Feature> mFeatures;
+
+		ShaderCache* mCache;
+		ShaderCompileThread* mWorker;
+		ShaderHotReload* mReload;
+
+		// unique_ptr: the programs' addresses must not change, since they are
+		// registered with the hot reload.
+		std::unordered_map<std::uint32_t,std::unique_ptr<ShaderProgram>> mVariants;
+};
+
+#endif // SHADER_PERMUTATIONS_HPP_0D6B3E92_71F4_4A8C_B5E2_9C47A1F03D68
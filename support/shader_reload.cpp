@@ -0,0 +1,77 @@
+#include "shader_reload.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#include <cstdio>
+
+#include "program.hpp"
+
+void ShaderHotReload::add( ShaderProgram& aProgram )
+{
+	mPrograms.emplace_back( Entry_{ &aProgram, false } );
+
+	for( auto const& source : aProgram.sources() )
+		mWatcher.watch( source.sourcePath );
+}
+
+void ShaderHotReload::remove( ShaderProgram& aProgram )
+{
+	// The files stay watched. Changes to them are simply ignored.
+	std::erase_if( mPrograms, [&aProgram] (Entry_ const& aEntry) {
+		return &aProgram == aEntry.program;
+	} );
+}
+
+std::size_t ShaderHotReload::update()
+{
+	// Start reloading programs whose sources have changed.
+	for( auto const& path : mWatcher.poll() )
+	{
+		for( auto& entry : mPrograms )
+		{
+			auto const& sources = entry.program->sources();
+			bool const affected = std::any_of( sources.begin(), sources.end(), [&path] (auto const& aSource) {
+				return path == aSource.sourcePath;
+			} );
+
+			if( !affected )
+				continue;
+
+			std::fprintf( stderr, "'%s' changed - reloading shader program\n", path.c_str() );
+
+			try
+			{
+				entry.program->reload_async();
+				entry.reloading = true;
+			}
+			catch( std::exception const& eErr )
+			{
+				// E.g. the file was briefly missing while being saved.
+				std::fprintf( stderr, "Shader reload failed (keeping previous program):\n%s\n", eErr.what() );
+			}
+		}
+	}
+
+	// Install any programs that have finished.
+	std::size_t replaced = 0;
+	for( auto& entry : mPrograms )
+	{
+		if( !entry.reloading || !entry.program->ready() )
+			continue;
+
+		entry.reloading = false;
+
+		try
+		{
+			entry.program->finish();
+			++replaced;
+		}
+		catch( std::exception const& eErr )
+		{
+			std::fprintf( stderr, "Shader reload failed (keeping previous program):\n%s\n", eErr.what() );
+		}
+	}
+
+	return replaced;
+}
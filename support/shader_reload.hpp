@@ -0,0 +1,50 @@
+#ifndef SHADER_RELOAD_HPP_C43F81A9_2D7E_4B50_9F6C_E18A05D3B72F
+#define SHADER_RELOAD_HPP_C43F81A9_2D7E_4B50_9F6C_E18A05D3B72F
+
+#include <vector>
+
+#include "file_watch.hpp"
+
+class ShaderProgram;
+
+/* ShaderHotReload: recompiles shader programs when their sources change
+ *
+ * Registered programs have all their ShaderSource::sourcePath files watched.
+ * When a file changes, only the programs using it are reloaded, using
+ * ShaderProgram::reload_async(), so compilation proceeds in the background.
+ *
+ * update() should be called once per frame, before any drawing. It installs
+ * programs that have finished compiling, so a program never changes in the
+ * middle of a frame. If a reload fails, the error is printed and the program
+ * keeps its last good version.
+ *
+ * Registered programs must outlive the ShaderHotReload instance (or be
+ * removed from it).
+ */
+class ShaderHotReload final
+{
+	public:
+		ShaderHotReload() = default;
+
+		ShaderHotReload( ShaderHotReload const& ) = delete;
+		ShaderHotReload& operator= (ShaderHotReload const&) = delete;
+
+	public:
+		void add( ShaderProgram& );
+		void remove( ShaderProgram& );
+
+		// Returns the number of programs that were replaced this frame.
+		std::size_t update();
+
+	private:
+		struct Entry_
+		{
+			ShaderProgram* program;
+			bool reloading;
+		};
+
+		FileWatcher mWatcher;
+		std::vector<Entry_> mPrograms;
+};
+
+#endif // SHADER_RELOAD_HPP_C43F81A9_2D7E_4B50_9F6C_E18A05D3B72F
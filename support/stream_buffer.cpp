@@ -0,0 +1,166 @@
+#include "stream_buffer.hpp"
+
+#include <cassert>
+
+#include "error.hpp"
+
+namespace
+{
+	// Waits up to this long per attempt. A longer wait almost certainly
+	// means that something went badly wrong, but we keep waiting anyway;
+	// overwriting data in use by the GPU would be worse.
+	constexpr GLuint64 kFenceTimeout_ = 1000000000ull; // ns
+}
+
+StreamBuffer::StreamBuffer( std::size_t aFrameSize )
+	: mFrameSize( aFrameSize )
+{
+	assert( aFrameSize > 0 );
+
+	glGenBuffers( 1, &mBuffer );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, mBuffer );
+
+	auto const total = GLsizeiptr(kFrames * mFrameSize);
+	if( GLAD_GL_VERSION_4_4 )
+	{
+		GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage( GL_COPY_WRITE_BUFFER, total, nullptr, flags );
+		mMapped = static_cast<char*>(glMapBufferRange( GL_COPY_WRITE_BUFFER, 0, total, flags ));
+	}
+
+	if( !mMapped )
+	{
+		// Buffer storage is immutable; if mapping failed, start over.
+		if( GLAD_GL_VERSION_4_4 )
+		{
+			glDeleteBuffers( 1, &mBuffer );
+			glGenBuffers( 1, &mBuffer );
+			glBindBuffer( GL_COPY_WRITE_BUFFER, mBuffer );
+		}
+
+		glBufferData( GL_COPY_WRITE_BUFFER, total, nullptr, GL_STREAM_DRAW );
+		mShadow.resize( mFrameSize );
+	}
+
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for( auto& fence : mFences )
+	{
+		if( fence )
+			glDeleteSync( fence );
+	}
+
+	if( mMapped )
+	{
+		glBindBuffer( GL_COPY_WRITE_BUFFER, mBuffer );
+		glUnmapBuffer( GL_COPY_WRITE_BUFFER );
+		glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+	}
+
+	glDeleteBuffers( 1, &mBuffer );
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate( std::size_t aSize, std::size_t aAlignment )
+{
+	assert( aAlignment > 0 && 0 == (aAlignment & (aAlignment-1)) );
+
+	// The regions start at multiples of mFrameSize, which need not be
+	// aligned; align the absolute offset.
+	std::size_t const base = mFrame * mFrameSize;
+	std::size_t const offset = (base + mUsed + aAlignment-1) & ~(aAlignment-1);
+
+	if( offset + aSize > base + mFrameSize )
+		throw Error( "StreamBuffer: out of space (%zu of %zu bytes used, %zu requested)", mUsed, mFrameSize, aSize );
+
+	mUsed = offset + aSize - base;
+
+	void* data = mMapped ? mMapped + offset : mShadow.data() + (offset - base);
+	return { data, offset, aSize };
+}
+
+void StreamBuffer::commit( Allocation const& aAlloc )
+{
+	if( mMapped || 0 == aAlloc.size )
+		return;
+
+	glBindBuffer( GL_COPY_WRITE_BUFFER, mBuffer );
+	glBufferSubData( GL_COPY_WRITE_BUFFER, GLintptr(aAlloc.offset), GLsizeiptr(aAlloc.size), aAlloc.data );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+}
+
+void StreamBuffer::bind_range( GLenum aTarget, GLuint aIndex, Allocation const& aAlloc ) const
+{
+	glBindBufferRange( aTarget, aIndex, mBuffer, GLintptr(aAlloc.offset), GLsizeiptr(aAlloc.size) );
+}
+
+void StreamBuffer::end_frame()
+{
+	auto& fence = mFences[mFrame];
+	if( fence )
+		glDeleteSync( fence );
+	fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+	mFrame = (mFrame+1) % kFrames;
+	mUsed = 0;
+
+	// Wait until the GPU is done with the next region. The first check does
+	// not wait, so that we can tell whether we stalled.
+	if( auto& next = mFences[mFrame] )
+	{
+		GLenum ret = glClientWaitSync( next, GL_SYNC_FLUSH_COMMANDS_BIT, 0 );
+		if( GL_TIMEOUT_EXPIRED == ret )
+		{
+			++mStalls;
+			do
+			{
+				ret = glClientWaitSync( next, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeout_ );
+			} while( GL_TIMEOUT_EXPIRED == ret );
+		}
+
+		glDeleteSync( next );
+		next = nullptr;
+
+		if( GL_WAIT_FAILED == ret )
+			throw Error( "StreamBuffer: glClientWaitSync() failed" );
+	}
+}
+
+GLuint StreamBuffer::buffer() const noexcept
+{
+	return mBuffer;
+}
+
+std::size_t StreamBuffer::frame_size() const noexcept
+{
+	return mFrameSize;
+}
+std::size_t StreamBuffer::frame_used() const noexcept
+{
+	return mUsed;
+}
+
+bool StreamBuffer::persistent() const noexcept
+{
+	return nullptr != mMapped;
+}
+
+std::size_t StreamBuffer::stalls() const noexcept
+{
+	return mStalls;
+}
+
+std::size_t StreamBuffer::uniform_alignment()
+{
+	GLint alignment = 0;
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment );
+	return alignment > 0 ? std::size_t(alignment) : 256;
+}
+std::size_t StreamBuffer::storage_alignment()
+{
+	GLint alignment = 0;
+	glGetIntegerv( GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment );
+	return alignment > 0 ? std::size_t(alignment) : 256;
+}
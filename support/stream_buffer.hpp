@@ -0,0 +1,98 @@
+#ifndef STREAM_BUFFER_HPP_3C8E51A7_D42F_4B69_A1E0_7F6B29D4C853
+#define STREAM_BUFFER_HPP_3C8E51A7_D42F_4B69_A1E0_7F6B29D4C853
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include <cstdlib>
+
+/* StreamBuffer: ring buffer for data that is regenerated every frame
+ *
+ * The buffer is split into kFrames regions. Each frame, data is suballocated
+ * from the current region with allocate() and written in place. end_frame()
+ * places a fence after the frame's commands and moves on to the next region,
+ * waiting for that region's fence first. Since the GPU usually runs at most
+ * one or two frames behind, the wait rarely blocks.
+ *
+ * With OpenGL 4.4, the buffer is created with glBufferStorage() and mapped
+ * once, persistently and coherently. Allocations point directly into the
+ * mapping, so writes need no copy and no further GL calls. Without 4.4,
+ * allocations point into a CPU-side copy of the region instead, and commit()
+ * uploads them with glBufferSubData(). Code should therefore always call
+ * commit() after writing an allocation, and before the draw that uses it.
+ *
+ * Allocations are valid until the next end_frame(). The data may be used by
+ * any binding point: as vertex or instance data (bind buffer() and use the
+ * offset), or as uniform or storage blocks (see bind_range()).
+ *
+ * The buffer must not outlive the OpenGL context.
+ */
+class StreamBuffer final
+{
+	public:
+		static constexpr std::size_t kFrames = 3;
+
+		struct Allocation
+		{
+			void* data;
+			std::size_t offset; // in bytes, relative to buffer()
+			std::size_t size;
+		};
+
+	public:
+		explicit StreamBuffer( std::size_t aFrameSize );
+		~StreamBuffer();
+
+		StreamBuffer( StreamBuffer const& ) = delete;
+		StreamBuffer& operator= (StreamBuffer const&) = delete;
+
+	public:
+		// Returns aSize bytes from the current frame's region, aligned to
+		// aAlignment bytes (a power of two). Throws Error if the region is
+		// full.
+		Allocation allocate( std::size_t aSize, std::size_t aAlignment = 16 );
+
+		// Makes the written data visible to the GPU. A no-op for persistent
+		// mappings.
+		void commit( Allocation const& );
+
+		// Binds an allocation to an indexed binding point (e.g.,
+		// GL_UNIFORM_BUFFER). Uniform blocks must be allocated with
+		// uniform_alignment(), storage blocks with storage_alignment().
+		void bind_range( GLenum aTarget, GLuint aIndex, Allocation const& ) const;
+
+		// Fences the current region and advances to the next one.
+		void end_frame();
+
+	public:
+		GLuint buffer() const noexcept;
+
+		std::size_t frame_size() const noexcept;
+		std::size_t frame_used() const noexcept; // bytes allocated this frame
+
+		bool persistent() const noexcept;
+
+		// Number of end_frame() calls that had to wait for the GPU.
+		std::size_t stalls() const noexcept;
+
+		// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+		static std::size_t uniform_alignment();
+		// GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+		static std::size_t storage_alignment();
+
+	private:
+		GLuint mBuffer = 0;
+
+		std::size_t mFrameSize;
+		std::size_t mFrame = 0;
+		std::size_t mUsed = 0;
+
+		char* mMapped = nullptr; // whole buffer; persistent mappings only
+		std::vector<char> mShadow; // current region; fallback only
+
+		GLsync mFences[kFrames] = {};
+		std::size_t mStalls = 0;
+};
+
+#endif // STREAM_BUFFER_HPP_3C8E51A7_D42F_4B69_A1E0_7F6B29D4C853
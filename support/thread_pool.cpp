@@ -0,0 +1,129 @@
+#include "thread_pool.hpp"
+
+#include <utility>
+#include <algorithm>
+
+ThreadPool::ThreadPool( unsigned aThreads )
+	: mGeneration( 0 )
+	, mBusy( 0 )
+	, mStop( false )
+	, mFn( nullptr )
+	, mCount( 0 )
+	, mGrain( 1 )
+	, mNext( 0 )
+{
+	if( 0 == aThreads )
+		aThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+	// The calling thread counts as one of the threads.
+	mThreads.reserve( aThreads-1 );
+	for( unsigned i = 1; i < aThreads; ++i )
+		mThreads.emplace_back( [this] { run_(); } );
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::scoped_lock lock( mMutex );
+		mStop = true;
+	}
+
+	mWake.notify_all();
+
+	for( auto& thread : mThreads )
+		thread.join();
+}
+
+void ThreadPool::parallel_for( std::size_t aCount, std::size_t aGrain, RangeFn const& aFn )
+{
+	aGrain = std::max<std::size_t>( 1, aGrain );
+
+	if( 0 == aCount )
+		return;
+
+	if( aCount <= aGrain || mThreads.empty() )
+	{
+		aFn( 0, aCount );
+		return;
+	}
+
+	std::scoped_lock callLock( mCallMutex );
+
+	{
+		std::scoped_lock lock( mMutex );
+		mFn = &aFn;
+		mCount = aCount;
+		mGrain = aGrain;
+		mNext = 0;
+		mError = nullptr;
+		mBusy = unsigned(mThreads.size());
+		++mGeneration;
+	}
+
+	mWake.notify_all();
+
+	work_();
+
+	std::unique_lock lock( mMutex );
+	mDone.wait( lock, [this] { return 0 == mBusy; } );
+
+	mFn = nullptr;
+	if( auto const error = std::exchange( mError, nullptr ) )
+		std::rethrow_exception( error );
+}
+
+unsigned ThreadPool::thread_count() const noexcept
+{
+	return unsigned(mThreads.size()) + 1;
+}
+
+void ThreadPool::run_()
+{
+	std::uint64_t seen = 0;
+
+	while( true )
+	{
+		{
+			std::unique_lock lock( mMutex );
+			mWake.wait( lock, [&] { return mStop || seen != mGeneration; } );
+
+			if( mStop )
+				return;
+
+			seen = mGeneration;
+		}
+
+		work_();
+
+		{
+			std::scoped_lock lock( mMutex );
+			--mBusy;
+		}
+
+		mDone.notify_one();
+	}
+}
+
+void ThreadPool::work_()
+{
+	while( true )
+	{
+		auto const begin = mNext.fetch_add( mGrain, std::memory_order_relaxed );
+		if( begin >= mCount )
+			return;
+
+		try
+		{
+			(*mFn)( begin, std::min( begin+mGrain, mCount ) );
+		}
+		catch( ... )
+		{
+			std::scoped_lock lock( mMutex );
+			if( !mError )
+				mError = std::current_exception();
+
+			// Skip the remaining chunks.
+			mNext = mCount;
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef THREAD_POOL_HPP_F27B9C40_6A1E_4D83_8C5F_0E93B1D7A264
+#define THREAD_POOL_HPP_F27B9C40_6A1E_4D83_8C5F_0E93B1D7A264
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#include <cstdint>
+#include <cstdlib>
+
+/* ThreadPool: persistent worker threads for data-parallel loops
+ *
+ * parallel_for() splits an index range into chunks of (at least) aGrain
+ * elements. The chunks are handed out dynamically to the workers and to the
+ * calling thread, which participates in the work. The call returns once all
+ * chunks have been processed. If the range fits into a single chunk, it is
+ * processed directly on the calling thread without involving the workers.
+ *
+ * Only one parallel_for() runs at a time; concurrent calls are serialized.
+ * If the loop body throws, the first exception is rethrown in the caller
+ * (after all chunks have finished or been skipped).
+ */
+class ThreadPool final
+{
+	public:
+		using RangeFn = std::function<void(std::size_t,std::size_t)>;
+
+	public:
+		// aThreads is the total number of threads, including the caller. Zero
+		// selects std::thread::hardware_concurrency().
+		explicit ThreadPool( unsigned aThreads = 0 );
+		~ThreadPool();
+
+		ThreadPool( ThreadPool const& ) = delete;
+		ThreadPool& operator= (ThreadPool const&) = delete;
+
+	public:
+		void parallel_for( std::size_t aCount, std::size_t aGrain, RangeFn const& );
+
+		unsigned thread_count() const noexcept;
+
+	private:
+		void run_();
+		void work_();
+
+	private:
+		std::vector<std::thread> mThreads;
+
+		std::mutex mCallMutex; // serializes parallel_for()
+
+		std::mutex mMutex;
+		std::condition_variable mWake, mDone;
+		std::uint64_t mGeneration;
+		unsigned mBusy;
+		bool mStop;
+
+		// Current job
+		RangeFn const* mFn;
+		std::size_t mCount, mGrain;
+		std::atomic<std::size_t> mNext;
+		std::exception_ptr mError;
+};
+
+#endif // THREAD_POOL_HPP_F27B9C40_6A1E_4D83_8C5F_0E93B1D7A264
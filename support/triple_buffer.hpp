@@ -0,0 +1,66 @@
+#ifndef TRIPLE_BUFFER_HPP_86F1D2A4_5C3B_4E97_A0D8_1B7E64C92F35
+#define TRIPLE_BUFFER_HPP_86F1D2A4_5C3B_4E97_A0D8_1B7E64C92F35
+
+#include <atomic>
+
+/* TripleBuffer: lock-free single-producer/single-consumer exchange of values
+ *
+ * The producer fills write_buffer() and calls publish(). The consumer calls
+ * update() to pick up the most recently published value, and then reads it
+ * via read(). Neither side ever waits for the other: the producer always has
+ * a buffer to write to, and the consumer keeps reading its current buffer
+ * until a newer one is available. Intermediate values are dropped if the
+ * producer is faster than the consumer.
+ *
+ * Exactly one thread may produce and exactly one thread may consume.
+ */
+template< typename tType >
+class TripleBuffer final
+{
+	public:
+		TripleBuffer() = default;
+
+		TripleBuffer( TripleBuffer const& ) = delete;
+		TripleBuffer& operator= (TripleBuffer const&) = delete;
+
+	public: // producer
+		tType& write_buffer() noexcept
+		{
+			return mBuffers[mWrite];
+		}
+
+		void publish() noexcept
+		{
+			// Swap the freshly written buffer with the middle one, and flag the
+			// middle one as containing new data.
+			mWrite = mMiddle.exchange( mWrite | kDirty_, std::memory_order_acq_rel ) & kIndexMask_;
+		}
+
+	public: // consumer
+		// Returns true if a new value was picked up.
+		bool update() noexcept
+		{
+			if( !(mMiddle.load( std::memory_order_relaxed ) & kDirty_) )
+				return false;
+
+			mRead = mMiddle.exchange( mRead, std::memory_order_acq_rel ) & kIndexMask_;
+			return true;
+		}
+
+		tType const& read() const noexcept
+		{
+			return mBuffers[mRead];
+		}
+
+	private:
+		static constexpr unsigned kIndexMask_ = 0x3u;
+		static constexpr unsigned kDirty_ = 0x4u;
+
+		tType mBuffers[3] = {};
+
+		unsigned mWrite = 0; // producer only
+		unsigned mRead = 1;  // consumer only
+		std::atomic<unsigned> mMiddle = 2;
+};
+
+#endif // TRIPLE_BUFFER_HPP_86F1D2A4_5C3B_4E97_A0D8_1B7E64C92F35